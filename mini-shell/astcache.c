@@ -0,0 +1,535 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shell.h"
+
+#define CACHE_MAGIC "MSHAST2"   // raised when the same text parses differently
+
+// File layout: header, the script's real path (padded to 8 bytes), units,
+// nodes, text. Every position is a count or an offset, never a pointer,
+// so the file works wherever it is mapped.
+struct cache_header {
+    char magic[8];
+    uint32_t node_size;     // sizeof(struct node): another layout is not read
+    uint32_t nunits;
+    uint64_t src_size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t src_hash;
+    uint64_t parsed_end;    // source bytes the units cover
+    uint64_t nnodes;
+    uint64_t text_len;
+    uint32_t path_len;
+    uint32_t pad;
+};
+
+// One parsed command: its tree is nodes[node_start, + nnodes) with word
+// offsets relative to text + text_start, exactly as ast_parse() built it
+struct cache_unit {
+    uint32_t node_start;
+    uint32_t nnodes;
+    uint32_t text_start;
+    uint32_t text_len;
+};
+
+enum cache_state {
+    CACHE_OFF,
+    CACHE_RECORD,       // parsing the script, saving each command
+    CACHE_REPLAY        // running the commands of a valid cache file
+};
+
+static enum cache_state state = CACHE_OFF;
+static pid_t owner;             // forked copies of the shell never write
+static int frozen = 0;          // a parse error: nothing after it is saved
+static char *cache_path = NULL;
+static char *script_path = NULL;    // realpath() of the script
+static struct stat script_st;
+static uint64_t script_hash;
+
+// CACHE_RECORD: the commands parsed so far
+static struct cache_unit *units = NULL;
+static size_t nunits = 0;
+static size_t units_cap = 0;
+static struct node *nodes = NULL;
+static size_t nnodes = 0;
+static size_t nodes_cap = 0;
+static char *text = NULL;
+static size_t text_len = 0;
+static size_t text_cap = 0;
+static size_t parsed_end = 0;
+
+// CACHE_REPLAY: the mapped file and the next unit to hand out
+static char *map = NULL;
+static size_t map_len = 0;
+static const struct cache_header *hdr;
+static const struct cache_unit *map_units;
+static struct node *map_nodes;
+static char *map_text;
+static size_t next_unit = 0;
+
+static uint64_t hash_bytes(const char *s, size_t len) {
+    uint64_t h = 0x9e3779b97f4a7c15u ^ len;
+    uint64_t w;
+    size_t i = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        memcpy(&w, s + i, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdu;
+        h ^= h >> 32;
+    }
+    w = 0;
+    memcpy(&w, s + i, len - i);
+    h = (h ^ w) * 0xc4ceb9fe1a85ec53u;
+    return h ^ (h >> 29);
+}
+
+static size_t pad8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+// $MINI_SHELL_AST_CACHE, or $XDG_CACHE_HOME/mini-shell, or
+// ~/.cache/mini-shell; NULL if caching is turned off
+static char *cache_dir(void) {
+    const char *dir = getenv("MINI_SHELL_AST_CACHE");
+    const char *base = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    char *path = NULL;
+
+    if (dir) return *dir && strcmp(dir, "off") != 0 ? strdup(dir) : NULL;
+    if (base && *base) {
+        if (asprintf(&path, "%s/mini-shell", base) < 0) return NULL;
+    } else if (home && *home) {
+        if (asprintf(&path, "%s/.cache/mini-shell", home) < 0) return NULL;
+        // ~/.cache may not exist yet
+        *strrchr(path, '/') = '\0';
+        mkdir(path, 0700);
+        path[strlen(path)] = '/';
+    } else {
+        return NULL;
+    }
+    mkdir(path, 0700);
+    return path;
+}
+
+#define TYPE(t) (1u << (t))
+#define COMPOUND (TYPE(NODE_IF) | TYPE(NODE_WHILE) | TYPE(NODE_FOR) | TYPE(NODE_GROUP))
+
+// The node types the evaluator expects among the children of each type
+static const unsigned child_types[] = {
+    [NODE_LIST] = TYPE(NODE_AND_OR),
+    [NODE_AND_OR] = TYPE(NODE_PIPELINE),
+    [NODE_PIPELINE] = TYPE(NODE_CMD) | COMPOUND | TYPE(NODE_FUNCDEF),
+    [NODE_CMD] = TYPE(NODE_WORD) | TYPE(NODE_REDIR),
+    [NODE_WORD] = 0,
+    [NODE_REDIR] = TYPE(NODE_WORD),
+    [NODE_IF] = TYPE(NODE_LIST) | TYPE(NODE_REDIR),
+    [NODE_WHILE] = TYPE(NODE_LIST) | TYPE(NODE_REDIR),
+    [NODE_FOR] = TYPE(NODE_WORD) | TYPE(NODE_LIST) | TYPE(NODE_REDIR),
+    [NODE_GROUP] = TYPE(NODE_LIST) | TYPE(NODE_REDIR),
+    [NODE_FUNCDEF] = TYPE(NODE_WORD) | COMPOUND,
+};
+
+// The evaluator scans a word up to its '\0', a marker up to CTL_END, and
+// skips the byte after CTL_ESC, none of them checking for the end of the
+// word: every marker must be closed inside it
+static int word_valid(const char *s, uint32_t len) {
+    if (s[len] != '\0') return 0;
+    for (uint32_t i = 0; i < len; i++) {
+        char c = s[i];
+        if (c == CTL_ESC) {
+            if (++i >= len) return 0;
+        } else if (c == CTL_VAR || c == CTL_QVAR) {
+            while (++i < len && s[i] != CTL_END) {
+            }
+            if (i >= len) return 0;
+        } else if (c == CTL_SUBST || c == CTL_QSUBST) {
+            while (++i < len && s[i] != CTL_END) {
+                if (s[i] == CTL_ESC) i++;
+            }
+            if (i >= len) return 0;
+        }
+    }
+    return 1;
+}
+
+// Checks one command's tree (n, count nodes) the way the evaluator walks
+// it. Every link must point further into the array, as the parser creates
+// a parent before its children and children in order, so the links can
+// form no loop; every node has at most one parent (owner[] holds the
+// stamp of the unit that claimed it), so checking all chains reads each
+// node once. len must match the chain, children must have the types their
+// parent's code expects, and words must end inside the unit's text.
+static int unit_valid(const struct node *n, uint32_t count, const char *text,
+                      uint32_t text_len, uint32_t *owner, uint32_t stamp) {
+    if (n[0].type != NODE_LIST) return 0;
+    for (uint32_t k = 0; k < count; k++) {
+        const struct node *node = &n[k];
+        if (node->type > NODE_FUNCDEF) return 0;
+        if (node->type == NODE_WORD) {
+            if (node->first > text_len || node->len >= text_len - node->first ||
+                !word_valid(text + node->first, node->len)) {
+                return 0;
+            }
+            continue;
+        }
+
+        // a redirection's len is unused: first is its one target word
+        uint32_t expect = node->type == NODE_REDIR ? 1 : node->len;
+        uint32_t children = 0, prev = k;
+        uint8_t types[2] = {NODE_WORD, NODE_WORD};  // of the first two children
+        int lists = 0;
+        for (uint32_t c = node->first; c; c = n[c].next) {
+            if (c <= prev || c >= count || owner[c] == stamp || children == expect ||
+                n[c].type > NODE_FUNCDEF || !(child_types[node->type] & TYPE(n[c].type))) {
+                return 0;
+            }
+            owner[c] = stamp;
+            if (children < 2) types[children] = n[c].type;
+            lists += n[c].type == NODE_LIST;
+            children++;
+            prev = c;
+        }
+        if (children != expect) return 0;
+
+        // the children a compound command's code reads without checking
+        int ok = 1;
+        switch (node->type) {
+        case NODE_REDIR:
+            ok = node->flags <= REDIR_STRING && node->fd <= REDIR_MAX_FD;
+            break;
+        case NODE_IF:
+        case NODE_GROUP:
+            ok = children >= 1 && types[0] == NODE_LIST;
+            break;
+        case NODE_WHILE:
+            ok = children >= 2 && types[0] == NODE_LIST && types[1] == NODE_LIST;
+            break;
+        case NODE_FOR:
+            ok = children >= 2 && types[0] == NODE_WORD && lists > 0;
+            break;
+        case NODE_FUNCDEF:
+            ok = children == 2 && types[0] == NODE_WORD && types[1] != NODE_WORD;
+            break;
+        default:
+            break;
+        }
+        if (!ok) return 0;
+    }
+    return 1;
+}
+
+// The cache is trusted only if it was written for this very script text
+static int cache_valid(void) {
+    if (map_len < sizeof(*hdr)) return 0;
+    hdr = (const struct cache_header *)map;
+    if (memcmp(hdr->magic, CACHE_MAGIC, sizeof(hdr->magic)) != 0 ||
+        hdr->node_size != sizeof(struct node) ||
+        hdr->src_size != (uint64_t)script_st.st_size ||
+        hdr->mtime_sec != (int64_t)script_st.st_mtim.tv_sec ||
+        hdr->mtime_nsec != (int64_t)script_st.st_mtim.tv_nsec ||
+        hdr->src_hash != script_hash || hdr->parsed_end > hdr->src_size ||
+        hdr->path_len != strlen(script_path)) {
+        return 0;
+    }
+
+    size_t off = sizeof(*hdr);
+    if (map_len - off < hdr->path_len ||
+        memcmp(map + off, script_path, hdr->path_len) != 0) {
+        return 0;
+    }
+    off += pad8(hdr->path_len);
+    if (hdr->nnodes > UINT32_MAX || hdr->text_len > UINT32_MAX) return 0;
+    size_t need = off + hdr->nunits * sizeof(struct cache_unit) +
+                  hdr->nnodes * sizeof(struct node) + hdr->text_len;
+    if (need != map_len) return 0;
+
+    map_units = (const struct cache_unit *)(map + off);
+    map_nodes = (struct node *)(map_units + hdr->nunits);
+    map_text = (char *)(map_nodes + hdr->nnodes);
+
+    // a damaged file must not send the evaluator outside the arrays
+    uint32_t *owner = calloc(hdr->nnodes ? hdr->nnodes : 1, sizeof(*owner));
+    if (!owner) return 0;
+    int valid = 1;
+    for (size_t u = 0; u < hdr->nunits && valid; u++) {
+        const struct cache_unit *unit = &map_units[u];
+        if (unit->nnodes == 0 || unit->nnodes > hdr->nnodes ||
+            unit->node_start > hdr->nnodes - unit->nnodes ||
+            unit->text_len > hdr->text_len ||
+            unit->text_start > hdr->text_len - unit->text_len) {
+            valid = 0;
+        } else {
+            valid = unit_valid(map_nodes + unit->node_start, unit->nnodes,
+                               map_text + unit->text_start, unit->text_len,
+                               owner + unit->node_start, (uint32_t)u + 1);
+        }
+    }
+    free(owner);
+    return valid;
+}
+
+int ast_cache_open(const char *path, const char *src, size_t len) {
+    char *dir = cache_dir();
+    int fd = -1;
+
+    if (!dir) return 0;
+    script_path = realpath(path, NULL);
+    if (!script_path || stat(script_path, &script_st) != 0 ||
+        (size_t)script_st.st_size != len ||
+        asprintf(&cache_path, "%s/%016llx.ast", dir,
+                 (unsigned long long)hash_bytes(script_path, strlen(script_path))) < 0) {
+        cache_path = NULL;
+        free(dir);
+        return 0;
+    }
+    free(dir);
+    owner = getpid();
+    script_hash = hash_bytes(src, len);
+    state = CACHE_RECORD;
+
+    struct stat st;
+    fd = open(cache_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        map_len = (size_t)st.st_size;
+        // private and writable, like the script mapping (input.c): the
+        // evaluator may terminate strings in place
+        map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) map = NULL;
+    }
+    close(fd);
+    if (map && cache_valid()) {
+        state = CACHE_REPLAY;
+        next_unit = 0;
+        return 1;
+    }
+    if (map) munmap(map, map_len);
+    map = NULL;
+    return 0;
+}
+
+int ast_cache_next(struct ast *view, size_t *resume) {
+    if (state != CACHE_REPLAY) return 0;
+    if (next_unit == hdr->nunits) {
+        // the rest of the script (after an exit, or a syntax error) was
+        // never parsed by the run that wrote the cache
+        *resume = hdr->parsed_end;
+        state = CACHE_OFF;
+        return 0;
+    }
+    const struct cache_unit *unit = &map_units[next_unit++];
+    view->nodes = map_nodes + unit->node_start;
+    view->nnodes = view->nodes_cap = unit->nnodes;
+    view->text = map_text + unit->text_start;
+    view->text_len = view->text_cap = unit->text_len;
+    return 1;
+}
+
+static int grow(void **buf, size_t *cap, size_t need, size_t size) {
+    if (need <= *cap) return 0;
+    size_t new_cap = *cap ? *cap : 1024;
+    while (new_cap < need) new_cap *= 2;
+    void *grown = realloc(*buf, new_cap * size);
+    if (!grown) return -1;
+    *buf = grown;
+    *cap = new_cap;
+    return 0;
+}
+
+void ast_cache_add(const struct ast *ast, size_t end) {
+    if (state != CACHE_RECORD || frozen) return;
+
+    if (nnodes + ast->nnodes > UINT32_MAX || text_len + ast->text_len > UINT32_MAX ||
+        grow((void **)&units, &units_cap, nunits + 1, sizeof(*units)) != 0 ||
+        grow((void **)&nodes, &nodes_cap, nnodes + ast->nnodes, sizeof(*nodes)) != 0 ||
+        grow((void **)&text, &text_cap, text_len + ast->text_len, 1) != 0) {
+        frozen = 1;
+        return;
+    }
+    struct cache_unit *unit = &units[nunits++];
+    unit->node_start = (uint32_t)nnodes;
+    unit->nnodes = ast->nnodes;
+    unit->text_start = (uint32_t)text_len;
+    unit->text_len = ast->text_len;
+    memcpy(nodes + nnodes, ast->nodes, ast->nnodes * sizeof(*nodes));
+    memcpy(text + text_len, ast->text, ast->text_len);
+    nnodes += ast->nnodes;
+    text_len += ast->text_len;
+    parsed_end = end;
+}
+
+void ast_cache_stop(void) {
+    frozen = 1;
+}
+
+static int write_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Writes the recorded commands to a temporary file and renames it over the
+// cache, so a reader never sees half a file
+static void cache_write(void) {
+    struct cache_header h;
+    struct stat st;
+    static const char zeros[8] = {0};
+    char *tmp = NULL;
+
+    // the script changed while it ran: what was parsed may not match the hash
+    if (stat(script_path, &st) != 0 || st.st_size != script_st.st_size ||
+        st.st_mtim.tv_sec != script_st.st_mtim.tv_sec ||
+        st.st_mtim.tv_nsec != script_st.st_mtim.tv_nsec) {
+        return;
+    }
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CACHE_MAGIC, sizeof(h.magic));
+    h.node_size = sizeof(struct node);
+    h.nunits = (uint32_t)nunits;
+    h.src_size = (uint64_t)script_st.st_size;
+    h.mtime_sec = (int64_t)script_st.st_mtim.tv_sec;
+    h.mtime_nsec = (int64_t)script_st.st_mtim.tv_nsec;
+    h.src_hash = script_hash;
+    h.parsed_end = parsed_end;
+    h.nnodes = nnodes;
+    h.text_len = text_len;
+    h.path_len = (uint32_t)strlen(script_path);
+
+    if (asprintf(&tmp, "%s.%d.tmp", cache_path, (int)getpid()) < 0) return;
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        free(tmp);
+        return;
+    }
+    int failed = write_all(fd, &h, sizeof(h)) != 0 ||
+                 write_all(fd, script_path, h.path_len) != 0 ||
+                 write_all(fd, zeros, pad8(h.path_len) - h.path_len) != 0 ||
+                 write_all(fd, units, nunits * sizeof(*units)) != 0 ||
+                 write_all(fd, nodes, nnodes * sizeof(*nodes)) != 0 ||
+                 write_all(fd, text, text_len) != 0;
+    if (close(fd) != 0) failed = 1;
+    if (failed || rename(tmp, cache_path) != 0) unlink(tmp);
+    free(tmp);
+}
+
+void ast_cache_close(void) {
+    if (state == CACHE_OFF && !cache_path) return;
+    if (getpid() != owner) return;
+
+    if (state == CACHE_RECORD && nunits > 0) cache_write();
+    if (map) munmap(map, map_len);
+    map = NULL;
+    free(units);
+    free(nodes);
+    free(text);
+    units = NULL;
+    nodes = NULL;
+    text = NULL;
+    nunits = nnodes = text_len = 0;
+    free(cache_path);
+    free(script_path);
+    cache_path = script_path = NULL;
+    state = CACHE_OFF;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+AST CACHE MODULE EXPLANATION:
+Running a script parses every line again on every run. For a script that
+runs often and changes rarely, the parse results can be kept instead:
+    mini-shell build.sh     first run: parse each command, run it, and
+                            save the trees in ~/.cache/mini-shell/
+    mini-shell build.sh     later runs: map the saved trees and run them,
+                            without lexing or parsing a single line
+
+WHY THE TREE CAN BE SAVED AS IT IS:
+The parser (parser.c) builds each command into two flat arrays, nodes and
+text, and nodes refer to each other and to their words by index, never by
+pointer. Copying the arrays byte for byte into a file therefore gives a
+tree that works at whatever address the file is mapped: ast_cache_next()
+only sets nodes and text of a struct ast to point into the mapping, and
+eval_ast() runs it like a freshly parsed line. Nothing is decoded or
+copied on a warm run.
+
+FILE FORMAT (<cache dir>/<hash of the script's real path>.ast):
+    struct cache_header     magic "MSHAST2", sizes, the key below
+    script path             padded to a multiple of 8 bytes
+    struct cache_unit[]     per command: where its nodes and text are
+    struct node[]           all commands' nodes, one after another
+    char text[]             all commands' word text
+The cache directory is $MINI_SHELL_AST_CACHE if set ("off" or an empty
+value turns caching off), else $XDG_CACHE_HOME/mini-shell, else
+~/.cache/mini-shell.
+
+WHEN A CACHE IS USED:
+A cache file belongs to one script text. It is used only if all of these
+match what was saved:
+- the script's real path (realpath(), stored in the file): the file name
+  is only a hash of it, and two paths could share a hash
+- its size and mtime (nanoseconds): cheap checks that fail first when the
+  script was edited
+- a 64-bit hash of its whole content: catches an edit that kept the size
+  and happened within the mtime's resolution, or a copied mtime
+- sizeof(struct node): a shell built with a different node layout writes
+  its own cache instead of misreading this one
+- the magic: its number goes up whenever the parser turns the same text
+  into a different tree (e.g. "$?" was plain text before version 2)
+Then each command's tree is walked once (unit_valid()) and checked the
+way the evaluator will use it, so a damaged cache file is rejected
+instead of crashing the evaluator:
+- links only point forward inside the command's own nodes (the parser
+  creates parents before children), so they cannot form a loop, and no
+  node is the child of two parents
+- each node's len matches its chain of children, and the children have
+  the types the code for their parent expects (a while has two lists, a
+  redirection one word with a descriptor the shell handles, ...)
+- every word ends with '\0' inside the command's text, and its CTL_*
+  markers are closed before that
+Hashing reads the script once (a few GB per second); that is what every
+warm run still pays, against lexing and parsing every line.
+
+RECORDING:
+Commands are saved as the normal run parses them (ast_cache_add() after
+each successful ast_parse()), so the first run costs one memcpy() per
+command. The file is written when the shell exits, also through the
+"exit" builtin (main.c registers ast_cache_close() with atexit()). It is
+first written to "<name>.<pid>.tmp" and then renamed over the cache:
+rename() replaces the file in one step, so a shell starting at the same
+moment sees the old file or the new one, never half of one.
+
+Only what the run actually parsed is saved: a script that ends with
+"exit" halfway, or has a syntax error (ast_cache_stop()), is cached up to
+that point. parsed_end in the header remembers where that was; a warm run
+that gets past the last saved command continues by reading and parsing
+the script from there (reader_seek(), input.c), and prints the same
+syntax error at the same moment as an uncached run. Forked copies of the
+shell (a "$(...)" or a background subshell) inherit the atexit handler
+but check owner and never write.
+
+If the script is changed while it runs, the size or mtime at exit
+differ from the ones hashed at the start and nothing is written.
+
+EXTERNAL FUNCTIONS USED:
+- realpath(path, NULL): absolute path without "." ".." or symbolic links
+- mmap(MAP_PRIVATE, PROT_READ | PROT_WRITE): maps the cache; a private
+  mapping is copy-on-write, so the file itself never changes
+- rename(old, new): atomically replaces new with old
+- asprintf(&s, fmt, ...): sprintf() into a newly malloc()ed string
+*/
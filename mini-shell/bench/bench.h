@@ -0,0 +1,57 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Helpers shared by the benchmarks in bench/. Each benchmark prints a table
+// for people; with BENCH_JSON=file set it also appends every number it
+// measures to that file as one JSON object per line (see the Makefile).
+
+static inline double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Appends {"version", "bench", "case", "metric", "value"} to $BENCH_JSON.
+// The names are written as they are, so they must not contain '"' or '\'.
+static inline void bench_record(const char *bench, const char *name,
+                                const char *metric, double value) {
+    const char *path = getenv("BENCH_JSON");
+    const char *version = getenv("BENCH_VERSION");
+    if (!path || !*path) return;
+
+    FILE *out = fopen(path, "a");
+    if (!out) {
+        perror(path);
+        return;
+    }
+    fprintf(out, "{\"version\": \"%s\", \"bench\": \"%s\", \"case\": \"%s\", "
+            "\"metric\": \"%s\", \"value\": %.6g}\n",
+            version ? version : "", bench, name, metric, value);
+    fclose(out);
+}
+
+#endif
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+BENCHMARK HELPERS EXPLANATION:
+- bench_now(): seconds from CLOCK_MONOTONIC, a clock that never jumps
+  backwards, so the difference of two calls is a duration
+- bench_record(): writes one result line such as
+      {"version": "2fa20e6", "bench": "parse", "case": "reused",
+       "metric": "lines_per_sec", "value": 3.67e+06}
+  (on one line in the file). BENCH_VERSION names the build the numbers
+  belong to; "make bench" sets it from git.
+
+Every line stands on its own ("JSON Lines"), so results from several
+benchmarks and runs can be appended to one file, read with jq, or compared
+line by line with bench/bench_compare.sh. The file is opened and closed per
+record: results are written once per table row, never inside a timed loop.
+*/
@@ -0,0 +1,52 @@
+#!/bin/sh
+# Compares two benchmark result files written by "make bench".
+# Usage: bench/bench_compare.sh old.jsonl new.jsonl
+#
+# Prints every metric found in both files with its old and new value and the
+# change in percent. Rates (*_per_sec) are better when higher, times (*_us,
+# *_ms, ns_*) and allocation counts when lower; a change of more than
+# THRESHOLD percent (default 10) in the wrong direction is marked "REGRESSION"
+# and makes the script exit with status 1.
+
+if [ $# -ne 2 ]; then
+    echo "usage: $0 old.jsonl new.jsonl" >&2
+    exit 2
+fi
+
+awk -v threshold="${THRESHOLD:-10}" '
+    # the files are written by bench_record() and the bench scripts, one flat
+    # object per line, so the fields can be picked out with match()
+    function field(name,    s) {
+        if (!match($0, "\"" name "\": \"[^\"]*\"")) return ""
+        s = substr($0, RSTART, RLENGTH)
+        sub("^\"" name "\": \"", "", s)
+        return substr(s, 1, length(s) - 1)
+    }
+    function value(    s) {
+        match($0, "\"value\": [-+0-9.eE]+")
+        s = substr($0, RSTART, RLENGTH)
+        sub("^\"value\": ", "", s)
+        return s + 0
+    }
+    {
+        key = field("bench") " " field("case") " " field("metric")
+        if (FILENAME == ARGV[1]) {
+            old[key] = value()
+        } else if (key in old) {
+            keys[++n] = key
+            new[key] = value()
+        }
+    }
+    END {
+        printf "%-44s %14s %14s %9s\n", "benchmark", "old", "new", "change"
+        for (i = 1; i <= n; i++) {
+            k = keys[i]
+            change = old[k] != 0 ? (new[k] - old[k]) * 100 / old[k] : 0
+            worse = k ~ /_per_sec$/ ? -change : change
+            mark = worse > threshold ? "  REGRESSION" : ""
+            if (mark != "") status = 1
+            printf "%-44s %14.6g %14.6g %+8.1f%%%s\n", k, old[k], new[k], change, mark
+        }
+        exit status
+    }
+' "$1" "$2"
@@ -0,0 +1,162 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "../shell.h"
+
+// Build: make build/bench_complete
+// Usage: ./bench_complete [max_programs] [rounds]
+
+static const char *prefixes[] = {"prog01234", "prog012", "zz"};
+#define NPREFIXES (sizeof(prefixes) / sizeof(prefixes[0]))
+
+// Fills dir with n executable files named prog<N>
+static void make_dir(const char *dir, long n) {
+    char path[512];
+
+    for (long i = 0; i < n; i++) {
+        snprintf(path, sizeof(path), "%s/prog%06ld", dir, i);
+        int fd = open(path, O_CREAT | O_WRONLY, 0755);
+        if (fd < 0) {
+            perror(path);
+            exit(1);
+        }
+        close(fd);
+    }
+}
+
+static void remove_dir(const char *dir, long n) {
+    char path[512];
+
+    for (long i = 0; i < n; i++) {
+        snprintf(path, sizeof(path), "%s/prog%06ld", dir, i);
+        unlink(path);
+    }
+    rmdir(dir);
+}
+
+// What completion would cost without the index: read the directory and
+// check every matching name on each Tab
+static long scan_complete(const char *dir, const char *prefix) {
+    size_t len = strlen(prefix);
+    struct stat st;
+    long found = 0;
+
+    DIR *d = opendir(dir);
+    if (!d) return 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        if (strncmp(e->d_name, prefix, len) != 0) continue;
+        if (fstatat(dirfd(d), e->d_name, &st, 0) == 0 && S_ISREG(st.st_mode) &&
+            (st.st_mode & 0111)) {
+            found++;
+        }
+    }
+    closedir(d);
+    return found;
+}
+
+static void run(const char *base, long n, int rounds) {
+    struct arg_vec out = {NULL, 0, 0};
+    char dir[256];
+
+    snprintf(dir, sizeof(dir), "%s/%ld", base, n);
+    if (mkdir(dir, 0755) != 0) {
+        perror(dir);
+        exit(1);
+    }
+    make_dir(dir, n);
+    var_set("PATH", dir);
+
+    // the index is built in steps of 256 entries, as the line editor does
+    // while it waits for a key; the longest step is how long a key can wait
+    double step_max = 0;
+    double t0 = bench_now();
+    complete_index_check();
+    while (complete_index_pending()) {
+        double s = bench_now();
+        complete_index_work(256);
+        double took = bench_now() - s;
+        if (took > step_max) step_max = took;
+    }
+    double build_ms = (bench_now() - t0) * 1e3;
+
+    long matches = 0;
+    t0 = bench_now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t p = 0; p < NPREFIXES; p++) {
+            out.len = 0;
+            matches += complete_commands(prefixes[p], &out);
+        }
+    }
+    double lookup_us = (bench_now() - t0) * 1e6 / ((double)rounds * NPREFIXES);
+
+    t0 = bench_now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t p = 0; p < NPREFIXES; p++) matches -= scan_complete(dir, prefixes[p]);
+    }
+    double scan_us = (bench_now() - t0) * 1e6 / ((double)rounds * NPREFIXES);
+
+    printf("%10ld %10.2f %10.1f %10.2f %12.1f %s\n", n, build_ms, step_max * 1e6, lookup_us,
+           scan_us, matches == 0 ? "" : "(results differ)");
+
+    char name[32];
+    snprintf(name, sizeof(name), "%ld", n);
+    bench_record("complete", name, "build_ms", build_ms);
+    bench_record("complete", name, "step_max_us", step_max * 1e6);
+    bench_record("complete", name, "lookup_us", lookup_us);
+    bench_record("complete", name, "scan_us", scan_us);
+    remove_dir(dir, n);
+    arg_vec_free(&out);
+}
+
+int main(int argc, char **argv) {
+    long max_programs = argc > 1 ? atol(argv[1]) : 100000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    char base[] = "/tmp/bench_complete_XXXXXX";
+
+    if (!mkdtemp(base)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    printf("%10s %10s %10s %10s %12s\n", "programs", "build_ms", "step_us", "lookup_us",
+           "scan_us");
+    for (long n = 1000; n <= max_programs; n *= 10) {
+        run(base, n, rounds);
+    }
+    rmdir(base);
+    return 0;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+COMPLETION BENCHMARK EXPLANATION:
+Measures Tab completion of command names (complete.c) against the number
+of programs in PATH, from 1000 up to max_programs (default 100000), ten
+times more per step. PATH is set to one directory of empty executable
+files prog000000, prog000001, ...
+
+Three prefixes are looked up each round: one that matches a single name
+("prog01234"), one that matches a hundred ("prog012") and one that
+matches nothing ("zz"). Builtins are part of every lookup, as they are in
+the shell.
+
+OUTPUT COLUMNS:
+- build_ms: time to build the index, in the steps of 256 directory
+  entries the line editor takes while the prompt is idle
+- step_us: the longest single step; a key pressed during the build waits
+  at most this long
+- lookup_us: average complete_commands() call on the finished index
+- scan_us: the same lookup done by reading the directory and checking the
+  matching names, as a completion without an index would on every Tab
+"(results differ)" is printed if the two methods found different numbers
+of programs.
+*/
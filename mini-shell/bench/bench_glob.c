@@ -0,0 +1,157 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "../shell.h"
+
+// Build: make build/bench_glob
+// Usage: ./bench_glob [max_files] [rounds]
+
+static const char *patterns[] = {"*.c", "file0012*", "*1?3*", "[a-f]*[0-4].txt"};
+#define NPATTERNS (sizeof(patterns) / sizeof(patterns[0]))
+
+// Fills dir with n files, one in ten a ".c" file, and moves the
+// directory's mtime a minute back: a listing of a directory that changed
+// just now is not trusted by the cache yet (glob.c, DIR_RACY_SEC)
+static void make_dir(const char *dir, long n) {
+    char path[512];
+
+    for (long i = 0; i < n; i++) {
+        snprintf(path, sizeof(path), i % 10 ? "%s/file%06ld.txt" : "%s/src%06ld.c", dir, i);
+        int fd = open(path, O_CREAT | O_WRONLY, 0644);
+        if (fd < 0) {
+            perror(path);
+            exit(1);
+        }
+        close(fd);
+    }
+    struct timespec times[2];
+    clock_gettime(CLOCK_REALTIME, &times[0]);
+    times[0].tv_sec -= 60;
+    times[1] = times[0];
+    utimensat(AT_FDCWD, dir, times, 0);
+}
+
+static void remove_dir(const char *dir, long n) {
+    char path[512];
+
+    for (long i = 0; i < n; i++) {
+        snprintf(path, sizeof(path), i % 10 ? "%s/file%06ld.txt" : "%s/src%06ld.c", dir, i);
+        unlink(path);
+    }
+    rmdir(dir);
+}
+
+// Expands every pattern once; returns the number of matches
+static long glob_all(const char *dir, struct arg_vec *out) {
+    char pattern[512];
+    long matches = 0;
+
+    for (size_t p = 0; p < NPATTERNS; p++) {
+        snprintf(pattern, sizeof(pattern), "%s/%s", dir, patterns[p]);
+        out->len = 0;
+        expand_reset();
+        matches += glob_expand(pattern, out);
+    }
+    return matches;
+}
+
+// The same with glob(3) from the C library, which reads the directory
+// every time
+static long libc_glob_all(const char *dir) {
+    char pattern[512];
+    long matches = 0;
+
+    for (size_t p = 0; p < NPATTERNS; p++) {
+        glob_t g;
+        snprintf(pattern, sizeof(pattern), "%s/%s", dir, patterns[p]);
+        if (glob(pattern, 0, NULL, &g) == 0) matches += (long)g.gl_pathc;
+        globfree(&g);
+    }
+    return matches;
+}
+
+static void run(const char *base, long n, int rounds) {
+    struct arg_vec out = {NULL, 0, 0};
+    char dir[256];
+
+    snprintf(dir, sizeof(dir), "%s/%ld", base, n);
+    if (mkdir(dir, 0755) != 0) {
+        perror(dir);
+        exit(1);
+    }
+    make_dir(dir, n);
+
+    // cold: the first glob reads and sorts the directory
+    glob_cache_clear();
+    double t0 = bench_now();
+    long matches = glob_all(dir, &out);
+    double cold_ms = (bench_now() - t0) * 1e3 / NPATTERNS;
+
+    // cached: one stat() per glob, then matching only
+    t0 = bench_now();
+    for (int r = 0; r < rounds; r++) matches += glob_all(dir, &out);
+    double cached_us = (bench_now() - t0) * 1e6 / ((double)rounds * NPATTERNS);
+
+    t0 = bench_now();
+    for (int r = 0; r < rounds; r++) matches -= libc_glob_all(dir);
+    double libc_us = (bench_now() - t0) * 1e6 / ((double)rounds * NPATTERNS);
+
+    printf("%10ld %12.2f %12.1f %12.1f %8.1fx %s\n", n, cold_ms, cached_us, libc_us,
+           libc_us / cached_us, matches == glob_all(dir, &out) ? "" : "(results differ)");
+
+    char name[32];
+    snprintf(name, sizeof(name), "%ld", n);
+    bench_record("glob", name, "cold_ms", cold_ms);
+    bench_record("glob", name, "cached_us", cached_us);
+    bench_record("glob", name, "libc_us", libc_us);
+    remove_dir(dir, n);
+    arg_vec_free(&out);
+}
+
+int main(int argc, char **argv) {
+    long max_files = argc > 1 ? atol(argv[1]) : 100000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    char base[] = "/tmp/bench_glob_XXXXXX";
+
+    if (!mkdtemp(base)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    printf("%10s %12s %12s %12s %9s\n", "files", "cold_ms", "cached_us", "libc_us", "speedup");
+    for (long n = 1000; n <= max_files; n *= 10) {
+        run(base, n, rounds);
+    }
+    rmdir(base);
+    return 0;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+GLOB BENCHMARK EXPLANATION:
+Measures pathname expansion (glob.c) against the size of the directory,
+from 1000 files up to max_files (default 100000), ten times more per step.
+Each directory holds file<N>.txt names and, for one in ten, src<N>.c.
+Four patterns are expanded each round: a suffix ("*.c"), a prefix
+("file0012*"), a middle with '?' ("*1?3*") and brackets
+("[a-f]*[0-4].txt").
+
+OUTPUT COLUMNS:
+- cold_ms: average time of the first globs, which read and sort the
+  directory into the cache
+- cached_us: average later glob over the unchanged directory: one stat()
+  to validate the cached listing, then matching the names
+- libc_us: the same patterns with glob(3) from the C library, which reads
+  the directory on every call
+- speedup: libc_us / cached_us
+"(results differ)" is printed if the cache and glob(3) disagree on the
+number of matches.
+*/
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "../shell.h"
+
+// Build: make build/bench_history (or cc -O2 -o bench_history bench/bench_history.c history.c)
+// Usage: ./bench_history [max_entries] [queries]
+
+static const char *programs[] = {
+    "git status", "git commit -m", "make -j8", "ls -la", "cd src/",
+    "grep -rn TODO", "vim main.c", "ssh build-host-", "docker run --rm img:",
+    "kubectl get pods -n ns-",
+};
+
+// Writes a history file with n entries; about one in ten is a new text,
+// the rest repeat earlier commands, like a real shell history
+static void make_history(const char *path, long n) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    srand(42);
+    for (long i = 0; i < n; i++) {
+        int p = rand() % 10;
+        long arg = rand() % 10 == 0 ? i : rand() % (i / 10 + 1);
+        fprintf(f, "%s%ld\n", programs[p], arg);
+    }
+    fclose(f);
+}
+
+static void run(const char *path, long entries, int queries) {
+    const char *prefixes[] = {"git c", "make", "ssh build-host-1", "kubectl get pods -n ns-42"};
+    const char *words[] = {"TODO", "host-7", "img:9", "pods -n ns-12"};
+
+    make_history(path, entries);
+
+    // startup: what the shell pays before its first prompt
+    double t0 = bench_now();
+    history_open(path);
+    double open_us = (bench_now() - t0) * 1e6;
+
+    // the first search builds the line and prefix indexes
+    t0 = bench_now();
+    size_t hit = history_find_prefix("git s");
+    double first_prefix_ms = (bench_now() - t0) * 1e3;
+
+    t0 = bench_now();
+    for (int i = 0; i < queries; i++) hit += history_find_prefix(prefixes[i % 4]);
+    double prefix_us = (bench_now() - t0) * 1e6 / queries;
+
+    // the first substring search builds the suffix array
+    t0 = bench_now();
+    hit += history_find_substring("status", history_count() + 1);
+    double first_substring_ms = (bench_now() - t0) * 1e3;
+
+    t0 = bench_now();
+    for (int i = 0; i < queries; i++) {
+        hit += history_find_substring(words[i % 4], history_count() + 1);
+    }
+    double substring_us = (bench_now() - t0) * 1e6 / queries;
+
+    printf("%10ld %10.1f %12.1f %10.2f %14.1f %12.2f %s\n", entries, open_us,
+           first_prefix_ms, prefix_us, first_substring_ms, substring_us,
+           hit ? "" : "(no hits)");
+
+    char name[32];
+    snprintf(name, sizeof(name), "%ld", entries);
+    bench_record("history", name, "open_us", open_us);
+    bench_record("history", name, "first_prefix_ms", first_prefix_ms);
+    bench_record("history", name, "prefix_us", prefix_us);
+    bench_record("history", name, "first_substring_ms", first_substring_ms);
+    bench_record("history", name, "substring_us", substring_us);
+    history_close();
+    unlink(path);
+}
+
+int main(int argc, char **argv) {
+    long max_entries = argc > 1 ? atol(argv[1]) : 1000000;
+    int queries = argc > 2 ? atoi(argv[2]) : 1000;
+    char path[] = "/tmp/bench_history_XXXXXX";
+    int fd = mkstemp(path);
+
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    printf("%10s %10s %12s %10s %14s %12s\n", "entries", "open_us",
+           "1st_pref_ms", "prefix_us", "1st_substr_ms", "substr_us");
+    for (long n = 1000; n <= max_entries; n *= 10) {
+        run(path, n, queries);
+    }
+    return 0;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+HISTORY BENCHMARK EXPLANATION:
+Measures how the history subsystem (history.c) scales with the number of
+remembered commands, from 1000 entries up to max_entries (default one
+million), growing ten times per step. The history files are synthetic: ten
+kinds of commands with numeric arguments, about one in ten entries new.
+
+OUTPUT COLUMNS:
+- open_us: history_open(), the only history work done at shell startup.
+  It maps the file and should stay flat as the file grows.
+- 1st_pref_ms: the first "!prefix" search, which also splits the file into
+  lines and builds the sorted index of distinct commands
+- prefix_us: average later prefix search (binary search in that index)
+- 1st_substr_ms: the first substring search, which builds the suffix array
+- substr_us: average later substring search (what Ctrl-R does per key)
+*/
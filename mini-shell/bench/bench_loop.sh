@@ -0,0 +1,63 @@
+#!/bin/sh
+# Loop throughput benchmark: if, for and functions run by eval.c.
+# Usage: bench/bench_loop.sh ./mini-shell [iterations]
+#
+# Runs for loops of ITERATIONS rounds whose bodies only use assignments,
+# builtins (also chained with && and || on $?) and function calls, so
+# nothing is forked per round, and prints the rounds per second and
+# nanoseconds per round. The "unrolled" row runs
+# the body of "assign" as ITERATIONS separate script lines instead, for
+# comparison: every line is read and parsed, while a loop body is parsed
+# once. With BENCH_JSON set, the results are also appended to that file
+# (see bench/bench.h).
+
+SHELL_BIN=${1:-./mini-shell}
+ITERATIONS=${2:-1000000}
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+
+# writes a script that runs the loop body given as $2
+make_loop() {
+    printf '%s\n' "$3" > "$DIR/$1"
+    printf 'for i in $(seq %s); do\n    %s\ndone\n' "$ITERATIONS" "$2" >> "$DIR/$1"
+}
+
+run() {
+    start=$(date +%s.%N)
+    MINI_SHELL_AST_CACHE=off "$SHELL_BIN" "$DIR/$1" > /dev/null
+    end=$(date +%s.%N)
+    rate=$(echo "$start $end" | awk -v n="$ITERATIONS" '{ printf "%.0f", n / ($2 - $1) }')
+    ns=$(echo "$start $end" | awk -v n="$ITERATIONS" '{ printf "%.0f", ($2 - $1) * 1e9 / n }')
+    printf '%-10s %10s %12s %8s\n' "$1" "$ITERATIONS" "$rate" "$ns"
+    if [ -n "$BENCH_JSON" ]; then
+        printf '{"version": "%s", "bench": "loop", "case": "%s", "metric": "iterations_per_sec", "value": %s}\n' \
+            "$BENCH_VERSION" "$1" "$rate" >> "$BENCH_JSON"
+    fi
+}
+
+# an assignment per round: expansion of $i, variable store
+make_loop assign 'X=$i'
+
+# builtins dispatched in the shell, and a builtin as an if condition
+make_loop builtin 'if unset Y; then hash -r; fi' 'Y=1'
+
+# a short-circuit chain of builtins that branches on $?
+make_loop status 'false || [ $? = 1 ] && X=$? || exit 1'
+
+# a call of a function with one argument per round
+make_loop function 'f $i' 'f() { X=$1; }'
+
+# a loop inside a loop, with the same number of rounds in total
+awk -v n="$ITERATIONS" 'BEGIN { print "for i in $(seq " int(n / 4) "); do"
+    print "    for j in a b c d; do X=$i$j; done"; print "done" }' > "$DIR/nested"
+
+# the assign body written out once per round
+awk -v n="$ITERATIONS" 'BEGIN { print "i=1"; for (i = 1; i <= n; i++) print "X=$i" }' > "$DIR/unrolled"
+
+printf '%-10s %10s %12s %8s\n' "case" "rounds" "rounds/s" "ns"
+run assign
+run builtin
+run status
+run function
+run nested
+run unrolled
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "../shell.h"
+
+// Build: make build/bench_parse (or cc -O2 -o bench_parse bench/bench_parse.c parser.c)
+// Usage: ./bench_parse [iterations]
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static unsigned long malloc_calls = 0;
+static unsigned long free_calls = 0;
+
+// Count every allocation made by the process, including the ones strdup()
+// makes inside the C library
+void *malloc(size_t size) {
+    malloc_calls++;
+    return __libc_malloc(size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    malloc_calls++;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    if (ptr) free_calls++;
+    __libc_free(ptr);
+}
+
+#define LEGACY_MAX_ARGS 64
+
+// The original parse_line()/free_args(): one strdup() per token
+static char **legacy_parse_line(char *line) {
+    char **args = malloc(LEGACY_MAX_ARGS * sizeof(char *));
+    if(!args) return NULL;
+
+    int i = 0;
+    char *token = strtok(line, " ");
+
+    while (token != NULL && i < LEGACY_MAX_ARGS -1)
+    {
+        args[i++] = strdup(token);
+        token = strtok(NULL, " ");
+    }
+
+    args[i] = NULL;
+    return args;
+}
+
+static void legacy_free_args(char **args) {
+    for (int i = 0; args[i]; i++) {
+        free(args[i]);
+    }
+    free(args);
+}
+
+// The shell's parser: one tree kept across lines, as main() does
+static struct ast reused = {NULL, 0, 0, NULL, 0, 0};
+
+static int reused_parse(const char *input, size_t len) {
+    return ast_parse(&reused, input, len);
+}
+
+// A fresh tree per line, freed right after
+static int oneshot_parse(const char *input, size_t len) {
+    struct ast ast = {NULL, 0, 0, NULL, 0, 0};
+    int status = ast_parse(&ast, input, len);
+    ast_free(&ast);
+    return status;
+}
+
+// The legacy parser works in place, so it gets its own copy of the line
+static int legacy_parse(const char *input, size_t len) {
+    static char line[4096];
+    if (len >= sizeof(line)) return -1;
+    memcpy(line, input, len + 1);
+    legacy_free_args(legacy_parse_line(line));
+    return 0;
+}
+
+// Parses each of the n lines iterations times and prints one result row
+static void run(const char *bench, const char *name, const char **lines, int n,
+                int iterations, int (*parse)(const char *, size_t)) {
+    size_t bytes = 0;
+    size_t *lens = malloc((size_t)n * sizeof(*lens));
+    for (int i = 0; i < n; i++) {
+        lens[i] = strlen(lines[i]);
+        bytes += lens[i];
+    }
+
+    unsigned long allocs = malloc_calls;
+    unsigned long frees = free_calls;
+    int errors = 0;
+    double start = bench_now();
+
+    for (int it = 0; it < iterations; it++) {
+        for (int i = 0; i < n; i++) {
+            if (parse(lines[i], lens[i]) != PARSE_OK) errors++;
+        }
+    }
+
+    double elapsed = bench_now() - start;
+    long parsed = (long)iterations * n;
+    printf("%-8s %8zu %8.2f %8.2f %14.0f %s\n", name, bytes / n,
+           (double)(malloc_calls - allocs) / parsed,
+           (double)(free_calls - frees) / parsed, parsed / elapsed,
+           errors ? "(syntax errors)" : "");
+    bench_record(bench, name, "lines_per_sec", parsed / elapsed);
+    bench_record(bench, name, "allocs_per_line",
+                 (double)(malloc_calls - allocs) / parsed);
+    free(lens);
+}
+
+// Builds "cmd a0 a1 ... a<n-2>", a line with n arguments
+static char *make_line(int n) {
+    char *line = malloc((size_t)n * 12 + 8);
+    char *p = line + sprintf(line, "cmd");
+    for (int i = 1; i < n; i++) {
+        p += sprintf(p, " a%d", i);
+    }
+    return line;
+}
+
+int main(int argc, char **argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+    // what interactive use and scripts look like: plain commands, quoting,
+    // pipelines, lists and redirections
+    const char *mix[] = {
+        "gcc -O2 -Wall -Wextra -o mini-shell main.c parser.c executor.c",
+        "ls -la /usr/local/bin",
+        "git commit -m \"fix: handle 'quoted' words\" --amend",
+        "grep -rn 'TODO\\|FIXME' src | sort | uniq -c | sort -rn | head -20",
+        "make -j8 >build.log 2>&1 && ./run_tests || echo \"build failed\"",
+        "cd /tmp; tar xzf archive\\ name.tar.gz; ls",
+        "sleep 5 &",
+        "time find . -name '*.c' | xargs wc -l",
+    };
+    int nmix = sizeof(mix) / sizeof(mix[0]);
+
+    printf("%d-line mix of plain, quoted, piped and redirected commands\n", nmix);
+    printf("%-8s %8s %8s %8s %14s\n", "parser", "bytes", "allocs", "frees", "lines_per_sec");
+    // legacy splits at spaces only: its rows show the cost, not a parse
+    run("parse", "legacy", mix, nmix, iterations, legacy_parse);
+    run("parse", "oneshot", mix, nmix, iterations, oneshot_parse);
+    run("parse", "reused", mix, nmix, iterations, reused_parse);
+
+    // argument count sweep: the legacy parser stops at 63 arguments
+    int sizes[] = {4, 64, 1000, 10000, 100000};
+    printf("\nargument count sweep (reused tree)\n");
+    printf("%-8s %8s %8s %8s %14s\n", "args", "bytes", "allocs", "frees", "lines_per_sec");
+    for (int i = 0; i < 5; i++) {
+        char *line = make_line(sizes[i]);
+        const char *one[] = {line};
+        char name[16];
+        int reps = iterations * 8 / sizes[i] + 1;
+
+        snprintf(name, sizeof(name), "%d", sizes[i]);
+        run("parse_args", name, one, 1, reps, reused_parse);
+        free(line);
+    }
+    ast_free(&reused);
+    return 0;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+PARSE BENCHMARK EXPLANATION:
+Compares the number of heap allocations and the speed of three parsers on
+a mix of representative lines (quotes, escapes, pipes, &&, ||, ;, &, and
+redirections):
+- legacy: the original strtok() splitter that copied every token with
+  strdup(). It only splits at spaces, so it does far less work than a real
+  parse; it is kept as the baseline the shell started from
+- oneshot: ast_parse() into a new tree, then ast_free(), per line
+- reused: ast_parse() with one struct ast kept across lines, as main()
+  does; it allocates only when a line is bigger than any line before it
+A second table runs the reused parser on lines with 4 to 100000 arguments.
+
+HOW ALLOCATIONS ARE COUNTED:
+The benchmark defines its own malloc(), realloc() and free(). The linker uses
+them instead of the C library versions (this is called "interposition"), and
+they forward to glibc's __libc_malloc()/__libc_realloc()/__libc_free() after
+incrementing a counter.
+Calls made inside the C library, such as the malloc() inside strdup(), are
+counted too.
+
+OUTPUT COLUMNS:
+- bytes: average length of the input lines
+- allocs / frees: average number of malloc()+realloc() and free() calls
+  per parsed line (the length array allocated by run() itself is not
+  counted)
+- lines_per_sec: parse (+ free) operations per second
+*/
@@ -0,0 +1,30 @@
+#!/bin/sh
+# Pipeline throughput benchmark.
+# Usage: bench/bench_pipeline.sh ./mini-shell [gigabytes]
+#
+# Pushes GIGABYTES of zeros through multi-stage pipelines run by mini-shell
+# and prints the throughput of each one. The "tee" rows go through the
+# builtin tee, which moves the data with splice()/tee() inside the kernel.
+# With BENCH_JSON set, the results are also appended to that file.
+
+SHELL_BIN=${1:-./mini-shell}
+GB=${2:-4}
+BYTES=$((GB * 1024 * 1024 * 1024))
+
+run() {
+    start=$(date +%s.%N)
+    echo "$2" | "$SHELL_BIN" > /dev/null
+    end=$(date +%s.%N)
+    rate=$(echo "$start $end" | awk -v gb="$GB" '{ printf "%.2f", gb / ($2 - $1) }')
+    printf '%-28s %8s GB/s\n' "$1" "$rate"
+    if [ -n "$BENCH_JSON" ]; then
+        printf '{"version": "%s", "bench": "pipeline", "case": "%s", "metric": "gb_per_sec", "value": %s}\n' \
+            "$BENCH_VERSION" "$1" "$rate" >> "$BENCH_JSON"
+    fi
+}
+
+printf '%-28s %13s\n' "pipeline" "throughput"
+run "head|cat|wc" "head -c $BYTES /dev/zero | cat | wc -c"
+run "head|cat|cat|cat|wc" "head -c $BYTES /dev/zero | cat | cat | cat | wc -c"
+run "head|tee|wc" "head -c $BYTES /dev/zero | tee | wc -c"
+run "head|tee(file)|wc" "head -c $BYTES /dev/zero | tee /dev/null | wc -c"
@@ -0,0 +1,77 @@
+#!/bin/sh
+# End-to-end script benchmark.
+# Usage: bench/bench_script.sh ./mini-shell [lines]
+#
+# Generates scripts of LINES lines, runs each with mini-shell and prints the
+# lines per second: reading, parsing, dispatch and (for the rows that start
+# programs) launching, everything a script pays per line. With BENCH_JSON set,
+# the results are also appended to that file (see bench/bench.h).
+
+SHELL_BIN=${1:-./mini-shell}
+LINES=${2:-200000}
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+
+# writes LINES lines to $DIR/$1, repeating the lines given after it
+make_script() {
+    name=$1
+    shift
+    awk -v n="$LINES" 'BEGIN {
+        for (i = 1; i < ARGC; i++) lines[i - 1] = ARGV[i]
+        for (i = 0; i < n; i++) print lines[i % (ARGC - 1)]
+        exit
+    }' "$@" > "$DIR/$name"
+}
+
+run() {
+    start=$(date +%s.%N)
+    "$SHELL_BIN" "$DIR/$1" > /dev/null
+    end=$(date +%s.%N)
+    rate=$(echo "$start $end" | awk -v n="$2" '{ printf "%.0f", n / ($2 - $1) }')
+    printf '%-12s %10s %14s\n' "$1" "$2" "$rate"
+    if [ -n "$BENCH_JSON" ]; then
+        printf '{"version": "%s", "bench": "script", "case": "%s", "metric": "lines_per_sec", "value": %s}\n' \
+            "$BENCH_VERSION" "$1" "$rate" >> "$BENCH_JSON"
+    fi
+}
+
+# lines the shell runs by itself: parsing and builtin dispatch only
+make_script builtin \
+    'cd .' \
+    'cd "." && cd '"'"'.'"'"'' \
+    '# a comment line' \
+    'cd . || cd /' \
+    'cd .; cd .' \
+    'hash -r'
+
+# echo, test, printf, pwd and true are builtins: printing and testing
+# starts no process, and the output is written in large blocks
+make_script utilities \
+    'echo "line $HOME"' \
+    '[ -n "$HOME" ] && printf "%s %d\n" x 42' \
+    'test -d . || echo missing' \
+    'true' \
+    'pwd'
+
+# every line starts programs, so launching dominates ("true" alone would
+# be the builtin)
+LINES=$((LINES / 50))
+make_script external \
+    '/bin/true' \
+    '/bin/true | /bin/true' \
+    '/bin/true > /dev/null' \
+    '/bin/true && /bin/true'
+
+# command substitutions: captured output, split into fields; the last line
+# needs a forked shell instead of a plain launch
+make_script subst \
+    'X=$(true)' \
+    'cd $(printf .)' \
+    'hash $(printf "%s " true cat ls sh)' \
+    'X=$(cd . && true)'
+
+printf '%-12s %10s %14s\n' "script" "lines" "lines_per_sec"
+run builtin $((LINES * 50))
+run utilities $((LINES * 50))
+run external "$LINES"
+run subst "$LINES"
@@ -0,0 +1,44 @@
+#!/bin/sh
+# Script startup benchmark: the saved syntax trees of astcache.c.
+# Usage: bench/bench_startup.sh ./mini-shell [lines]
+#
+# Generates a script of LINES variable assignments, which are cheap to run,
+# so most of the time goes into reading and parsing, and runs it three ways:
+#   off   MINI_SHELL_AST_CACHE=off: every line is parsed, nothing saved
+#   cold  empty cache: every line is parsed, the trees are saved at exit
+#   warm  the trees of the cold run are mapped, nothing is parsed
+# With BENCH_JSON set, the results are also appended to that file (see
+# bench/bench.h).
+
+SHELL_BIN=${1:-./mini-shell}
+LINES=${2:-100000}
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+
+# assignments run in microseconds but have quotes, escapes and $-words
+# for the lexer to work through
+awk -v n="$LINES" 'BEGIN {
+    for (i = 0; i < n; i++) {
+        if (i % 3 == 0) print "X=" i " Y=\"two words\" Z='\''three'\''"
+        if (i % 3 == 1) print "A=${X}:$Y B=a\\ b C=\"$Z and $X\""
+        if (i % 3 == 2) print "E=\"a long quoted value\" F='\''single quoted'\'' G=plain\\ escaped"
+    }
+}' > "$DIR/script.sh"
+mkdir "$DIR/cache"
+
+run() {
+    start=$(date +%s.%N)
+    MINI_SHELL_AST_CACHE=$2 "$SHELL_BIN" "$DIR/script.sh" > /dev/null
+    end=$(date +%s.%N)
+    ms=$(echo "$start $end" | awk '{ printf "%.1f", ($2 - $1) * 1000 }')
+    printf '%-6s %10s %10s\n' "$1" "$LINES" "$ms"
+    if [ -n "$BENCH_JSON" ]; then
+        printf '{"version": "%s", "bench": "startup", "case": "%s", "metric": "ms", "value": %s}\n' \
+            "$BENCH_VERSION" "$1" "$ms" >> "$BENCH_JSON"
+    fi
+}
+
+printf '%-6s %10s %10s\n' "cache" "lines" "ms"
+run off off
+run cold "$DIR/cache"
+run warm "$DIR/cache"
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Tracing overhead benchmark: the same scripts with and without --trace.
+# Usage: bench/bench_trace.sh ./mini-shell [rounds]
+#
+# "builtins" is a loop of test and echo, two builtin spans per round and
+# nothing else, so the cost of recording and writing spans shows fully.
+# "programs" launches /bin/true, ROUNDS / 100 times: a spawn, an exec and
+# a wait span each. Prints the run time off and on, and the extra
+# nanoseconds per round. With BENCH_JSON set, the results are also
+# appended to that file (see bench/bench.h).
+
+SHELL_BIN=${1:-./mini-shell}
+ROUNDS=${2:-300000}
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+
+printf 'for i in $(seq %s); do\n    if [ $i -gt 0 ]; then echo "line $i"; fi\ndone\n' \
+    "$ROUNDS" > "$DIR/builtins"
+printf 'for i in $(seq %s); do\n    /bin/true\ndone\n' $((ROUNDS / 100)) > "$DIR/programs"
+
+# prints the run time of script $1 in seconds; more arguments go before it
+run_time() {
+    script=$1
+    shift
+    start=$(date +%s.%N)
+    MINI_SHELL_AST_CACHE=off "$SHELL_BIN" "$@" "$DIR/$script" > /dev/null
+    end=$(date +%s.%N)
+    echo "$start $end" | awk '{ printf "%.4f", $2 - $1 }'
+}
+
+run() {
+    n=$2
+    off=$(run_time "$1")
+    on=$(run_time "$1" --trace "$DIR/trace.json")
+    extra=$(echo "$off $on" | awk -v n="$n" '{ printf "%.0f", ($2 - $1) * 1e9 / n }')
+    printf '%-10s %10s %10s %10s %12s\n' "$1" "$n" "$off" "$on" "$extra"
+    if [ -n "$BENCH_JSON" ]; then
+        printf '{"version": "%s", "bench": "trace", "case": "%s", "metric": "overhead_ns", "value": %s}\n' \
+            "$BENCH_VERSION" "$1" "$extra" >> "$BENCH_JSON"
+    fi
+}
+
+printf '%-10s %10s %10s %10s %12s\n' "script" "rounds" "off_s" "on_s" "extra_ns"
+run builtins "$ROUNDS"
+run programs $((ROUNDS / 100))
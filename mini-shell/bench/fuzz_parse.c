@@ -0,0 +1,412 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include "bench.h"
+#include "../shell.h"
+
+// Build: make build/fuzz_parse
+// Usage: ./fuzz_parse [iterations] [seed]
+
+#define LINE_MAX_LEN 2048
+#define EVAL_LIMIT_US 100000    // a line's run is cut off after this long
+
+static FILE *report;    // the real stderr; fd 2 is /dev/null for the parser
+
+static uint64_t rng;
+
+static uint32_t rnd(uint32_t n) {
+    // xorshift64*
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return (uint32_t)((rng * 2685821657736338717ULL) >> 32) % n;
+}
+
+#define PICK(list) (list[rnd(sizeof(list) / sizeof(list[0]))])
+
+// Words only name builtins: PATH points at an empty directory while lines
+// run, so nothing else could be started anyway
+static const char *const words[] = {
+    "echo", "printf", "%s\\n", "true", "false", ":", "test", "[", "]", "=", "!=",
+    "-n", "-z", "!", "pwd", "f", "g", "x", "a", "'a b'", "\"$X\"", "\"a$X\"",
+    "\\$", "a\\ b", "''", "\"\"", "*", "?", "[ab]", "$X", "${X}", "$Y", "$1",
+    "$#", "$@", "\"$@\"", "$*", "$?", "$$", "$(echo a)", "$(true)", "$(f)",
+    "\"$(echo a b)\"", "x$(echo y)z", "$(X=1; echo $X)", "X=1", "X=", "Y=$X",
+    "X=$(false)", "unset", "X", "return", "break", "continue", "time", "timeout",
+    "0.05", "hash", "-r", "exit", "ulimit", "-n", "wait", "jobs",
+};
+
+static const char *const assigns[] = {"X=1", "X=", "Y=$X", "X=$(false)", "X='a b'"};
+
+static const char *const redir_ops[] = {">", ">>", "<", "2>", "<<<", ">&2 >"};
+
+// Everything else a line can hold, for the unstructured streams
+static const char *const operators[] = {
+    "|", "&&", "||", ";", "&", "\n", ">", ">>", "<", "2>&1", "3>&-", ">&2", "<<<",
+    "out", "{", "}", "(", ")", "()", "if", "then", "elif", "else", "fi", "while",
+    "until", "for", "in", "do", "done", "#",
+};
+
+static const char raw_bytes[] = " \t'\"\\$(){}|&;<>#\n\001\002\003\004\005\006az09=*?[]";
+
+struct line {
+    char text[LINE_MAX_LEN];
+    size_t len;
+};
+
+static void add(struct line *l, const char *s) {
+    size_t n = strlen(s);
+    if (l->len + n + 1 >= LINE_MAX_LEN) return;
+    memcpy(l->text + l->len, s, n);
+    l->len += n;
+    l->text[l->len] = '\0';
+}
+
+static void gen_list(struct line *l, int depth);
+
+static void gen_simple(struct line *l) {
+    if (rnd(4) == 0) {
+        add(l, PICK(assigns));
+        add(l, " ");
+    }
+    for (uint32_t n = rnd(5); n > 0; n--) {
+        add(l, PICK(words));
+        add(l, " ");
+    }
+    if (rnd(5) == 0) {
+        add(l, PICK(redir_ops));
+        add(l, rnd(2) ? " out " : " $X ");
+    }
+}
+
+static void gen_command(struct line *l, int depth) {
+    if (depth <= 0) {
+        gen_simple(l);
+        return;
+    }
+    switch (rnd(8)) {
+    case 0:
+        add(l, "if ");
+        gen_list(l, depth - 1);
+        add(l, "; then ");
+        gen_list(l, depth - 1);
+        if (rnd(2)) {
+            add(l, "; elif ");
+            gen_list(l, depth - 1);
+            add(l, "; then ");
+            gen_list(l, depth - 1);
+        }
+        if (rnd(2)) {
+            add(l, "; else ");
+            gen_list(l, depth - 1);
+        }
+        add(l, "; fi ");
+        break;
+    case 1:
+        add(l, rnd(2) ? "while false; do " : "until $X; do ");
+        gen_list(l, depth - 1);
+        add(l, "; done ");
+        break;
+    case 2:
+        add(l, rnd(2) ? "for i in a \"b c\" $X *; do " : "for i; do ");
+        gen_list(l, depth - 1);
+        add(l, "; done ");
+        break;
+    case 3:
+        add(l, "{ ");
+        gen_list(l, depth - 1);
+        add(l, "; } ");
+        break;
+    case 4:
+        add(l, rnd(2) ? "f() { " : "g() ");
+        if (l->text[l->len - 2] == ')') add(l, "{ ");
+        gen_list(l, depth - 1);
+        add(l, "; } ");
+        break;
+    default:
+        gen_simple(l);
+        break;
+    }
+    if (rnd(6) == 0) add(l, "> out ");
+}
+
+static void gen_list(struct line *l, int depth) {
+    static const char *const joins[] = {" | ", " && ", " || ", "; ", "\n", " & "};
+
+    gen_command(l, depth);
+    for (uint32_t n = rnd(4); n > 0; n--) {
+        add(l, PICK(joins));
+        gen_command(l, depth);
+    }
+}
+
+// A line: either shaped by the grammar (and then maybe damaged a little),
+// or a random stream of words, operators and bytes
+static void gen_line(struct line *l) {
+    l->len = 0;
+    l->text[0] = '\0';
+    if (rnd(2)) {
+        gen_list(l, (int)rnd(4));
+        for (uint32_t n = rnd(3); n > 0 && l->len > 0; n--) {
+            l->text[rnd((uint32_t)l->len)] = raw_bytes[rnd(sizeof(raw_bytes) - 1)];
+        }
+        return;
+    }
+    for (uint32_t n = 1 + rnd(24); n > 0; n--) {
+        switch (rnd(3)) {
+        case 0:
+            add(l, PICK(words));
+            break;
+        case 1:
+            add(l, PICK(operators));
+            break;
+        default: {
+            char byte[2] = {raw_bytes[rnd(sizeof(raw_bytes) - 1)], '\0'};
+            add(l, byte);
+            break;
+        }
+        }
+        if (rnd(3)) add(l, " ");
+    }
+}
+
+// What the evaluator relies on in a tree from ast_parse(): links point
+// forward inside the array, every node but the root is the child of
+// exactly one node, len counts the children, words end with '\0'
+static const char *tree_error(const struct ast *ast) {
+    static unsigned char *claimed = NULL;
+    static size_t claimed_cap = 0;
+
+    if (ast->nnodes == 0 || ast->nodes[0].type != NODE_LIST) return "root is not a list";
+    if (ast->nnodes > claimed_cap) {
+        free(claimed);
+        claimed = malloc(ast->nnodes);
+        if (!claimed) return "out of memory";
+        claimed_cap = ast->nnodes;
+    }
+    memset(claimed, 0, ast->nnodes);
+
+    for (uint32_t k = 0; k < ast->nnodes; k++) {
+        const struct node *n = &ast->nodes[k];
+        if (n->type > NODE_FUNCDEF) return "bad node type";
+        if (n->type == NODE_WORD) {
+            if (n->first >= ast->text_len || n->len >= ast->text_len - n->first ||
+                ast->text[n->first + n->len] != '\0') {
+                return "word outside the text";
+            }
+            continue;
+        }
+        uint32_t expect = n->type == NODE_REDIR ? 1 : n->len;
+        uint32_t count = 0;
+        for (uint32_t c = n->first, prev = k; c; prev = c, c = ast->nodes[c].next) {
+            if (c <= prev || c >= ast->nnodes) return "link does not point forward";
+            if (claimed[c]++) return "node with two parents";
+            if (++count > expect) return "more children than len";
+        }
+        if (count != expect) return "fewer children than len";
+    }
+    for (uint32_t k = 1; k < ast->nnodes; k++) {
+        if (!claimed[k]) return "unreachable node";
+    }
+    return NULL;
+}
+
+// Runs the tree in a child, like the shell would, and returns its wait
+// status. The child is a process group of its own so that everything it
+// started can be killed afterwards.
+static int eval_child(const struct ast *ast) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(report, "fork: %s\n", strerror(errno));
+        exit(2);
+    }
+    if (pid == 0) {
+        setpgid(0, 0);
+        int null_fd = open("/dev/null", O_RDWR);
+        dup2(null_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        struct itimerval limit = {{0, 0}, {0, EVAL_LIMIT_US}};
+        setitimer(ITIMER_REAL, &limit, NULL);
+        jobs_init(0);
+        eval_ast(ast);
+        fflush(stdout);
+        _exit(0);
+    }
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+    }
+    kill(-pid, SIGKILL);    // background jobs and stages it left behind
+    return status;
+}
+
+static void print_escaped(FILE *out, const char *s, size_t len) {
+    fputc('"', out);
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+        else if (c == '\n') fputs("\\n", out);
+        else if (c < 0x20 || c >= 0x7f) fprintf(out, "\\%03o", c);
+        else fputc(c, out);
+    }
+    fputs("\"\n", out);
+}
+
+static void remove_files(const char *dir) {
+    DIR *d = opendir(dir);
+    struct dirent *de;
+
+    if (!d) return;
+    while ((de = readdir(d))) {
+        if (strcmp(de->d_name, ".") != 0 && strcmp(de->d_name, "..") != 0) {
+            unlinkat(dirfd(d), de->d_name, 0);
+        }
+    }
+    closedir(d);
+    rmdir(dir);
+}
+
+// Reports a line that broke the parser or crashed the evaluator, keeps it
+// in fuzz_crash.sh and stops
+static void fail(const char *crash_path, const struct line *l, const char *what) {
+    fprintf(report, "FAIL: %s\ninput: ", what);
+    print_escaped(report, l->text, l->len);
+    FILE *out = fopen(crash_path, "w");
+    if (out) {
+        fwrite(l->text, 1, l->len, out);
+        fputc('\n', out);
+        fclose(out);
+        fprintf(report, "saved to %s; rerun it with ./mini-shell %s\n", crash_path, crash_path);
+    }
+}
+
+int main(int argc, char **argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : 20000;
+    unsigned long long seed = argc > 2 ? strtoull(argv[2], NULL, 10) : (unsigned long long)time(NULL);
+    char crash_path[PATH_MAX];
+    char dir[] = "/tmp/fuzz_parse.XXXXXX";
+    struct ast ast = {NULL, 0, 0, NULL, 0, 0};
+    struct line l;
+    long ok = 0, incomplete = 0, errors = 0, cut_off = 0;
+    int failed = 0;
+
+    if (!getcwd(crash_path, sizeof(crash_path) - 16)) strcpy(crash_path, ".");
+    strcat(crash_path, "/fuzz_crash.sh");
+    if (!mkdtemp(dir) || chdir(dir) != 0) {
+        perror("fuzz_parse");
+        return 2;
+    }
+    // syntax errors are the expected result of most lines: the parser's
+    // messages go to /dev/null, this program's own to the real stderr
+    int null_fd = open("/dev/null", O_WRONLY);
+    report = fdopen(dup(STDERR_FILENO), "w");
+    if (null_fd < 0 || !report) {
+        perror("fuzz_parse");
+        return 2;
+    }
+    setvbuf(report, NULL, _IONBF, 0);
+    dup2(null_fd, STDERR_FILENO);
+    close(null_fd);
+    setenv("PATH", dir, 1);
+    rng = seed ? seed : 1;
+    printf("seed %llu, %ld lines\n", seed, iterations);
+
+    double start = bench_now();
+    for (long i = 0; i < iterations && !failed; i++) {
+        gen_line(&l);
+        int parsed = ast_parse(&ast, l.text, l.len);
+        if (parsed == PARSE_INCOMPLETE) {
+            incomplete++;
+            continue;
+        }
+        if (parsed != PARSE_OK) {
+            errors++;
+            continue;
+        }
+        ok++;
+        const char *error = tree_error(&ast);
+        if (error) {
+            fail(crash_path, &l, error);
+            failed = 1;
+            break;
+        }
+        int status = eval_child(&ast);
+        if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM) {
+            cut_off++;
+        } else if (WIFSIGNALED(status)) {
+            char what[64];
+            snprintf(what, sizeof(what), "evaluation killed by signal %d (%s)",
+                     WTERMSIG(status), strsignal(WTERMSIG(status)));
+            fail(crash_path, &l, what);
+            failed = 1;
+        }
+    }
+    double elapsed = bench_now() - start;
+
+    remove_files(dir);
+    ast_free(&ast);
+    printf("%-12s %10s %10s %10s %10s %10s\n", "result", "parsed", "incomplete", "errors",
+           "cut off", "lines/s");
+    printf("%-12s %10ld %10ld %10ld %10ld %10.0f\n", failed ? "FAIL" : "ok", ok, incomplete,
+           errors, cut_off, (ok + incomplete + errors) / elapsed);
+    return failed;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+PARSER FUZZ TEST EXPLANATION:
+Feeds generated lines through ast_parse() and runs every line that parses
+through eval_ast(), looking for inputs that break the parser's tree or
+crash the shell. "make fuzz" runs FUZZ_ITERATIONS lines (default 20000)
+with a seed taken from the clock; "./build/fuzz_parse N SEED" repeats a
+run exactly.
+
+THE INPUT:
+Half of the lines are shaped by the grammar (if, while/until, for, { },
+functions, pipelines, && and ||, redirections) around words made of
+builtin names, quotes, escapes, parameters and $(...), then have a few
+bytes overwritten. The other half are random streams of the same words,
+operators and single bytes, including the CTL_* marker bytes the lexer
+uses internally. Most of those end as syntax errors or incomplete
+commands, which exercises the error paths.
+
+THE CHECKS:
+- tree_error(): for every PARSE_OK tree, the properties the evaluator and
+  the AST cache rely on: links point forward, each node has one parent,
+  len matches the children, every word is '\0'-terminated in the text
+- the parser's own messages ("syntax error: ...") are thrown away: fd 2
+  is /dev/null for the whole run and the report goes to a duplicate of
+  the original stderr
+- eval_child(): the line runs in a forked child with stdin, stdout and
+  stderr on /dev/null, PATH set to an empty directory (only builtins
+  can run) and its current directory in a temporary one for the files
+  redirections create. A run longer than EVAL_LIMIT_US ("while true")
+  is ended by SIGALRM and counted as "cut off"; any other signal is a
+  crash. The child leads a process group, which is killed afterwards
+  with everything it left running.
+A failing line is printed escaped and saved to fuzz_crash.sh, to be
+rerun with ./mini-shell fuzz_crash.sh.
+
+SANITIZERS:
+Memory errors that do not crash are found by building with
+AddressSanitizer and UndefinedBehaviorSanitizer, which then abort:
+    make clean
+    UBSAN_OPTIONS=halt_on_error=1 ASAN_OPTIONS=abort_on_error=1:detect_leaks=0 \
+        make fuzz CFLAGS="-O1 -g -fsanitize=address,undefined"
+The report itself goes to the child's stderr (/dev/null); rerun the saved
+line with the sanitized ./mini-shell to read it.
+*/
@@ -0,0 +1,17 @@
+#ifndef BUILTIN_HASH_H
+#define BUILTIN_HASH_H
+
+// Seeded FNV-1a over a builtin name. Shared by builtins.c and the
+// generator in tools/, which picks a seed with no collisions.
+static inline unsigned builtin_name_hash(const char *name, unsigned seed) {
+    unsigned h = seed;
+    while (*name) {
+        h ^= (unsigned char)*name++;
+        h *= 16777619u;
+    }
+    // the low bits of an FNV product only depend on the low bits of the
+    // seed and the input; folding the high half in lets every seed count
+    return h ^ (h >> 16);
+}
+
+#endif
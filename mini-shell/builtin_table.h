@@ -0,0 +1,12 @@
+/* Generated by tools/gen_builtin_hash.c from builtins.def. Do not edit. */
+#define BUILTIN_COUNT 25
+#define BUILTIN_SLOTS 64
+#define BUILTIN_SEED 107u
+
+// slot -> position in builtins.def, -1 for an empty slot
+static const signed char builtin_slot_index[BUILTIN_SLOTS] = {
+    3, 5, -1, 0, 9, -1, -1, -1, 23, -1, 20, 24, -1, 10, -1, -1,
+    1, -1, -1, -1, -1, -1, 6, -1, 13, -1, -1, 15, 14, 18, -1, -1,
+    4, -1, -1, -1, 16, -1, -1, 7, -1, -1, 17, -1, -1, -1, -1, 11,
+    -1, -1, 2, -1, 19, -1, -1, 8, 22, -1, 12, -1, -1, -1, 21, -1,
+};
@@ -0,0 +1,275 @@
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdio_ext.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "shell.h"
+#include "builtin_hash.h"
+#include "builtin_table.h"
+
+// Handlers living in this file; the rest are in their own modules
+static int builtin_cd(char **args);
+static int builtin_exit(char **args);
+static int builtin_hash(char **args);
+
+static const struct builtin builtin_table[] = {
+#define BUILTIN(name, handler) {#name, handler},
+#include "builtins.def"
+#undef BUILTIN
+};
+
+_Static_assert(sizeof(builtin_table) / sizeof(builtin_table[0]) == BUILTIN_COUNT,
+               "builtins.def changed: regenerate builtin_table.h");
+
+const struct builtin *lookup_builtin(const char *name) {
+    unsigned slot = builtin_name_hash(name, BUILTIN_SEED) & (BUILTIN_SLOTS - 1);
+    int index = builtin_slot_index[slot];
+
+    if (index < 0 || strcmp(builtin_table[index].name, name) != 0) return NULL;
+    return &builtin_table[index];
+}
+
+// The i-th builtin name, NULL past the last one (command completion)
+const char *builtin_name(size_t i) {
+    return i < BUILTIN_COUNT ? builtin_table[i].name : NULL;
+}
+
+// A function (eval.c) or a command routed to a coprocess (coproc.c) also
+// runs inside the shell; a function hides a builtin of the same name
+int is_builtin(char **args) {
+    return args[0] && (is_function(args[0]) || lookup_builtin(args[0]) != NULL ||
+                       is_coproc(args[0]));
+}
+
+static int dispatch(char **args) {
+    if (is_function(args[0])) return eval_function(args, NULL, 0);
+
+    const struct builtin *b = lookup_builtin(args[0]);
+    return b ? b->handler(args) : coproc_request(args);
+}
+
+int run_builtin(char **args) {
+    if (!trace_enabled) return dispatch(args);
+
+    // the mark keeps a copy of the name: a function's own commands reuse
+    // the strings args points to
+    struct trace_mark mark;
+    trace_begin(&mark, args[0]);
+    int status = dispatch(args);
+    trace_end(&mark, TRACE_BUILTIN);
+    return status;
+}
+
+// 1 when a builtin's output must be written right after it ran
+static int flush_each = -1;
+
+// Builtins that run in the shell leave their output in stdout's buffer
+// until a program is started (launch_command() flushes it), so a loop of
+// echo does not call write() per round. When stderr is the same file, an
+// error message written directly would overtake that output, so then it
+// is flushed after every builtin. Children whose stdout or stderr changed
+// call builtin_output_setup() again.
+void builtin_output_setup(void) {
+    struct stat out, err;
+
+    flush_each = fstat(STDOUT_FILENO, &out) != 0 || fstat(STDERR_FILENO, &err) != 0 ||
+                 (out.st_dev == err.st_dev && out.st_ino == err.st_ino);
+}
+
+// The last builtin that added to stdout's buffer, named when writing it
+// out fails later, and the buffer's fill level after it ran
+static const char *unflushed = "write";
+static size_t unflushed_len = 0;
+
+// A write to stdout failed ("echo hi > /dev/full"): reports it like bash,
+// "echo: write error: No space left on device", and makes the status 1.
+// glibc drops the data that could not be written, so clearing the error
+// leaves stdout usable for the next command. EPIPE is not reported: the
+// reader of a pipe stopped early ("printf ... | head -1"), where a program
+// would be killed by SIGPIPE without a message.
+static int output_status(const char *name, int status) {
+    if (!ferror(stdout)) return status;
+    if (errno != EPIPE) fprintf(stderr, "%s: write error: %s\n", name, strerror(errno));
+    clearerr(stdout);
+    return 1;
+}
+
+int builtin_output_done(const char *name, int status) {
+    if (flush_each < 0) builtin_output_setup();
+    if (!flush_each && !ferror(stdout)) {
+        // __fpending(): bytes waiting in the buffer
+        size_t len = __fpending(stdout);
+        const struct builtin *b = len != unflushed_len ? lookup_builtin(name) : NULL;
+        if (b) unflushed = b->name;     // name itself may be reused
+        unflushed_len = len;
+        return status;
+    }
+    return builtin_output_flush(name, status);
+}
+
+int builtin_output_flush(const char *name, int status) {
+    fflush(stdout);
+    unflushed_len = 0;
+    return output_status(name ? name : unflushed, status);
+}
+
+// exit [N]: without N, the status of the last command
+static int builtin_exit(char **args) {
+    int status = eval_status();
+
+    if (args[1]) {
+        char *end;
+        long n = strtol(args[1], &end, 10);
+        if (*end || end == args[1]) {
+            fprintf(stderr, "exit: %s: numeric argument required\n", args[1]);
+            n = 2;
+        }
+        status = (int)(n & 0xff);
+    }
+    if (shell_interactive) printf("Goodbye!\n");
+    int flushed = builtin_output_flush(NULL, status);
+    exit(args[1] ? status : flushed);
+}
+
+static int builtin_cd(char **args) {
+    if (!args[1]) {
+        fprintf(stderr, "cd: missing argument\n");
+        return 1;
+    }
+    if (chdir(args[1]) != 0) {
+        perror("cd");
+        return 1;
+    }
+    return 0;
+}
+
+static int builtin_hash(char **args) {
+    int status = 0;
+
+    if (!args[1]) {
+        path_cache_print();
+    } else if (strcmp(args[1], "-r") == 0) {
+        // also the directory listings globbing remembers (glob.c)
+        path_cache_clear();
+        glob_cache_clear();
+    } else {
+        for (int i = 1; args[i]; i++) {
+            if (!find_command(args[i])) {
+                fprintf(stderr, "hash: %s: not found\n", args[i]);
+                status = 1;
+            }
+        }
+    }
+    return status;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+BUILTINS MODULE EXPLANATION:
+Built-in commands are executed by the shell itself instead of starting a
+program. Some must be (cd changes the shell's own directory, exit ends it);
+others are simply much cheaper without a new process.
+
+REGISTRATION:
+Every builtin is one line in builtins.def: BUILTIN(name, handler). That file
+is included in builtin_table[] above with
+    #define BUILTIN(name, handler) {#name, handler},
+so each line becomes an initializer like {"cd", builtin_cd}. The "#name"
+operator turns the macro argument into a string literal.
+
+A handler has the type int (*)(char **args): it gets the same argv an
+external program would, and returns an exit status (0 = success).
+
+LOOKUP (PERFECT HASH):
+The old code compared the command name with every builtin name using a
+chain of strcmp() calls, so each command cost one strcmp() per builtin.
+Now:
+1. builtin_name_hash(name, BUILTIN_SEED) hashes the name once
+2. "& (BUILTIN_SLOTS - 1)" turns the hash into a slot number
+3. builtin_slot_index[slot] gives the builtin at that slot (or -1)
+4. One strcmp() confirms the name (any other word may hash to the slot)
+The seed and slot table in builtin_table.h are generated at build time by
+tools/gen_builtin_hash.c so that no two builtins share a slot. The
+_Static_assert makes the build fail if builtins.def and builtin_table.h
+disagree on the number of builtins.
+
+FUNCTION IMPLEMENTATIONS:
+
+1. const struct builtin *lookup_builtin(const char *name)
+   RETURN VALUE: The table entry for name, or NULL if it is not a builtin
+
+2. int is_builtin(char **args)
+   RETURN VALUE: 1 if args[0] is a shell function, a builtin or a running
+   coprocess, 0 otherwise (also for an empty argv, e.g. a command that is only a
+   redirection)
+
+3. int run_builtin(char **args)
+   PURPOSE: Calls the function named args[0] (eval_function() in eval.c),
+   the handler of args[0], or sends the command to the coprocess of that
+   name (coproc_request() in coproc.c). Functions come first, so a function
+   named like a builtin hides it.
+   RETURN VALUE: The builtin's exit status
+
+4. int builtin_output_done(const char *name, int status)
+   PURPOSE: Called after the builtin name ran in the shell with the
+   status it returned; writes stdout's buffer out only if stderr is the
+   same file (builtin_output_setup() checks that with fstat(), once per
+   process)
+   RETURN VALUE: status, or 1 if writing its output failed; the error is
+   reported as "name: write error: <reason>"
+   - int builtin_output_flush(const char *name, int status) always writes
+     the buffer out, where the output of a builtin must not wait: after a
+     builtin with redirections, in a forked builtin before it exits, and
+     when a function or compound command puts stdout back. A NULL name
+     stands for the last builtin that left output in the buffer.
+
+5. const char *builtin_name(size_t i)
+   RETURN VALUE: The name of the i-th builtin in builtins.def order, NULL
+   for i >= BUILTIN_COUNT; Tab completion (complete.c) lists them with the
+   programs in PATH
+
+SUPPORTED COMMANDS:
+- "exit [N]": Terminates the shell program with status N, or the status
+  of the last command
+- "cd": Changes current working directory
+- "coproc": Starts a long-lived worker that later commands of the same
+  name are sent to as request lines, without starting a process
+  (builtin_coproc() in coproc.c)
+- "hash": Lists remembered command locations; "hash -r" forgets them all,
+  and the cached directory listings of glob.c too;
+  "hash name..." looks the names up and remembers them
+- "history": Lists or searches remembered commands (builtin_history() in
+  history.c)
+- "tee": Copies stdin to stdout and files (builtin_tee() in pipeline.c);
+  inside a pipeline it moves the data with splice()/tee() system calls
+- "wait": Waits for background jobs (builtin_wait() in jobs.c)
+- "jobs", "fg", "bg": List jobs, and continue a stopped or background job
+  in the foreground or in the background (jobs.c)
+- "stats": Prints per-command statistics as JSON; "stats on|off|-r"
+  (builtin_stats() in stats.c)
+- "export", "unset": Pass variables to launched programs, list them, or
+  remove variables (vars.c)
+- "echo", "printf", "test", "[", "true", ":", "false", "pwd": the utilities
+  scripts call most, here to save a process each time (utilities.c)
+- "ulimit": Shows or sets resource limits that launched programs inherit
+  (builtin_ulimit() in limits.c)
+"time" is not in the table: it is a keyword of the parser (parser.c).
+Neither is "timeout": pipeline.c takes it off the front of a command and
+arms a timer for the process (limits.c, jobs.c).
+
+WHY BUILT-INS EXIST:
+Some commands must be executed by the shell itself because they need to
+modify the shell's environment (like changing directory or setting
+variables).
+
+EXTERNAL FUNCTIONS USED:
+- chdir(const char *path): changes the current working directory;
+  returns 0 on success, -1 on error
+- exit(int status): terminates the shell
+- perror(const char *s): prints s and the errno message to stderr
+*/
@@ -0,0 +1,388 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "shell.h"
+
+// Names merged per unit of the budget of complete_index_work(): merging
+// a name costs a strcmp(), reading one costs a readdir() entry and an
+// fstatat()
+#define MERGE_PER_ENTRY 16
+
+// Names of the executables in the PATH directories, for completing command
+// names. The names are stored one after another in pool and names[] holds
+// their offsets; once the last directory has been read they are sorted and
+// each name is kept once.
+struct cmd_index {
+    char *path;             // PATH the index is built from, NULL before the first prompt
+    char *dirs;             // a copy of path with every ':' replaced by '\0'
+    struct timespec *mtimes;    // mtime of each PATH directory when it was read
+    size_t ndirs;
+    char *pool;
+    size_t pool_len;
+    size_t pool_cap;
+    uint32_t *names;
+    size_t count;
+    size_t cap;
+    int ready;              // every directory read, names sorted
+    size_t dir;             // directory being read while the index is built
+    const char *dir_name;
+    DIR *d;
+    int sorting;            // every directory read, names being merge sorted
+    uint32_t *merged;       // the merge sort's output, swapped with names after a pass
+    size_t merged_cap;
+    size_t width;           // length of the sorted runs of this pass
+    size_t lo, i, j, k;     // runs [lo, lo + width) and the next; i, j, k merge positions
+};
+
+static struct cmd_index cmds;
+
+static void mtime_of(const char *dir, struct timespec *t) {
+    struct stat st;
+
+    if (stat(*dir ? dir : ".", &st) == 0) {
+        *t = st.st_mtim;
+    } else {
+        t->tv_sec = 0;
+        t->tv_nsec = 0;
+    }
+}
+
+// Drops the index and starts over with the current PATH
+static int index_restart(const char *path) {
+    if (cmds.d) closedir(cmds.d);
+    cmds.d = NULL;
+    free(cmds.path);
+    free(cmds.dirs);
+    free(cmds.mtimes);
+    cmds.pool_len = 0;
+    cmds.count = 0;
+    cmds.ready = 0;
+    cmds.sorting = 0;
+
+    cmds.ndirs = 1;
+    for (const char *p = path; *p; p++) cmds.ndirs += *p == ':';
+    cmds.path = strdup(path);
+    cmds.dirs = strdup(path);
+    cmds.mtimes = calloc(cmds.ndirs, sizeof(*cmds.mtimes));
+    if (!cmds.path || !cmds.dirs || !cmds.mtimes) {
+        free(cmds.path);
+        free(cmds.dirs);
+        free(cmds.mtimes);
+        cmds.path = cmds.dirs = NULL;
+        cmds.mtimes = NULL;
+        return -1;
+    }
+    for (char *p = cmds.dirs; *p; p++) {
+        if (*p == ':') *p = '\0';
+    }
+    cmds.dir = 0;
+    cmds.dir_name = cmds.dirs;
+    return 0;
+}
+
+void complete_index_check(void) {
+    const char *path = var_get("PATH");
+    struct timespec t;
+
+    if (!path) path = "";
+    if (!cmds.path || strcmp(cmds.path, path) != 0) {
+        index_restart(path);
+        return;
+    }
+    if (!cmds.ready) return;
+
+    // installing or removing a program changes its directory's mtime
+    const char *dir = cmds.dirs;
+    for (size_t i = 0; i < cmds.ndirs; i++) {
+        mtime_of(dir, &t);
+        if (t.tv_sec != cmds.mtimes[i].tv_sec || t.tv_nsec != cmds.mtimes[i].tv_nsec) {
+            index_restart(path);
+            return;
+        }
+        dir += strlen(dir) + 1;
+    }
+}
+
+int complete_index_pending(void) {
+    return cmds.path && !cmds.ready;
+}
+
+static int add_name(const char *name) {
+    size_t len = strlen(name) + 1;
+
+    if (cmds.count == cmds.cap) {
+        size_t new_cap = cmds.cap ? cmds.cap * 2 : 1024;
+        uint32_t *grown = realloc(cmds.names, new_cap * sizeof(*grown));
+        if (!grown) return -1;
+        cmds.names = grown;
+        cmds.cap = new_cap;
+    }
+    if (cmds.pool_len + len > cmds.pool_cap) {
+        size_t new_cap = cmds.pool_cap ? cmds.pool_cap : 16384;
+        while (new_cap < cmds.pool_len + len) new_cap *= 2;
+        char *grown = realloc(cmds.pool, new_cap);
+        if (!grown) return -1;
+        cmds.pool = grown;
+        cmds.pool_cap = new_cap;
+    }
+    memcpy(cmds.pool + cmds.pool_len, name, len);
+    cmds.names[cmds.count++] = (uint32_t)cmds.pool_len;
+    cmds.pool_len += len;
+    return 0;
+}
+
+// Starts a bottom-up merge sort of names[]: runs of one name are merged
+// into runs of two, then four, ... Every position is kept in cmds, so the
+// sort can stop after any name and go on in the next step.
+static void sort_start(void) {
+    if (cmds.merged_cap < cmds.cap) {
+        uint32_t *grown = realloc(cmds.merged, cmds.cap * sizeof(*grown));
+        // out of memory: no index, completion offers the builtins only
+        if (!grown) {
+            cmds.count = 0;
+            cmds.ready = 1;
+            return;
+        }
+        cmds.merged = grown;
+        cmds.merged_cap = cmds.cap;
+    }
+    cmds.sorting = 1;
+    cmds.width = 1;
+    cmds.lo = cmds.i = cmds.k = 0;
+    cmds.j = cmds.count < 1 ? cmds.count : 1;
+}
+
+static size_t min_size(size_t a, size_t b) {
+    return a < b ? a : b;
+}
+
+// Merges at most budget names. Returns the budget left over.
+static size_t sort_step(size_t budget) {
+    const char *pool = cmds.pool;
+
+    while (budget > 0 && cmds.width < cmds.count) {
+        size_t mid = min_size(cmds.lo + cmds.width, cmds.count);
+        size_t hi = min_size(cmds.lo + 2 * cmds.width, cmds.count);
+
+        while (budget > 0 && cmds.k < hi) {
+            if (cmds.i < mid && (cmds.j >= hi || strcmp(pool + cmds.names[cmds.i],
+                                                         pool + cmds.names[cmds.j]) <= 0)) {
+                cmds.merged[cmds.k++] = cmds.names[cmds.i++];
+            } else {
+                cmds.merged[cmds.k++] = cmds.names[cmds.j++];
+            }
+            budget--;
+        }
+        if (cmds.k < hi) break;
+
+        // the next pair of runs, or the next pass with runs twice as long
+        cmds.lo = hi;
+        if (cmds.lo >= cmds.count) {
+            uint32_t *names = cmds.names;
+            size_t cap = cmds.cap;
+            cmds.names = cmds.merged;
+            cmds.cap = cmds.merged_cap;
+            cmds.merged = names;
+            cmds.merged_cap = cap;
+            cmds.lo = 0;
+            cmds.width *= 2;
+        }
+        cmds.i = cmds.k = cmds.lo;
+        cmds.j = min_size(cmds.lo + cmds.width, cmds.count);
+    }
+    return budget;
+}
+
+// The names are sorted: removes the ones a later PATH directory repeats
+static void index_finish(void) {
+    size_t kept = cmds.count > 0;
+
+    for (size_t i = 1; i < cmds.count; i++) {
+        if (strcmp(cmds.pool + cmds.names[i], cmds.pool + cmds.names[kept - 1]) != 0) {
+            cmds.names[kept++] = cmds.names[i];
+        }
+    }
+    cmds.count = kept;
+    cmds.sorting = 0;
+    cmds.ready = 1;
+}
+
+void complete_index_work(size_t budget) {
+    struct stat st;
+
+    while (complete_index_pending() && budget > 0) {
+        if (cmds.sorting) {
+            size_t merges = budget > SIZE_MAX / MERGE_PER_ENTRY ? SIZE_MAX
+                                                                 : budget * MERGE_PER_ENTRY;
+            size_t left = sort_step(merges);
+            if (left > 0) index_finish();
+            budget = left / MERGE_PER_ENTRY;
+            continue;
+        }
+        if (!cmds.d) {
+            if (cmds.dir == cmds.ndirs) {
+                sort_start();
+                continue;
+            }
+            // an empty PATH entry means the current directory
+            const char *dir = *cmds.dir_name ? cmds.dir_name : ".";
+            mtime_of(dir, &cmds.mtimes[cmds.dir]);
+            cmds.d = opendir(dir);
+            cmds.dir_name += strlen(cmds.dir_name) + 1;
+            cmds.dir++;
+            continue;
+        }
+
+        struct dirent *e = readdir(cmds.d);
+        if (!e) {
+            closedir(cmds.d);
+            cmds.d = NULL;
+            continue;
+        }
+        budget--;
+        if (e->d_name[0] == '.' || e->d_type == DT_DIR) continue;
+        if (fstatat(dirfd(cmds.d), e->d_name, &st, 0) != 0) continue;
+        if (!S_ISREG(st.st_mode) || !(st.st_mode & 0111)) continue;
+        if (add_name(e->d_name) != 0) {
+            // out of memory: complete from what was found so far
+            closedir(cmds.d);
+            cmds.d = NULL;
+            cmds.dir = cmds.ndirs;
+        }
+    }
+}
+
+// First index entry that is not smaller than prefix
+static size_t index_lower_bound(const char *prefix, size_t len) {
+    size_t lo = 0, hi = cmds.count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strncmp(cmds.pool + cmds.names[mid], prefix, len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+long complete_commands(const char *prefix, struct arg_vec *out) {
+    size_t len = strlen(prefix);
+    size_t start = out->len;
+    const char *name;
+
+    // Tab came before the idle time finished the index
+    if (!cmds.path) complete_index_check();
+    complete_index_work((size_t)-1);
+
+    for (size_t i = index_lower_bound(prefix, len); i < cmds.count; i++) {
+        char *cmd = cmds.pool + cmds.names[i];
+        if (strncmp(cmd, prefix, len) != 0) break;
+        if (arg_vec_push(out, cmd) != 0) return -1;
+    }
+
+    // builtins go into their sorted place, unless a program has the name
+    for (size_t b = 0; (name = builtin_name(b)) != NULL; b++) {
+        if (strncmp(name, prefix, len) != 0) continue;
+        size_t at = start;
+        while (at < out->len && strcmp(out->argv[at], name) < 0) at++;
+        if (at < out->len && strcmp(out->argv[at], name) == 0) continue;
+        if (arg_vec_push(out, NULL) != 0) return -1;
+        memmove(out->argv + at + 1, out->argv + at, (out->len - 1 - at) * sizeof(char *));
+        out->argv[at] = (char *)name;
+    }
+    return (long)(out->len - start);
+}
+
+long complete_files(const char *prefix, struct arg_vec *out) {
+    size_t len = strlen(prefix);
+    char *pattern = malloc(2 * len + 2);
+    size_t n = 0;
+
+    if (!pattern) return -1;
+    for (size_t i = 0; i < len; i++) {
+        if (strchr("\\*?[", prefix[i])) pattern[n++] = '\\';
+        pattern[n++] = prefix[i];
+    }
+    pattern[n++] = '*';
+    pattern[n] = '\0';
+
+    long found = glob_expand(pattern, out);
+    free(pattern);
+    return found;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+COMPLETION MODULE EXPLANATION:
+Supplies the candidates for Tab in the line editor (lineedit.c):
+- complete_commands("gi", out): every builtin and every program in a PATH
+  directory whose name starts with "gi", sorted, each name once
+- complete_files("src/ma", out): the paths that "src/ma*" matches, through
+  the glob module (glob.c) and its cached directory listings
+
+THE COMMAND INDEX:
+Listing every PATH directory on each Tab would cost a readdir() of
+thousands of names plus one stat() per name: tens of milliseconds on a
+system with tens of thousands of programs. Instead the names are collected
+once into struct cmd_index:
+- pool: all names, '\0'-terminated, one after another
+- names: their offsets, sorted by name
+A lookup is a binary search for the first name >= the prefix, followed by
+a walk over the names that start with it, so it costs microseconds however
+many programs are installed. Offsets instead of pointers let the pool
+grow with realloc() while the index is built.
+
+BUILDING IN THE BACKGROUND:
+The shell has no threads, so "background" means the time the line editor
+would otherwise spend blocked in poll() waiting for a key:
+1. complete_index_check() runs at every prompt. A changed PATH, or a PATH
+   directory whose mtime changed (a program was installed or removed),
+   drops the index and starts a new one.
+2. While an index is being built (complete_index_pending()), the editor
+   polls the terminal with a zero timeout and, when no key is waiting,
+   calls complete_index_work(256): it reads and checks at most 256
+   directory entries and returns. A key is therefore never delayed by more
+   than one such step.
+3. After the last directory the names are sorted, also in steps: 256
+   entries of budget allow 4096 names to be merged (MERGE_PER_ENTRY).
+   qsort() could not stop halfway, and sorting 100000 names at once takes
+   tens of milliseconds, long enough to notice as a stuck key. A
+   bottom-up merge sort can: it merges runs of 1 name into runs of 2,
+   then 4, 8, ..., and sort_step() keeps its place (run width, the pair
+   of runs, the three positions in them) in cmds between calls. Each
+   pass writes into merged[], which then becomes names[].
+4. Duplicates, now next to each other, are removed. Like the shell, the
+   index keeps the first program of a name; completion only needs the
+   name.
+If Tab comes before the index is complete, complete_commands() finishes it
+right away, which is the same work a plain directory scan would do once.
+
+WHAT COUNTS AS A COMMAND:
+A regular file with an execute bit, found with fstatat() (it follows
+symbolic links, so /usr/bin/python3 -> python3.12 counts). Directories and
+names starting with '.' are skipped. An empty PATH entry means the current
+directory, as it does for the command lookup (pathcache.c).
+
+FILE NAMES:
+complete_files() turns the typed prefix into a glob pattern: the prefix
+with its pattern characters escaped ("a*b" -> "a\*b") plus '*'. Matching
+reuses the directory cache, so pressing Tab repeatedly in a large
+directory reads it only once. The results are strings of the expansion
+arena (expand.c) and stay valid until expand_reset().
+
+EXTERNAL FUNCTIONS USED:
+- opendir()/readdir()/closedir(): list a directory one entry at a time;
+  d_type tells directories apart without a stat() on most file systems
+- fstatat(dirfd, name, &st, 0): stat() of a name relative to the open
+  directory, without building the full path
+*/
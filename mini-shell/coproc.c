@@ -0,0 +1,402 @@
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+#include "shell.h"
+
+#define REPLY_CHUNK 4096
+
+// A long-lived worker process the shell talks to through two pipes
+struct coproc {
+    char *name;         // command word that routes requests to it
+    char *mark;         // line that ends a reply; NULL: replies are one line
+    size_t mark_len;
+    pid_t pid;
+    int to_fd;          // write end of the worker's stdin
+    int from_fd;        // read end of the worker's stdout
+    char *buf;          // reply bytes read but not handed out yet
+    size_t start;
+    size_t end;
+    size_t cap;
+};
+
+static struct coproc *coprocs = NULL;
+static size_t ncoprocs = 0;
+static size_t coprocs_cap = 0;
+
+// Request line built from a command's words, reused between requests
+static char *request_buf = NULL;
+static size_t request_cap = 0;
+
+static struct coproc *find_coproc(const char *name) {
+    for (size_t i = 0; i < ncoprocs; i++) {
+        if (strcmp(coprocs[i].name, name) == 0) return &coprocs[i];
+    }
+    return NULL;
+}
+
+int is_coproc(const char *name) {
+    return ncoprocs > 0 && find_coproc(name) != NULL;
+}
+
+// Closes the pipes (the worker reads EOF and should exit; jobs.c reaps it)
+// and removes the entry, moving the last one into its place
+static void drop_coproc(struct coproc *c) {
+    close(c->to_fd);
+    close(c->from_fd);
+    free(c->name);
+    free(c->mark);
+    free(c->buf);
+    *c = coprocs[--ncoprocs];
+}
+
+void coproc_close_all(void) {
+    while (ncoprocs > 0) drop_coproc(&coprocs[0]);
+    free(coprocs);
+    free(request_buf);
+    coprocs = NULL;
+    request_buf = NULL;
+    coprocs_cap = request_cap = 0;
+}
+
+static int start_coproc(const char *name, const char *mark, char **argv) {
+    int to[2], from[2];
+
+    if (find_coproc(name)) {
+        fprintf(stderr, "coproc: %s: already running\n", name);
+        return 1;
+    }
+    if (ncoprocs == coprocs_cap) {
+        size_t new_cap = coprocs_cap ? coprocs_cap * 2 : 4;
+        struct coproc *grown = realloc(coprocs, new_cap * sizeof(*grown));
+        if (!grown) {
+            perror("coproc");
+            return 1;
+        }
+        coprocs = grown;
+        coprocs_cap = new_cap;
+    }
+
+    // the shell's ends stay close-on-exec, so no other program holds them
+    // and the worker sees EOF as soon as the shell closes its end
+    if (pipe2(to, O_CLOEXEC) != 0) {
+        perror("coproc");
+        return 1;
+    }
+    if (pipe2(from, O_CLOEXEC) != 0) {
+        perror("coproc");
+        close(to[0]);
+        close(to[1]);
+        return 1;
+    }
+
+    // with job control the worker gets its own process group, so Ctrl-C
+    // at the terminal goes to the foreground job and not to the worker
+    struct launch_opts opts = {to[0], from[1], job_tty >= 0 ? 0 : -1, 0, NULL, 0, NULL};
+    pid_t pid = launch_command(argv, &opts);
+    close(to[0]);
+    close(from[1]);
+    if (pid < 0) {
+        close(to[1]);
+        close(from[0]);
+        return 127;
+    }
+
+    // a background job like "cmd &": listed by jobs, reported when it exits
+    char **stages[1] = {argv};
+    job_start(&pid, 1, stages, opts.pgid < 0 ? -1 : pid, 0);
+
+    struct coproc *c = &coprocs[ncoprocs];
+    memset(c, 0, sizeof(*c));
+    c->name = strdup(name);
+    c->mark = mark ? strdup(mark) : NULL;
+    c->mark_len = mark ? strlen(mark) : 0;
+    c->pid = pid;
+    c->to_fd = to[1];
+    c->from_fd = from[0];
+    ncoprocs++;
+    if (!c->name || (mark && !c->mark)) {
+        perror("coproc");
+        drop_coproc(c);
+        return 1;
+    }
+    return 0;
+}
+
+static int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t w = write(fd, buf, len);
+        if (w < 0) {
+            if (errno == EINTR && !shell_interrupted) continue;
+            return -1;
+        }
+        buf += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+// Copies one reply from the worker to stdout. Returns 0, 1 if the worker
+// closed its output, or -1 with errno set (EINTR after Ctrl-C)
+static int copy_reply(struct coproc *c) {
+    for (;;) {
+        // before the first read buf is still NULL: nothing to search
+        char *line = c->buf + c->start;
+        char *nl = c->end > c->start ? memchr(line, '\n', c->end - c->start) : NULL;
+
+        if (nl) {
+            size_t len = (size_t)(nl - line);
+            c->start += len + 1;
+            if (c->mark && len == c->mark_len && memcmp(line, c->mark, len) == 0) {
+                return 0;
+            }
+            fwrite(line, 1, len + 1, stdout);
+            if (!c->mark) return 0;
+            continue;
+        }
+
+        // keep the unfinished line at the front and read more after it
+        if (c->start > 0) {
+            memmove(c->buf, c->buf + c->start, c->end - c->start);
+            c->end -= c->start;
+            c->start = 0;
+        }
+        if (c->end == c->cap) {
+            size_t new_cap = c->cap ? c->cap * 2 : REPLY_CHUNK;
+            char *grown = realloc(c->buf, new_cap);
+            if (!grown) return -1;
+            c->buf = grown;
+            c->cap = new_cap;
+        }
+        ssize_t n = read(c->from_fd, c->buf + c->end, c->cap - c->end);
+        if (n < 0 && errno == EINTR && !shell_interrupted) continue;
+        if (n < 0) return -1;
+        if (n == 0) return 1;
+        c->end += (size_t)n;
+    }
+}
+
+// Sends text (which ends in '\n') and copies the reply. Any failure leaves
+// the worker's output out of step with its requests, so the worker is closed.
+static int round_trip(struct coproc *c, const char *text, size_t len) {
+    int r = write_all(c->to_fd, text, len);
+    if (r == 0) r = copy_reply(c);
+    if (r == 0) return 0;
+
+    if (r > 0 || errno == EPIPE) {
+        fprintf(stderr, "%s: worker exited\n", c->name);
+    } else if (errno == EINTR) {
+        fprintf(stderr, "%s: interrupted, worker closed\n", c->name);
+    } else {
+        fprintf(stderr, "%s: %s\n", c->name, strerror(errno));
+    }
+    drop_coproc(c);
+    return 1;
+}
+
+// Joins words with single spaces into request_buf, followed by '\n'
+static size_t build_request(char **words) {
+    size_t len = 0;
+
+    for (int i = 0; words[i]; i++) len += strlen(words[i]) + 1;
+    if (len > request_cap) {
+        char *grown = realloc(request_buf, len);
+        if (!grown) return 0;
+        request_buf = grown;
+        request_cap = len;
+    }
+
+    char *p = request_buf;
+    for (int i = 0; words[i]; i++) {
+        size_t n = strlen(words[i]);
+        memcpy(p, words[i], n);
+        p += n;
+        *p++ = words[i + 1] ? ' ' : '\n';
+    }
+    return len;
+}
+
+// Sends every line of stdin as one request, until EOF or Ctrl-C
+static int stream_requests(struct coproc *c) {
+    struct line_reader in;
+    char *line;
+
+    if (reader_open_fd(&in, STDIN_FILENO) != 0) return 1;
+    int status = 0;
+    while (!status && (line = reader_next_line(&in)) && !shell_interrupted) {
+        // the reader replaced the '\n' with '\0': put it back for the worker
+        size_t len = strlen(line);
+        line[len] = '\n';
+        status = round_trip(c, line, len + 1);
+    }
+    reader_close(&in);
+    return shell_interrupted ? 130 : status;
+}
+
+int coproc_request(char **args) {
+    struct coproc *c = find_coproc(args[0]);
+    if (!c) return 127;
+
+    double started = stats_enabled ? now_seconds() : 0;
+    // a worker that has exited must not kill the shell with SIGPIPE
+    void (*old_handler)(int) = signal(SIGPIPE, SIG_IGN);
+    int status;
+
+    shell_interrupted = 0;
+    if (args[1]) {
+        size_t len = build_request(args + 1);
+        status = len > 0 ? round_trip(c, request_buf, len) : 1;
+    } else {
+        status = stream_requests(c);
+    }
+    signal(SIGPIPE, old_handler);
+
+    // no spawn happened, so only the round-trip time is recorded
+    if (stats_enabled) stats_record(args[0], now_seconds() - started, -1, NULL);
+    return status;
+}
+
+static void print_coprocs(void) {
+    for (size_t i = 0; i < ncoprocs; i++) {
+        printf("%-12s %d", coprocs[i].name, (int)coprocs[i].pid);
+        if (coprocs[i].mark) printf("  (replies end with \"%s\")", coprocs[i].mark);
+        printf("\n");
+    }
+}
+
+int builtin_coproc(char **args) {
+    const char *name = NULL;
+    const char *mark = NULL;
+    int i = 1;
+
+    if (!args[1]) {
+        print_coprocs();
+        return 0;
+    }
+    if (strcmp(args[1], "-k") == 0) {
+        int status = 0;
+        for (i = 2; args[i]; i++) {
+            struct coproc *c = find_coproc(args[i]);
+            if (!c) {
+                fprintf(stderr, "coproc: %s: no such worker\n", args[i]);
+                status = 1;
+                continue;
+            }
+            drop_coproc(c);
+        }
+        return status;
+    }
+
+    for (; args[i] && args[i][0] == '-'; i += 2) {
+        if (!args[i + 1]) break;
+        if (strcmp(args[i], "-n") == 0) {
+            name = args[i + 1];
+        } else if (strcmp(args[i], "-e") == 0) {
+            mark = args[i + 1];
+        } else {
+            break;
+        }
+    }
+    if (!args[i] || args[i][0] == '-') {
+        fprintf(stderr, "usage: coproc [-n name] [-e end-line] command [args...]\n"
+                        "       coproc -k name...\n");
+        return 2;
+    }
+
+    if (!name) {
+        // "coproc /usr/bin/bc -l" is reached as "bc"
+        const char *slash = strrchr(args[i], '/');
+        name = slash ? slash + 1 : args[i];
+    }
+    if (lookup_builtin(name)) {
+        fprintf(stderr, "coproc: %s: is a shell builtin, use -n\n", name);
+        return 1;
+    }
+    return start_coproc(name, mark, args + i);
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+COPROC MODULE EXPLANATION:
+Some tools are run thousands of times in a row (a calculator, a formatter,
+a small interpreter). Every run pays for a process start, exec, dynamic
+linking and the tool's own start-up, which is often much more than the work
+asked for. A coprocess is started once and kept alive; the shell writes
+requests into its stdin and reads the replies from its stdout:
+
+    coproc bc -l                start bc, reachable under the name "bc"
+    bc 4*a(1)                   sends "4*a(1)" and prints bc's answer
+    seq 1000 | bc               sends 1000 lines, one request each
+    coproc                      lists the running workers
+    coproc -k bc                closes bc's pipes; bc exits on EOF
+
+LINE PROTOCOL:
+- A request is one line: the command's words joined by single spaces
+  ("bc 2 + 2" sends "2 + 2\n"). A command without words sends every line
+  of its stdin as a separate request, so it works inside pipelines.
+- A reply is one line by default. A worker started with "-e MARK" may
+  answer with any number of lines followed by a line that is exactly MARK;
+  the marker itself is not printed.
+- Requests are sent one at a time: the next one is written only after the
+  reply to the previous one has been read. The worker must flush its
+  output after every reply (many tools have a switch for that, e.g.
+  "sed -u", "grep --line-buffered", "python3 -u").
+- If the worker exits, or a reply is interrupted with Ctrl-C, its pipes are
+  closed and it is removed: a late reply would otherwise be taken as the
+  answer to the next request.
+
+ROUTING:
+is_builtin() (builtins.c) also returns true for the name of a running
+worker, and run_builtin() passes such commands to coproc_request(). So a
+routed command is handled inside the shell like any builtin: no process is
+started, it can read from and write to pipes and redirections, and real
+builtins keep their names (a worker cannot be called "cd"). A command run
+in a background job talks to the same worker from a forked copy of the
+shell; do not send requests from two places at once.
+
+PROCESS HANDLING:
+- The worker is started with launch_command(), with stdin and stdout
+  connected to two pipes. The shell's ends are close-on-exec, so commands
+  started later do not inherit them and the worker sees EOF when the shell
+  closes its end (coproc -k, or the shell exiting).
+- It is registered as a background job (job_start), so "jobs" lists it,
+  it gets its own process group, and it is reaped and reported like "&".
+- With stats on (stats.c), each request is recorded under the worker's
+  name with its round-trip time.
+
+FUNCTION IMPLEMENTATIONS:
+
+1. int builtin_coproc(char **args)
+   PURPOSE: "coproc [-n name] [-e end-line] command [args...]" starts a
+   worker, named after the command unless -n is given; "coproc -k name..."
+   closes workers; plain "coproc" lists them
+   RETURN VALUE: 0, 1 on error, 2 for a usage error, 127 if the command
+   could not be started
+
+2. int is_coproc(const char *name)
+   PURPOSE: Tells whether name is a running worker. Costs nothing while no
+   worker runs, since it is asked for every command.
+
+3. int coproc_request(char **args)
+   PURPOSE: Sends args[1..] (or every stdin line) to the worker args[0]
+   and copies the replies to stdout
+   RETURN VALUE: 0, 1 if the worker failed, 130 after Ctrl-C
+
+4. void coproc_close_all(void)
+   PURPOSE: Closes every worker, before the shell waits for its jobs
+
+EXTERNAL FUNCTIONS USED:
+- pipe2(fds, O_CLOEXEC): creates a pipe whose ends are closed on exec
+- write(fd, buf, len) / read(fd, buf, len): send requests, receive replies
+- memchr(s, '\n', n): finds the end of a reply line
+- signal(SIGPIPE, SIG_IGN): a write to an exited worker fails with EPIPE
+  instead of killing the shell
+*/
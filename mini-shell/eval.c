@@ -0,0 +1,786 @@
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "shell.h"
+
+// Deepest nesting of function calls; a runaway recursion stops here
+// instead of running out of stack
+#define CALL_DEPTH_MAX 1000
+
+// Set by break, continue and return. The lists being left stop running
+// commands until the loop or function call it is meant for clears it.
+enum jump {
+    JUMP_NONE,
+    JUMP_BREAK,
+    JUMP_CONTINUE,
+    JUMP_RETURN
+};
+
+static enum jump jump = JUMP_NONE;
+static long jump_loops;         // break/continue N: loops still to leave
+static int return_status;       // the status "return" gave
+static long loop_depth;         // loops running in the current function call
+static int call_depth;
+static int last_status;         // of the last pipeline that ran
+
+// Strings that must outlive the pipeline that expanded them: the words of
+// running for loops and the arguments of running function calls. Pipelines
+// reuse the expansion arena (expand.c), so these are copied here. It is
+// used as a stack and kept from one use to the next: once it is big enough,
+// loops and calls allocate nothing.
+static char *saved = NULL;
+static size_t saved_len = 0;
+static size_t saved_cap = 0;
+
+// The arguments of the running function call: argc strings one after the
+// other in saved, starting at offset args
+struct call_frame {
+    size_t args;
+    size_t argc;
+    struct call_frame *prev;
+};
+
+static struct call_frame *frame = NULL;
+
+// A function's compound command, copied out of the line it was defined in
+struct body {
+    struct ast ast;             // nodes[0] is the compound command
+    struct body *next;          // on the retired list
+};
+
+struct function {
+    char *name;                 // NULL for an empty slot
+    struct body *body;
+};
+
+// Open addressing table of the defined functions, like the variables' (vars.c)
+static struct function *functions = NULL;
+static size_t functions_cap = 0;    // always a power of two
+static size_t functions_used = 0;
+
+// Bodies replaced while a call may still be running them; freed once no
+// function runs
+static struct body *retired = NULL;
+
+static int eval_list(const struct ast *ast, const struct node *list);
+
+// Copies s with its '\0' to the top of saved; -1 if memory ran out
+static int save_string(const char *s) {
+    size_t len = strlen(s) + 1;
+
+    if (saved_len + len > saved_cap) {
+        size_t new_cap = saved_cap ? saved_cap : 4096;
+        while (new_cap < saved_len + len) new_cap *= 2;
+        char *grown = realloc(saved, new_cap);
+        if (!grown) return -1;
+        saved = grown;
+        saved_cap = new_cap;
+    }
+    memcpy(saved + saved_len, s, len);
+    saved_len += len;
+    return 0;
+}
+
+static int run_and_or(const struct ast *ast, const struct node *and_or) {
+    int status = 0;
+
+    for (uint32_t i = and_or->first; i && jump == JUMP_NONE; i = ast->nodes[i].next) {
+        const struct node *pipeline = &ast->nodes[i];
+
+        // "a && b || c" groups as "(a && b) || c": a skipped pipeline
+        // leaves the status of the last one that ran
+        if ((pipeline->flags & NODE_AND) && status != 0) continue;
+        if ((pipeline->flags & NODE_OR) && status == 0) continue;
+        status = last_status = execute_pipeline(ast, pipeline, 0);
+    }
+    return status;
+}
+
+static const char *const compound_names[] = {
+    [NODE_IF] = "if", [NODE_WHILE] = "while", [NODE_FOR] = "for",
+    [NODE_GROUP] = "{", [NODE_FUNCDEF] = "function",
+};
+
+// The word a compound command starts with, to name it in job lists
+const char *compound_name(const struct node *cmd) {
+    if (cmd->type == NODE_WHILE && (cmd->flags & NODE_UNTIL)) return "until";
+    return compound_names[cmd->type];
+}
+
+// Writes the command text of an and-or list, as the jobs builtin shows it
+static void print_and_or(FILE *out, const struct ast *ast, const struct node *and_or) {
+    static const char *ops[] = {
+        [REDIR_IN] = "<", [REDIR_OUT] = ">", [REDIR_APPEND] = ">>",
+        [REDIR_DUP] = ">&", [REDIR_CLOSE] = ">&", [REDIR_STRING] = "<<<",
+    };
+
+    for (uint32_t p = and_or->first; p; p = ast->nodes[p].next) {
+        const struct node *pipeline = &ast->nodes[p];
+        if (pipeline->flags & NODE_AND) fputs(" && ", out);
+        if (pipeline->flags & NODE_OR) fputs(" || ", out);
+
+        for (uint32_t c = pipeline->first; c; c = ast->nodes[c].next) {
+            if (c != pipeline->first) fputs(" | ", out);
+            if (ast->nodes[c].type != NODE_CMD) {
+                // only the start of a compound command: "while ..."
+                fprintf(out, "%s ...", compound_name(&ast->nodes[c]));
+                continue;
+            }
+            for (uint32_t w = ast->nodes[c].first; w; w = ast->nodes[w].next) {
+                const struct node *n = &ast->nodes[w];
+                if (w != ast->nodes[c].first) fputc(' ', out);
+                if (n->type == NODE_REDIR) {
+                    fprintf(out, "%d%s", n->fd, ops[n->flags]);
+                    n = &ast->nodes[n->first];
+                }
+                word_print(out, ast->text + n->first);
+            }
+        }
+    }
+}
+
+// "a && b &": only a shell can decide whether b runs, so a forked copy of
+// this one evaluates the list while the real shell goes on
+static int background_and_or(const struct ast *ast, const struct node *and_or) {
+    pid_t pgid = job_tty >= 0 ? 0 : -1;
+
+    builtin_output_flush(NULL, 0);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork failed");
+        return 1;
+    }
+    if (pid == 0) {
+        job_child_setup(pgid, 0);
+        jobs_forked();
+        // the copy runs its commands like a script: no job control, no
+        // notices, and no terminal input
+        job_tty = -1;
+        shell_interactive = 0;
+        shell_max_jobs = 0;
+        int null_fd = open("/dev/null", O_RDONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDIN_FILENO);
+            if (null_fd != STDIN_FILENO) close(null_fd);
+        }
+        int status = run_and_or(ast, and_or);
+        _exit(builtin_output_flush(NULL, status));
+    }
+
+    char *text = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&text, &size);
+    if (out) {
+        print_and_or(out, ast, and_or);
+        fclose(out);
+    }
+    if (trace_enabled) trace_process_start(pid, text ? text : "");
+    char *words[] = {text ? text : "", NULL};
+    char **stages[] = {words};
+    job_start(&pid, 1, stages, pgid < 0 ? -1 : pid, 0);
+    free(text);
+    return 0;
+}
+
+// Runs the and-or lists of a NODE_LIST one after another
+static int eval_list(const struct ast *ast, const struct node *list) {
+    int status = 0;
+
+    for (uint32_t i = list->first; i && jump == JUMP_NONE; i = ast->nodes[i].next) {
+        const struct node *and_or = &ast->nodes[i];
+        int background = and_or->flags & NODE_BACKGROUND;
+
+        if (and_or->len == 1) {
+            // a single pipeline is its own job, also in the background
+            status = execute_pipeline(ast, &ast->nodes[and_or->first], background);
+            last_status = status;
+        } else if (background || shell_max_jobs > 0) {
+            // -j N: the whole list joins the worker pool
+            while (shell_max_jobs > 0 && jobs_active() >= shell_max_jobs) {
+                jobs_poll(JOBS_POLL_MS);
+            }
+            status = last_status = background_and_or(ast, and_or);
+        } else {
+            status = run_and_or(ast, and_or);
+        }
+    }
+    return status;
+}
+
+int eval_ast(const struct ast *ast) {
+    return eval_list(ast, &ast->nodes[0]);
+}
+
+// $?: the status of the last pipeline that ran
+int eval_status(void) {
+    return last_status;
+}
+
+void eval_set_status(int status) {
+    last_status = status;
+}
+
+// Called after a loop's condition or body ran: 1 when the loop ends here,
+// because of return, or a break (or continue N) meant for this loop or an
+// outer one. Ctrl-C ends every loop as well.
+static int loop_ends(void) {
+    if (shell_interrupted) return 1;
+    if (jump == JUMP_NONE) return 0;
+    if (jump == JUMP_RETURN || --jump_loops > 0) return 1;
+
+    int ends = jump == JUMP_BREAK;
+    jump = JUMP_NONE;
+    return ends;
+}
+
+// if: the body after the first condition that succeeds, or the else part
+static int eval_if(const struct ast *ast, const struct node *cmd) {
+    uint32_t c = cmd->first;
+
+    while (c && ast->nodes[c].type == NODE_LIST) {
+        uint32_t body = ast->nodes[c].next;
+        if (!body || ast->nodes[body].type != NODE_LIST) {
+            return eval_list(ast, &ast->nodes[c]);      // else
+        }
+        int status = eval_list(ast, &ast->nodes[c]);
+        if (jump != JUMP_NONE) return status;
+        if (status == 0) return eval_list(ast, &ast->nodes[body]);
+        c = ast->nodes[body].next;
+    }
+    return 0;
+}
+
+// while/until: the status is the last body's, 0 if it never ran
+static int eval_while(const struct ast *ast, const struct node *cmd) {
+    const struct node *cond = &ast->nodes[cmd->first];
+    const struct node *body = &ast->nodes[cond->next];
+    int until = (cmd->flags & NODE_UNTIL) != 0;
+    int status = 0;
+
+    loop_depth++;
+    for (;;) {
+        int test = eval_list(ast, cond);
+        if (loop_ends() || (test != 0) != until) break;
+        status = eval_list(ast, body);
+        if (loop_ends()) break;
+    }
+    loop_depth--;
+    return status;
+}
+
+// for: the words are expanded once, copied to saved, and the body runs
+// with the variable set to each; nothing is parsed or allocated per round
+static int eval_for(const struct ast *ast, const struct node *cmd) {
+    static struct arg_vec fields = {NULL, 0, 0};
+    const struct node *name = &ast->nodes[cmd->first];
+    const char *var = ast->text + name->first;
+    size_t base = saved_len;
+    size_t start = base;
+    size_t count = 0;
+    uint32_t c = name->next;
+    int status = 0;
+
+    if (cmd->flags & NODE_ARGS) {
+        // "for x; do": the function's arguments, which stay put meanwhile
+        if (frame) {
+            start = frame->args;
+            count = frame->argc;
+        }
+    } else {
+        expand_reset();
+        fields.len = 0;
+        for (; ast->nodes[c].type == NODE_WORD; c = ast->nodes[c].next) {
+            if (expand_word(ast, &ast->nodes[c], &fields) != 0) return 1;
+        }
+        for (size_t i = 0; i < fields.len; i++) {
+            if (save_string(fields.argv[i]) != 0) {
+                perror("for");
+                saved_len = base;
+                return 1;
+            }
+        }
+        count = fields.len;
+    }
+    while (ast->nodes[c].type != NODE_LIST) c = ast->nodes[c].next;
+    const struct node *body = &ast->nodes[c];
+
+    loop_depth++;
+    size_t off = start;
+    for (size_t i = 0; i < count; i++) {
+        // saved may move while the body runs, so it is indexed afresh
+        const char *word = saved + off;
+        off += strlen(word) + 1;
+        if (var_set(var, word) != 0) {
+            perror(var);
+            status = 1;
+            break;
+        }
+        status = eval_list(ast, body);
+        if (loop_ends()) break;
+    }
+    loop_depth--;
+    saved_len = base;
+    return status;
+}
+
+// Points the shell's own descriptors at the targets of a function's or
+// compound command's redirections; backup keeps the originals. The files
+// are closed again right away (their descriptors are copied), since the
+// commands run in between reuse the vector r lives in.
+static int redirect_shell(struct redirect *r, size_t n, struct fd_backup *backup) {
+    builtin_output_flush(NULL, 0);
+    fd_backup_init(backup);
+    // the originals are saved first: a file opened below may be given the
+    // very number it is meant for
+    for (size_t i = 0; i < n; i++) fd_backup_dup2(backup, r[i].fd, r[i].fd);
+    if (redirects_open(r, n) != 0) {
+        fd_backup_restore(backup);
+        return -1;
+    }
+
+    int err = 0;
+    for (size_t i = 0; i < n && !err; i++) {
+        if (fd_backup_dup2(backup, r[i].src, r[i].fd) != 0) {
+            fprintf(stderr, "%d: bad file descriptor\n", r[i].src);
+            err = 1;
+        } else if (r[i].src == r[i].fd) {
+            // the file itself is the descriptor: keep it, and open for the
+            // programs started from here
+            fcntl(r[i].fd, F_SETFD, 0);
+            r[i].opened = 0;
+        }
+    }
+    redirects_close(r, n);
+    if (err) fd_backup_restore(backup);
+    return err ? -1 : 0;
+}
+
+// Expands the NODE_REDIR children of a compound command and applies them.
+// Returns 1 if there were some, 0 if not, -1 on errors.
+static int compound_redirects(const struct ast *ast, const struct node *cmd,
+                              struct fd_backup *backup) {
+    static struct redir_vec redirs = {NULL, 0, 0};
+    int expanded = 0;
+
+    redirs.len = 0;
+    for (uint32_t c = cmd->first; c; c = ast->nodes[c].next) {
+        const struct node *child = &ast->nodes[c];
+        if (child->type != NODE_REDIR) continue;
+        if (!expanded) {
+            expand_reset();
+            expanded = 1;
+        }
+        const struct node *word = &ast->nodes[child->first];
+        const char *target = child->flags == REDIR_STRING ?
+            expand_string(ast, word) : expand_target(ast, word);
+        if (!target) return -1;
+        if (redir_vec_add(&redirs, child->fd, child->flags, target) != 0) {
+            perror("redirect");
+            return -1;
+        }
+    }
+    if (redirs.len == 0) return 0;
+    return redirect_shell(redirs.items, redirs.len, backup) == 0 ? 1 : -1;
+}
+
+static size_t hash_name(const char *s) {
+    // FNV-1a
+    size_t h = 2166136261u;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static struct function *find_slot(struct function *t, size_t cap, const char *name) {
+    size_t i = hash_name(name) & (cap - 1);
+
+    while (t[i].name && strcmp(t[i].name, name) != 0) i = (i + 1) & (cap - 1);
+    return &t[i];
+}
+
+static struct function *find_function(const char *name) {
+    if (functions_used == 0 || !name) return NULL;
+    struct function *f = find_slot(functions, functions_cap, name);
+    return f->name ? f : NULL;
+}
+
+int is_function(const char *name) {
+    return find_function(name) != NULL;
+}
+
+static int grow_functions(void) {
+    size_t new_cap = functions_cap ? functions_cap * 2 : 16;
+    struct function *grown = calloc(new_cap, sizeof(*grown));
+    if (!grown) return -1;
+
+    for (size_t i = 0; i < functions_cap; i++) {
+        if (functions[i].name) *find_slot(grown, new_cap, functions[i].name) = functions[i];
+    }
+    free(functions);
+    functions = grown;
+    functions_cap = new_cap;
+    return 0;
+}
+
+// One past the highest node index in the subtree at i
+static uint32_t subtree_end(const struct ast *ast, uint32_t i) {
+    uint32_t end = i + 1;
+
+    if (ast->nodes[i].type == NODE_WORD) return end;
+    for (uint32_t c = ast->nodes[i].first; c; c = ast->nodes[c].next) {
+        uint32_t e = subtree_end(ast, c);
+        if (e > end) end = e;
+    }
+    return end;
+}
+
+// Copies the subtree at root into a tree of its own, root becoming node 0:
+// the line's tree is reused by the next line, the function stays. The
+// parser stores a subtree in one run of nodes, so that run and the run of
+// text its words use are copied as they are, with their indexes shifted.
+static struct body *copy_body(const struct ast *ast, uint32_t root) {
+    uint32_t end = subtree_end(ast, root);
+    uint32_t text_start = UINT32_MAX;
+    uint32_t text_end = 0;
+
+    for (uint32_t i = root; i < end; i++) {
+        const struct node *n = &ast->nodes[i];
+        if (n->type != NODE_WORD) continue;
+        if (n->first < text_start) text_start = n->first;
+        if (n->first + n->len + 1 > text_end) text_end = n->first + n->len + 1;
+    }
+    if (text_start > text_end) text_start = text_end = 0;
+
+    struct body *b = calloc(1, sizeof(*b));
+    if (!b) return NULL;
+    b->ast.nnodes = b->ast.nodes_cap = end - root;
+    b->ast.text_len = b->ast.text_cap = text_end - text_start;
+    b->ast.nodes = malloc(b->ast.nnodes * sizeof(struct node));
+    b->ast.text = malloc(b->ast.text_len ? b->ast.text_len : 1);
+    if (!b->ast.nodes || !b->ast.text) {
+        ast_free(&b->ast);
+        free(b);
+        return NULL;
+    }
+    memcpy(b->ast.nodes, ast->nodes + root, b->ast.nnodes * sizeof(struct node));
+    memcpy(b->ast.text, ast->text + text_start, b->ast.text_len);
+
+    for (uint32_t i = 0; i < b->ast.nnodes; i++) {
+        struct node *n = &b->ast.nodes[i];
+        if (n->next) n->next -= root;
+        if (n->type == NODE_WORD) {
+            n->first -= text_start;
+        } else if (n->first) {
+            n->first -= root;
+        }
+    }
+    b->ast.nodes[0].next = 0;
+    return b;
+}
+
+static void free_body(struct body *b) {
+    ast_free(&b->ast);
+    free(b);
+}
+
+// name() { ... }: stores a copy of the body under the name
+static int define_function(const struct ast *ast, const struct node *cmd) {
+    const struct node *name = &ast->nodes[cmd->first];
+    const char *text = ast->text + name->first;
+
+    struct body *b = copy_body(ast, name->next);
+    if (!b) {
+        perror(text);
+        return 1;
+    }
+    struct function *f = find_function(text);
+    if (f) {
+        // a running call may be the old body's: it goes when none runs
+        if (call_depth > 0) {
+            f->body->next = retired;
+            retired = f->body;
+        } else {
+            free_body(f->body);
+        }
+        f->body = b;
+        return 0;
+    }
+
+    char *copy = strdup(text);
+    if (!copy || ((functions_used + 1) * 4 > functions_cap * 3 && grow_functions() != 0)) {
+        perror(text);
+        free(copy);
+        free_body(b);
+        return 1;
+    }
+    f = find_slot(functions, functions_cap, copy);
+    f->name = copy;
+    f->body = b;
+    functions_used++;
+    return 0;
+}
+
+int eval_function(char **args, struct redirect *redirs, size_t nredirs) {
+    struct function *f = find_function(args[0]);
+    struct fd_backup backup;
+    struct call_frame call = {saved_len, 0, frame};
+
+    if (!f) return 127;
+    if (call_depth >= CALL_DEPTH_MAX) {
+        fprintf(stderr, "%s: maximum function nesting level exceeded (%d)\n", args[0],
+                CALL_DEPTH_MAX);
+        return 1;
+    }
+    if (nredirs > 0 && redirect_shell(redirs, nredirs, &backup) != 0) return 1;
+
+    // the arguments point into the pipeline's vectors, which the body's
+    // own pipelines reuse: $1, $2, ... read copies
+    for (int i = 1; args[i]; i++, call.argc++) {
+        if (save_string(args[i]) != 0) {
+            perror(args[0]);
+            saved_len = call.args;
+            if (nredirs > 0) fd_backup_restore(&backup);
+            return 1;
+        }
+    }
+
+    // break and continue do not reach the caller's loops
+    struct body *body = f->body;
+    long loops = loop_depth;
+    frame = &call;
+    loop_depth = 0;
+    call_depth++;
+    int status = eval_compound(&body->ast, &body->ast.nodes[0]);
+    if (jump == JUMP_RETURN) {
+        jump = JUMP_NONE;
+        status = return_status;
+    }
+    call_depth--;
+    loop_depth = loops;
+    frame = call.prev;
+    saved_len = call.args;
+
+    if (call_depth == 0) {
+        while (retired) {
+            struct body *next = retired->next;
+            free_body(retired);
+            retired = next;
+        }
+    }
+    if (nredirs > 0) {
+        status = builtin_output_flush(NULL, status);
+        fd_backup_restore(&backup);
+    }
+    return status;
+}
+
+// $1 is eval_arg(1); NULL past the last argument or outside a function
+const char *eval_arg(size_t n) {
+    if (!frame || n == 0 || n > frame->argc) return NULL;
+
+    const char *arg = saved + frame->args;
+    while (--n > 0) arg += strlen(arg) + 1;
+    return arg;
+}
+
+size_t eval_argc(void) {
+    return frame ? frame->argc : 0;
+}
+
+int eval_compound(const struct ast *ast, const struct node *cmd) {
+    struct fd_backup backup;
+    int status;
+
+    int redirected = compound_redirects(ast, cmd, &backup);
+    if (redirected < 0) return 1;
+
+    switch (cmd->type) {
+    case NODE_IF:
+        status = eval_if(ast, cmd);
+        break;
+    case NODE_WHILE:
+        status = eval_while(ast, cmd);
+        break;
+    case NODE_FOR:
+        status = eval_for(ast, cmd);
+        break;
+    case NODE_GROUP:
+        status = eval_list(ast, &ast->nodes[cmd->first]);
+        break;
+    case NODE_FUNCDEF:
+        status = define_function(ast, cmd);
+        break;
+    default:
+        status = 1;
+        break;
+    }
+
+    if (redirected) {
+        status = builtin_output_flush(NULL, status);
+        fd_backup_restore(&backup);
+    }
+    return status;
+}
+
+// break [N] and continue [N] leave N loops (at most all of them). A bad
+// N still leaves one, so that "while true" cannot run away.
+static int loop_jump(char **args, enum jump kind) {
+    long n = 1;
+    int status = 0;
+
+    if (loop_depth == 0) {
+        fprintf(stderr, "%s: only meaningful in a `for', `while', or `until' loop\n", args[0]);
+        return 0;
+    }
+    if (args[1]) {
+        char *end;
+        n = strtol(args[1], &end, 10);
+        if (*end || end == args[1] || n < 1) {
+            fprintf(stderr, "%s: %s: loop count out of range\n", args[0], args[1]);
+            n = 1;
+            status = 1;
+        }
+    }
+    jump = kind;
+    jump_loops = n < loop_depth ? n : loop_depth;
+    return status;
+}
+
+int builtin_break(char **args) {
+    return loop_jump(args, JUMP_BREAK);
+}
+
+int builtin_continue(char **args) {
+    return loop_jump(args, JUMP_CONTINUE);
+}
+
+// return [N]: without N, the status of the last command
+int builtin_return(char **args) {
+    if (call_depth == 0) {
+        fprintf(stderr, "return: can only `return' from a function\n");
+        return 1;
+    }
+    int status = last_status;
+    if (args[1]) {
+        char *end;
+        long n = strtol(args[1], &end, 10);
+        if (*end || end == args[1]) {
+            fprintf(stderr, "return: %s: numeric argument required\n", args[1]);
+            n = 2;
+        }
+        status = (int)(n & 0xff);
+    }
+    jump = JUMP_RETURN;
+    return_status = status;
+    return status;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+EVAL MODULE EXPLANATION:
+Runs a line parsed by ast_parse() (parser.c) by walking its syntax tree:
+    a ; b          run a, then b
+    a & b          start a in the background, then run b
+    a && b         run b only if a succeeded (exit status 0)
+    a || b         run b only if a failed
+The chains group from the left: "a && b || c" runs c if a or b failed.
+Each pipeline is handed to execute_pipeline() (pipeline.c), which returns
+its exit status; the status of the line is the last pipeline's.
+
+WALKING THE TREE:
+Children are followed with their indexes: "first" leads to the first
+child, "next" to the following sibling, and 0 ends the chain. No recursion
+or extra memory is needed, and since the parser stored parents before
+children, the walk moves forward through the node array.
+
+EXIT STATUS:
+Every pipeline returns its status as an int, all the way up: a builtin's
+return value, or exit_status() of the wait status of the last process.
+last_status keeps the status of the last pipeline that ran; it is $?
+(eval_status()), the default of "return" and "exit", and what the shell
+exits with at the end of a script (main.c). "a && b || c" is decided in
+run_and_or() with these ints, in one pass over the and-or node's
+pipelines: a chain of builtins never forks, and nothing waits for a
+process twice. A pipeline sent to the background (or to the "-j N" pool)
+has status 0; its own status is reported by "wait" and "jobs".
+
+BACKGROUND LISTS:
+A single pipeline with "&" becomes a background job as before. For
+"a && b &" the shell cannot wait for a itself, so background_and_or()
+forks a copy of the shell that runs the list with job control off and
+stdin on /dev/null, and exits with the list's status. The copy is one
+background job ([1] pid), shown by "jobs" with the list's text. In "-j N"
+mode a line with && or || is run this way as well, after waiting for a
+free slot in the pool.
+
+COMPOUND COMMANDS:
+if, while, until, for and { } are nodes of the tree (see parser.c), so a
+loop body is parsed once and run again from its nodes on every round;
+nothing is read or parsed per iteration. The words of a for loop are
+expanded once, before the first round. A loop made only of assignments
+and builtins forks nothing: pipeline.c runs a compound command alone in
+the foreground in the shell, through eval_compound().
+A compound command in a pipeline or with "&" runs in a forked child.
+
+BREAK, CONTINUE AND RETURN:
+The builtins only record the jump in "jump": run_and_or() and eval_list()
+stop at the next check, and the loop or function that the jump is aimed
+at clears it. "break 2" counts down jump_loops as it passes each loop.
+loop_depth counts the loops around the running command, and is reset
+inside a function body, as in bash. A loop also stops when Ctrl-C was
+pressed (shell_interrupted), so "while true; do sleep 1; done" can be
+interrupted.
+
+NO ALLOCATION PER ROUND:
+The words of a for loop and the arguments of a function call are copied
+into "saved", one string stack whose memory is kept between uses; a loop
+returns it to its earlier length when it ends. The loop variable is set
+with var_set(), which overwrites the old value in place (vars.c). A warm
+loop of assignments and builtins therefore runs without malloc().
+
+FUNCTIONS:
+"name() { ...; }" copies the body's nodes and text out of the line's tree
+(copy_body()), since the tree is reused for the next line. Calls find the
+function in a hash table of names, which is checked before the builtins.
+A call pushes a call_frame with its arguments, read by $1, $#, $@ and $*
+(eval_arg(), eval_argc()). A function that redefines itself while it runs
+would free the nodes being walked, so a body replaced during a call is
+kept on the "retired" list until the outermost call returns. Calls nest
+at most CALL_DEPTH_MAX deep, so endless recursion reports an error
+instead of overflowing the C stack.
+
+FUNCTION IMPLEMENTATIONS:
+
+1. int eval_ast(const struct ast *ast)
+   PURPOSE: Runs every and-or list of the root NODE_LIST in order
+   RETURN VALUE: Exit status of the last pipeline that ran (0 for a line
+   that only started background jobs)
+
+2. int eval_compound(const struct ast *ast, const struct node *n)
+   PURPOSE: Runs one if/while/for/{ } node in the shell, with its
+   redirections applied around it and undone afterwards
+   RETURN VALUE: Exit status of the last command it ran
+
+3. int eval_function(char **args, struct redirect *redirs, size_t nredirs)
+   PURPOSE: Calls the function args[0] with args[1..] as $1, $2, ...
+   RETURN VALUE: The status given to "return", or of the last command
+
+4. int builtin_break / builtin_continue / builtin_return(char **args)
+   PURPOSE: Record a jump out of loops or the current function
+   RETURN VALUE: 0, or 1 (with a message) for a bad count or a return
+   outside a function
+
+EXTERNAL FUNCTIONS USED:
+- fork(): creates the copy of the shell that runs a background list
+- open_memstream(&buf, &size): a FILE that writes into a growing buffer,
+  used to build the job's command text
+- _exit(status): ends the copy without running the shell's exit handlers
+*/
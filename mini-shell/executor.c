@@ -1,46 +1,230 @@
+#define _GNU_SOURCE
 #include <unistd.h>
+#include <spawn.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include "shell.h"
 
-int is_builtin(char **args) {
-    return (strcmp(args[0], "exit") == 0 || strcmp(args[0], "cd") == 0);
+// Backend used to start external programs (see set_launch_mode)
+enum launch_mode launch_mode = LAUNCH_SPAWN;
+
+int set_launch_mode(const char *name) {
+    if (strcmp(name, "spawn") == 0) {
+        launch_mode = LAUNCH_SPAWN;
+    } else if (strcmp(name, "fork") == 0) {
+        launch_mode = LAUNCH_FORK;
+    } else {
+        fprintf(stderr, "unknown launch mode: %s\n", name);
+        return -1;
+    }
+    return 0;
 }
 
-void run_builtin(char **args) {
-    if (strcmp(args[0], "exit") == 0) {
-        printf("Goodbye!\n");
-        exit(0);
-    } else if (strcmp(args[0], "cd") == 0) {
-        if (args[1]) {
-            if (chdir(args[1]) != 0) {
-                perror("cd");
-            }
+static int launch_spawn(const char *path, char **args,
+                        const struct launch_opts *opts, pid_t *pid) {
+    // the child starts with the signal mask and dispositions the shell
+    // itself was started with (jobs.c changes some for job control)
+    posix_spawnattr_t attr;
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setsigmask(&attr, &job_sigmask);
+    posix_spawnattr_setsigdefault(&attr, &job_sigdefault);
+    if (opts && opts->pgid >= 0) {
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&attr, opts->pgid);
+    }
+    posix_spawnattr_setflags(&attr, flags);
+
+    int take_tty = opts && opts->foreground && opts->pgid >= 0 && job_tty >= 0;
+    if (!take_tty && (!opts || (opts->in_fd < 0 && opts->out_fd < 0 &&
+                                opts->nredirs == 0 && !opts->envp))) {
+        int err = posix_spawn(pid, path, NULL, &attr, args, vars_environ());
+        posix_spawnattr_destroy(&attr);
+        return err;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (opts->in_fd >= 0) {
+        posix_spawn_file_actions_adddup2(&actions, opts->in_fd, STDIN_FILENO);
+    }
+    if (opts->out_fd >= 0) {
+        posix_spawn_file_actions_adddup2(&actions, opts->out_fd, STDOUT_FILENO);
+    }
+    // redirections come after the pipes, in the order they were written
+    for (size_t i = 0; i < opts->nredirs; i++) {
+        const struct redirect *r = &opts->redirs[i];
+        if (r->src < 0) {
+            posix_spawn_file_actions_addclose(&actions, r->fd);
         } else {
-            fprintf(stderr, "cd: missing argument\n");
+            posix_spawn_file_actions_adddup2(&actions, r->src, r->fd);
         }
     }
+    if (take_tty) {
+        // runs after the child joined its process group
+        posix_spawn_file_actions_addtcsetpgrp_np(&actions, job_tty);
+    }
+    int err = posix_spawn(pid, path, &actions, &attr, args,
+                          opts->envp ? opts->envp : vars_environ());
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    return err;
 }
 
-void execute_command(char **args) {
-    pid_t pid = fork();
+static int launch_fork(const char *path, char **args,
+                       const struct launch_opts *opts, pid_t *pid) {
+    // the child reports a failed exec through this pipe; a successful exec
+    // closes it (O_CLOEXEC), so EOF tells the parent the program is running
+    int err_pipe[2];
+    char **envp = opts && opts->envp ? opts->envp : vars_environ();
+    if (pipe2(err_pipe, O_CLOEXEC) != 0) return errno;
 
-    if (pid < 0) {
-        perror("fork failed");
-        return;
-    } else if (pid == 0) {
+    *pid = fork();
+
+    if (*pid < 0) {
+        int err = errno;
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        return err;
+    } else if (*pid == 0) {
         // Child
-        execvp(args[0], args);
-        perror("exec");
-        exit(1);
-    } else {
-        // Parent
-        int status;
-        waitpid(pid, &status, 0);
+        job_child_setup(opts ? opts->pgid : -1, opts && opts->foreground);
+        if (opts && opts->in_fd >= 0) dup2(opts->in_fd, STDIN_FILENO);
+        if (opts && opts->out_fd >= 0) dup2(opts->out_fd, STDOUT_FILENO);
+        if (!opts || redirects_apply(opts->redirs, opts->nredirs) == 0) {
+            execve(path, args, envp);
+        }
+        int err = errno;
+        if (write(err_pipe[1], &err, sizeof(err)) < 0) _exit(127);
+        _exit(127);
+    }
+
+    // Parent
+    int err = 0;
+    ssize_t n;
+    close(err_pipe[1]);
+    while ((n = read(err_pipe[0], &err, sizeof(err))) < 0 && errno == EINTR) {
+    }
+    close(err_pipe[0]);
+
+    if (n == sizeof(err)) {
+        waitpid(*pid, NULL, 0);
+        return err;
+    }
+    return 0;
+}
+
+// The descriptor the child would have as stderr, so launch errors follow
+// "2> file" and "2>&1" like the program's own messages would
+static int error_fd(const struct launch_opts *opts) {
+    int fds[REDIR_MAX_FD + 1];
+
+    if (!opts || opts->nredirs == 0) return STDERR_FILENO;
+    for (int fd = 0; fd <= REDIR_MAX_FD; fd++) fds[fd] = fd;
+    if (opts->out_fd >= 0) fds[STDOUT_FILENO] = opts->out_fd;
+    for (size_t i = 0; i < opts->nredirs; i++) {
+        const struct redirect *r = &opts->redirs[i];
+        if (r->src < 0) {
+            fds[r->fd] = -1;
+        } else {
+            fds[r->fd] = r->opened || r->src > REDIR_MAX_FD ? r->src : fds[r->src];
+        }
+    }
+    return fds[STDERR_FILENO];
+}
+
+pid_t launch_command(char **args, const struct launch_opts *opts) {
+    struct trace_mark mark;
+
+    if (!args[0]) return -1;    // callers skip empty commands; nothing to run
+
+    // builtins may have left output in the buffer (builtins.c)
+    builtin_output_flush(NULL, 0);
+    if (trace_enabled) trace_begin(&mark, args[0]);
+    for (int attempt = 0; attempt < 2; attempt++) {
+        const char *path = find_command(args[0]);
+        if (!path) {
+            dprintf(error_fd(opts), "%s: command not found\n", args[0]);
+            return -1;
+        }
+
+        pid_t pid = -1;
+        int err = launch_mode == LAUNCH_FORK ? launch_fork(path, args, opts, &pid)
+                                             : launch_spawn(path, args, opts, &pid);
+        if (err == 0) {
+            if (trace_enabled) {
+                trace_end(&mark, TRACE_SPAWN);
+                trace_process_start(pid, args[0]);
+            }
+            return pid;
+        }
+
+        // the cached program was removed or moved: search PATH again once
+        if (err == ENOENT && path != args[0] && attempt == 0) {
+            path_cache_forget(args[0]);
+            continue;
+        }
+        dprintf(error_fd(opts), "%s: %s\n", args[0], strerror(err));
+        return -1;
     }
+    return -1;
+}
+
+int wait_process(pid_t pid, const char *name, double started, double launched) {
+    struct rusage ru;
+    struct trace_mark mark;
+    int status = 0;
+
+    // the program runs meanwhile: a good time to write the trace
+    if (trace_enabled) {
+        trace_flush();
+        trace_begin(&mark, name);
+    }
+    // with job control, Ctrl-Z returns control to the shell; while
+    // commands have a timeout, jobs.c waits so that it can kill them
+    int options = job_tty >= 0 ? WUNTRACED : 0;
+    while ((job_timers_pending() ? job_wait_timed(pid, &status, options, &ru)
+                                 : wait4(pid, &status, options, &ru)) < 0) {
+        if (errno != EINTR) return 0;
+    }
+    if (trace_enabled) {
+        trace_end(&mark, TRACE_WAIT);
+        if (!WIFSTOPPED(status)) trace_process_end(pid);
+    }
+    if (stats_enabled && !WIFSTOPPED(status)) {
+        stats_record(name, now_seconds() - started,
+                     launched >= 0 ? launched - started : -1, &ru);
+    }
+    return status;
+}
+
+int exit_status(int wait_status) {
+    if (WIFEXITED(wait_status)) return WEXITSTATUS(wait_status);
+    if (WIFSIGNALED(wait_status)) return 128 + WTERMSIG(wait_status);
+    if (WIFSTOPPED(wait_status)) return 128 + WSTOPSIG(wait_status);
+    return 0;
+}
+
+int execute_command(char **args) {
+    // with job control the command gets its own process group and the terminal
+    struct launch_opts opts = {-1, -1, job_tty >= 0 ? 0 : -1, 1, NULL, 0, NULL};
+    double started = stats_enabled ? now_seconds() : 0;
+    pid_t pid = launch_command(args, &opts);
+
+    if (pid < 0) {
+        return 127 << 8;
+    }
+
+    // Parent
+    double launched = stats_enabled ? now_seconds() : 0;
+    return job_wait_foreground(&pid, 1, &args, opts.pgid < 0 ? -1 : pid,
+                               started, &launched);
 }
 
 /*
@@ -49,48 +233,78 @@ void execute_command(char **args) {
 ===============================================================================
 
 EXECUTOR MODULE EXPLANATION:
-This module handles command execution, including both built-in commands and
-external programs. It demonstrates process creation and management in Unix-like
-systems.
+This module handles the execution of external programs (built-in commands
+live in builtins.c). It demonstrates process creation and management in
+Unix-like systems.
 
 FUNCTION IMPLEMENTATIONS:
 
-1. int is_builtin(char **args)
-   PURPOSE: Determines if a command should be handled internally
-   
-   PARAMETERS:
-   - char **args: Array of command arguments (first element is command name)
+1. pid_t launch_command(char **args, const struct launch_opts *opts)
+   PURPOSE: Starts an external program and returns its process ID
    
-   RETURN VALUE:
-   - Returns 1 (true) if command is built-in, 0 (false) otherwise
+   STANDARD INPUT/OUTPUT:
+   - opts (may be NULL) names descriptors that become the child's stdin
+     (in_fd) and stdout (out_fd); -1 keeps the shell's own
+   - The spawn backend passes them as posix_spawn file actions, the fork
+     backend calls dup2() in the child. dup2() clears close-on-exec on the
+     copy, so pipe ends created with O_CLOEXEC survive only as fd 0/1
+   - opts->redirs lists the command's redirections (redirect.c), already
+     opened by the shell; each becomes one more dup2 (or close) after the
+     pipes. A failing redirection is reported like a failed exec.
+   - Errors ("command not found") are written to the descriptor the child
+     would have had as stderr (error_fd()), so "cmd 2>/dev/null" hides
+     them as it would in other shells
+   - opts->pgid and opts->foreground put the child in a process group and
+     give that group the terminal (job control, jobs.c)
+   - The child gets opts->envp as its environment, or the exported shell
+     variables (vars_environ(), vars.c) when it is NULL
    
-   HOW IT WORKS:
-   - Uses strcmp() to compare command name with known built-ins
-   - Currently supports "exit" and "cd" commands
-   - Built-ins must be handled by the shell itself, not external programs
+   PATH LOOKUP:
+   - find_command() (pathcache.c) resolves args[0] to an absolute path,
+     searching $PATH only the first time a command is used
+   - If a cached program has disappeared (ENOENT), the entry is dropped and
+     PATH is searched once more
 
-2. void run_builtin(char **args)
-   PURPOSE: Executes built-in shell commands
-   
-   SUPPORTED COMMANDS:
-   - "exit": Terminates the shell program
-   - "cd": Changes current working directory
+   LAUNCH BACKENDS (selected with set_launch_mode()):
+   - LAUNCH_SPAWN (default): posix_spawn(). glibc implements it with
+     clone(CLONE_VM | CLONE_VFORK), so the child borrows the parent's memory
+     until it calls exec. No page tables are copied, which keeps launches
+     fast even when the shell itself has a large heap.
+   - LAUNCH_FORK: the classic fork() + execve(). fork() must copy the
+     parent's page tables, so its cost grows with the shell's memory size.
+     Kept as a fallback and for comparison. The child reports a failed exec
+     through a close-on-exec pipe, so both backends return only once the
+     program is running (or with the exec error).
    
-   ERROR HANDLING:
-   - Uses perror() to display system error messages
-   - fprintf(stderr, ...) prints error to standard error stream
-   
-   WHY BUILT-INS EXIST:
-   Some commands must be executed by the shell itself because they need to
-   modify the shell's environment (like changing directory).
+   RETURN VALUE:
+   - Child PID on success, -1 if the program could not be started
 
-3. void execute_command(char **args)
+2. int execute_command(char **args)
    PURPOSE: Executes external programs using process creation
    
    PROCESS CREATION WORKFLOW:
-   1. fork() creates identical copy of current process
-   2. Child process replaces itself with new program using execvp()
-   3. Parent process waits for child to complete
+   1. launch_command() starts the program with the selected backend
+   2. Child process replaces itself with the new program
+   3. Parent process waits for child to complete (wait_process())
+   
+   RETURN VALUE:
+   - The wait status from wait4() (decode it with WIFEXITED()/WEXITSTATUS());
+     127 << 8, like "exit 127", if the program could not be started
+
+   int wait_process(pid_t pid, const char *name, double started, double launched)
+   - Waits for one child with wait4(), which also returns its resource usage
+   - In stats mode, records wall time, spawn latency (launched - started),
+     CPU time and peak memory under name (stats.c)
+
+   int exit_status(int wait_status)
+   - Turns a wait status into the number scripts see: the exit code, or
+     128 + the signal number for a killed or stopped process (130 after
+     Ctrl-C), like other shells
+
+3. int set_launch_mode(const char *name)
+   PURPOSE: Selects the launch backend by name ("spawn" or "fork")
+   RETURN VALUE: 0 on success, -1 for an unknown name
+   USAGE: main() calls it with the MINI_SHELL_LAUNCH environment variable
    
    POINTER CONCEPTS IN PROCESS MANAGEMENT:
    - pid_t: Process ID type (integer-like)
@@ -109,29 +323,47 @@ From <unistd.h>:
     - -1 on error
   * Usage: Fundamental for creating new processes in Unix
 
-- execvp(const char *file, char *const argv[]):
-  * Purpose: Replaces current process image with new program
-  * Parameters:
-    - file: Program name to execute
-    - argv: Array of argument pointers (NULL-terminated)
-  * Returns: Only returns on error (-1)
-  * Behavior: Searches PATH for executable if file contains no '/'
+- _exit(int status):
+  * Purpose: Terminates the process without flushing stdio buffers
+  * Usage: Used in a forked child so the parent's buffered output is not
+    written twice
 
-- chdir(const char *path):
-  * Purpose: Changes current working directory
-  * Parameters: path - New directory path
-  * Returns: 0 on success, -1 on error
-  * Effect: Changes where relative paths are resolved
+- execve(const char *path, char *const argv[], char *const envp[]):
+  * Purpose: Replaces current process image with the program at path
+  * Behavior: No PATH search; path must name the program file. The fork
+    backend calls it with the path find_command() returned and the
+    shell's environment (vars_environ())
+
+- dup2(int oldfd, int newfd):
+  * Purpose: Makes newfd refer to the same open file as oldfd
+  * Usage: dup2(pipe_fd, STDOUT_FILENO) sends a program's output into a pipe
+
+From <spawn.h>:
+- posix_spawn(pid, path, file_actions, attrp, argv, envp):
+  * Purpose: Creates a child process that runs a new program in one call
+  * Parameters: pid receives the child PID; path is the program file
+    (posix_spawnp() would search PATH instead);
+    file_actions/attrp may be NULL; envp is the child environment
+  * Returns: 0 on success, an error number (not -1) on failure
+  * Advantage: Avoids copying the parent address space like fork() does
+- posix_spawn_file_actions_adddup2(&actions, fd, newfd):
+  * Purpose: Records a dup2() for posix_spawn() to perform in the child
+- posix_spawn_file_actions_addclose(&actions, fd):
+  * Purpose: Records a close() for posix_spawn() to perform in the child
 
 From <sys/wait.h>:
-- waitpid(pid_t pid, int *status, int options):
-  * Purpose: Waits for specific child process to change state
+- wait4(pid_t pid, int *status, int options, struct rusage *ru):
+  * Purpose: Waits for specific child process to change state, like
+    waitpid(), and also fills in its resource usage (CPU time, peak memory)
   * Parameters:
     - pid: Process ID to wait for
     - status: Pointer to store exit status
-    - options: Behavior flags (0 for default)
+    - options: WUNTRACED with job control, so a stopped job returns too
   * Returns: Process ID of child that changed state
   * Usage: Prevents zombie processes and gets exit codes
+- waitpid(pid_t pid, int *status, int options):
+  * Purpose: The same without resource usage; the fork backend uses it to
+    collect a child whose exec failed
 
 From <sys/types.h>:
 - pid_t:
@@ -147,6 +379,8 @@ From <stdlib.h>:
   * Usage: Normal program termination
 
 From <stdio.h>:
+- dprintf(int fd, const char *format, ...):
+  * Purpose: Like fprintf(), but writes straight to a file descriptor
 - printf(const char *format, ...):
   * Purpose: Prints formatted output to stdout
   * Parameters: Format string and arguments
@@ -194,9 +428,15 @@ Creates an exact copy of the calling process. After fork():
 
 EXEC FAMILY FUNCTIONS:
 Replace the current process image with a new program:
-- execvp() searches PATH and takes array of arguments
+- execvp() and posix_spawnp() search PATH on every call: they try
+  execve() in each directory until one works
 - execl() takes arguments as separate parameters
-- execve() doesn't search PATH, requires full path
+- execve() and posix_spawn() don't search PATH and require a path
+This shell searches PATH itself: find_command() (pathcache.c) looks a
+name up once and keeps the result in a hash table, like bash's "hash".
+Every later launch of that command passes the cached path straight to
+posix_spawn() (or to execve() after fork()), so starting it costs one exec
+instead of one try per PATH directory.
 
 PROCESS STATES:
 - Running: Currently executing on CPU
@@ -220,10 +460,17 @@ MEMORY AND POINTERS IN PROCESS CONTEXT:
 - After fork(), both processes have identical memory
 - Memory modifications in one process don't affect the other
 - Pointers have same values but point to different memory spaces
-- execvp() completely replaces memory, so pointers become invalid
+- posix_spawn() does not copy memory: the child runs in the parent's
+  memory (CLONE_VM | CLONE_VFORK) until exec, while the parent waits
+- execve() completely replaces memory, so pointers become invalid
 
 SECURITY CONSIDERATIONS:
-- execvp() searches PATH, which could be security risk
+- A command name without '/' is looked up in PATH, so a writable
+  directory early in PATH could provide a program of the same name
+- Found paths are cached: a program installed later under the same name
+  in an earlier PATH directory is not used until "hash -r". Setting PATH
+  clears the cache, and a cached file that disappeared makes the launch
+  search again
 - Always validate user input before passing to exec functions
-- Consider using execv() with full paths for security-critical applications
+- A full path ("/usr/bin/ls") bypasses PATH and the cache entirely
 */
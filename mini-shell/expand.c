@@ -0,0 +1,706 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/wait.h>
+#include "shell.h"
+
+// Smallest block of expanded text; larger fields get a block of their own
+#define ARENA_BLOCK 4096
+
+// A command substitution reads its output in pieces of at least this size
+#define CAPTURE_READ 65536
+// Capture buffers that grew beyond this are freed again after the pipeline
+#define CAPTURE_KEEP (1 << 20)
+
+// Expanded words live in blocks that are never moved, so the argv pointers
+// into them stay valid until expand_reset()
+struct block {
+    struct block *next;
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+static struct block *blocks = NULL;     // the newest block first
+
+// The field being built; copied into a block once it is complete
+static char *field = NULL;
+static size_t field_len = 0;
+static size_t field_cap = 0;
+
+// The output of each command substitution of the pipeline stays in a
+// buffer of its own, since fields point into it. The buffers are kept for
+// the next pipeline, so a script that substitutes in a loop reuses them.
+struct capture {
+    char *data;
+    size_t cap;
+};
+
+static struct capture *captures = NULL;
+static size_t ncaptures = 0;
+static size_t captures_used = 0;
+
+// A parsed substitution; taken while it runs (see command_subst())
+static struct ast subst_ast;
+
+// Exit status of the last $(...) of the current pipeline, 0 if it had none
+static int subst_status = 0;
+
+void expand_reset(void) {
+    // keep one block: the next line usually fits in it again
+    while (blocks && blocks->next) {
+        struct block *next = blocks->next;
+        free(blocks);
+        blocks = next;
+    }
+    if (blocks) blocks->used = 0;
+
+    for (size_t i = 0; i < captures_used; i++) {
+        if (captures[i].cap > CAPTURE_KEEP) {
+            free(captures[i].data);
+            captures[i].data = NULL;
+            captures[i].cap = 0;
+        }
+    }
+    captures_used = 0;
+    subst_status = 0;
+}
+
+// "X=$(cmd)" has no command of its own: its status is that of cmd
+int expand_subst_status(void) {
+    return subst_status;
+}
+
+static int out_of_memory(void) {
+    perror("expand");
+    return -1;
+}
+
+char *expand_save(const char *s, size_t len) {
+    if (!blocks || blocks->size - blocks->used < len + 1) {
+        size_t size = len + 1 > ARENA_BLOCK ? len + 1 : ARENA_BLOCK;
+        struct block *b = malloc(sizeof(*b) + size);
+        if (!b) return NULL;
+        b->size = size;
+        b->used = 0;
+        b->next = blocks;
+        blocks = b;
+    }
+    char *copy = blocks->data + blocks->used;
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    blocks->used += len + 1;
+    return copy;
+}
+
+static int field_add(const char *s, size_t len) {
+    if (field_len + len > field_cap) {
+        size_t new_cap = field_cap ? field_cap : 256;
+        while (new_cap < field_len + len) new_cap *= 2;
+        char *grown = realloc(field, new_cap);
+        if (!grown) return -1;
+        field = grown;
+        field_cap = new_cap;
+    }
+    if (len == 0) return 0;     // field may still be NULL
+    memcpy(field + field_len, s, len);
+    field_len += len;
+    return 0;
+}
+
+// Characters that get a backslash in the fields of a pattern word (see
+// glob.c): all pattern characters where they are literal, and only the
+// backslash itself where *, ? and [ keep their meaning
+#define GLOB_LITERAL "\\*?["
+#define GLOB_ACTIVE "\\"
+
+// field_add() with a backslash before each of the characters in escape;
+// escape NULL adds s as it is
+static int field_add_escaped(const char *s, size_t len, const char *escape) {
+    const char *end = s + len;
+
+    if (!escape) return field_add(s, len);
+    while (s < end) {
+        const char *run = s;
+        while (s < end && !strchr(escape, *s)) s++;
+        if (field_add(run, (size_t)(s - run)) != 0) return -1;
+        if (s < end && (field_add("\\", 1) != 0 || field_add(s++, 1) != 0)) return -1;
+    }
+    return 0;
+}
+
+// Moves the field into the arena and appends it to out
+static int field_end(struct arg_vec *out) {
+    char *copy = expand_save(field ? field : "", field_len);
+    field_len = 0;
+    return copy ? arg_vec_push(out, copy) : -1;
+}
+
+// Reads fd to the end into the next capture buffer. Returns the output
+// with trailing newlines removed, '\0'-terminated; *len is its length.
+static char *capture_output(int fd, size_t *len) {
+    if (captures_used == ncaptures) {
+        struct capture *grown = realloc(captures, (ncaptures + 1) * sizeof(*grown));
+        if (!grown) return NULL;
+        captures = grown;
+        captures[ncaptures].data = NULL;
+        captures[ncaptures].cap = 0;
+        ncaptures++;
+    }
+    struct capture *c = &captures[captures_used++];
+    size_t n = 0;
+
+    for (;;) {
+        // every read() may fill CAPTURE_READ bytes, and there is always
+        // room for the final '\0'
+        if (c->cap - n < CAPTURE_READ + 1) {
+            size_t new_cap = c->cap ? c->cap * 2 : 2 * CAPTURE_READ;
+            char *grown = realloc(c->data, new_cap);
+            if (!grown) return NULL;
+            c->data = grown;
+            c->cap = new_cap;
+        }
+        ssize_t got = read(fd, c->data + n, c->cap - n - 1);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) return NULL;
+        if (got == 0) break;
+        n += (size_t)got;
+    }
+    while (n > 0 && c->data[n - 1] == '\n') n--;
+    c->data[n] = '\0';
+    *len = n;
+    return c->data;
+}
+
+// The argv of a parsed line that is one plain program call ("date",
+// "ls /tmp"): no builtin, pipe, redirection, assignment or expansion.
+// NULL for anything else.
+static char **simple_command(const struct ast *ast) {
+    static struct arg_vec args = {NULL, 0, 0};
+    const struct node *nodes = ast->nodes;
+
+    if (nodes[0].len != 1) return NULL;
+    const struct node *and_or = &nodes[nodes[0].first];
+    if (and_or->len != 1 || (and_or->flags & NODE_BACKGROUND)) return NULL;
+    const struct node *pipeline = &nodes[and_or->first];
+    if (pipeline->len != 1 || (pipeline->flags & NODE_TIMED)) return NULL;
+    if (nodes[pipeline->first].type != NODE_CMD) return NULL;
+
+    args.len = 0;
+    for (uint32_t w = nodes[pipeline->first].first; w; w = nodes[w].next) {
+        if (nodes[w].type != NODE_WORD || (nodes[w].flags & (NODE_EXPAND | NODE_ASSIGN))) {
+            return NULL;
+        }
+        if (arg_vec_push(&args, ast->text + nodes[w].first) != 0) return NULL;
+    }
+    if (arg_vec_push(&args, NULL) != 0 || is_builtin(args.argv)) return NULL;
+    return args.argv;
+}
+
+// Runs a parsed substitution with its output going to out_fd and returns
+// the process to wait for, or -1 if nothing was started
+static pid_t subst_start(const struct ast *ast, int out_fd, int in_fd) {
+    char **args = simple_command(ast);
+
+    if (args) {
+        // the common case, "$(date)", is launched like any program
+        struct launch_opts opts = {-1, out_fd, -1, 0, NULL, 0, NULL};
+        return launch_command(args, &opts);
+    }
+
+    // anything else needs a shell: a copy of this one runs it, like the
+    // forked shell of "a && b &" (eval.c)
+    builtin_output_flush(NULL, 0);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork failed");
+        return -1;
+    }
+    if (pid == 0) {
+        job_child_setup(-1, 0);
+        jobs_forked();
+        job_tty = -1;
+        shell_interactive = 0;
+        shell_max_jobs = 0;
+        dup2(out_fd, STDOUT_FILENO);
+        close(out_fd);
+        close(in_fd);
+        builtin_output_setup();
+        int status = eval_ast(ast);
+        fflush(stdout);
+        _exit(status);
+    }
+    if (trace_enabled) trace_process_start(pid, "$(...)");
+    return pid;
+}
+
+// Runs the command of a $(...) marker (text, len bytes, still holding
+// CTL_ESC bytes) and returns its output, see capture_output()
+static char *command_subst(const char *text, size_t len, size_t *out_len) {
+    static char *src = NULL;
+    static size_t src_cap = 0;
+    size_t n = 0;
+
+    if (len + 1 > src_cap) {
+        char *grown = realloc(src, len + 1);
+        if (!grown) {
+            out_of_memory();
+            return NULL;
+        }
+        src = grown;
+        src_cap = len + 1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] == CTL_ESC) i++;
+        src[n++] = text[i];
+    }
+
+    // The tree is taken out of subst_ast while the command runs: a forked
+    // copy of the shell that meets another $(...) in it then parses that
+    // into a new tree instead of overwriting the one it is running
+    struct ast ast = subst_ast;
+    memset(&subst_ast, 0, sizeof(subst_ast));
+    int parsed = ast_parse(&ast, src, n);
+    if (parsed != PARSE_OK) {
+        if (parsed == PARSE_INCOMPLETE) {
+            fprintf(stderr, "$(%.*s): unexpected end of command\n", (int)n, src);
+        }
+        subst_ast = ast;
+        return NULL;
+    }
+
+    char *output = NULL;
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+        perror("pipe failed");
+        subst_ast = ast;
+        return NULL;
+    }
+    pid_t pid = subst_start(&ast, fds[1], fds[0]);
+    close(fds[1]);
+    struct trace_mark mark;
+    if (trace_enabled) {
+        trace_flush();
+        trace_begin(&mark, "$(...)");
+    }
+    output = capture_output(fds[0], out_len);
+    if (!output) perror("command substitution");
+    close(fds[0]);
+    if (pid > 0) {
+        int wait_status = 0;
+        while (waitpid(pid, &wait_status, 0) < 0 && errno == EINTR) {
+        }
+        subst_status = exit_status(wait_status);
+    } else {
+        subst_status = 127;
+    }
+    if (trace_enabled) {
+        trace_end(&mark, TRACE_WAIT);
+        if (pid > 0) trace_process_end(pid);
+    }
+    subst_ast = ast;
+    return output;
+}
+
+// Splits a command's output at IFS characters like expand() splits a
+// variable's value. The output is ours to change, so a field that lies
+// inside it completely is '\0'-terminated where it is and goes out
+// without being copied; only text joining the word around the
+// substitution ("x$(cmd)y") goes through the field buffer. last is 1 when
+// the substitution ends the word; escape is passed to field_add_escaped().
+static int split_output(char *v, size_t len, const char *ifs, int *have, int last,
+                        const char *escape, struct arg_vec *out) {
+    char *end = v + len;
+
+    while (v < end) {
+        if (!strchr(ifs, *v) || *v == '\0') {
+            char *run = v;
+            while (v < end && (!strchr(ifs, *v) || *v == '\0')) v++;
+            // a field that needs backslashes cannot stay where it is
+            if (field_len == 0 && (v < end || last) &&
+                !(escape && memchr(run, '\\', (size_t)(v - run)))) {
+                // the separator after the field (or the output's final
+                // '\0') ends it, and is used up like field_end() would
+                *v = '\0';
+                if (arg_vec_push(out, run) != 0) return out_of_memory();
+                *have = 0;
+                if (v < end) v++;
+                continue;
+            }
+            if (field_add_escaped(run, (size_t)(v - run), escape) != 0) return out_of_memory();
+            *have = 1;
+            continue;
+        }
+        int blank = *v == ' ' || *v == '\t' || *v == '\n';
+        if ((*have || !blank) && field_end(out) != 0) return out_of_memory();
+        *have = 0;
+        v++;
+    }
+    return 0;
+}
+
+// Splits an unquoted value into fields at $IFS characters, adding its
+// start to the field being built. IFS spaces, tabs and newlines run
+// together; any other IFS character ends a field on its own, even an
+// empty one.
+static int split_value(const char *value, const char *ifs, int *have, const char *escape,
+                       struct arg_vec *out) {
+    for (const char *v = value; *v; ) {
+        if (!strchr(ifs, *v)) {
+            const char *run = v;
+            while (*v && !strchr(ifs, *v)) v++;
+            if (field_add_escaped(run, (size_t)(v - run), escape) != 0) return out_of_memory();
+            *have = 1;
+            continue;
+        }
+        int blank = *v == ' ' || *v == '\t' || *v == '\n';
+        if ((*have || !blank) && field_end(out) != 0) return out_of_memory();
+        *have = 0;
+        v++;
+    }
+    return 0;
+}
+
+// $@ and $* (which is c): the function's arguments. "$@" makes each one a
+// field of its own, "$*" joins them with the first IFS character, and
+// unquoted both split every argument on its own. Where the result is one
+// string (split 0: assignments, here-strings) "$@" joins them with spaces.
+static int expand_args(char c, int quoted, int split, const char *ifs, int *have,
+                       const char *literal, const char *active, struct arg_vec *out) {
+    size_t argc = eval_argc();
+
+    for (size_t i = 1; i <= argc; i++) {
+        const char *arg = eval_arg(i);
+        if (quoted && c == '@' && split) {
+            if (i > 1 && field_end(out) != 0) return out_of_memory();
+            if (field_add_escaped(arg, strlen(arg), literal) != 0) return out_of_memory();
+            *have = 1;
+        } else if (quoted || !split) {
+            char sep = *ifs && c == '*' ? *ifs : ' ';
+            if (i > 1 && (quoted || *ifs || c == '@') &&
+                field_add_escaped(&sep, 1, literal) != 0) {
+                return out_of_memory();
+            }
+            if (field_add_escaped(arg, strlen(arg), quoted ? literal : active) != 0) {
+                return out_of_memory();
+            }
+            if (quoted) *have = 1;
+        } else {
+            if (i > 1 && *have && field_end(out) != 0) return out_of_memory();
+            *have = 0;
+            if (split_value(arg, ifs, have, active, out) != 0) return -1;
+        }
+    }
+    // "$*" of no arguments is still one (empty) field, "$@" is none
+    if (quoted && c == '*') *have = 1;
+    if (quoted && c == '@' && split && argc == 0 && field_len == 0) *have = 0;
+    return 0;
+}
+
+// The value of the parameter called name (len bytes); "" when it is unset
+static const char *param_value(const char *name, size_t len, char *buf, size_t size) {
+    if (len == 1 && name[0] == '$') {
+        snprintf(buf, size, "%ld", (long)getpid());
+        return buf;
+    }
+    if (len == 1 && name[0] == '?') {
+        snprintf(buf, size, "%d", eval_status());
+        return buf;
+    }
+    if (len == 1 && name[0] == '#') {
+        snprintf(buf, size, "%zu", eval_argc());
+        return buf;
+    }
+    if (name[0] >= '0' && name[0] <= '9') {
+        size_t n = 0;
+        for (size_t i = 0; i < len && n <= eval_argc(); i++) n = n * 10 + (size_t)(name[i] - '0');
+        if (n == 0) return "mini-shell";
+        const char *arg = eval_arg(n);
+        return arg ? arg : "";
+    }
+    if (len >= size) return "";
+    memcpy(buf, name, len);
+    buf[len] = '\0';
+    const char *value = var_get(buf);
+    return value ? value : "";
+}
+
+// Expands text into out: the values of $NAME and the output of $(command)
+// replace the markers, and with split set, an unquoted value is split into
+// fields at $IFS characters. With glob set, the fields are written as
+// patterns for glob_fields(): literal pattern characters get a backslash.
+// have is 1 when the field exists even if it stays empty ("", '').
+static int expand(const char *text, int split, int have, int glob, struct arg_vec *out) {
+    const char *ifs = var_get("IFS");
+    const char *literal = glob ? GLOB_LITERAL : NULL;
+    const char *active = glob ? GLOB_ACTIVE : NULL;
+    char name[256];
+
+    if (!ifs) ifs = " \t\n";
+    field_len = 0;
+    for (const char *p = text; *p; ) {
+        if (*p == CTL_ESC) {
+            if (field_add_escaped(p + 1, 1, literal) != 0) return out_of_memory();
+            have = 1;
+            p += 2;
+            continue;
+        }
+        if (*p == CTL_SUBST || *p == CTL_QSUBST) {
+            int quoted = *p == CTL_QSUBST;
+            const char *start = ++p;
+            size_t len;
+            while (*p != CTL_END) p += *p == CTL_ESC ? 2 : 1;
+            char *output = command_subst(start, (size_t)(p - start), &len);
+            p++;
+            if (!output) return -1;
+
+            if (quoted || !split) {
+                if (field_len == 0 && !*p && !glob) {
+                    // the whole word: the output is the field as it is
+                    if (arg_vec_push(out, output) != 0) return out_of_memory();
+                    return 0;
+                }
+                if (field_add_escaped(output, len, quoted ? literal : active) != 0) {
+                    return out_of_memory();
+                }
+                if (quoted) have = 1;
+            } else if (split_output(output, len, ifs, &have, !*p, active, out) != 0) {
+                return -1;
+            }
+            continue;
+        }
+        if (*p != CTL_VAR && *p != CTL_QVAR) {
+            const char *run = p;
+            while (*p && *p != CTL_ESC && *p != CTL_VAR && *p != CTL_QVAR &&
+                   *p != CTL_SUBST && *p != CTL_QSUBST) {
+                p++;
+            }
+            if (field_add_escaped(run, (size_t)(p - run), active) != 0) return out_of_memory();
+            have = 1;
+            continue;
+        }
+
+        int quoted = *p == CTL_QVAR;
+        const char *start = ++p;
+        while (*p != CTL_END) p++;
+        p++;
+        if (*start == '@' || *start == '*') {
+            if (expand_args(*start, quoted, split, ifs, &have, literal, active, out) != 0) {
+                return -1;
+            }
+            continue;
+        }
+        const char *value = param_value(start, (size_t)(p - 1 - start), name, sizeof(name));
+
+        if (quoted || !split) {
+            if (field_add_escaped(value, strlen(value), quoted ? literal : active) != 0) {
+                return out_of_memory();
+            }
+            if (quoted) have = 1;
+            continue;
+        }
+        if (split_value(value, ifs, &have, active, out) != 0) return -1;
+    }
+    if (have && field_end(out) != 0) return out_of_memory();
+    return 0;
+}
+
+int expand_word(const struct ast *ast, const struct node *word, struct arg_vec *out) {
+    char *text = ast->text + word->first;
+
+    // most words hold no expansion and go out as they are
+    if (!(word->flags & NODE_EXPAND)) {
+        return arg_vec_push(out, text) != 0 ? out_of_memory() : 0;
+    }
+    size_t start = out->len;
+    int glob = (word->flags & NODE_GLOB) != 0;
+    if (expand(text, 1, word->flags & NODE_QUOTED, glob, out) != 0) return -1;
+    if (glob && glob_fields(out, start) != 0) return out_of_memory();
+    return 0;
+}
+
+char *expand_string(const struct ast *ast, const struct node *word) {
+    static struct arg_vec one = {NULL, 0, 0};
+    char *text = ast->text + word->first;
+
+    if (!(word->flags & NODE_EXPAND)) return text;
+    one.len = 0;
+    if (expand(text, 0, 1, 0, &one) != 0) return NULL;
+    return one.argv[0];
+}
+
+char *expand_target(const struct ast *ast, const struct node *word) {
+    static struct arg_vec fields = {NULL, 0, 0};
+    char *text = ast->text + word->first;
+
+    if (!(word->flags & NODE_EXPAND)) return text;
+    fields.len = 0;
+    if (expand_word(ast, word, &fields) != 0) return NULL;
+    if (fields.len != 1) {
+        fprintf(stderr, "%s: ambiguous redirect\n", word_source(ast, word));
+        return NULL;
+    }
+    return fields.argv[0];
+}
+
+void word_print(FILE *out, const char *text) {
+    for (const char *p = text; *p; p++) {
+        if (*p == CTL_ESC) {
+            fputc(*++p, out);
+        } else if (*p == CTL_VAR || *p == CTL_QVAR) {
+            const char *start = ++p;
+            while (*p != CTL_END) p++;
+            fprintf(out, "${%.*s}", (int)(p - start), start);
+        } else if (*p == CTL_SUBST || *p == CTL_QSUBST) {
+            fputs("$(", out);
+            for (p++; *p != CTL_END; p++) {
+                if (*p == CTL_ESC) p++;
+                fputc(*p, out);
+            }
+            fputc(')', out);
+        } else {
+            fputc(*p, out);
+        }
+    }
+}
+
+const char *word_source(const struct ast *ast, const struct node *word) {
+    static char *buf = NULL;
+    static size_t size = 0;
+    const char *text = ast->text + word->first;
+
+    if (!(word->flags & NODE_EXPAND)) return text;
+
+    free(buf);
+    buf = NULL;
+    FILE *out = open_memstream(&buf, &size);
+    if (!out) return text;
+    word_print(out, text);
+    fclose(out);
+    return buf;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+EXPAND MODULE EXPLANATION:
+Turns the words of a parsed command into the strings a program gets, right
+before the command runs:
+    echo $HOME "${USER}'s" '$HOME' $(uname -m)
+    -> echo /home/ann ann's $HOME x86_64
+The values are looked up when the command runs, not when the line is
+parsed, so "X=1; echo $X" sees the new value.
+
+HOW THE PARSER MARKS EXPANSIONS:
+The lexer (parser.c) removes quotes while it copies a word into the text
+pool, so afterwards "$A" and '$A' would look the same. Instead it leaves
+markers in the text, control bytes 1 to 4 (CTL_* in shell.h):
+    CTL_VAR name CTL_END     $name outside quotes
+    CTL_QVAR name CTL_END    $name inside "double quotes"
+    CTL_SUBST text CTL_END   $(text) outside quotes
+    CTL_QSUBST text CTL_END  "$(text)"
+    CTL_ESC c                the byte c, literally (for input containing
+                             the control bytes themselves)
+A word holding any of them has NODE_EXPAND set. Every other word, most of
+them in practice, is passed on as the pointer into the text pool, with no
+copying at all.
+
+FIELD SPLITTING:
+A $NAME outside double quotes is split at the characters of $IFS (space,
+tab and newline when IFS is unset), so with A="-l -a", "ls $A" runs ls with
+two arguments, and an empty $A disappears instead of becoming "". Inside
+double quotes the value stays one argument. Runs of spaces, tabs and
+newlines count as one separator; any other IFS character separates on its
+own (IFS=: turns "a::b" into a, "", b).
+
+PATTERNS:
+A word with NODE_GLOB (an unquoted *, ? or [, or an unquoted expansion) is
+expanded with glob set: its fields are written in pattern form, where a
+backslash makes the next character literal. Quoted characters and quoted
+values get one before \ * ? and [ (GLOB_LITERAL), unquoted text and values
+only before \ (GLOB_ACTIVE): in "$D"*.c a star in the value of D only
+matches a star, while the last one matches any text. glob_fields() (glob.c) then replaces each pattern
+with the file names it matches and removes the backslashes from the rest.
+
+COMMAND SUBSTITUTION:
+$(command) runs the command and is replaced by its output, minus trailing
+newlines. command_subst() parses the text with ast_parse() and starts it
+with its stdout on a pipe:
+- a plain program call ("$(date +%F)", simple_command()) is launched with
+  launch_command(), the same posix_spawn() path every program takes
+- anything else (builtins, pipes, &&, "$(cd dir && pwd)") runs in a
+  forked copy of the shell, so "cd" or "X=1" inside cannot change the
+  shell itself
+The output is read with read() calls of at least 64 KiB into a capture
+buffer that only grows (doubling), so there is no allocation per piece,
+and usually none at all: the buffers are kept for the next pipeline.
+Buffers above 1 MiB are freed again by expand_reset().
+
+Splitting the output does not copy it either. The buffer belongs to this
+pipeline, so split_output() writes a '\0' over the separator after each
+field and the argv entry points straight into the buffer. Only text that
+joins a word around the substitution ("x$(cmd)y": the first and last
+field) goes through the field buffer. "$(cat file)" as a whole word is
+passed on as the buffer itself.
+
+Each substitution of a pipeline gets its own buffer, since the fields of
+"$(a) $(b)" must all stay valid until the command runs. A substitution
+inside a forked copy (nested "$(a $(b))") works on that process's copies
+of the buffers and of the parsed tree; subst_ast is emptied while its
+tree runs, so the nested one is parsed into a tree of its own.
+The substitution's exit status is kept in subst_status: "X=$(cmd)" has no
+command of its own, so pipeline.c makes cmd's status the line's status
+(expand_subst_status()), and "X=$(cmd) || exit" works as in other shells.
+
+MEMORY:
+Expanded strings are built in one growing buffer (field) and then copied
+into blocks of at least 4 KiB that are never moved or reallocated, so the
+argv pointers into them stay valid while the pipeline runs.
+expand_reset(), called before the next pipeline's words are expanded, frees
+all blocks but one, which is reused.
+
+FUNCTION IMPLEMENTATIONS:
+
+1. int expand_word(const struct ast *ast, const struct node *word,
+                   struct arg_vec *out)
+   PURPOSE: Appends the fields of word to out (none, one or several)
+   RETURN VALUE: 0, or -1 after printing an error (out of memory, a
+   $(command) that could not be parsed)
+
+   Patterns among the fields are replaced by the file names they match.
+
+2. char *expand_string(const struct ast *ast, const struct node *word)
+   PURPOSE: Expands word into exactly one string without splitting, as for
+   the "NAME=value" of an assignment (A=$B keeps the spaces of B)
+
+3. char *expand_target(const struct ast *ast, const struct node *word)
+   PURPOSE: Expands a redirection target. It must give exactly one field;
+   "> $F" with F unset or holding spaces prints "ambiguous redirect"
+   RETURN VALUE: the string, or NULL after printing an error
+
+4. char *expand_save(const char *s, size_t len)
+   PURPOSE: Copies s into the blocks, where it lives until expand_reset()
+   (glob.c keeps the matched file names there)
+
+5. void word_print(FILE *out, const char *text)
+   const char *word_source(const struct ast *ast, const struct node *word)
+   PURPOSE: Show a word with ${NAME} in place of the markers, for messages
+   and the command text of background jobs. word_source() returns a buffer
+   that is overwritten by the next call.
+
+EXTERNAL FUNCTIONS USED:
+- open_memstream(&buf, &size): a FILE that writes into a growing buffer
+- getpid(): the shell's process ID, the value of $$; $? is eval_status()
+  (eval.c), the status of the last pipeline
+- pipe2(fds, O_CLOEXEC): the pipe a substitution's output comes through;
+  close-on-exec keeps it out of every other program
+- read(fd, buf, n): returns up to n bytes, 0 at the end of the output
+- fork() / _exit(): the copy of the shell that runs a complex substitution
+- waitpid(pid, NULL, 0): collects the finished substitution
+*/
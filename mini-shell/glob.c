@@ -0,0 +1,615 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "shell.h"
+
+// Directory listings kept between globs; the least recently used one is
+// replaced when a new directory comes along
+#define DIR_CACHE_SIZE 16
+
+// A listing read less than this many seconds after the directory changed
+// is read again next time: a second change within the same timestamp tick
+// would leave the mtime as it was
+#define DIR_RACY_SEC 1
+
+// Longest pattern component that can match: a name has at most 255 bytes
+#define GLOB_MAX_ATOMS 256
+
+struct dir_entry {
+    uint32_t name;          // offset of the name in names
+    uint32_t len;
+    unsigned char type;     // d_type: DT_DIR, DT_LNK, DT_UNKNOWN, ...
+};
+
+struct dir_listing {
+    char *path;             // as written in the pattern, "" for "."
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;  // of the directory when it was read
+    int racy;               // see DIR_RACY_SEC
+    int busy;               // being walked: must not be replaced
+    unsigned long used;     // when it was last used, for replacement
+    char *names;            // every name, '\0'-terminated, back to back
+    struct dir_entry *entries;  // sorted by name
+    size_t count;
+};
+
+static struct dir_listing **dir_cache = NULL;
+static size_t dir_cache_len = 0;
+static unsigned long dir_clock = 0;
+
+static int entry_cmp(const void *a, const void *b, void *names) {
+    return strcmp((const char *)names + ((const struct dir_entry *)a)->name,
+                  (const char *)names + ((const struct dir_entry *)b)->name);
+}
+
+// Reads the directory into l, sorted, so every later glob over it gives
+// its matches in order without sorting them again
+static int read_listing(struct dir_listing *l, const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) return -1;
+
+    size_t names_len = 0, names_cap = 0, cap = 0;
+    char *names = NULL;
+    struct dir_entry *entries = NULL;
+    size_t count = 0;
+    struct dirent *de;
+
+    while ((de = readdir(d))) {
+        if (de->d_name[0] == '.' && (!de->d_name[1] || (de->d_name[1] == '.' && !de->d_name[2]))) {
+            continue;
+        }
+        size_t len = strlen(de->d_name);
+        if (names_len + len + 1 > names_cap || count == cap) {
+            if (names_len + len + 1 > UINT32_MAX) break;
+            size_t new_names = names_cap ? names_cap : 4096;
+            while (new_names < names_len + len + 1) new_names *= 2;
+            size_t new_cap = count == cap ? (cap ? cap * 2 : 64) : cap;
+            char *grown_names = realloc(names, new_names);
+            if (grown_names) names = grown_names;
+            struct dir_entry *grown = realloc(entries, new_cap * sizeof(*grown));
+            if (grown) entries = grown;
+            if (!grown_names || !grown) {
+                free(names);
+                free(entries);
+                closedir(d);
+                return -1;
+            }
+            names_cap = new_names;
+            cap = new_cap;
+        }
+        memcpy(names + names_len, de->d_name, len + 1);
+        entries[count].name = (uint32_t)names_len;
+        entries[count].len = (uint32_t)len;
+        entries[count].type = de->d_type;
+        count++;
+        names_len += len + 1;
+    }
+    closedir(d);
+    if (count > 0) qsort_r(entries, count, sizeof(*entries), entry_cmp, names);
+
+    free(l->names);
+    free(l->entries);
+    l->names = names;
+    l->entries = entries;
+    l->count = count;
+    return 0;
+}
+
+// The listing of dir ("" for the current directory), read again only if
+// the directory changed since it was cached. NULL if it is not a
+// directory that can be read.
+static struct dir_listing *dir_listing_get(const char *dir) {
+    const char *open_path = *dir ? dir : ".";
+    struct dir_listing *l = NULL;
+    struct stat st;
+
+    if (stat(open_path, &st) != 0 || !S_ISDIR(st.st_mode)) return NULL;
+
+    for (size_t i = 0; i < dir_cache_len; i++) {
+        if (strcmp(dir_cache[i]->path, dir) == 0) {
+            l = dir_cache[i];
+            break;
+        }
+    }
+    if (l && !l->racy && l->dev == st.st_dev && l->ino == st.st_ino &&
+        l->mtime.tv_sec == st.st_mtim.tv_sec && l->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+        l->used = ++dir_clock;
+        return l;
+    }
+
+    if (!l) {
+        // a free slot, or the least recently used listing nobody walks
+        for (size_t i = 0; i < dir_cache_len; i++) {
+            if (!dir_cache[i]->busy && (!l || dir_cache[i]->used < l->used)) l = dir_cache[i];
+        }
+        if (dir_cache_len < DIR_CACHE_SIZE || !l) {
+            struct dir_listing **grown = realloc(dir_cache, (dir_cache_len + 1) * sizeof(*grown));
+            if (!grown) return NULL;
+            dir_cache = grown;
+            l = calloc(1, sizeof(*l));
+            if (!l) return NULL;
+            dir_cache[dir_cache_len++] = l;
+        }
+        char *path = strdup(dir);
+        if (!path) return NULL;
+        free(l->path);
+        l->path = path;
+        l->count = 0;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    if (read_listing(l, open_path) != 0) {
+        l->mtime.tv_sec = -1;   // never matches: read again next time
+        l->count = 0;
+        return NULL;
+    }
+    l->dev = st.st_dev;
+    l->ino = st.st_ino;
+    l->mtime = st.st_mtim;
+    l->racy = st.st_mtim.tv_sec + DIR_RACY_SEC >= now.tv_sec;
+    l->used = ++dir_clock;
+    return l;
+}
+
+void glob_cache_clear(void) {
+    for (size_t i = 0; i < dir_cache_len; i++) {
+        free(dir_cache[i]->path);
+        free(dir_cache[i]->names);
+        free(dir_cache[i]->entries);
+        free(dir_cache[i]);
+    }
+    free(dir_cache);
+    dir_cache = NULL;
+    dir_cache_len = 0;
+}
+
+// One position of a compiled pattern: the set of bytes it accepts, a bit
+// per byte value, so matching a byte is one table lookup
+struct glob_atom {
+    uint32_t bits[8];
+};
+
+// A run of atoms between two '*'. Every atom matches exactly one byte, so a
+// segment has a fixed length and can be tried at any position directly.
+struct glob_seg {
+    uint32_t first;         // index of its first atom
+    uint32_t len;
+    int literal;            // only plain characters: compare with memcmp()
+};
+
+struct glob_pat {
+    struct glob_atom atoms[GLOB_MAX_ATOMS];
+    char chars[GLOB_MAX_ATOMS];     // the character of each plain atom
+    struct glob_seg segs[GLOB_MAX_ATOMS];
+    size_t natoms;
+    size_t nsegs;
+    int star_start;         // begins with '*'
+    int star_end;           // ends with '*'
+    int dot;                // begins with a literal '.': may match dot files
+};
+
+static void atom_set(struct glob_atom *a, unsigned char c) {
+    a->bits[c >> 5] |= 1u << (c & 31);
+}
+
+static int atom_has(const struct glob_atom *a, unsigned char c) {
+    return (a->bits[c >> 5] >> (c & 31)) & 1;
+}
+
+// Parses the bracket expression at p ("[a-z]", "[!0-9]", "[[:alpha:]_]")
+// into a. Returns the position after its ']', or NULL when there is no
+// ']': then the '[' is an ordinary character.
+static const char *parse_bracket(const char *p, const char *end, struct glob_atom *a) {
+    static const struct {
+        const char *name;
+        int (*test)(int);
+    } classes[] = {
+        {"alnum", isalnum}, {"alpha", isalpha}, {"blank", isblank}, {"cntrl", iscntrl},
+        {"digit", isdigit}, {"graph", isgraph}, {"lower", islower}, {"print", isprint},
+        {"punct", ispunct}, {"space", isspace}, {"upper", isupper}, {"xdigit", isxdigit},
+    };
+    const char *q = p + 1;
+    int negate = 0;
+
+    memset(a, 0, sizeof(*a));
+    if (q < end && (*q == '!' || *q == '^')) {
+        negate = 1;
+        q++;
+    }
+    // a ']' right at the start is one of the characters
+    for (int first = 1; q < end && (*q != ']' || first); first = 0) {
+        if (*q == '[' && q + 1 < end && q[1] == ':') {
+            const char *close = memmem(q + 2, (size_t)(end - q - 2), ":]", 2);
+            size_t n = close ? (size_t)(close - q - 2) : 0;
+            size_t k = 0;
+            while (k < sizeof(classes) / sizeof(classes[0]) &&
+                   !(strlen(classes[k].name) == n && memcmp(classes[k].name, q + 2, n) == 0)) {
+                k++;
+            }
+            if (close && k < sizeof(classes) / sizeof(classes[0])) {
+                for (int c = 1; c < 256; c++) {
+                    if (classes[k].test(c)) atom_set(a, (unsigned char)c);
+                }
+                q = close + 2;
+                continue;
+            }
+        }
+        unsigned char lo = (unsigned char)*q;
+        if (*q == '\\' && q + 1 < end) lo = (unsigned char)*++q;
+        q++;
+        unsigned char hi = lo;
+        if (q + 1 < end && *q == '-' && q[1] != ']') {
+            q++;
+            hi = (unsigned char)*q;
+            if (*q == '\\' && q + 1 < end) hi = (unsigned char)*++q;
+            q++;
+        }
+        for (unsigned c = lo; c <= hi; c++) atom_set(a, (unsigned char)c);
+    }
+    if (q >= end) return NULL;
+
+    if (negate) {
+        for (int i = 0; i < 8; i++) a->bits[i] = ~a->bits[i];
+    }
+    // no pattern matches '/' or the end of a name
+    a->bits[0] &= ~1u;
+    a->bits['/' >> 5] &= ~(1u << ('/' & 31));
+    return q + 1;
+}
+
+// Compiles one component of a pattern (p up to end, no '/'). Returns -1
+// if it has too many positions to match any name.
+static int compile(struct glob_pat *g, const char *p, const char *end) {
+    struct glob_seg *seg = NULL;
+
+    g->natoms = 0;
+    g->nsegs = 0;
+    g->star_start = p < end && *p == '*';
+    g->star_end = 0;
+    g->dot = p < end && (*p == '.' || (*p == '\\' && p + 1 < end && p[1] == '.'));
+    while (p < end) {
+        if (*p == '*') {
+            seg = NULL;
+            g->star_end = 1;
+            p++;
+            continue;
+        }
+        if (g->natoms == GLOB_MAX_ATOMS) return -1;
+        struct glob_atom *a = &g->atoms[g->natoms];
+        const char *next = NULL;
+        int plain = 0;
+
+        g->star_end = 0;
+        if (*p == '?') {
+            memset(a, 0xff, sizeof(*a));
+            a->bits[0] &= ~1u;
+            next = p + 1;
+        } else if (*p == '[') {
+            next = parse_bracket(p, end, a);
+        }
+        if (!next) {
+            if (*p == '\\' && p + 1 < end) p++;
+            memset(a, 0, sizeof(*a));
+            atom_set(a, (unsigned char)*p);
+            g->chars[g->natoms] = *p;
+            plain = 1;
+            next = p + 1;
+        }
+        if (!seg) {
+            seg = &g->segs[g->nsegs++];
+            seg->first = (uint32_t)g->natoms;
+            seg->len = 0;
+            seg->literal = 1;
+        }
+        seg->len++;
+        seg->literal &= plain;
+        g->natoms++;
+        p = next;
+    }
+    return 0;
+}
+
+static int seg_at(const struct glob_pat *g, const struct glob_seg *seg, const char *s) {
+    if (seg->literal) return memcmp(g->chars + seg->first, s, seg->len) == 0;
+    for (uint32_t i = 0; i < seg->len; i++) {
+        if (!atom_has(&g->atoms[seg->first + i], (unsigned char)s[i])) return 0;
+    }
+    return 1;
+}
+
+// Leftmost position in s[from, to) where seg matches, or NULL
+static const char *seg_find(const struct glob_pat *g, const struct glob_seg *seg,
+                            const char *from, const char *to) {
+    if ((size_t)(to - from) < seg->len) return NULL;
+    if (seg->literal) return memmem(from, (size_t)(to - from), g->chars + seg->first, seg->len);
+
+    const struct glob_atom *a = &g->atoms[seg->first];
+    for (const char *s = from; s + seg->len <= to; s++) {
+        if (atom_has(a, (unsigned char)*s) && seg_at(g, seg, s)) return s;
+    }
+    return NULL;
+}
+
+// Whether the name (len bytes) matches. Segments sit between '*'s, so the
+// first and the last are anchored to the ends of the name and every other
+// one may take its leftmost place: if any placement works, that one does.
+static int pat_match(const struct glob_pat *g, const char *name, size_t len) {
+    const char *s = name;
+    const char *end = name + len;
+    size_t first = 0;
+    size_t last = g->nsegs;
+
+    if (g->nsegs == 0) return g->star_start || len == 0;
+    if (!g->star_start) {
+        const struct glob_seg *seg = &g->segs[0];
+        if (len < seg->len || !seg_at(g, seg, s)) return 0;
+        if (g->nsegs == 1 && !g->star_end) return len == seg->len;
+        s += seg->len;
+        first = 1;
+    }
+    if (!g->star_end) {
+        const struct glob_seg *seg = &g->segs[g->nsegs - 1];
+        if ((size_t)(end - s) < seg->len || !seg_at(g, seg, end - seg->len)) return 0;
+        end -= seg->len;
+        last--;
+    }
+    for (size_t i = first; i < last; i++) {
+        const struct glob_seg *seg = &g->segs[i];
+        s = seg_find(g, seg, s, end);
+        if (!s) return 0;
+        s += seg->len;
+    }
+    return 1;
+}
+
+// Whether p up to end has an unescaped *, ? or complete [...]
+static int has_meta(const char *p, const char *end) {
+    struct glob_atom scratch;
+
+    for (; p < end; p++) {
+        if (*p == '\\' && p + 1 < end) {
+            p++;
+        } else if (*p == '*' || *p == '?') {
+            return 1;
+        } else if (*p == '[' && parse_bracket(p, end, &scratch)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int glob_has_meta(const char *pattern) {
+    return has_meta(pattern, pattern + strlen(pattern));
+}
+
+void glob_unescape(char *s) {
+    char *out = strchr(s, '\\');
+
+    if (!out) return;
+    for (const char *p = out; *p; p++) {
+        if (*p == '\\' && p[1]) p++;
+        *out++ = *p;
+    }
+    *out = '\0';
+}
+
+// The path being matched, built up one component at a time
+static char *path_buf = NULL;
+static size_t path_cap = 0;
+
+static int path_reserve(size_t need) {
+    if (need <= path_cap) return 0;
+    size_t new_cap = path_cap ? path_cap : 256;
+    while (new_cap < need) new_cap *= 2;
+    char *grown = realloc(path_buf, new_cap);
+    if (!grown) return -1;
+    path_buf = grown;
+    path_cap = new_cap;
+    return 0;
+}
+
+// Matches pat (what is left of the pattern) below the directory
+// path_buf[0, len), which is "" or ends with '/'. Appends the matches to
+// out and returns their number, or -1.
+static long walk(size_t len, const char *pat, struct arg_vec *out) {
+    const char *slash = strchr(pat, '/');
+    const char *comp_end = slash ? slash : pat + strlen(pat);
+    const char *rest = slash;
+    struct stat st;
+    long found = 0;
+
+    if (rest) {
+        while (*rest == '/') rest++;
+    }
+
+    if (!has_meta(pat, comp_end)) {
+        // a plain component ("src" in "src/*.c") needs no listing
+        if (path_reserve(len + (size_t)(comp_end - pat) + 2) != 0) return -1;
+        for (const char *p = pat; p < comp_end; p++) {
+            if (*p == '\\' && p + 1 < comp_end) p++;
+            path_buf[len++] = *p;
+        }
+        if (slash) path_buf[len++] = '/';
+        path_buf[len] = '\0';
+        if (rest && *rest) return walk(len, rest, out);
+        if (lstat(path_buf, &st) != 0 || (slash && !S_ISDIR(st.st_mode))) return 0;
+        if (arg_vec_push(out, expand_save(path_buf, len)) != 0) return -1;
+        return 1;
+    }
+
+    // compiled per level: a deeper level compiles its own component
+    struct glob_pat *g = malloc(sizeof(*g));
+    if (!g || path_reserve(len + 1) != 0) {
+        free(g);
+        return -1;
+    }
+    if (compile(g, pat, comp_end) != 0) {
+        free(g);
+        return 0;
+    }
+    path_buf[len] = '\0';
+    struct dir_listing *l = dir_listing_get(len ? path_buf : "");
+    if (!l) {
+        free(g);
+        return 0;
+    }
+
+    l->busy++;
+    for (size_t i = 0; i < l->count && found >= 0; i++) {
+        const struct dir_entry *e = &l->entries[i];
+        const char *name = l->names + e->name;
+
+        if (name[0] == '.' && !g->dot) continue;
+        if (!pat_match(g, name, e->len)) continue;
+        // only a directory (or a link that may lead to one) has more below
+        if (slash && e->type != DT_DIR && e->type != DT_LNK && e->type != DT_UNKNOWN) continue;
+
+        if (path_reserve(len + e->len + 2) != 0) {
+            found = -1;
+            break;
+        }
+        memcpy(path_buf + len, name, e->len);
+        size_t sub = len + e->len;
+        if (slash) path_buf[sub++] = '/';
+        path_buf[sub] = '\0';
+
+        if (rest && *rest) {
+            long n = walk(sub, rest, out);
+            found = n < 0 ? -1 : found + n;
+        } else if (!slash || (stat(path_buf, &st) == 0 && S_ISDIR(st.st_mode))) {
+            char *copy = expand_save(path_buf, sub);
+            found = copy && arg_vec_push(out, copy) == 0 ? found + 1 : -1;
+        }
+    }
+    l->busy--;
+    free(g);
+    return found;
+}
+
+long glob_expand(const char *pattern, struct arg_vec *out) {
+    return walk(0, pattern, out);
+}
+
+int glob_fields(struct arg_vec *v, size_t start) {
+    static struct arg_vec patterns = {NULL, 0, 0};
+    size_t i = start;
+
+    // usually no field is a pattern after all ("[", "$var")
+    while (i < v->len && !glob_has_meta(v->argv[i])) glob_unescape(v->argv[i++]);
+    if (i == v->len) return 0;
+
+    patterns.len = 0;
+    for (size_t k = i; k < v->len; k++) {
+        if (arg_vec_push(&patterns, v->argv[k]) != 0) return -1;
+    }
+    v->len = i;
+    for (size_t k = 0; k < patterns.len; k++) {
+        char *field = patterns.argv[k];
+        long n = glob_has_meta(field) ? glob_expand(field, v) : 0;
+
+        if (n < 0) return -1;
+        if (n == 0) {
+            // no match: the pattern stays as it was written, like in sh
+            glob_unescape(field);
+            if (arg_vec_push(v, field) != 0) return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+GLOB MODULE EXPLANATION:
+Pathname expansion ("globbing"): a word with *, ? or [...] outside quotes
+is replaced by the names of the files it matches, in sorted order:
+    ls *.c          -> ls builtins.c eval.c executor.c ...
+    cat src/?/[a-m]*.txt
+    echo "*.c" \*   -> echo *.c *  (quoted: no expansion)
+A pattern that matches nothing stays as it was written, like in sh. Names
+starting with '.' are only matched by a pattern that starts with '.'.
+
+HOW A PATTERN REACHES THIS MODULE:
+The lexer (parser.c) sets NODE_GLOB on a word with an unquoted *, ? or [
+(or an unquoted $NAME or $(...), whose value may hold them) and puts
+CTL_ESC before the quoted ones. expand.c then writes the fields of such a
+word in pattern form: a character that must not be special gets a
+backslash ("\*"). glob_fields() looks at each field: a real pattern is
+matched against the file system, anything else just loses the
+backslashes (glob_unescape()).
+
+DIRECTORY CACHE:
+Globbing the same large directory over and over, in a loop or a script,
+would read the whole directory every time: readdir() of 100000 names takes
+milliseconds. dir_listing_get() keeps the sorted listings of the last 16
+directories (DIR_CACHE_SIZE) and checks them with a single stat() of the
+directory: creating, removing or renaming a file changes the directory's
+mtime, so an unchanged mtime (and the same device and inode, since "."
+names another directory after cd) means the listing is still right.
+- The one weak spot of mtime checks: a change in the same clock tick as
+  the mtime we saw leaves the mtime unchanged. A listing read less than
+  DIR_RACY_SEC after the directory last changed is therefore marked racy
+  and read again next time, until the directory has been quiet for long
+  enough (git treats its index the same way).
+- The listing is sorted once when it is read, so matches come out in order
+  without sorting per glob. Entries keep the offset of their name in one
+  buffer of names instead of a pointer, so the buffer may move while it
+  grows.
+- A listing being walked is "busy" and never replaced by a deeper level of
+  the same pattern (one with a pattern in several components); the cache
+  grows past 16 entries instead.
+
+MATCHING:
+Each pattern component is compiled once per glob into segments, the runs
+between the stars: "f*1?.txt" has "f" and "1?.txt". Every position of a
+segment matches exactly one byte and is stored as a 256-bit set, so
+testing a byte is one lookup, whether the position is a plain character,
+"?" or "[a-z]". Segments of plain characters are compared with memcmp()
+and searched with memmem(), which glibc implements with SIMD
+instructions, comparing 16 or 32 bytes at a time.
+A name is matched without backtracking: the first segment must sit at the
+start of the name, the last one at its end, and each one in between at
+the leftmost place where it fits; if the segments fit anywhere, they fit
+there. "*.c" is therefore one suffix compare per name.
+
+FUNCTION IMPLEMENTATIONS:
+
+1. int glob_fields(struct arg_vec *v, size_t start)
+   PURPOSE: Expands the fields v->argv[start..] (in pattern form) into
+   the matching file names
+   RETURN VALUE: 0, or -1 when memory runs out
+
+2. long glob_expand(const char *pattern, struct arg_vec *out)
+   PURPOSE: Appends the files matching pattern to out, in sorted order
+   RETURN VALUE: number of matches, or -1 when memory runs out
+   The names are copied with expand_save() and so live until
+   expand_reset(), like every other expanded word.
+
+3. int glob_has_meta(const char *pattern) / void glob_unescape(char *s)
+   PURPOSE: Whether a field is a pattern at all; remove the backslashes
+   of a field that is not
+
+4. void glob_cache_clear(void)
+   PURPOSE: Forgets every cached listing ("hash -r" calls it)
+
+EXTERNAL FUNCTIONS USED:
+- opendir(path) / readdir(dir) / closedir(dir): list a directory; d_type
+  tells directories apart without a stat() per name (DT_UNKNOWN on file
+  systems that do not fill it in)
+- stat(path, &st): st_mtim is the directory's modification time, with
+  nanoseconds; st_dev and st_ino identify the directory itself
+- lstat(path, &st): like stat(), but does not follow a symbolic link
+- qsort_r(base, n, size, cmp, arg): sorts the listing by name; arg
+  passes the names buffer to the comparison, since entries hold offsets
+- memmem(hay, hay_len, needle, needle_len): finds a byte string
+- isalpha() and friends (<ctype.h>): the [:class:] sets
+*/
@@ -0,0 +1,666 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "shell.h"
+
+#define HISTORY_FILE ".mini_shell_history"
+#define NEWEST_BLOCK 64
+
+// One history entry: where its text starts and how long it is
+struct hist_line {
+    const char *text;
+    size_t len;
+};
+
+// A distinct command text of the mapped log and its newest entry number
+struct hist_text {
+    struct hist_line line;
+    size_t latest;
+};
+
+static int hist_fd = -1;
+
+// Entries from earlier sessions: the log file, mapped read-only. They
+// never change, so the indexes below are built once, on first use.
+static const char *map = NULL;
+static size_t map_size = 0;
+static struct hist_line *map_lines = NULL;  // NULL until indexed
+static size_t map_count = 0;
+
+// Newest entry number at each position of a sorted index, and the maximum
+// of every NEWEST_BLOCK positions, to find the newest entry in a range
+struct newest_index {
+    uint32_t *latest;
+    uint32_t *block_max;
+    size_t n;
+};
+
+// Prefix index: the distinct texts of map_lines, sorted
+static struct hist_text *texts = NULL;
+static size_t ntexts = 0;
+static struct newest_index text_newest;
+
+// Substring index: a suffix array over the sorted texts joined with '\0'
+static char *blob = NULL;
+static uint32_t *suffixes = NULL;
+static size_t nsuffixes = 0;
+static struct newest_index suffix_newest;
+
+// Entries added in this session (one '\n'-terminated line each in tail_buf)
+static char *tail_buf = NULL;
+static size_t tail_len = 0, tail_cap = 0;
+static size_t *tail_offsets = NULL;
+static size_t tail_count = 0, tail_offsets_cap = 0;
+
+// Output of history_expand(), reused for every line
+static char *expand_buf = NULL;
+static size_t expand_cap = 0;
+
+int history_open(const char *path) {
+    char default_path[4096];
+    struct stat st;
+
+    if (!path) {
+        const char *home = getenv("HOME");
+        if (!home) return -1;
+        snprintf(default_path, sizeof(default_path), "%s/%s", home, HISTORY_FILE);
+        path = default_path;
+    }
+
+    hist_fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (hist_fd < 0) return -1;
+
+    // map the whole log without reading it: startup costs the same for ten
+    // entries or ten million
+    if (fstat(hist_fd, &st) == 0 && st.st_size > 0) {
+        void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, hist_fd, 0);
+        if (m != MAP_FAILED) {
+            map = m;
+            map_size = (size_t)st.st_size;
+        }
+    }
+    return 0;
+}
+
+// Splits the mapped log into lines, the first time an entry is needed
+static int index_lines(void) {
+    if (map_lines || !map) return 0;
+
+    size_t count = 0;
+    for (const char *p = map; p < map + map_size; count++) {
+        const char *nl = memchr(p, '\n', (size_t)(map + map_size - p));
+        p = nl ? nl + 1 : map + map_size;
+    }
+
+    map_lines = malloc((count ? count : 1) * sizeof(*map_lines));
+    if (!map_lines) return -1;
+
+    const char *p = map;
+    for (size_t i = 0; i < count; i++) {
+        const char *nl = memchr(p, '\n', (size_t)(map + map_size - p));
+        const char *end = nl ? nl : map + map_size;
+        map_lines[i].text = p;
+        map_lines[i].len = (size_t)(end - p);
+        p = end + 1;
+    }
+    map_count = count;
+    return 0;
+}
+
+size_t history_count(void) {
+    if (index_lines() != 0) return tail_count;
+    return map_count + tail_count;
+}
+
+const char *history_entry(size_t n, size_t *len) {
+    if (n == 0 || index_lines() != 0) return NULL;
+    if (n <= map_count) {
+        *len = map_lines[n - 1].len;
+        return map_lines[n - 1].text;
+    }
+    n -= map_count;
+    if (n > tail_count) return NULL;
+
+    size_t start = tail_offsets[n - 1];
+    size_t end = n < tail_count ? tail_offsets[n] : tail_len;
+    *len = end - start - 1;     // without the '\n'
+    return tail_buf + start;
+}
+
+// The newest entry, found without indexing the mapped log
+static const char *last_entry(size_t *len) {
+    if (tail_count > 0) {
+        size_t start = tail_offsets[tail_count - 1];
+        *len = tail_len - start - 1;
+        return tail_buf + start;
+    }
+    if (map_size == 0) return NULL;
+
+    size_t end = map_size;
+    if (map[end - 1] == '\n') end--;
+    const char *nl = memrchr(map, '\n', end);
+    const char *start = nl ? nl + 1 : map;
+    *len = (size_t)(map + end - start);
+    return start;
+}
+
+void history_add(const char *line) {
+    size_t len = strlen(line);
+    size_t last_len;
+    const char *last;
+
+    // blank lines and lines starting with a space are not remembered, and a
+    // repeated command is stored once
+    if (hist_fd < 0 || len == 0 || line[0] == ' ') return;
+    last = last_entry(&last_len);
+    if (last && last_len == len && memcmp(last, line, len) == 0) return;
+
+    // O_APPEND and a single writev(): the line lands whole at the end of
+    // the file, even with several shells writing to it
+    struct iovec iov[2] = {{(void *)line, len}, {"\n", 1}};
+    if (writev(hist_fd, iov, 2) < 0) return;
+
+    if (tail_len + len + 1 > tail_cap) {
+        size_t new_cap = tail_cap ? tail_cap * 2 : 4096;
+        while (new_cap < tail_len + len + 1) new_cap *= 2;
+        char *grown = realloc(tail_buf, new_cap);
+        if (!grown) return;
+        tail_buf = grown;
+        tail_cap = new_cap;
+    }
+    if (tail_count == tail_offsets_cap) {
+        size_t new_cap = tail_offsets_cap ? tail_offsets_cap * 2 : 64;
+        size_t *grown = realloc(tail_offsets, new_cap * sizeof(*grown));
+        if (!grown) return;
+        tail_offsets = grown;
+        tail_offsets_cap = new_cap;
+    }
+    tail_offsets[tail_count++] = tail_len;
+    memcpy(tail_buf + tail_len, line, len);
+    tail_buf[tail_len + len] = '\n';
+    tail_len += len + 1;
+}
+
+// Builds the block maxima of ix->latest (filled by the caller)
+static int newest_index_build(struct newest_index *ix, size_t n) {
+    size_t nblocks = n / NEWEST_BLOCK + 1;
+
+    ix->block_max = calloc(nblocks, sizeof(*ix->block_max));
+    if (!ix->block_max) return -1;
+    for (size_t i = 0; i < n; i++) {
+        if (ix->latest[i] > ix->block_max[i / NEWEST_BLOCK]) {
+            ix->block_max[i / NEWEST_BLOCK] = ix->latest[i];
+        }
+    }
+    ix->n = n;
+    return 0;
+}
+
+// The newest entry number below "before" among positions lo .. hi - 1.
+// A whole block is decided by its maximum when that is below "before", so
+// a range of k positions costs about k / NEWEST_BLOCK steps.
+static size_t newest_below(const struct newest_index *ix, size_t lo, size_t hi,
+                           size_t before) {
+    size_t best = 0;
+
+    while (lo < hi) {
+        if (lo % NEWEST_BLOCK == 0 && lo + NEWEST_BLOCK <= hi) {
+            size_t max = ix->block_max[lo / NEWEST_BLOCK];
+            if (max <= best) {
+                lo += NEWEST_BLOCK;     // nothing in here can win
+                continue;
+            }
+            if (max < before) {
+                best = max;
+                lo += NEWEST_BLOCK;
+                continue;
+            }
+        }
+        if (ix->latest[lo] < before && ix->latest[lo] > best) best = ix->latest[lo];
+        lo++;
+    }
+    return best;
+}
+
+static void newest_index_free(struct newest_index *ix) {
+    free(ix->latest);
+    free(ix->block_max);
+    memset(ix, 0, sizeof(*ix));
+}
+
+static int compare_lines(const struct hist_line *a, const struct hist_line *b) {
+    int c = memcmp(a->text, b->text, a->len < b->len ? a->len : b->len);
+    if (c != 0) return c;
+    return (a->len > b->len) - (a->len < b->len);
+}
+
+static int compare_texts(const void *a, const void *b) {
+    return compare_lines(&((const struct hist_text *)a)->line,
+                         &((const struct hist_text *)b)->line);
+}
+
+static size_t hash_line(const struct hist_line *l) {
+    // FNV-1a
+    size_t h = 2166136261u;
+    for (size_t i = 0; i < l->len; i++) {
+        h ^= (unsigned char)l->text[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Builds the prefix index: duplicates are merged with a hash table (one
+// pass), then only the distinct texts are sorted
+static int index_texts(void) {
+    if (texts || index_lines() != 0 || map_count == 0) return 0;
+    if (map_count > UINT32_MAX) return -1;
+
+    size_t cap = 16;
+    while (cap < map_count * 2) cap *= 2;
+    size_t *slots = malloc(cap * sizeof(*slots));     // texts index + 1, 0 = empty
+    texts = malloc(map_count * sizeof(*texts));
+    if (!slots || !texts) {
+        free(slots);
+        free(texts);
+        texts = NULL;
+        return -1;
+    }
+    memset(slots, 0, cap * sizeof(*slots));
+
+    for (size_t i = 0; i < map_count; i++) {
+        size_t s = hash_line(&map_lines[i]) & (cap - 1);
+        while (slots[s] && compare_lines(&texts[slots[s] - 1].line, &map_lines[i]) != 0) {
+            s = (s + 1) & (cap - 1);
+        }
+        if (!slots[s]) {
+            texts[ntexts].line = map_lines[i];
+            slots[s] = ++ntexts;
+        }
+        texts[slots[s] - 1].latest = i + 1;     // later lines overwrite
+    }
+    free(slots);
+
+    qsort(texts, ntexts, sizeof(*texts), compare_texts);
+
+    text_newest.latest = malloc(ntexts * sizeof(*text_newest.latest));
+    if (!text_newest.latest) return -1;
+    for (size_t i = 0; i < ntexts; i++) {
+        text_newest.latest[i] = (uint32_t)texts[i].latest;
+    }
+    return newest_index_build(&text_newest, ntexts);
+}
+
+// Compares the start of text with prefix: 0 if text begins with prefix
+static int compare_prefix(const struct hist_line *text, const char *prefix, size_t plen) {
+    int c = memcmp(text->text, prefix, text->len < plen ? text->len : plen);
+    if (c != 0) return c;
+    return text->len < plen ? -1 : 0;
+}
+
+size_t history_find_prefix(const char *prefix) {
+    size_t plen = strlen(prefix);
+    size_t len;
+
+    if (index_lines() != 0) return 0;
+
+    // this session's entries are few and the newest: check them first
+    for (size_t n = tail_count; n > 0; n--) {
+        const char *t = history_entry(map_count + n, &len);
+        if (len >= plen && memcmp(t, prefix, plen) == 0) return map_count + n;
+    }
+
+    if (index_texts() != 0 || ntexts == 0) return 0;
+
+    // two binary searches find the texts starting with prefix: they are
+    // the ones from the first text >= prefix up to the first one after
+    size_t lo = 0, hi = ntexts;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (compare_prefix(&texts[mid].line, prefix, plen) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    size_t first = lo;
+    hi = ntexts;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (compare_prefix(&texts[mid].line, prefix, plen) == 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return newest_below(&text_newest, first, lo, SIZE_MAX);
+}
+
+struct suffix {
+    uint32_t pos;       // where the suffix starts in blob
+    uint32_t latest;    // newest entry of the text it belongs to
+};
+
+static int compare_suffixes(const void *a, const void *b) {
+    return strcmp(blob + ((const struct suffix *)a)->pos,
+                  blob + ((const struct suffix *)b)->pos);
+}
+
+// Builds the substring index: every suffix of every distinct text, sorted.
+// All suffixes that start with a pattern are then next to each other.
+static int index_suffixes(void) {
+    if (suffixes || index_texts() != 0 || ntexts == 0) return 0;
+
+    size_t blob_size = 0;
+    for (size_t i = 0; i < ntexts; i++) blob_size += texts[i].line.len + 1;
+    if (blob_size > UINT32_MAX) return -1;
+
+    struct suffix *sorted = malloc(blob_size * sizeof(*sorted));
+    blob = malloc(blob_size);
+    suffixes = malloc(blob_size * sizeof(*suffixes));
+    suffix_newest.latest = malloc(blob_size * sizeof(*suffix_newest.latest));
+    if (!sorted || !blob || !suffixes || !suffix_newest.latest) {
+        free(sorted);
+        free(blob);
+        free(suffixes);
+        newest_index_free(&suffix_newest);
+        blob = NULL;
+        suffixes = NULL;
+        return -1;
+    }
+
+    size_t pos = 0;
+    for (size_t i = 0; i < ntexts; i++) {
+        // a '\0' inside a line would end the suffix early; that is harmless
+        memcpy(blob + pos, texts[i].line.text, texts[i].line.len);
+        for (size_t k = 0; k < texts[i].line.len; k++) {
+            sorted[nsuffixes].pos = (uint32_t)(pos + k);
+            sorted[nsuffixes].latest = (uint32_t)texts[i].latest;
+            nsuffixes++;
+        }
+        pos += texts[i].line.len;
+        blob[pos++] = '\0';
+    }
+    qsort(sorted, nsuffixes, sizeof(*sorted), compare_suffixes);
+
+    for (size_t i = 0; i < nsuffixes; i++) {
+        suffixes[i] = sorted[i].pos;
+        suffix_newest.latest[i] = sorted[i].latest;
+    }
+    free(sorted);
+    return newest_index_build(&suffix_newest, nsuffixes);
+}
+
+size_t history_find_substring(const char *text, size_t before) {
+    size_t tlen = strlen(text);
+    size_t len;
+
+    if (tlen == 0) return 0;
+    for (size_t n = history_count(); n > map_count; n--) {
+        const char *t = history_entry(n, &len);
+        if (n < before && memmem(t, len, text, tlen)) return n;
+    }
+
+    if (index_suffixes() != 0 || nsuffixes == 0) return 0;
+
+    size_t lo = 0, hi = nsuffixes;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strncmp(blob + suffixes[mid], text, tlen) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    size_t first = lo;
+    hi = nsuffixes;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strncmp(blob + suffixes[mid], text, tlen) == 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return newest_below(&suffix_newest, first, lo, before);
+}
+
+// Appends n bytes to expand_buf, growing it as needed
+static int expand_put(size_t *used, const char *s, size_t n) {
+    if (*used + n + 1 > expand_cap) {
+        size_t new_cap = expand_cap ? expand_cap * 2 : 256;
+        while (new_cap < *used + n + 1) new_cap *= 2;
+        char *grown = realloc(expand_buf, new_cap);
+        if (!grown) return -1;
+        expand_buf = grown;
+        expand_cap = new_cap;
+    }
+    memcpy(expand_buf + *used, s, n);
+    *used += n;
+    return 0;
+}
+
+char *history_expand(char *line) {
+    size_t used = 0;
+    int changed = 0;
+
+    if (!strchr(line, '!')) return line;
+
+    for (char *p = line; *p;) {
+        int word_start = p == line || p[-1] == ' ';
+        char next = p[1];
+
+        // "!" alone, "!=" and "! cmd" stay as they are
+        if (*p != '!' || !word_start || next == '\0' || next == ' ' || next == '=') {
+            if (expand_put(&used, p, 1) != 0) return NULL;
+            p++;
+            continue;
+        }
+
+        char *spec = p + 1;
+        char *end = spec + strcspn(spec, " ");
+        size_t n = 0;
+        char saved = *end;
+
+        *end = '\0';
+        if (strcmp(spec, "!") == 0) {
+            n = history_count();
+        } else if (spec[0] == '-' && spec[1] >= '0' && spec[1] <= '9') {
+            size_t back = strtoul(spec + 1, NULL, 10);
+            n = back <= history_count() ? history_count() + 1 - back : 0;
+        } else if (spec[0] >= '0' && spec[0] <= '9') {
+            n = strtoul(spec, NULL, 10);
+        } else {
+            n = history_find_prefix(spec);
+        }
+
+        size_t len;
+        const char *event = n ? history_entry(n, &len) : NULL;
+        if (!event) {
+            fprintf(stderr, "!%s: event not found\n", spec);
+            *end = saved;
+            return NULL;
+        }
+        *end = saved;
+        if (expand_put(&used, event, len) != 0) return NULL;
+        changed = 1;
+        p = end;
+    }
+    if (!changed) return line;
+
+    expand_buf[used] = '\0';
+    // show the command that will run, like other shells do
+    printf("%s\n", expand_buf);
+    return expand_buf;
+}
+
+void history_close(void) {
+    if (map) munmap((void *)map, map_size);
+    if (hist_fd >= 0) close(hist_fd);
+    free(map_lines);
+    free(texts);
+    free(blob);
+    free(suffixes);
+    newest_index_free(&text_newest);
+    newest_index_free(&suffix_newest);
+    free(tail_buf);
+    free(tail_offsets);
+    free(expand_buf);
+
+    hist_fd = -1;
+    map = NULL;
+    map_size = map_count = ntexts = nsuffixes = 0;
+    map_lines = NULL;
+    texts = NULL;
+    blob = NULL;
+    suffixes = NULL;
+    tail_buf = NULL;
+    tail_len = tail_cap = tail_count = tail_offsets_cap = 0;
+    tail_offsets = NULL;
+    expand_buf = NULL;
+    expand_cap = 0;
+}
+
+static void print_entry(size_t n) {
+    size_t len;
+    const char *text = history_entry(n, &len);
+    if (text) printf("%5zu  %.*s\n", n, (int)len, text);
+}
+
+int builtin_history(char **args) {
+    size_t count = history_count();
+
+    if (args[1] && strcmp(args[1], "-s") == 0) {
+        if (!args[2]) {
+            fprintf(stderr, "usage: history [N | -s text]\n");
+            return 2;
+        }
+        // newest match first, then each next older one
+        size_t found = 0, cap = 0;
+        size_t *matches = NULL;
+        for (size_t n = history_find_substring(args[2], count + 1); n;
+             n = history_find_substring(args[2], n)) {
+            if (found == cap) {
+                cap = cap ? cap * 2 : 64;
+                size_t *grown = realloc(matches, cap * sizeof(*matches));
+                if (!grown) break;
+                matches = grown;
+            }
+            matches[found++] = n;
+        }
+        while (found > 0) print_entry(matches[--found]);
+        free(matches);
+        return 0;
+    }
+
+    size_t first = 1;
+    if (args[1]) {
+        size_t last = strtoul(args[1], NULL, 10);
+        if (last < count) first = count - last + 1;
+    }
+    for (size_t n = first; n <= count; n++) print_entry(n);
+    return 0;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+HISTORY MODULE EXPLANATION:
+An interactive shell remembers every command line in a log file
+(~/.mini_shell_history, or the file named by MINI_SHELL_HISTFILE), one line
+per command. The log is only ever appended to, so it works like a journal:
+a line is written once, with one writev() on a descriptor opened with
+O_APPEND, and never rewritten. Several shells can share the file.
+
+STARTUP COST:
+history_open() maps the file with mmap() and does nothing else. Mapping
+costs the same for any file size: the kernel only reads a page of the file
+when it is first touched. A shell with ten million remembered commands
+starts as fast as one with ten.
+
+The expensive structures are built the first time they are needed, and only
+for the mapped part, which never changes while the shell runs:
+1. map_lines: where every line starts (one memchr() pass over the file)
+2. texts: the distinct command texts, sorted. Duplicates are merged with an
+   open-addressing hash table first, so only distinct texts are sorted; each
+   remembers the number of its newest entry.
+3. suffixes: a suffix array. Every distinct text is copied into one blob,
+   each followed by '\0', and the positions of all characters are sorted by
+   the text that starts there ("the suffix"). All suffixes that begin with a
+   search string are neighbours in this order, so one binary search finds
+   every text containing it.
+Lines added in this session go to a small in-memory tail instead and are
+searched first, one by one; they are the newest entries anyway.
+
+SEARCHING:
+- Prefix ("!git"): binary search in texts for the first text >= "git";
+  every text starting with "git" follows it. The newest entry among them is
+  the answer.
+- Substring ("history -s make", and Ctrl-R in a line editor): binary search
+  in suffixes. history_find_substring(text, before) returns the newest
+  match older than entry "before", so calling it again with the previous
+  answer walks back through older matches, the way Ctrl-R does.
+
+A common prefix like "git" can match thousands of texts, and looking at each
+one to find the newest would make every search as slow as that range is long.
+So both indexes keep, next to each position, the newest entry number of its
+text (struct newest_index), plus the maximum of every block of 64 positions.
+Two binary searches find the ends of the range; newest_below() then takes a
+whole block's maximum whenever it is older than "before", and only looks at
+single positions at the two ragged ends and in blocks that straddle
+"before". With a million entries a search takes about a microsecond.
+
+HISTORY EXPANSION (history_expand):
+A word starting with "!" is replaced before the line is parsed:
+- !!       the previous command
+- !N       entry number N (as printed by "history")
+- !-N      the Nth previous command
+- !prefix  the newest command starting with prefix
+The expanded line is printed, then run and remembered. "!" alone and "!="
+are left alone. Expansion only happens in interactive shells.
+
+THE "history" BUILTIN:
+- history            list every entry with its number
+- history N          list the last N entries
+- history -s text    list entries containing text; a command repeated in
+                     earlier sessions is listed once, at its newest entry
+
+FUNCTION IMPLEMENTATIONS:
+
+1. int history_open(const char *path)
+   PURPOSE: Opens (or creates) the log and maps it; NULL uses the default
+   RETURN VALUE: 0, or -1 if the file cannot be opened
+
+2. void history_add(const char *line)
+   PURPOSE: Appends a command to the file and to the in-memory tail
+
+3. size_t history_count(void) / const char *history_entry(size_t n, size_t *len)
+   PURPOSE: Number of entries, and the text of entry n (1 = oldest). The
+   text is not '\0'-terminated; *len gives its length.
+
+4. size_t history_find_prefix(const char *prefix)
+   size_t history_find_substring(const char *text, size_t before)
+   RETURN VALUE: An entry number, or 0 if nothing matches
+
+5. char *history_expand(char *line)
+   RETURN VALUE: line itself, a buffer holding the expanded line (valid
+   until the next call), or NULL if an event was not found
+
+6. void history_close(void)
+   PURPOSE: Unmaps the log and frees every index
+
+EXTERNAL FUNCTIONS USED:
+- mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0): maps the log into memory
+- writev(fd, iov, 2): writes the line and its '\n' with one system call
+- memchr(s, '\n', n): finds the end of a line
+- memmem(haystack, hlen, needle, nlen): finds a byte string in another
+- qsort(base, n, size, compare): sorts an array with a comparison function
+*/
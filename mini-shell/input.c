@@ -0,0 +1,217 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shell.h"
+
+#define READ_CHUNK (64 * 1024)
+
+int reader_open_fd(struct line_reader *r, int fd) {
+    memset(r, 0, sizeof(*r));
+    r->fd = fd;
+    r->cap = READ_CHUNK;
+    r->buf = malloc(r->cap);
+    return r->buf ? 0 : -1;
+}
+
+int reader_open_string(struct line_reader *r, const char *text) {
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+    r->end = strlen(text);
+    r->cap = r->end + 1;
+    r->buf = malloc(r->cap);
+    if (!r->buf) return -1;
+    memcpy(r->buf, text, r->cap);
+    r->eof = 1;
+    return 0;
+}
+
+int reader_open_file(struct line_reader *r, const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        // a private writable mapping lets lines be terminated in place;
+        // the written pages are copied on demand, the file never changes
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            close(fd);
+            memset(r, 0, sizeof(*r));
+            r->fd = -1;
+            r->buf = map;
+            r->cap = r->end = (size_t)st.st_size;
+            r->eof = 1;
+            r->mapped = 1;
+            madvise(map, r->cap, MADV_SEQUENTIAL);
+            return 0;
+        }
+    }
+    if (reader_open_fd(r, fd) != 0) {
+        close(fd);
+        return -1;
+    }
+    r->owns_fd = 1;
+    return 0;
+}
+
+// Moves the unread bytes to the front and reads more after them,
+// always keeping one byte free for a final '\0'. Returns -1 if a signal
+// (Ctrl-C at the prompt) interrupted the read.
+static int fill(struct line_reader *r) {
+    if (r->start > 0) {
+        memmove(r->buf, r->buf + r->start, r->end - r->start);
+        r->end -= r->start;
+        r->start = 0;
+    }
+    ssize_t n = read(r->fd, r->buf + r->end, r->cap - 1 - r->end);
+    if (n < 0 && errno == EINTR) return -1;
+    if (n <= 0) {
+        r->eof = 1;
+        return 0;
+    }
+    r->end += (size_t)n;
+    return 1;
+}
+
+char *reader_next_line(struct line_reader *r) {
+    for (;;) {
+        char *line = r->buf + r->start;
+        char *nl = memchr(line, '\n', r->end - r->start);
+
+        if (nl) {
+            *nl = '\0';
+            r->start = (size_t)(nl - r->buf) + 1;
+            return line;
+        }
+
+        if (r->eof) {
+            if (r->start == r->end) return NULL;
+
+            // last line without '\n'
+            if (r->mapped) {
+                // the mapping has no room for a terminator: copy the tail
+                free(r->tail);
+                r->tail = strndup(line, r->end - r->start);
+                r->start = r->end;
+                return r->tail;
+            }
+            r->buf[r->end] = '\0';
+            r->start = r->end;
+            return line;
+        }
+
+        // a line longer than the buffer: double the buffer and keep reading
+        if (r->start == 0 && r->end == r->cap - 1) {
+            char *grown = realloc(r->buf, r->cap * 2);
+            if (!grown) {
+                // out of memory: hand out what we have as a piece
+                r->buf[r->end] = '\0';
+                r->start = r->end;
+                return line;
+            }
+            r->buf = grown;
+            r->cap *= 2;
+        }
+        if (fill(r) < 0) {
+            // interrupted: drop the unfinished input, return an empty line
+            r->start = r->end;
+            r->buf[r->end] = '\0';
+            return r->buf + r->end;
+        }
+    }
+}
+
+// Position in the input of the next line. Only a mapped file or a string
+// holds all of its input, so only for them it is an offset in the input.
+size_t reader_offset(const struct line_reader *r) {
+    return r->start;
+}
+
+void reader_seek(struct line_reader *r, size_t offset) {
+    r->start = offset < r->end ? offset : r->end;
+}
+
+void reader_close(struct line_reader *r) {
+    if (r->mapped) {
+        munmap(r->buf, r->cap);
+    } else {
+        free(r->buf);
+    }
+    if (r->owns_fd) close(r->fd);
+    free(r->tail);
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+INPUT MODULE EXPLANATION:
+This module hands the main loop one line at a time without calling fgets()
+per line. Input is read in 64 KiB chunks (or memory-mapped), and each line
+is returned as a pointer into that buffer with its '\n' replaced by '\0'.
+ast_parse() then copies the words of the line into its text pool once, and
+the argv handed to exec points straight into that pool.
+
+struct line_reader (declared in shell.h):
+- buf/cap: the buffer and its size
+- start: first byte not yet returned as a line
+- end: one past the last byte read so far
+- eof: no more data will arrive
+- mapped: buf is a memory-mapped file, released with munmap()
+
+FUNCTION IMPLEMENTATIONS:
+
+1. int reader_open_fd(struct line_reader *r, int fd)
+   PURPOSE: Reads lines from a descriptor (stdin, a pipe, a terminal)
+
+2. int reader_open_file(struct line_reader *r, const char *path)
+   PURPOSE: Reads lines from a script file
+   - Regular files are mapped with mmap(MAP_PRIVATE). The whole script is
+     then one big buffer: no read() calls at all, and the kernel loads pages
+     as they are touched. Writing '\0' into a private mapping changes only
+     our copy of that page, never the file.
+   - Anything else (or a failed mmap) falls back to reader_open_fd()
+
+3. int reader_open_string(struct line_reader *r, const char *text)
+   PURPOSE: Reads lines from a string (used by "mini-shell -c")
+
+4. char *reader_next_line(struct line_reader *r)
+   PURPOSE: Returns the next line, or NULL at end of input
+   - memchr() looks for '\n' in the unread part of the buffer
+   - If there is none, the unread bytes move to the front and read() appends
+     up to a chunk after them, so a single read() serves many lines
+   - The returned pointer is valid until the next call
+   - If Ctrl-C interrupts read() (the shell's SIGINT handler does not
+     restart it), the unfinished input is dropped and an empty line is
+     returned, so the main loop simply prints a new prompt
+   - A line longer than the buffer doubles the buffer (realloc) until it
+     fits, so lines of any length arrive whole. The grown buffer is kept,
+     so one long line does not make later lines slower.
+
+5. size_t reader_offset(const struct line_reader *r) /
+   void reader_seek(struct line_reader *r, size_t offset)
+   PURPOSE: Where the next line starts, and moving there. For a mapped
+   script that is a byte offset in the file: the AST cache (astcache.c)
+   saves it after each command and a warm run continues from it
+
+6. void reader_close(struct line_reader *r)
+   PURPOSE: Releases the buffer (and the file, if the reader opened it)
+
+EXTERNAL FUNCTIONS USED:
+- read(fd, buf, n): reads up to n bytes; returns 0 at end of file
+- mmap(addr, len, prot, flags, fd, offset): maps a file into memory
+- madvise(addr, len, MADV_SEQUENTIAL): tells the kernel to read ahead
+- munmap(addr, len): removes a mapping
+- memchr(s, c, n): finds a byte in the first n bytes of s
+- memmove(dst, src, n): copies bytes between regions that may overlap
+- strndup(s, n): copies at most n characters into new memory
+*/
@@ -0,0 +1,949 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "shell.h"
+
+struct job_proc {
+    struct job *job;
+    pid_t pid;
+    int pidfd;          // -1 if pidfd_open() is not available
+    int done;
+    int stopped;
+    char *name;         // program name, for stats
+};
+
+struct job {
+    int id;             // number shown as [id]
+    int live;           // processes not reaped yet
+    int stopped;        // live processes that are stopped
+    int reported;       // the current Stopped state was already printed
+    int nprocs;
+    int status;         // wait status of the last process
+    pid_t pgid;         // process group, -1 without job control
+    unsigned long seq;  // last start/stop, the highest is the current job
+    int has_tmodes;
+    struct termios tmodes;  // terminal modes the job had when it stopped
+    double started;
+    char *cmd;
+    struct job_proc procs[];
+};
+
+int shell_interactive = 0;
+int shell_max_jobs = 0;
+int job_tty = -1;
+sigset_t job_sigmask;
+sigset_t job_sigdefault;
+volatile sig_atomic_t shell_interrupted = 0;
+
+static struct job **jobs = NULL;    // index = id - 1, NULL for a free number
+static int jobs_cap = 0;
+static int jobs_running = 0;
+static unsigned long jobs_seq = 0;
+static int epoll_fd = -1;
+static int sigchld_fd = -1;
+
+static pid_t shell_pgid;
+static struct termios shell_tmodes;
+
+// A command started with a "timeout" prefix (limits.c)
+struct job_timer {
+    pid_t pid;
+    double deadline;    // now_seconds() time of the next signal, 0 for none
+    double seconds;     // the timeout, for the message
+    double kill_after;  // SIGKILL this long after the first signal, 0: never
+    int sig;
+    int fired;          // the first signal was sent
+    char *name;
+};
+
+static struct job_timer *timers = NULL;
+static int ntimers = 0;
+static int timers_cap = 0;
+static int timer_fd = -1;   // armed for the earliest deadline, in epoll_fd
+
+static int pidfd_open(pid_t pid) {
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+}
+
+static void on_sigint(int sig) {
+    (void)sig;
+    shell_interrupted = 1;
+    // the line typed so far is thrown away: start the prompt on a new line
+    if (write(STDOUT_FILENO, "\n", 1) < 0) return;
+}
+
+void jobs_init(int interactive) {
+    int stop_signals[] = {SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU};
+
+    sigprocmask(SIG_SETMASK, NULL, &job_sigmask);
+    sigemptyset(&job_sigdefault);
+    if (!interactive) return;
+
+    // wait until the shell is in the foreground before taking over
+    int tty = STDIN_FILENO;
+    while ((shell_pgid = getpgrp()) != tcgetpgrp(tty)) {
+        if (tcgetpgrp(tty) < 0) return;
+        kill(-shell_pgid, SIGTTIN);
+    }
+
+    // Ctrl-C, Ctrl-\ and Ctrl-Z are meant for the foreground job, and a
+    // shell outside the foreground group must be able to take the terminal
+    // back without being stopped
+    for (int i = 0; i < 5; i++) {
+        signal(stop_signals[i], SIG_IGN);
+        sigaddset(&job_sigdefault, stop_signals[i]);
+    }
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigint;      // no SA_RESTART: interrupt read()
+    sigaction(SIGINT, &sa, NULL);
+
+    if (setpgid(0, 0) != 0 && errno != EPERM) return;
+    shell_pgid = getpgrp();
+    tcsetpgrp(tty, shell_pgid);
+    tcgetattr(tty, &shell_tmodes);
+    // a descriptor of its own: a pipeline stage takes the terminal after
+    // its fd 0 became the pipe (executor.c), so fd 0 is not the terminal
+    // there; like bash's fd 255, it is closed in the programs started
+    job_tty = fcntl(tty, F_DUPFD_CLOEXEC, 10);
+    if (job_tty < 0) job_tty = tty;
+}
+
+void job_child_setup(pid_t pgid, int foreground) {
+    if (pgid >= 0) {
+        setpgid(0, pgid);
+        // SIGTTOU is still ignored here, so a background group may do this
+        if (foreground && job_tty >= 0) tcsetpgrp(job_tty, pgid ? pgid : getpid());
+    }
+    for (int sig = 1; sig < NSIG; sig++) {
+        if (sigismember(&job_sigdefault, sig) == 1) signal(sig, SIG_DFL);
+    }
+    sigprocmask(SIG_SETMASK, &job_sigmask, NULL);
+    // only the shell itself writes the --trace file (trace.c)
+    trace_enabled = 0;
+}
+
+// Creates the epoll set on first use: every pidfd plus a signalfd for
+// SIGCHLD, which is the only way to learn that a child has stopped
+static int watch_init(void) {
+    if (epoll_fd >= 0) return 0;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+
+    sigset_t chld;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld, NULL);
+    sigchld_fd = signalfd(-1, &chld, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (sigchld_fd >= 0) {
+        struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sigchld_fd, &ev);
+    }
+    return 0;
+}
+
+// Arms timer_fd for the earliest deadline, or disarms it
+static void arm_timer(void) {
+    struct itimerspec its = {{0, 0}, {0, 0}};
+    double next = 0;
+
+    for (int i = 0; i < ntimers; i++) {
+        double d = timers[i].deadline;
+        if (d > 0 && (next == 0 || d < next)) next = d;
+    }
+    if (next > 0) {
+        // now_seconds() reads CLOCK_MONOTONIC, the timer's clock
+        its.it_value.tv_sec = (time_t)next;
+        its.it_value.tv_nsec = (long)((next - (double)(time_t)next) * 1e9);
+        if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) its.it_value.tv_nsec = 1;
+    }
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+// timer_fd went off: signal every command whose deadline passed, with
+// the processes it started (its process group, see job_timer_add())
+static void fire_timers(void) {
+    uint64_t expirations;
+    double now = now_seconds();
+
+    while (read(timer_fd, &expirations, sizeof(expirations)) > 0) {
+    }
+    for (int i = 0; i < ntimers; i++) {
+        struct job_timer *t = &timers[i];
+        if (t->deadline == 0 || t->deadline > now) continue;
+        if (!t->fired) {
+            fprintf(stderr, "%s: timed out after %gs\n", t->name, t->seconds);
+            kill(-t->pid, t->sig);
+            t->fired = 1;
+            t->deadline = t->kill_after > 0 ? now + t->kill_after : 0;
+        } else {
+            kill(-t->pid, SIGKILL);
+            t->deadline = 0;
+        }
+    }
+    arm_timer();
+}
+
+int job_timer_add(pid_t pid, const char *name, const struct timeout *timeout) {
+    // the child makes itself a group leader too, but may not have run yet
+    setpgid(pid, pid);
+    if (watch_init() != 0) return -1;
+    if (timer_fd < 0) {
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_fd < 0) {
+            perror("timerfd_create");
+            return -1;
+        }
+        struct epoll_event ev = {.events = EPOLLIN, .data.ptr = &timer_fd};
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev);
+    }
+    if (ntimers == timers_cap) {
+        int cap = timers_cap ? timers_cap * 2 : 8;
+        struct job_timer *grown = realloc(timers, cap * sizeof(*grown));
+        if (!grown) {
+            perror("timeout");
+            return -1;
+        }
+        timers = grown;
+        timers_cap = cap;
+    }
+    struct job_timer *t = &timers[ntimers];
+    t->name = strdup(name);
+    if (!t->name) {
+        perror("timeout");
+        return -1;
+    }
+    t->pid = pid;
+    t->seconds = timeout->seconds;
+    t->deadline = now_seconds() + timeout->seconds;
+    t->kill_after = timeout->kill_after;
+    t->sig = timeout->sig;
+    t->fired = 0;
+    ntimers++;
+    arm_timer();
+    return 0;
+}
+
+// The wait status to report for a process that ended with status: 124
+// ("exit 124", as coreutils' timeout) if its timeout killed it
+static int timer_status(pid_t pid, int status) {
+    for (int i = 0; i < ntimers; i++) {
+        if (timers[i].pid != pid) continue;
+        if (timers[i].fired) status = 124 << 8;
+        free(timers[i].name);
+        timers[i] = timers[--ntimers];
+        arm_timer();
+        break;
+    }
+    return status;
+}
+
+// Rebuilds the command text ("a x | b") from the pipeline stages
+static char *join_stages(char ***stages, int n) {
+    size_t len = 1;
+    for (int st = 0; st < n; st++) {
+        len += 3;
+        for (int i = 0; stages[st][i]; i++) len += strlen(stages[st][i]) + 1;
+    }
+
+    char *s = malloc(len);
+    if (!s) return NULL;
+
+    char *p = s;
+    for (int st = 0; st < n; st++) {
+        if (st > 0) {
+            memcpy(p, "| ", 2);
+            p += 2;
+        }
+        for (int i = 0; stages[st][i]; i++) {
+            size_t len_arg = strlen(stages[st][i]);
+            memcpy(p, stages[st][i], len_arg);
+            p += len_arg;
+            *p++ = ' ';
+        }
+    }
+    if (p > s) p--;
+    *p = '\0';
+    return s;
+}
+
+static int free_job_id(void) {
+    for (int i = 0; i < jobs_cap; i++) {
+        if (!jobs[i]) return i + 1;
+    }
+
+    int new_cap = jobs_cap ? jobs_cap * 2 : 16;
+    struct job **grown = realloc(jobs, new_cap * sizeof(*jobs));
+    if (!grown) return -1;
+    memset(grown + jobs_cap, 0, (new_cap - jobs_cap) * sizeof(*jobs));
+    jobs = grown;
+    jobs_cap = new_cap;
+    return free_job_id();
+}
+
+static const char *job_state(const struct job *job) {
+    if (job->live == 0) return "Done";
+    return job->stopped == job->live ? "Stopped" : "Running";
+}
+
+// The job "fg" and "bg" use without an argument: the last one started or stopped
+static struct job *current_job(void) {
+    struct job *best = NULL;
+
+    for (int i = 0; i < jobs_cap; i++) {
+        if (jobs[i] && (!best || jobs[i]->seq > best->seq)) best = jobs[i];
+    }
+    return best;
+}
+
+static void print_job(const struct job *job) {
+    printf("[%d]%c  %-8s\t%s\n", job->id, job == current_job() ? '+' : ' ',
+           job_state(job), job->cmd ? job->cmd : "");
+}
+
+int job_start(pid_t *pids, int npids, char ***stages, pid_t pgid, int stopped) {
+    if (watch_init() != 0) return -1;
+
+    int id = free_job_id();
+    struct job *job = id > 0 ? calloc(1, sizeof(*job) + npids * sizeof(struct job_proc)) : NULL;
+    if (!job) {
+        perror("job");
+        return -1;
+    }
+    job->id = id;
+    job->pgid = pgid;
+    job->seq = ++jobs_seq;
+    job->started = now_seconds();
+
+    for (int i = 0; i < npids; i++) {
+        struct job_proc *p = &job->procs[job->nprocs];
+        if (pids[i] <= 0) continue;
+
+        p->job = job;
+        p->pid = pids[i];
+        p->stopped = stopped;
+        p->name = stats_enabled ? strdup(stages[i][0]) : NULL;
+        p->pidfd = pidfd_open(pids[i]);
+        if (p->pidfd >= 0) {
+            struct epoll_event ev = {.events = EPOLLIN, .data.ptr = p};
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, p->pidfd, &ev);
+        }
+        job->nprocs++;
+        job->live++;
+    }
+    if (job->nprocs == 0) {
+        free(job);
+        return -1;
+    }
+    if (stopped) job->stopped = job->live;
+
+    job->cmd = join_stages(stages, npids);
+    jobs[id - 1] = job;
+    jobs_running++;
+    if (stopped) {
+        job->reported = 1;
+        if (shell_interactive) {
+            printf("\n");
+            print_job(job);
+        }
+    } else if (shell_interactive) {
+        printf("[%d] %d\n", id, (int)job->procs[job->nprocs - 1].pid);
+    }
+    return id;
+}
+
+static void reap_proc(struct job_proc *p, int status) {
+    p->done = 1;
+    if (p->stopped) {
+        p->stopped = 0;
+        p->job->stopped--;
+    }
+    if (p->pidfd >= 0) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, p->pidfd, NULL);
+        close(p->pidfd);
+        p->pidfd = -1;
+    }
+    if (p == &p->job->procs[p->job->nprocs - 1]) {
+        p->job->status = status;
+    }
+    if (--p->job->live == 0) {
+        jobs_running--;
+    }
+}
+
+// Collects whatever happened to p: exit, stop or continue. Returns 1 if p
+// was reaped.
+static int try_reap(struct job_proc *p) {
+    struct rusage ru;
+    int status = 0;
+
+    if (p->done) return 0;
+
+    pid_t r = wait4(p->pid, &status, WNOHANG | WUNTRACED | WCONTINUED, &ru);
+    if (r == p->pid && WIFSTOPPED(status)) {
+        if (!p->stopped) {
+            p->stopped = 1;
+            p->job->stopped++;
+            p->job->seq = ++jobs_seq;
+            p->job->reported = 0;
+        }
+        return 0;
+    }
+    if (r == p->pid && WIFCONTINUED(status)) {
+        if (p->stopped) {
+            p->stopped = 0;
+            p->job->stopped--;
+        }
+        return 0;
+    }
+
+    if (r == p->pid && p->name) {
+        stats_record(p->name, now_seconds() - p->job->started, -1, &ru);
+    }
+    if (r == p->pid && trace_enabled) trace_process_end(p->pid);
+    if (r == p->pid || (r < 0 && errno == ECHILD)) {
+        if (ntimers > 0) status = timer_status(p->pid, status);
+        reap_proc(p, status);
+        return 1;
+    }
+    return 0;
+}
+
+// SIGCHLD arrived: drain the signalfd and check every live process, since
+// pidfds only report exits and queued SIGCHLDs merge into one
+static int check_all(void) {
+    struct signalfd_siginfo info[8];
+    int reaped = 0;
+
+    while (read(sigchld_fd, info, sizeof(info)) > 0) {
+    }
+    for (int i = 0; i < jobs_cap; i++) {
+        if (!jobs[i]) continue;
+        for (int k = 0; k < jobs[i]->nprocs; k++) {
+            reaped += try_reap(&jobs[i]->procs[k]);
+        }
+    }
+    return reaped;
+}
+
+// Waits up to timeout_ms for the epoll set and handles what happened:
+// exits, SIGCHLD, and timeouts that are due
+static int watch_events(int timeout_ms) {
+    struct epoll_event events[32];
+    int reaped = 0;
+
+    int n = epoll_wait(epoll_fd, events, 32, timeout_ms);
+    for (int i = 0; i < n; i++) {
+        struct job_proc *p = events[i].data.ptr;
+        if (events[i].data.ptr == &timer_fd) {
+            fire_timers();
+        } else {
+            reaped += p ? try_reap(p) : check_all();
+        }
+    }
+    return reaped;
+}
+
+int jobs_poll(int timeout_ms) {
+    int reaped = 0;
+
+    if (jobs_running == 0 && ntimers == 0) return 0;
+
+    // without SIGCHLD notification, processes without a pidfd are checked
+    // directly
+    if (sigchld_fd < 0) {
+        for (int i = 0; i < jobs_cap; i++) {
+            if (!jobs[i]) continue;
+            for (int k = 0; k < jobs[i]->nprocs; k++) {
+                struct job_proc *p = &jobs[i]->procs[k];
+                if (p->pidfd < 0 && try_reap(p)) {
+                    reaped++;
+                    timeout_ms = 0;
+                }
+            }
+        }
+    }
+
+    return reaped + watch_events(timeout_ms);
+}
+
+// wait4() for a foreground process while timed commands run: the shell
+// sleeps in the epoll set, so a due timeout is handled on time, and
+// SIGCHLD wakes it to check the process again
+pid_t job_wait_timed(pid_t pid, int *status, int options, struct rusage *ru) {
+    for (;;) {
+        pid_t r = wait4(pid, status, options | WNOHANG, ru);
+        if (r != 0) {
+            if (r == pid && !WIFSTOPPED(*status)) *status = timer_status(pid, *status);
+            return r;
+        }
+        watch_events(sigchld_fd >= 0 ? -1 : JOBS_POLL_MS);
+    }
+}
+
+int job_timers_pending(void) {
+    return ntimers;
+}
+
+int jobs_active(void) {
+    return jobs_running;
+}
+
+static void release_job(struct job *job) {
+    for (int k = 0; k < job->nprocs; k++) {
+        if (job->procs[k].pidfd >= 0) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, job->procs[k].pidfd, NULL);
+            close(job->procs[k].pidfd);
+        }
+        free(job->procs[k].name);
+    }
+    if (job->live > 0) jobs_running--;
+    jobs[job->id - 1] = NULL;
+    free(job->cmd);
+    free(job);
+}
+
+void jobs_forked(void) {
+    // the epoll set, signalfd and timerfd are shared with the shell that
+    // forked this copy: a pidfd added here would reach the other shell with
+    // a pointer into this one's memory, and every epoll_ctl(DEL) or
+    // timerfd_settime() would change the other shell's set. Close them
+    // first, so releasing the jobs below leaves the other shell's untouched.
+    if (epoll_fd >= 0) close(epoll_fd);
+    if (sigchld_fd >= 0) close(sigchld_fd);
+    if (timer_fd >= 0) close(timer_fd);
+    epoll_fd = sigchld_fd = timer_fd = -1;
+
+    // the other shell's children can't be waited for from here
+    for (int i = 0; i < jobs_cap; i++) {
+        if (jobs[i]) release_job(jobs[i]);
+    }
+    for (int i = 0; i < ntimers; i++) free(timers[i].name);
+    ntimers = 0;
+}
+
+// Readable when a background process may have exited, for callers that
+// wait in their own poll() (lineedit.c); -1 while no job is running, since
+// SIGCHLDs of foreground commands can stay queued in the signalfd
+int jobs_event_fd(void) {
+    return jobs_running > 0 ? epoll_fd : -1;
+}
+
+void jobs_notify(void) {
+    jobs_poll(0);
+    for (int i = 0; i < jobs_cap; i++) {
+        struct job *job = jobs[i];
+        if (!job) continue;
+
+        if (job->live == 0) {
+            if (shell_interactive) print_job(job);
+            release_job(job);
+        } else if (job->stopped == job->live && !job->reported) {
+            if (shell_interactive) print_job(job);
+            job->reported = 1;
+        }
+    }
+}
+
+// Blocks until the given job (or every job if id is 0) has finished.
+// Ctrl-C ends the wait early.
+static void wait_for(int id) {
+    shell_interrupted = 0;
+    while (!shell_interrupted) {
+        if (id > 0) {
+            if (id > jobs_cap || !jobs[id - 1] || jobs[id - 1]->live == 0) return;
+        } else if (jobs_running == 0) {
+            return;
+        }
+        // a pidfd-less process can only be polled, so do not sleep forever
+        jobs_poll(JOBS_POLL_MS);
+    }
+}
+
+void jobs_wait_all(void) {
+    wait_for(0);
+    for (int i = 0; i < jobs_cap; i++) {
+        if (jobs[i] && jobs[i]->live == 0) release_job(jobs[i]);
+    }
+}
+
+// Gives the terminal back to the shell once a foreground job finished or
+// stopped; a stopped job keeps its terminal modes for "fg"
+static void take_terminal(struct job *stopped_job, int status) {
+    if (job_tty < 0) return;
+
+    // the terminal echoed "^C" where the job left off; a loop running the
+    // job stops as if the shell had got the Ctrl-C itself (eval.c)
+    if (WIFSIGNALED(status) && WTERMSIG(status) == SIGINT) {
+        printf("\n");
+        shell_interrupted = 1;
+    }
+
+    tcsetpgrp(job_tty, shell_pgid);
+    if (stopped_job) {
+        stopped_job->has_tmodes = tcgetattr(job_tty, &stopped_job->tmodes) == 0;
+    }
+    tcsetattr(job_tty, TCSADRAIN, &shell_tmodes);
+}
+
+int job_wait_foreground(pid_t *pids, int npids, char ***stages, pid_t pgid,
+                        double started, const double *launched) {
+    int status = 0;
+    int stopped = 0;
+
+    for (int i = 0; i < npids; i++) {
+        if (pids[i] <= 0) continue;
+
+        int st = wait_process(pids[i], stages[i][0], started,
+                              launched ? launched[i] : -1);
+        if (WIFSTOPPED(st)) {
+            stopped = 1;
+        } else {
+            pids[i] = -1;       // reaped; the rest may become a stopped job
+        }
+        if (i == npids - 1) status = st;
+    }
+    if (pgid <= 0) return status;
+
+    if (!stopped) {
+        take_terminal(NULL, status);
+        return status;
+    }
+    int id = job_start(pids, npids, stages, pgid, 1);
+    take_terminal(id > 0 ? jobs[id - 1] : NULL, status);
+    return status;
+}
+
+// Finds the job named by a "%N" or process ID argument, or the current job
+static struct job *find_job(const char *builtin, const char *spec) {
+    int id = 0;
+
+    if (!spec || strcmp(spec, "%+") == 0 || strcmp(spec, "%%") == 0) {
+        struct job *job = current_job();
+        if (!job) fprintf(stderr, "%s: no current job\n", builtin);
+        return job;
+    }
+    if (spec[0] == '%') {
+        id = atoi(spec + 1);
+    } else {
+        // a process ID: find the job that owns it
+        pid_t pid = (pid_t)atoi(spec);
+        for (int j = 0; j < jobs_cap && !id; j++) {
+            for (int k = 0; jobs[j] && k < jobs[j]->nprocs; k++) {
+                if (jobs[j]->procs[k].pid == pid) id = j + 1;
+            }
+        }
+    }
+    if (id <= 0 || id > jobs_cap || !jobs[id - 1]) {
+        fprintf(stderr, "%s: %s: no such job\n", builtin, spec);
+        return NULL;
+    }
+    return jobs[id - 1];
+}
+
+// Sends SIGCONT to every process of a stopped job. The job counts as
+// running right away; a later WCONTINUED report changes nothing.
+static void continue_job(struct job *job) {
+    job->seq = ++jobs_seq;
+    job->stopped = 0;
+    for (int k = 0; k < job->nprocs; k++) {
+        job->procs[k].stopped = 0;
+    }
+    if (job->pgid > 0) {
+        kill(-job->pgid, SIGCONT);
+        return;
+    }
+    for (int k = 0; k < job->nprocs; k++) {
+        if (!job->procs[k].done) kill(job->procs[k].pid, SIGCONT);
+    }
+}
+
+// "wait" returns the status of the job started last, "wait %1 %2" that of
+// the last job named (127 if there is no such job); 130 after Ctrl-C
+int builtin_wait(char **args) {
+    int status = 0;
+
+    if (!args[1]) {
+        unsigned long seq = 0;
+
+        wait_for(0);
+        if (shell_interrupted) return 128 + SIGINT;
+        for (int i = 0; i < jobs_cap; i++) {
+            struct job *job = jobs[i];
+            if (!job || job->live > 0) continue;
+            if (job->seq >= seq) {
+                seq = job->seq;
+                status = exit_status(job->status);
+            }
+            release_job(job);
+        }
+        return status;
+    }
+
+    for (int i = 1; args[i]; i++) {
+        struct job *job = find_job("wait", args[i]);
+        if (!job) {
+            status = 127;
+            continue;
+        }
+
+        int id = job->id;
+        wait_for(id);
+        if (shell_interrupted) return 128 + SIGINT;
+        if (jobs[id - 1] && jobs[id - 1]->live == 0) {
+            status = exit_status(jobs[id - 1]->status);
+            release_job(jobs[id - 1]);
+        }
+    }
+    return status;
+}
+
+int builtin_jobs(char **args) {
+    (void)args;
+    jobs_poll(0);
+    for (int i = 0; i < jobs_cap; i++) {
+        struct job *job = jobs[i];
+        if (!job) continue;
+
+        print_job(job);
+        if (job->live == 0) {
+            release_job(job);
+        } else if (job->stopped == job->live) {
+            job->reported = 1;
+        }
+    }
+    return 0;
+}
+
+int builtin_fg(char **args) {
+    struct job *job = find_job("fg", args[1]);
+    if (!job) return 1;
+
+    printf("%s\n", job->cmd ? job->cmd : "");
+    fflush(stdout);
+    if (job_tty >= 0 && job->pgid > 0) {
+        if (job->has_tmodes) tcsetattr(job_tty, TCSADRAIN, &job->tmodes);
+        tcsetpgrp(job_tty, job->pgid);
+    }
+    if (job->stopped > 0) continue_job(job);
+
+    // the pidfds and the SIGCHLD signalfd report every exit and stop
+    while (job->live > 0 && job->stopped < job->live) {
+        jobs_poll(JOBS_POLL_MS);
+    }
+
+    if (job->live > 0) {
+        if (job_tty >= 0 && job->pgid > 0) take_terminal(job, 0);
+        job->reported = 1;
+        if (shell_interactive) {
+            printf("\n");
+            print_job(job);
+        }
+        return 0;
+    }
+    int status = job->status;
+    if (job_tty >= 0 && job->pgid > 0) take_terminal(NULL, status);
+
+    release_job(job);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+static void background_job(struct job *job) {
+    if (job->stopped > 0) continue_job(job);
+    if (shell_interactive) {
+        printf("[%d]+ %s &\n", job->id, job->cmd ? job->cmd : "");
+    }
+}
+
+int builtin_bg(char **args) {
+    int status = 0;
+
+    if (!args[1]) {
+        struct job *job = find_job("bg", NULL);
+        if (!job) return 1;
+        background_job(job);
+        return 0;
+    }
+    for (int i = 1; args[i]; i++) {
+        struct job *job = find_job("bg", args[i]);
+        if (job) {
+            background_job(job);
+        } else {
+            status = 1;
+        }
+    }
+    return status;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+JOBS MODULE EXPLANATION:
+A "job" is one command line the shell manages as a unit, which may be a
+pipeline of several processes. Jobs started with "&" run in the background;
+a foreground job stopped with Ctrl-Z becomes a stopped job. The shell keeps
+running while jobs run, so it needs a way to learn when children exit or
+stop without sitting in a blocking waitpid() call.
+
+HOW CHILDREN ARE WATCHED:
+- pidfd_open(pid) returns a file descriptor that refers to one process.
+  It becomes readable when that process exits.
+- A signalfd receives SIGCHLD as readable data instead of as a signal
+  handler call. SIGCHLD is blocked so it can only arrive this way.
+  The kernel sends it when a child exits, stops or continues; pidfds only
+  report exits, so this is how stopped jobs are noticed.
+- All pidfds and the signalfd are registered in one epoll instance.
+  epoll_wait() then reports every exited child at once, and can do so with
+  a timeout of 0 (just check) or -1 (sleep until something happens).
+- For a ready process, wait4(pid, WNOHANG | WUNTRACED | WCONTINUED)
+  collects what happened immediately; for an exit this is what removes the
+  zombie. wait4() also returns the child's resource usage, which is
+  recorded in stats mode.
+- If the kernel has no pidfd_open (Linux < 5.3), the SIGCHLD signalfd
+  still wakes the shell and every live process is checked.
+- Commands run with "timeout" (limits.c) get an entry in timers. One
+  timerfd, armed with TFD_TIMER_ABSTIME for the earliest deadline, is in
+  the same epoll set: when it fires, fire_timers() signals every process
+  whose deadline passed (and SIGKILLs it kill_after later). A timed
+  process leads its own process group and the signal goes to the group
+  (kill(-pid)), so the processes it started are ended with it. No process or
+  thread waits per timed command. The status of a process killed this way
+  is reported as 124. While timers are pending, foreground waits go
+  through job_wait_timed() instead of a blocking wait4().
+
+JOB CONTROL (interactive shells only):
+- Every job gets its own process group (setpgid), led by its first process.
+  The terminal sends Ctrl-C (SIGINT) and Ctrl-Z (SIGTSTP) to one process
+  group: the terminal's foreground group.
+- tcsetpgrp() hands the terminal to a foreground job and back to the shell
+  when it finishes or stops. The child does it itself too, before exec, so
+  a program that reads the terminal immediately is not stopped by SIGTTIN.
+  It uses job_tty, a close-on-exec copy of the terminal descriptor (10 or
+  above), since a pipeline stage's fd 0 is already its pipe by then.
+- The shell ignores SIGQUIT, SIGTSTP, SIGTTIN and SIGTTOU, and catches
+  SIGINT only to throw away the line being typed. Children get all of them
+  back as default (job_sigdefault), together with the original signal mask
+  (job_sigmask), through posix_spawn attributes or job_child_setup().
+- When a job stops, its terminal modes (tcgetattr) are saved and the
+  shell's modes restored, so "fg" can give an editor its raw mode back.
+Scripts, "-c" and piped input run without job control: processes stay in
+the shell's process group and Ctrl-C stops the shell with them.
+
+DATA STRUCTURES:
+- struct job: id, command text, live and stopped process counts, process
+  group, and a flexible array member "procs[]" holding one struct job_proc
+  per process. A flexible array member lets one calloc() hold the struct
+  and its array together.
+- jobs[]: growable array of job pointers indexed by id - 1, so the lowest
+  free number is reused, like in bash
+- The epoll event stores a pointer to the job_proc (data.ptr), so a ready
+  pidfd leads straight to its process without a search; the signalfd is
+  registered with a NULL pointer
+- seq: a counter stamped on a job when it starts or stops; the job with the
+  highest stamp is the current job ("+" in the jobs list)
+
+FUNCTION IMPLEMENTATIONS:
+
+1. void jobs_init(int interactive)
+   PURPOSE: Records the signal mask children inherit and, for an
+   interactive shell, puts the shell in its own process group in the
+   terminal's foreground and sets up the signals described above
+
+2. void job_child_setup(pid_t pgid, int foreground)
+   PURPOSE: Called in a forked child before it runs anything: joins the
+   job's process group, takes the terminal for a foreground job, and
+   restores the signals the shell changed
+   - jobs_forked() is called in addition by a forked copy of the shell
+     ("a && b &", "$(...)", a function in a pipeline): it closes the epoll
+     set, signalfd and timerfd it shares with the shell that forked it,
+     which would otherwise receive the copy's pidfds, and forgets that
+     shell's jobs and timeouts
+
+3. int job_start(pid_t *pids, int npids, char ***stages, pid_t pgid, int stopped)
+   PURPOSE: Registers the processes of a job
+   - pids[i] is the process of pipeline stage i (-1 if it failed to start,
+     ran inside the shell or was already reaped); stages[] gives the
+     command text; pgid is the job's process group (-1 for none)
+   - stopped is 1 for a foreground job that was just stopped with Ctrl-Z
+   RETURN VALUE: The job number, or -1 on failure
+
+4. int job_wait_foreground(pid_t *pids, int npids, char ***stages, pid_t pgid,
+                           double started, const double *launched)
+   PURPOSE: Waits for every process of a foreground job with
+   wait_process(). If one stops, the processes not reaped yet become a
+   stopped job. Then the shell takes the terminal back.
+   RETURN VALUE: The wait status of the last stage
+
+5. int jobs_poll(int timeout_ms)
+   PURPOSE: Reaps exited children and notes stopped ones, waiting up to
+   timeout_ms for something to happen
+   RETURN VALUE: Number of processes reaped
+
+6. int jobs_active(void)
+   PURPOSE: Number of jobs that still have live processes
+   USAGE: The -j N worker pool waits in jobs_poll() while this is >= N
+
+7. void jobs_notify(void)
+   PURPOSE: Reports finished jobs and forgets them ("[1]+  Done  sleep 5"),
+   and reports jobs that stopped in the background
+   USAGE: Called before each prompt, and by the line editor while the
+   prompt waits: jobs_event_fd() returns the epoll descriptor, which
+   becomes readable when a child exits, so lineedit.c can poll() it
+   together with the terminal
+
+8. void jobs_wait_all(void) / int builtin_wait(char **args)
+   PURPOSE: The "wait" builtin: "wait" waits for every job,
+   "wait %2" for job 2, "wait 1234" for the job containing process 1234.
+   Ctrl-C stops waiting.
+   RETURN VALUE: The exit status of the last job named, 127 if it does
+   not exist; for a plain "wait", that of the job started last; 130 after
+   Ctrl-C
+
+9. int builtin_jobs(char **args)
+   PURPOSE: The "jobs" builtin: lists every job as Running, Stopped or Done
+
+10. int builtin_fg(char **args) / int builtin_bg(char **args)
+   PURPOSE: "fg [%N]" gives the job the terminal, continues it with SIGCONT
+   sent to its process group and waits until it exits or stops again.
+   "bg [%N...]" continues stopped jobs in the background.
+   Without an argument both use the current job.
+
+EXTERNAL FUNCTIONS USED:
+- syscall(SYS_pidfd_open, pid, 0): opens a pidfd (glibc 2.36 has no
+  wrapper in every distribution, so the raw system call is used)
+- signalfd(-1, &mask, flags): creates a descriptor that receives the
+  (blocked) signals in mask
+- sigprocmask(how, &set, &old): blocks or unblocks signals
+- epoll_create1(EPOLL_CLOEXEC): creates an epoll instance
+- epoll_ctl(epfd, op, fd, &event): adds or removes a watched descriptor
+- epoll_wait(epfd, events, max, timeout): waits for ready descriptors
+- wait4(pid, &status, WNOHANG, &ru): collects an exit status and resource
+  usage without blocking
+- timerfd_create(CLOCK_MONOTONIC, flags) / timerfd_settime(fd,
+  TFD_TIMER_ABSTIME, &its, NULL): a descriptor that becomes readable at an
+  absolute time
+- setpgid(pid, pgid): moves a process into a process group
+- tcgetpgrp(fd) / tcsetpgrp(fd, pgid): read or change the foreground process
+  group of a terminal
+- tcgetattr(fd, &modes) / tcsetattr(fd, TCSADRAIN, &modes): save and restore
+  terminal settings (echo, line editing, ...)
+- kill(-pgid, SIGCONT): sends a signal to a whole process group
+*/
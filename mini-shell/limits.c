@@ -0,0 +1,244 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <strings.h>
+#include <math.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include "shell.h"
+
+struct limit {
+    char option;
+    int resource;
+    rlim_t unit;            // bytes per unit of the value ulimit shows
+    const char *label;
+    const char *unit_name;  // NULL for plain counts
+};
+
+static const struct limit limits[] = {
+    {'c', RLIMIT_CORE, 1024, "core file size", "blocks"},
+    {'d', RLIMIT_DATA, 1024, "data seg size", "kbytes"},
+    {'f', RLIMIT_FSIZE, 1024, "file size", "blocks"},
+    {'l', RLIMIT_MEMLOCK, 1024, "max locked memory", "kbytes"},
+    {'m', RLIMIT_RSS, 1024, "max memory size", "kbytes"},
+    {'n', RLIMIT_NOFILE, 1, "open files", NULL},
+    {'s', RLIMIT_STACK, 1024, "stack size", "kbytes"},
+    {'t', RLIMIT_CPU, 1, "cpu time", "seconds"},
+    {'u', RLIMIT_NPROC, 1, "max user processes", NULL},
+    {'v', RLIMIT_AS, 1024, "virtual memory", "kbytes"},
+};
+#define NLIMITS (sizeof(limits) / sizeof(limits[0]))
+
+static const struct {
+    const char *name;
+    int sig;
+} signal_names[] = {
+    {"HUP", SIGHUP}, {"INT", SIGINT}, {"QUIT", SIGQUIT}, {"KILL", SIGKILL},
+    {"USR1", SIGUSR1}, {"USR2", SIGUSR2}, {"ALRM", SIGALRM}, {"TERM", SIGTERM},
+};
+
+static const struct limit *find_limit(char option) {
+    for (size_t i = 0; i < NLIMITS; i++) {
+        if (limits[i].option == option) return &limits[i];
+    }
+    return NULL;
+}
+
+static void print_limit(const struct limit *l, int hard, int labels) {
+    struct rlimit rl;
+
+    if (getrlimit(l->resource, &rl) != 0) {
+        perror("ulimit");
+        return;
+    }
+    rlim_t value = hard ? rl.rlim_max : rl.rlim_cur;
+    if (labels) {
+        char unit[32];
+        if (l->unit_name) snprintf(unit, sizeof(unit), "(%s, -%c)", l->unit_name, l->option);
+        else snprintf(unit, sizeof(unit), "(-%c)", l->option);
+        printf("%-20s %16s ", l->label, unit);
+    }
+    if (value == RLIM_INFINITY) printf("unlimited\n");
+    else printf("%llu\n", (unsigned long long)(value / l->unit));
+}
+
+// "ulimit [-SH] [-a | -cdflmnstuv] [value]": limits of the shell, which
+// every command it starts inherits. Without -S or -H a new value sets
+// both the soft and the hard limit, and the soft one is shown.
+int builtin_ulimit(char **args) {
+    const struct limit *l = find_limit('f');
+    int soft = 0, hard = 0, all = 0;
+    int i = 1;
+
+    for (; args[i] && args[i][0] == '-' && args[i][1]; i++) {
+        for (const char *o = args[i] + 1; *o; o++) {
+            if (*o == 'S') soft = 1;
+            else if (*o == 'H') hard = 1;
+            else if (*o == 'a') all = 1;
+            else if (!(l = find_limit(*o))) {
+                fprintf(stderr, "ulimit: -%c: invalid option\n"
+                        "usage: ulimit [-SH] [-a | -cdflmnstuv] [limit]\n", *o);
+                return 2;
+            }
+        }
+    }
+    if (all) {
+        for (size_t k = 0; k < NLIMITS; k++) print_limit(&limits[k], hard && !soft, 1);
+        return 0;
+    }
+    if (!args[i]) {
+        print_limit(l, hard && !soft, 0);
+        return 0;
+    }
+    if (args[i + 1]) {
+        fprintf(stderr, "ulimit: too many arguments\n");
+        return 2;
+    }
+
+    struct rlimit rl;
+    if (getrlimit(l->resource, &rl) != 0) {
+        perror("ulimit");
+        return 1;
+    }
+    rlim_t value;
+    if (strcmp(args[i], "unlimited") == 0) {
+        value = RLIM_INFINITY;
+    } else if (strcmp(args[i], "hard") == 0 || strcmp(args[i], "soft") == 0) {
+        value = args[i][0] == 'h' ? rl.rlim_max : rl.rlim_cur;
+    } else {
+        char *end;
+        unsigned long long n = strtoull(args[i], &end, 10);
+        if (end == args[i] || *end || args[i][0] == '-' ||
+            n > (unsigned long long)RLIM_INFINITY / l->unit) {
+            fprintf(stderr, "ulimit: %s: invalid number\n", args[i]);
+            return 1;
+        }
+        value = (rlim_t)n * l->unit;
+    }
+    if (!soft && !hard) soft = hard = 1;
+    if (soft) rl.rlim_cur = value;
+    if (hard) rl.rlim_max = value;
+    if (setrlimit(l->resource, &rl) != 0) {
+        fprintf(stderr, "ulimit: %s: cannot modify limit: %s\n", l->label, strerror(errno));
+        return 1;
+    }
+    return 0;
+}
+
+// "1.5", "30s", "2m", "1h", "1d"; returns -1 if s is not a duration
+static double parse_duration(const char *s) {
+    char *end;
+    double value = strtod(s, &end);
+
+    if (end == s || !isfinite(value) || value < 0) return -1;
+    if (*end && end[1]) return -1;
+    switch (*end) {
+    case '\0': case 's': return value;
+    case 'm': return value * 60;
+    case 'h': return value * 3600;
+    case 'd': return value * 86400;
+    default: return -1;
+    }
+}
+
+static int parse_signal(const char *s) {
+    char *end;
+    long n = strtol(s, &end, 10);
+
+    if (end != s && !*end) return n > 0 && n < NSIG ? (int)n : -1;
+    if (strncasecmp(s, "SIG", 3) == 0) s += 3;
+    for (size_t i = 0; i < sizeof(signal_names) / sizeof(signal_names[0]); i++) {
+        if (strcasecmp(s, signal_names[i].name) == 0) return signal_names[i].sig;
+    }
+    return -1;
+}
+
+int timeout_prefix(char **args, struct timeout *t) {
+    int i = 1;
+
+    t->seconds = 0;
+    t->kill_after = 0;
+    t->sig = SIGTERM;
+    if (!args[0] || strcmp(args[0], "timeout") != 0 || is_function(args[0])) return 0;
+
+    for (; args[i] && args[i][0] == '-' && (args[i][1] == 'k' || args[i][1] == 's') &&
+           !args[i][2]; i += 2) {
+        if (!args[i + 1]) break;
+        if (args[i][1] == 'k') {
+            t->kill_after = parse_duration(args[i + 1]);
+            if (t->kill_after < 0) {
+                fprintf(stderr, "timeout: %s: invalid time interval\n", args[i + 1]);
+                return -1;
+            }
+        } else if ((t->sig = parse_signal(args[i + 1])) < 0) {
+            fprintf(stderr, "timeout: %s: invalid signal\n", args[i + 1]);
+            return -1;
+        }
+    }
+    if (!args[i] || !args[i + 1]) {
+        fprintf(stderr, "usage: timeout [-k duration] [-s signal] duration command [args...]\n");
+        return -1;
+    }
+    t->seconds = parse_duration(args[i]);
+    if (t->seconds < 0) {
+        fprintf(stderr, "timeout: %s: invalid time interval\n", args[i]);
+        return -1;
+    }
+    return i + 1;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+LIMITS MODULE EXPLANATION:
+Keeps one runaway command from stalling a whole batch: "ulimit" caps the
+resources commands may use, "timeout" the time they may run.
+
+ULIMIT:
+"ulimit -v 1000000" (kbytes), "ulimit -t 60" (CPU seconds), "ulimit -n
+256" (open files), ... change the shell's own limits with setrlimit().
+Limits are inherited: every process the shell starts afterwards has them
+from its first instruction, set by the kernel between spawn and exec
+without any work per command. As in other shells they also apply to the
+shell itself: a batch script that sets them limits itself along with its
+commands.
+- "ulimit -X" prints the soft limit of resource X (-f without an option),
+  "ulimit -a" all of them; -H shows hard limits
+- "ulimit -X value" sets the soft and the hard limit; with -S only the
+  soft one, which can be raised again up to the hard one later
+- the value "unlimited" removes the limit, "hard"/"soft" copy the
+  current hard or soft limit
+
+TIMEOUT:
+"timeout [-k kill_after] [-s signal] duration command args..." works like
+the coreutils program of that name, but is not a process of its own: it
+is a prefix that pipeline.c takes off the command (timeout_prefix()).
+The command is started as usual (always as a process, also a builtin or
+function, so it can be killed) and its pid goes into the timer list of
+jobs.c. One timerfd, armed for the earliest deadline of all timed
+commands, wakes the wait loop of the shell when a deadline passes: the
+command gets the signal (SIGTERM by default), and SIGKILL kill_after
+later if it is still alive. Like coreutils' timeout, the command leads a
+process group of its own and the signals go to the whole group, so
+"timeout 1 sh -c 'sleep 9'" also ends the sleep that sh started. In an
+interactive pipeline the command therefore leaves the job's group, and
+Ctrl-C or Ctrl-Z does not reach it. A command that timed out finishes with
+status 124, and "NAME: timed out after Ns" is printed.
+Durations are seconds, or a number with s, m, h or d; 0 means no limit.
+Status 125 means the timeout words themselves were wrong.
+
+Timers keep working for background jobs and the "-j N" pool: every wait
+of the shell (foreground programs, "wait", the pool's wait for a free
+slot, the idle prompt) sleeps in the epoll set that also holds the timer
+fd.
+
+EXTERNAL FUNCTIONS USED:
+- getrlimit(resource, &rl) / setrlimit(resource, &rl): read and change a
+  limit; rl.rlim_cur is the soft limit the kernel enforces, rl.rlim_max
+  the ceiling an unprivileged process may raise it to
+- strtod(s, &end): parses the number of a duration, fractions included
+*/
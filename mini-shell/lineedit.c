@@ -0,0 +1,707 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include "shell.h"
+
+// Keys that arrive as escape sequences get codes above the byte values
+enum {
+    KEY_NONE = -1,
+    KEY_UP = 256,
+    KEY_DOWN,
+    KEY_LEFT,
+    KEY_RIGHT,
+    KEY_HOME,
+    KEY_END,
+    KEY_DELETE
+};
+
+// How long to wait for the rest of an escape sequence (milliseconds)
+#define ESC_WAIT_MS 50
+
+// Directory entries the command index reads per idle step (complete.c)
+#define INDEX_STEP 256
+
+// More completion candidates than this are counted instead of listed
+#define COMPLETE_LIST_MAX 300
+
+// The line being edited, always '\0'-terminated
+static char *line = NULL;
+static size_t line_len = 0;
+static size_t line_cap = 0;
+static size_t cursor = 0;
+
+// The edited line while history entries are shown instead
+static char *saved = NULL;
+static size_t saved_len = 0;
+static size_t hist_at = 0;      // history entry shown, history_count() + 1 for the line
+
+// Reverse search (Ctrl-R)
+static int searching = 0;
+static char query[128];
+static size_t query_len = 0;
+static size_t found_at = 0;     // entry that matched, 0 if none
+
+// Bytes read from the terminal and not used yet: the rest of a pasted
+// block, or keys typed while a command was running
+static unsigned char input[512];
+static size_t input_start = 0;
+static size_t input_end = 0;
+
+// Everything one batch of keys changes on the screen, sent with one write()
+static char *out = NULL;
+static size_t out_len = 0;
+static size_t out_cap = 0;
+
+static int last_key = KEY_NONE;
+
+static void out_add(const char *s, size_t len) {
+    if (out_len + len > out_cap) {
+        size_t new_cap = out_cap ? out_cap : 1024;
+        while (new_cap < out_len + len) new_cap *= 2;
+        char *grown = realloc(out, new_cap);
+        if (!grown) return;
+        out = grown;
+        out_cap = new_cap;
+    }
+    memcpy(out + out_len, s, len);
+    out_len += len;
+}
+
+static void out_str(const char *s) {
+    out_add(s, strlen(s));
+}
+
+static void out_flush(void) {
+    size_t done = 0;
+
+    while (done < out_len) {
+        ssize_t n = write(STDOUT_FILENO, out + done, out_len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    out_len = 0;
+}
+
+static int line_reserve(size_t need) {
+    if (need + 1 <= line_cap) return 0;
+    size_t new_cap = line_cap ? line_cap : 256;
+    while (new_cap < need + 1) new_cap *= 2;
+    char *grown = realloc(line, new_cap);
+    if (!grown) return -1;
+    line = grown;
+    line_cap = new_cap;
+    return 0;
+}
+
+static void line_set(const char *s, size_t len) {
+    if (line_reserve(len) != 0) return;
+    memcpy(line, s, len);
+    line_len = cursor = len;
+    line[len] = '\0';
+}
+
+static void line_insert(const char *s, size_t len) {
+    if (line_reserve(line_len + len) != 0) return;
+    memmove(line + cursor + len, line + cursor, line_len - cursor + 1);
+    memcpy(line + cursor, s, len);
+    line_len += len;
+    cursor += len;
+}
+
+static void line_delete(size_t from, size_t to) {
+    memmove(line + from, line + to, line_len - to + 1);
+    line_len -= to - from;
+    cursor = from;
+}
+
+// UTF-8: a character is one lead byte and its 10xxxxxx continuation bytes,
+// and takes one column on the screen
+static int is_cont(char c) {
+    return ((unsigned char)c & 0xc0) == 0x80;
+}
+
+static size_t columns(const char *s, size_t len) {
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) n += !is_cont(s[i]);
+    return n;
+}
+
+static size_t char_before(size_t pos) {
+    if (pos > 0) pos--;
+    while (pos > 0 && is_cont(line[pos])) pos--;
+    return pos;
+}
+
+static size_t char_after(size_t pos) {
+    if (pos < line_len) pos++;
+    while (pos < line_len && is_cont(line[pos])) pos++;
+    return pos;
+}
+
+static size_t term_width(void) {
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) return ws.ws_col;
+    return 80;
+}
+
+// Rewrites the whole prompt line: a line longer than the terminal scrolls
+// sideways so the cursor stays visible
+static void refresh(const char *prompt) {
+    char search_prompt[sizeof(query) + 32];
+    char move[32];
+
+    if (searching) {
+        snprintf(search_prompt, sizeof(search_prompt), "(%sreverse-i-search)`%.*s': ",
+                 found_at || query_len == 0 ? "" : "failed ", (int)query_len, query);
+        prompt = search_prompt;
+    }
+
+    size_t width = term_width();
+    size_t plen = columns(prompt, strlen(prompt));
+    size_t room = width > plen + 1 ? width - plen - 1 : 1;
+    size_t start = 0;
+    size_t skip = columns(line, cursor);
+    skip = skip > room ? skip - room : 0;
+    while (skip-- > 0) {
+        start++;
+        while (start < line_len && is_cont(line[start])) start++;
+    }
+    size_t end = start;
+    for (size_t shown = 0; end < line_len && shown < room; shown++) {
+        end++;
+        while (end < line_len && is_cont(line[end])) end++;
+    }
+
+    out_str("\r");
+    out_str(prompt);
+    out_add(line + start, end - start);
+    out_str("\x1b[K\r");
+    size_t col = plen + columns(line + start, cursor - start);
+    if (col > 0) {
+        snprintf(move, sizeof(move), "\x1b[%zuC", col);
+        out_str(move);
+    }
+}
+
+// Next unused input byte; waits up to wait_ms for one if none is buffered.
+// Returns -1 if none came.
+static int next_byte(int wait_ms) {
+    if (input_start == input_end) {
+        struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+        if (poll(&pfd, 1, wait_ms) <= 0) return -1;
+        ssize_t n = read(STDIN_FILENO, input, sizeof(input));
+        if (n <= 0) return -1;
+        input_start = 0;
+        input_end = (size_t)n;
+    }
+    return input[input_start++];
+}
+
+// Reads one key: a byte, or an escape sequence such as "\x1b[A" (Up) or
+// "\x1b[3~" (Delete). Unknown sequences are read to their end and ignored.
+static int read_key(void) {
+    int c = next_byte(0);
+    if (c != 0x1b) return c;
+
+    int kind = next_byte(ESC_WAIT_MS);
+    if (kind != '[' && kind != 'O') return KEY_NONE;
+
+    int param = 0;
+    int first = 1;
+    while ((c = next_byte(ESC_WAIT_MS)) >= 0) {
+        if (c >= '0' && c <= '9') {
+            if (first) param = param * 10 + (c - '0');
+        } else if (c == ';') {
+            first = 0;
+        } else {
+            break;
+        }
+    }
+    switch (c) {
+    case 'A': return KEY_UP;
+    case 'B': return KEY_DOWN;
+    case 'C': return KEY_RIGHT;
+    case 'D': return KEY_LEFT;
+    case 'H': return KEY_HOME;
+    case 'F': return KEY_END;
+    case '~':
+        if (param == 1 || param == 7) return KEY_HOME;
+        if (param == 4 || param == 8) return KEY_END;
+        if (param == 3) return KEY_DELETE;
+        return KEY_NONE;
+    default: return KEY_NONE;
+    }
+}
+
+// Up (-1) and Down (+1) walk through the history; the line being written
+// is kept and comes back below the newest entry
+static void history_move(int step) {
+    size_t count = history_count();
+    size_t len;
+
+    if (step < 0 && hist_at <= 1) return;
+    if (step > 0 && hist_at > count) return;
+
+    if (hist_at > count) {
+        char *copy = realloc(saved, line_len + 1);
+        if (!copy) return;
+        memcpy(copy, line, line_len + 1);
+        saved = copy;
+        saved_len = line_len;
+    }
+    hist_at += step;
+    if (hist_at > count) {
+        line_set(saved, saved_len);
+        return;
+    }
+    const char *entry = history_entry(hist_at, &len);
+    if (entry) line_set(entry, len);
+}
+
+static void search_update(size_t before) {
+    size_t len;
+
+    query[query_len] = '\0';
+    found_at = query_len ? history_find_substring(query, before) : 0;
+    if (!found_at) return;
+
+    const char *entry = history_entry(found_at, &len);
+    if (!entry) return;
+    line_set(entry, len);
+    const char *hit = memmem(entry, len, query, query_len);
+    if (hit) cursor = (size_t)(hit - entry);
+}
+
+// A key during Ctrl-R. Returns 1 if it was used up, 0 if it ends the
+// search and is then handled as usual.
+static int search_key(int key) {
+    switch (key) {
+    case CTRL('R'):
+        if (found_at > 1) search_update(found_at);
+        return 1;
+    case CTRL('G'):
+        searching = 0;
+        line_set(saved ? saved : "", saved ? saved_len : 0);
+        return 1;
+    case 127:
+    case CTRL('H'):
+        if (query_len > 0) query_len--;
+        search_update(history_count() + 1);
+        return 1;
+    default:
+        if (key >= 32 && key < 256 && key != 127) {
+            if (query_len + 1 < sizeof(query)) query[query_len++] = (char)key;
+            search_update(found_at ? found_at + 1 : history_count() + 1);
+            return 1;
+        }
+        searching = 0;
+        return 0;
+    }
+}
+
+// Characters that need a backslash to be part of a word
+static int needs_escape(char c) {
+    return c == ' ' || c == '\t' || strchr("\\'\"|&;()<>$`*?[#", c) != NULL;
+}
+
+static int ends_word(char c) {
+    return c == ' ' || c == '\t' || strchr("|&;()<>", c) != NULL;
+}
+
+static int is_dir(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// Prints the candidates below the prompt line in columns, like ls. skip
+// bytes of each (the directory part of a path) are left out.
+static void list_candidates(const struct arg_vec *c, size_t skip, int files) {
+    char msg[64];
+
+    out_str("\r\n");
+    if (c->len > COMPLETE_LIST_MAX) {
+        snprintf(msg, sizeof(msg), "%zu possibilities\r\n", c->len);
+        out_str(msg);
+        return;
+    }
+    size_t widest = 0;
+    for (size_t i = 0; i < c->len; i++) {
+        size_t w = columns(c->argv[i] + skip, strlen(c->argv[i] + skip)) + 1;
+        if (w > widest) widest = w;
+    }
+    size_t ncols = term_width() / (widest + 1);
+    if (ncols == 0) ncols = 1;
+    size_t nrows = (c->len + ncols - 1) / ncols;
+
+    for (size_t r = 0; r < nrows; r++) {
+        for (size_t k = 0; k < ncols; k++) {
+            size_t i = k * nrows + r;
+            if (i >= c->len) break;
+            const char *name = c->argv[i] + skip;
+            size_t w = columns(name, strlen(name));
+            out_str(name);
+            if (files && is_dir(c->argv[i])) {
+                out_str("/");
+                w++;
+            }
+            if (k + 1 < ncols && i + nrows < c->len) {
+                while (w++ < widest + 1) out_str(" ");
+            }
+        }
+        out_str("\r\n");
+    }
+}
+
+// Tab: completes the word before the cursor. The first word of a command
+// is looked up among the builtins and the programs in PATH, any other word
+// (or one with a '/') among the file names.
+static void complete(void) {
+    static struct arg_vec cands = {NULL, 0, 0};
+    char *word;
+    size_t start = cursor;
+    size_t wlen = 0;
+    int quoted = 0;
+
+    while (start > 0 && !(ends_word(line[start - 1]) &&
+                          (start < 2 || line[start - 2] != '\\'))) {
+        start--;
+    }
+    word = malloc(cursor - start + 1);
+    if (!word) return;
+    for (size_t i = start; i < cursor; i++) {
+        char c = line[i];
+        if (c == '\'' || c == '"') {
+            quoted = 1;
+            continue;
+        }
+        if (c == '\\' && i + 1 < cursor) c = line[++i];
+        word[wlen++] = c;
+    }
+    word[wlen] = '\0';
+
+    size_t before = start;
+    while (before > 0 && (line[before - 1] == ' ' || line[before - 1] == '\t')) before--;
+    int command = (before == 0 || strchr("|&;(", line[before - 1])) && !strchr(word, '/');
+
+    cands.len = 0;
+    expand_reset();
+    long n = command ? complete_commands(word, &cands) : complete_files(word, &cands);
+    if (n <= 0) {
+        out_str("\a");
+        free(word);
+        return;
+    }
+
+    // the longest prefix every candidate shares is certain to be typed
+    size_t common = strlen(cands.argv[0]);
+    for (size_t i = 1; i < cands.len; i++) {
+        size_t k = 0;
+        while (k < common && cands.argv[i][k] == cands.argv[0][k]) k++;
+        common = k;
+    }
+
+    if (common > wlen) {
+        for (size_t i = wlen; i < common; i++) {
+            char c = cands.argv[0][i];
+            if (!quoted && needs_escape(c)) line_insert("\\", 1);
+            line_insert(&c, 1);
+        }
+    }
+    if (cands.len == 1) {
+        if (!command && is_dir(cands.argv[0])) {
+            line_insert("/", 1);
+        } else if (quoted) {
+            // close the quote the word was opened with
+            for (size_t i = start; i < cursor; i++) {
+                if (line[i] == '\'' || line[i] == '"') {
+                    line_insert(&line[i], 1);
+                    break;
+                }
+            }
+            line_insert(" ", 1);
+        } else {
+            line_insert(" ", 1);
+        }
+    } else if (common <= wlen) {
+        // a second Tab with nothing left to add shows the choices
+        if (last_key == '\t') {
+            const char *slash = strrchr(word, '/');
+            list_candidates(&cands, command || !slash ? 0 : (size_t)(slash - word + 1), !command);
+        } else {
+            out_str("\a");
+        }
+    }
+    free(word);
+}
+
+// Finished jobs are reported above the prompt while it waits for a key
+static void show_jobs(void) {
+    out_str("\r\x1b[K");
+    out_flush();
+    jobs_notify();
+    fflush(stdout);
+}
+
+// Handles one key. Returns 0 to go on editing, 1 when the line is done,
+// -1 at end of input.
+static int handle_key(int key) {
+    if (searching && search_key(key)) return 0;
+
+    switch (key) {
+    case '\r':
+    case '\n':
+        cursor = line_len;
+        return 1;
+    case CTRL('C'):
+        // like the terminal would: the line stays on the screen and is
+        // dropped (line_edit())
+        cursor = line_len;
+        shell_interrupted = 1;
+        return 1;
+    case CTRL('D'):
+        if (line_len == 0) {
+            out_str("\r\n");
+            return -1;
+        }
+        if (cursor < line_len) line_delete(cursor, char_after(cursor));
+        break;
+    case KEY_DELETE:
+        if (cursor < line_len) line_delete(cursor, char_after(cursor));
+        break;
+    case 127:
+    case CTRL('H'):
+        if (cursor > 0) line_delete(char_before(cursor), cursor);
+        break;
+    case CTRL('A'):
+    case KEY_HOME:
+        cursor = 0;
+        break;
+    case CTRL('E'):
+    case KEY_END:
+        cursor = line_len;
+        break;
+    case CTRL('B'):
+    case KEY_LEFT:
+        cursor = char_before(cursor);
+        break;
+    case CTRL('F'):
+    case KEY_RIGHT:
+        cursor = char_after(cursor);
+        break;
+    case CTRL('K'):
+        line_len = cursor;
+        line[line_len] = '\0';
+        break;
+    case CTRL('U'):
+        line_delete(0, cursor);
+        break;
+    case CTRL('W'): {
+        size_t from = cursor;
+        while (from > 0 && (line[from - 1] == ' ' || line[from - 1] == '\t')) from--;
+        while (from > 0 && line[from - 1] != ' ' && line[from - 1] != '\t') from--;
+        line_delete(from, cursor);
+        break;
+    }
+    case CTRL('L'):
+        out_str("\x1b[H\x1b[2J");
+        break;
+    case CTRL('P'):
+    case KEY_UP:
+        history_move(-1);
+        break;
+    case CTRL('N'):
+    case KEY_DOWN:
+        history_move(1);
+        break;
+    case CTRL('R'): {
+        char *copy = realloc(saved, line_len + 1);
+        if (!copy) break;
+        memcpy(copy, line, line_len + 1);
+        saved = copy;
+        saved_len = line_len;
+        searching = 1;
+        query_len = 0;
+        found_at = 0;
+        break;
+    }
+    case '\t':
+        complete();
+        break;
+    default:
+        if (key >= 32 && key < 256 && key != 127) {
+            char c = (char)key;
+            line_insert(&c, 1);
+        }
+        break;
+    }
+    last_key = key;
+    return 0;
+}
+
+char *line_edit(const char *prompt) {
+    struct termios cooked, raw;
+    int done = 0;
+
+    if (line_reserve(0) != 0) return NULL;
+    line_len = cursor = 0;
+    line[0] = '\0';
+    hist_at = history_count() + 1;
+    searching = 0;
+    last_key = KEY_NONE;
+    complete_index_check();
+
+    if (tcgetattr(STDIN_FILENO, &cooked) != 0) return NULL;
+    raw = cooked;
+    raw.c_iflag &= ~(ICRNL | INLCR | IXON | ISTRIP);
+    raw.c_lflag &= ~(ICANON | ECHO | ISIG | IEXTEN);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSADRAIN, &raw);
+
+    refresh(prompt);
+    while (!done) {
+        out_flush();
+        if (input_start == input_end) {
+            struct pollfd fds[2] = {
+                {STDIN_FILENO, POLLIN, 0},
+                {jobs_event_fd(), POLLIN, 0},
+            };
+            // with no key waiting, idle time builds the command index
+            int n = poll(fds, 2, complete_index_pending() ? 0 : -1);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) {
+                done = -1;
+                break;
+            }
+            if (n == 0) {
+                complete_index_work(INDEX_STEP);
+                continue;
+            }
+            if (fds[1].revents & POLLIN) {
+                show_jobs();
+                refresh(prompt);
+            }
+            if (!fds[0].revents) continue;
+
+            ssize_t r = read(STDIN_FILENO, input, sizeof(input));
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) {
+                done = -1;
+                break;
+            }
+            input_start = 0;
+            input_end = (size_t)r;
+        }
+
+        // every key already read is handled before the screen is redrawn
+        while (!done && input_start < input_end) {
+            int key = read_key();
+            if (key != KEY_NONE) done = handle_key(key);
+        }
+        if (done >= 0) refresh(prompt);
+    }
+    if (done > 0) {
+        out_str(shell_interrupted ? "^C\r\n" : "\r\n");
+        if (shell_interrupted) line_len = cursor = 0;
+        line[line_len] = '\0';
+    }
+    out_flush();
+    tcsetattr(STDIN_FILENO, TCSADRAIN, &cooked);
+    return done > 0 ? line : NULL;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+LINE EDITOR EXPLANATION:
+An interactive shell reads the terminal through line_edit() instead of the
+line reader (input.c). The terminal is switched to raw mode for as long as
+the prompt waits, so every key reaches the shell at once and the editor
+itself decides what appears on the screen:
+- Left/Right, Ctrl-B/Ctrl-F      move by one character
+- Home/End, Ctrl-A/Ctrl-E        go to the start or the end
+- Backspace, Delete, Ctrl-D      delete a character (Ctrl-D on an empty
+                                 line is end of input)
+- Ctrl-K / Ctrl-U / Ctrl-W       delete to the end, to the start, the word
+                                 before the cursor
+- Up/Down, Ctrl-P/Ctrl-N         previous and next history entries
+- Ctrl-R                         search the history backwards; Ctrl-R
+                                 again finds an older match, Ctrl-G gives
+                                 up, any other key takes the match
+- Tab                            complete a command or file name; a second
+                                 Tab lists the choices
+- Ctrl-L                         clear the screen
+- Ctrl-C                         drop the line (main.c also drops an
+                                 unfinished multi-line command)
+The line is returned without the newline and stays valid until the next
+call. Lines a terminal cannot edit (a script, a pipe, TERM=dumb) are still
+read by the line reader; main.c makes that choice.
+
+RAW MODE:
+tcgetattr() reads the terminal settings and tcsetattr() changes them:
+- ICANON off: read() returns each key, the kernel does no line editing
+- ECHO off: keys are not printed by the kernel; refresh() draws them
+- ISIG off: Ctrl-C and Ctrl-Z arrive as bytes 3 and 26 instead of signals
+- IEXTEN, ICRNL, INLCR, IXON off: Ctrl-V, Ctrl-S/Ctrl-Q and the Enter key
+  reach the editor unchanged
+Output processing (OPOST) stays on, so the "\n" of job messages printed
+meanwhile still starts a new line. The previous settings are restored
+before line_edit() returns, and before any command runs.
+
+ONE WRITE PER REDRAW:
+Every change goes to the out buffer, and out_flush() sends it with a
+single write() after all keys that were read have been handled. A redraw
+is always the complete line:
+    "\r" prompt visible-part-of-line "\x1b[K" "\r" "\x1b[<col>C"
+carriage return, the text, "erase to the end of the line", and a move of
+the cursor to its column. Drawing the whole line is simpler than patching
+parts of it and costs one small write: a line of 80 characters is under
+100 bytes. Writing each piece separately would mean several system calls
+per key and, over a slow connection, visible flicker. Pasting a 500 byte
+command arrives in one read() and is drawn once, not 500 times.
+
+A line longer than the terminal scrolls sideways: refresh() skips enough
+characters at the start that the cursor stays on screen. Columns are
+counted in UTF-8 characters (bytes that are not 10xxxxxx continuation
+bytes), so "é" moves the cursor one column, not two.
+
+INPUT AND ESCAPE SEQUENCES:
+Keys are read in chunks of up to 512 bytes into input[]. Keys typed while
+a command ran, or the rest of a pasted block of lines, stay there for the
+next call. Arrow and function keys send escape sequences: Up is
+"\x1b[A", Delete "\x1b[3~", Home "\x1b[H" or "\x1b[1~" depending on the
+terminal. read_key() collects the sequence and returns one KEY_* code
+above 255, so handle_key() switches over keys and bytes alike. A sequence
+split across reads is completed by waiting up to 50 ms (ESC_WAIT_MS).
+
+WAITING:
+While the prompt waits, poll() watches two descriptors:
+1. the terminal, for keys
+2. jobs_event_fd() (jobs.c), which becomes readable when a background job
+   exits: show_jobs() clears the prompt line, jobs_notify() prints
+   "[1]+ Done ...", and the prompt is drawn again below it
+While the command index (complete.c) is incomplete, the timeout is 0: a
+poll() that finds nothing lets complete_index_work() read 256 more
+directory entries, then poll() checks for keys again. Once the index is
+ready the timeout is -1 and the shell sleeps until something happens.
+
+COMPLETION:
+complete() finds the word before the cursor (backslashes and quotes are
+taken off), then asks complete_commands() if it is the first word of a
+command (at the start of the line, or after |, &, ; or "("), or
+complete_files() otherwise. The longest prefix all candidates share is
+inserted, with a backslash before characters like spaces. With a single
+candidate a ' ' follows, or a '/' for a directory. With several and
+nothing to add, the first Tab rings the bell and the second one lists
+them; more than 300 are only counted.
+*/
@@ -1,36 +1,192 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "shell.h"
 
-int main() {
-    char line[MAX_LINE];
+#define USAGE "usage: mini-shell [-j N] [--trace FILE] [-c command | script]\n"
+
+// A command that goes on over several lines, joined with '\n'
+static char *pending = NULL;
+static size_t pending_len = 0;
+static size_t pending_cap = 0;
+
+static int pending_add(const char *text, size_t len) {
+    if (pending_len + len > pending_cap) {
+        size_t new_cap = pending_cap ? pending_cap : 256;
+        while (new_cap < pending_len + len) new_cap *= 2;
+        char *grown = realloc(pending, new_cap);
+        if (!grown) return -1;
+        pending = grown;
+        pending_cap = new_cap;
+    }
+    memcpy(pending + pending_len, text, len);
+    pending_len += len;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    struct line_reader reader;
+    struct ast ast = {NULL, 0, 0, NULL, 0, 0};
+    struct ast cached;
+    int script = 0;
+    int replaying = 0;
+    char *line;
+
+    // choose how external commands are started (spawn or fork)
+    char *mode = getenv("MINI_SHELL_LAUNCH");
+    if (mode) set_launch_mode(mode);
+
+    // MINI_SHELL_STATS=1 records every command from the start
+    char *stats = getenv("MINI_SHELL_STATS");
+    if (stats && strcmp(stats, "1") == 0) stats_enabled = 1;
+
+    // -j N: run up to N command lines at the same time
+    // --trace FILE: write a timeline of the run to FILE (trace.c)
+    int argi = 1;
+    while (argi < argc && (strcmp(argv[argi], "-j") == 0 || strcmp(argv[argi], "--trace") == 0)) {
+        if (argi + 1 >= argc || (argv[argi][1] == 'j' && atoi(argv[argi + 1]) <= 0)) {
+            fprintf(stderr, USAGE);
+            return 2;
+        }
+        if (argv[argi][1] == 'j') {
+            shell_max_jobs = atoi(argv[argi + 1]);
+        } else if (trace_open(argv[argi + 1]) != 0) {
+            return 1;
+        }
+        argi += 2;
+    }
+
+    // pick the input: -c string, script file, or stdin
+    if (argi < argc && strcmp(argv[argi], "-c") == 0) {
+        if (argi + 1 >= argc) {
+            fprintf(stderr, USAGE);
+            return 2;
+        }
+        if (reader_open_string(&reader, argv[argi + 1]) != 0) return 1;
+    } else if (argi < argc) {
+        if (reader_open_file(&reader, argv[argi]) != 0) {
+            perror(argv[argi]);
+            return 127;
+        }
+        // a mapped script holds all of its text: its parsed commands can
+        // be saved, or taken from the last run (astcache.c)
+        if (reader.mapped) {
+            script = 1;
+            replaying = ast_cache_open(argv[argi], reader.buf, reader.end);
+            atexit(ast_cache_close);
+        }
+    } else {
+        if (reader_open_fd(&reader, STDIN_FILENO) != 0) return 1;
+        shell_interactive = isatty(STDIN_FILENO);
+    }
+
+    // process groups and terminal handoff, for an interactive shell only
+    jobs_init(shell_interactive);
+
+    // an interactive shell remembers its commands (MINI_SHELL_HISTFILE or
+    // ~/.mini_shell_history)
+    if (shell_interactive) history_open(getenv("MINI_SHELL_HISTFILE"));
+
+    // keys are edited by the shell itself when the output is a terminal
+    // that understands cursor movement (lineedit.c)
+    const char *term = getenv("TERM");
+    int editing = shell_interactive && isatty(STDOUT_FILENO) &&
+                  !(term && strcmp(term, "dumb") == 0);
 
     while(1) {
 
-        printf("pupa-cli> ");
-        if(!fgets(line, MAX_LINE, stdin)) {
+        // report background jobs that finished since the last line
+        jobs_notify();
+
+        // commands saved by an earlier run need no reading or parsing
+        if (replaying) {
+            size_t resume;
+            if (ast_cache_next(&cached, &resume)) {
+                eval_ast(&cached);
+                continue;
+            }
+            replaying = 0;
+            reader_seek(&reader, resume);
+        }
+
+        const char *prompt = pending_len > 0 ? "> " : "pupa-cli> ";
+        if (shell_interactive && !editing) {
+            printf("%s", prompt);
+            fflush(stdout);
+        }
+
+        // both return the line without its newline
+        shell_interrupted = 0;
+        line = editing ? line_edit(prompt) : reader_next_line(&reader);
+        if (!line) {
+            if (pending_len > 0) {
+                fprintf(stderr, "syntax error: unexpected end of file\n");
+                eval_set_status(2);
+            }
             break;
         }
 
-        // remove trailing newline
-        trim_newLine(line);
+        // Ctrl-C drops an unfinished multi-line command
+        if (shell_interrupted) {
+            pending_len = 0;
+            continue;
+        }
 
         // ignore empty input
-        if(line[0] == '\0') continue;
+        if (line[0] == '\0' && pending_len == 0) continue;
 
-        // parse and execute
-        char **args = parse_line(line);
-        if (args == NULL) continue;
+        // "!!" and friends are replaced before the line is remembered
+        if (shell_interactive) {
+            line = history_expand(line);
+            if (!line) continue;
+            history_add(line);
+        }
 
-        if(is_builtin(args)) {
-            run_builtin(args);
-        } else {
-            execute_command(args);
+        // parse and execute (the ast's arrays are reused by every line)
+        const char *src = line;
+        size_t len = strlen(line);
+        if (pending_len > 0) {
+            if (pending_add(line, len) != 0) break;
+            src = pending;
+            len = pending_len;
         }
 
-        free_args(args);
+        struct trace_mark mark;
+        if (trace_enabled) trace_begin(&mark, "parse");
+        int parsed = ast_parse(&ast, src, len);
+        if (trace_enabled) trace_end(&mark, TRACE_PARSE);
+        if (parsed == PARSE_INCOMPLETE) {
+            // an open quote, or a line ending in "|", "&&" or "\":
+            // keep it and parse again with the next line added
+            if (pending_len == 0 && pending_add(line, len) != 0) break;
+            if (pending_add("\n", 1) != 0) break;
+            continue;
+        }
+        pending_len = 0;
+        if (script) {
+            if (parsed == PARSE_OK) {
+                ast_cache_add(&ast, reader_offset(&reader));
+            } else {
+                ast_cache_stop();
+            }
+        }
+        if (parsed == PARSE_OK) eval_ast(&ast);
+        else eval_set_status(2);    // a syntax error, as in other shells
     }
 
-    return 0;
+    // coprocesses see EOF and exit; then the worker pool finishes its
+    // queue before the shell exits
+    coproc_close_all();
+    if (shell_max_jobs > 0) jobs_wait_all();
+
+    ast_cache_close();
+    ast_free(&ast);
+    free(pending);
+    reader_close(&reader);
+    history_close();
+    // output of the last builtins that could not be written fails the run
+    return builtin_output_flush(NULL, eval_status());
 }
 
 /*
@@ -43,28 +199,82 @@ The main() function is the entry point of every C program. When you run the
 program, execution starts here. This function implements the main shell loop
 that reads user input, parses it, and executes commands.
 
+USAGE:
+- mini-shell              read commands from stdin (a terminal or a pipe)
+- mini-shell script.sh    run the commands in a script file
+- mini-shell -c "cmd"     run the given command string
+- mini-shell -j N ...     run up to N command lines in parallel (each line
+                          becomes a background job; the shell waits for
+                          all of them before exiting)
+- mini-shell --trace FILE ...
+                          record parsing, builtins, launches, processes
+                          and waits in FILE as Chrome trace JSON, to view
+                          in Perfetto (trace.c)
+
 PROGRAM FLOW:
-1. Declare a character array to store user input
-2. Enter infinite loop to continuously accept commands
-3. Display shell prompt "krsh> "
-4. Read user input using fgets()
-5. Clean the input by removing newline character
-6. Skip empty input lines
-7. Parse the command line into arguments
-8. Check if it's a built-in command or external command
-9. Execute the appropriate command
-10. Free allocated memory
-11. Repeat until user exits
+1. Pick the launch backend from MINI_SHELL_LAUNCH, turn on stats mode
+   if MINI_SHELL_STATS=1, and read the -j and --trace options
+2. Open a line reader on the -c string, the script file, or stdin, and
+   turn on job control (jobs_init) and history (history_open) when stdin
+   is a terminal
+   A script file is also looked up in the AST cache (astcache.c)
+3. Enter infinite loop to continuously accept commands
+4. Report background jobs that have finished (jobs_notify). While the
+   cache has commands saved by an earlier run of the script, run the next
+   one (eval_ast) and start over here; after the last one, reading goes
+   on where that run stopped parsing (reader_seek)
+5. Display shell prompt "pupa-cli> ", or "> " while a command continues
+   (only when stdin is a terminal)
+6. Read the next line: with line_edit() when stdin and stdout are a
+   terminal (and TERM is not "dumb"), with reader_next_line() otherwise
+7. Skip empty input lines
+8. Expand "!!"-style history references and remember the line (terminal
+   only; history.c)
+9. Parse the line into a syntax tree (ast_parse). If it is incomplete (an
+   open quote, a trailing "|", "&&", "||" or "\"), keep it in the pending
+   buffer and go back to step 4 for the next line
+10. Run the tree (eval_ast): lists, && and || chains, pipelines. A
+    syntax error sets $? to 2 instead, and so does input that ends
+    inside an unfinished command ("unexpected end of file").
+11. Run each stage as a built-in or external command
+12. Repeat until user exits, then close the coprocesses (coproc.c) and
+    free the reader, syntax tree and history. The shell exits with the
+    status of the last command, so a script's caller sees its failure.
 
 VARIABLES EXPLAINED:
-- char line[MAX_LINE]: A character array (string) to store user input
-  * Arrays in C are collections of elements of the same type
+- struct line_reader reader: The input source and its buffer (input.c)
+  * Input is read in large chunks (or a script file is memory-mapped), and
+    lines are handed out from that buffer instead of one fgets() per line
+
+- int editing: 1 when lines are read with the line editor (lineedit.c):
+  arrow keys, history search and Tab completion. A terminal that cannot
+  move the cursor (TERM=dumb, e.g. inside an editor's shell buffer) or
+  output going to a file gets the plain prompt and the kernel's own line
+  editing instead
+
+- char *line: Points at the current line inside the reader's buffer (or
+  the editor's)
   * line[0] accesses the first character, line[1] the second, etc.
-  * MAX_LINE (1024) defines the maximum input length
+  * It stays valid until the next reader_next_line() call, which is after
+    the command has finished
+
+- int shell_interactive: 1 when stdin is a terminal (isatty)
+  * Scripts, "-c" strings and piped input get no prompt
+  * Like shell_max_jobs it is defined in jobs.c: main.c only holds main(),
+    so the benchmarks can link every other module without it
 
-- char **args: A double pointer returned by parse_line()
-  * This represents an array of strings (command arguments)
-  * Each element points to a different argument string
+- struct ast ast: Syntax tree shared by all lines (parser.c)
+  * Its node and text arrays double when a line needs more room
+  * Reusing it means ordinary lines are parsed without any allocation
+
+- int script / int replaying: the input is a mapped script file, whose
+  parsed commands are saved (ast_cache_add) or, when replaying, come from
+  the cache of an earlier run (ast_cache_next). ast_cache_close() writes
+  the cache; it is registered with atexit() so that a script ending in the
+  "exit" builtin, which calls exit() directly, is saved too
+
+- char *pending: The lines of a command that is not finished yet, joined
+  with '\n'; a normal one-line command is parsed straight from line
 
 CONTROL STRUCTURES:
 
@@ -72,10 +282,10 @@ CONTROL STRUCTURES:
    * Continues until explicitly broken with exit command
    * The condition (1) is always true
 
-2. if(!fgets(line, MAX_LINE, stdin)):
-   * fgets() returns NULL on error or end-of-file
+2. if (!line) break:
+   * reader_next_line() returns NULL at end of input
    * The ! operator negates the result (converts NULL to true)
-   * This breaks the loop if input fails (Ctrl+D pressed)
+   * This breaks the loop at end of file (or when Ctrl+D is pressed)
 
 3. if(line[0] == '\0'):
    * Checks if the first character is null terminator
@@ -91,45 +301,56 @@ From <stdio.h>:
   * Returns: Number of characters printed
   * Example: printf("Hello %s\n", "World");
 
-- fgets(buffer, size, stream):
-  * Purpose: Reads a line from input stream (safer than gets())
-  * Parameters: 
-    - buffer: Character array to store input
-    - size: Maximum characters to read
-    - stream: Input source (stdin for keyboard)
-  * Returns: Pointer to buffer on success, NULL on error/EOF
-  * Advantage: Prevents buffer overflow by limiting input size
+- fflush(stdout):
+  * Purpose: Writes out buffered output immediately
+  * Why needed: The prompt has no '\n', so it would otherwise stay in the
+    stdio buffer while the shell waits for input
+
+From <stdlib.h>:
+- getenv(name):
+  * Purpose: Reads an environment variable
+  * Returns: Pointer to its value, or NULL if it is not set
+  * Example: MINI_SHELL_LAUNCH=fork ./mini-shell uses the fork() backend
+
+From <unistd.h>:
+- isatty(fd):
+  * Purpose: Checks whether a descriptor is a terminal
+  * Returns: 1 for a terminal, 0 for a file or pipe
 
 From "shell.h" (our custom functions):
-- trim_newLine(line):
-  * Purpose: Removes '\n' character added by fgets()
-  * Why needed: fgets() includes newline in the string
+- reader_open_fd() / reader_open_file() / reader_open_string():
+  * Purpose: Prepare the line reader for stdin, a script, or a "-c" string
 
-- parse_line(line):
-  * Purpose: Splits command string into array of arguments
-  * Returns: Array of string pointers (char **)
+- reader_next_line(&reader):
+  * Purpose: Returns the next line with its '\n' already removed
 
-- is_builtin(args):
-  * Purpose: Checks if command is handled internally
-  * Returns: 1 (true) for built-ins like "exit" and "cd"
+- line_edit(prompt):
+  * Purpose: Shows the prompt and lets the user edit the line in raw
+    terminal mode; returns it without '\n', or NULL for Ctrl-D
 
-- run_builtin(args):
-  * Purpose: Executes built-in commands
+- ast_parse(&ast, text, len):
+  * Purpose: Turns the command text into a syntax tree (parser.c)
+  * Returns: PARSE_OK, PARSE_INCOMPLETE when more lines are needed, or
+    PARSE_ERROR after printing a syntax error
 
-- execute_command(args):
-  * Purpose: Runs external programs using system calls
+- eval_ast(&ast):
+  * Purpose: Runs the parsed line: lists, && and || chains, and pipelines
+    ("ls | wc -l") through execute_pipeline()
+  * Uses is_builtin()/run_builtin() for commands the shell handles itself
+    and execute_command()/launch_command() for external programs
 
-- free_args(args):
-  * Purpose: Deallocates memory to prevent memory leaks
+- ast_free(&ast):
+  * Purpose: Deallocates the syntax tree's arrays when the shell exits
 
 MEMORY MANAGEMENT CONCEPTS:
-C requires manual memory management. When parse_line() allocates memory
-using malloc(), we must call free_args() to return that memory to the system.
-Failure to do this causes memory leaks.
+C requires manual memory management. Memory that ast_parse() allocates for
+the tree is kept for the next line and returned with ast_free() at the end;
+the pending buffer is released with free(). Failure to free memory that is
+no longer needed causes memory leaks.
 
 ARRAY vs POINTER CONCEPTS:
-- char line[MAX_LINE]: Stack-allocated array (automatic memory)
-- char **args: Pointer to dynamically allocated memory (heap memory)
+- struct line_reader reader: Stack-allocated structure (automatic memory)
+- char *pending: Pointer to dynamically allocated memory (heap memory)
 
 Stack memory is automatically cleaned up when the function ends.
 Heap memory must be manually freed with free().
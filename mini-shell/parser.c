@@ -1,38 +1,928 @@
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include "shell.h"
 
+// Nodes and text bytes a fresh ast starts with; both double when needed
+#define AST_INITIAL_NODES 64
+#define AST_INITIAL_TEXT 1024
+
 void trim_newLine(char *line) {
     char *p = strchr(line, '\n');
     if(p) *p = '\0';
 }
 
-char **parse_line(char *line) {
-    char **args = malloc(MAX_ARGS * sizeof(char *));
-    if(!args) return NULL;
+// Makes room for at least need pointers, doubling the capacity
+int arg_vec_reserve(struct arg_vec *v, size_t need) {
+    if (need <= v->cap) return 0;
+
+    size_t new_cap = v->cap ? v->cap : ARGS_INITIAL_CAP;
+    while (new_cap < need) new_cap *= 2;
+
+    char **grown = realloc(v->argv, new_cap * sizeof(char *));
+    if (!grown) return -1;
+    v->argv = grown;
+    v->cap = new_cap;
+    return 0;
+}
+
+int arg_vec_push(struct arg_vec *v, char *arg) {
+    if (arg_vec_reserve(v, v->len + 1) != 0) return -1;
+    v->argv[v->len++] = arg;
+    return 0;
+}
+
+void arg_vec_free(struct arg_vec *v) {
+    free(v->argv);
+    v->argv = NULL;
+    v->len = v->cap = 0;
+}
+
+enum token {
+    TOK_WORD,
+    TOK_REDIR,          // <, >, >>, <<<, N>&M, ...
+    TOK_PIPE,           // |
+    TOK_AND_IF,         // &&
+    TOK_OR_IF,          // ||
+    TOK_AMP,            // &
+    TOK_SEMI,           // ;
+    TOK_NEWLINE,
+    TOK_OTHER,          // ( ) ;; : valid shell syntax this shell does not have
+    TOK_EOF,
+    TOK_ERROR           // the lexer already set the parse status
+};
+
+// Character classes for the lexer, one table lookup per byte
+#define CH_BLANK 0x01   // separates words
+#define CH_META  0x02   // ends a word: blanks, newline and operator characters
+#define CH_QUOTE 0x04   // starts quoting inside a word: \ ' "
+#define CH_SPECIAL 0x08 // $ and the CTL_* bytes (shell.h): not copied as they are
+#define CH_GLOB  0x10   // * ? [: a pattern when unquoted (glob.c)
+
+static const unsigned char char_class[256] = {
+    [' '] = CH_BLANK | CH_META, ['\t'] = CH_BLANK | CH_META, ['\n'] = CH_META,
+    [';'] = CH_META, ['&'] = CH_META, ['|'] = CH_META, ['<'] = CH_META,
+    ['>'] = CH_META, ['('] = CH_META, [')'] = CH_META,
+    ['\\'] = CH_QUOTE, ['\''] = CH_QUOTE, ['"'] = CH_QUOTE,
+    ['$'] = CH_SPECIAL, [CTL_ESC] = CH_SPECIAL, [CTL_VAR] = CH_SPECIAL,
+    [CTL_QVAR] = CH_SPECIAL, [CTL_END] = CH_SPECIAL, [CTL_SUBST] = CH_SPECIAL,
+    [CTL_QSUBST] = CH_SPECIAL, ['*'] = CH_GLOB, ['?'] = CH_GLOB, ['['] = CH_GLOB,
+};
+
+// All parsing state lives here, on the caller's stack: no globals, so
+// several threads may parse into their own ast at the same time
+struct parser {
+    const char *p;          // next unread character
+    const char *end;
+    struct ast *ast;
+    int status;             // PARSE_OK until something goes wrong
+
+    // the current token (one token of lookahead)
+    enum token tok;
+    const char *tok_start;  // its source text, for error messages
+    uint32_t word;          // TOK_WORD: offset of its text in ast->text
+    uint32_t word_len;
+    int word_quoted;
+    int word_expand;        // the text holds CTL_* markers
+    int word_assign;        // it starts with NAME=
+    int word_glob;          // unquoted * ? [ or expansion: may be a pattern
+    int redir_fd;           // TOK_REDIR: descriptor and operator
+    enum redir_op redir_op;
+};
+
+static int text_reserve(struct ast *ast, size_t extra) {
+    size_t need = (size_t)ast->text_len + extra;
+    if (need <= ast->text_cap) return 0;
+    if (need > UINT32_MAX) return -1;
+
+    size_t new_cap = ast->text_cap ? ast->text_cap : AST_INITIAL_TEXT;
+    while (new_cap < need) new_cap *= 2;
+    if (new_cap > UINT32_MAX) new_cap = UINT32_MAX;
+
+    char *grown = realloc(ast->text, new_cap);
+    if (!grown) return -1;
+    ast->text = grown;
+    ast->text_cap = (uint32_t)new_cap;
+    return 0;
+}
+
+// Appends a node and returns its index, or 0 (the root's index, never a
+// valid result) when memory runs out
+static uint32_t node_new(struct parser *ps, enum node_type type) {
+    struct ast *ast = ps->ast;
+
+    if (ast->nnodes == ast->nodes_cap) {
+        size_t new_cap = ast->nodes_cap ? (size_t)ast->nodes_cap * 2 : AST_INITIAL_NODES;
+        struct node *grown = new_cap <= UINT32_MAX ?
+            realloc(ast->nodes, new_cap * sizeof(*grown)) : NULL;
+        if (!grown) {
+            perror("parse");
+            ps->status = PARSE_ERROR;
+            return 0;
+        }
+        ast->nodes = grown;
+        ast->nodes_cap = (uint32_t)new_cap;
+    }
+
+    uint32_t index = ast->nnodes++;
+    memset(&ast->nodes[index], 0, sizeof(ast->nodes[index]));
+    ast->nodes[index].type = (uint8_t)type;
+    return index;
+}
+
+// Links child as the last child of parent; *last tracks that last child
+static void add_child(struct ast *ast, uint32_t parent, uint32_t *last, uint32_t child) {
+    if (*last) {
+        ast->nodes[*last].next = child;
+    } else {
+        ast->nodes[parent].first = child;
+    }
+    *last = child;
+    ast->nodes[parent].len++;
+}
+
+// An unclosed quote or a final backslash: the word goes on in the next line
+static enum token incomplete(struct parser *ps) {
+    ps->status = PARSE_INCOMPLETE;
+    return TOK_ERROR;
+}
+
+// Length of the variable name (letters, digits, '_', no leading digit)
+// starting at p
+static size_t name_length(const char *p, const char *end) {
+    const char *q = p;
+
+    if (q == end || !((*q >= 'a' && *q <= 'z') || (*q >= 'A' && *q <= 'Z') || *q == '_')) {
+        return 0;
+    }
+    while (q < end && ((*q >= 'a' && *q <= 'z') || (*q >= 'A' && *q <= 'Z') ||
+                       (*q >= '0' && *q <= '9') || *q == '_')) {
+        q++;
+    }
+    return (size_t)(q - p);
+}
+
+// Copies one literal byte; the CTL_* bytes themselves and quoted pattern
+// characters get a CTL_ESC
+static char *put_literal(struct parser *ps, char *out, char c) {
+    if ((char_class[(unsigned char)c] & (CH_SPECIAL | CH_GLOB)) && c != '$') {
+        *out++ = CTL_ESC;
+        ps->word_expand = 1;
+    }
+    *out++ = c;
+    return out;
+}
 
-    int i = 0;
-    char *token = strtok(line, " ");
+// Finds the ')' that ends a "$(" whose command text starts at p, skipping
+// quoted text and nested parentheses. NULL when the input ends first.
+static const char *subst_close(const char *p, const char *end) {
+    int depth = 0;
 
-    while (token != NULL && i < MAX_ARGS -1)
-    {
-        args[i++] = strdup(token);
-        token = strtok(NULL, " ");
+    while (p < end) {
+        if (*p == '\\') {
+            p += 2;
+        } else if (*p == '\'') {
+            const char *close = memchr(p + 1, '\'', (size_t)(end - p - 1));
+            if (!close) return NULL;
+            p = close + 1;
+        } else if (*p == '"') {
+            for (p++; p < end && *p != '"'; p++) {
+                if (*p == '\\') {
+                    p++;
+                } else if (*p == '$' && p + 1 < end && p[1] == '(') {
+                    // "...$(...)..." may hold quotes of its own
+                    p = subst_close(p + 2, end);
+                    if (!p) return NULL;
+                }
+            }
+            if (p >= end) return NULL;
+            p++;
+        } else if (*p == ')' && depth == 0) {
+            return p;
+        } else {
+            if (*p == '(') depth++;
+            if (*p == ')') depth--;
+            p++;
+        }
     }
+    return NULL;
+}
 
-    args[i] = NULL;
-    return args;    
+// The parameters that are not variables: $$, the last status $?, the
+// function arguments $1 to $9 (more with ${10}), their count $# and all of
+// them, $@ and $*
+static int special_param(char c) {
+    return (c >= '0' && c <= '9') || c == '$' || c == '?' || c == '#' || c == '@' ||
+           c == '*';
 }
 
-void free_args(char **args) {
-    int i = 0;
+// Reads $NAME, ${NAME}, a special parameter or $(command) at *pp and writes
+// its marker (see shell.h). Returns 1, 0 when the '$' is an ordinary
+// character ("$", "a$-b"), or -1 with the parse status set.
+static int lex_param(struct parser *ps, const char **pp, char **outp, int quoted) {
+    const char *p = *pp + 1;
+    const char *end = ps->end;
+    const char *name = p;
+    size_t len;
 
-    while (args[i])
-    {
-        free(args[i]);
-        i++;
+    if (p < end && *p == '(') {
+        // the command text is kept as written and parsed when it runs
+        const char *close = subst_close(p + 1, end);
+        if (!close) {
+            ps->status = PARSE_INCOMPLETE;
+            return -1;
+        }
+        char *out = *outp;
+        *out++ = quoted ? CTL_QSUBST : CTL_SUBST;
+        for (p++; p < close; p++) out = put_literal(ps, out, *p);
+        *out++ = CTL_END;
+        *outp = out;
+        *pp = close + 1;
+        ps->word_expand = 1;
+        return 1;
     }
-    free(args);
+    if (p < end && *p == '{') {
+        const char *close = memchr(p + 1, '}', (size_t)(end - p - 1));
+        if (!close) {
+            ps->status = PARSE_INCOMPLETE;
+            return -1;
+        }
+        name = p + 1;
+        len = (size_t)(close - name);
+        size_t digits = 0;
+        while (digits < len && name[digits] >= '0' && name[digits] <= '9') digits++;
+        if (!(len == 1 && special_param(*name)) && !(digits == len && len > 0) &&
+            (len == 0 || name_length(name, close) != len)) {
+            fprintf(stderr, "%.*s: bad substitution\n", (int)(close + 1 - *pp), *pp);
+            ps->status = PARSE_ERROR;
+            return -1;
+        }
+        p = close + 1;
+    } else if (p < end && special_param(*p)) {
+        len = 1;
+        p++;
+    } else {
+        len = name_length(p, end);
+        if (len == 0) return 0;
+        p += len;
+    }
+
+    char *out = *outp;
+    *out++ = quoted ? CTL_QVAR : CTL_VAR;
+    memcpy(out, name, len);
+    out += len;
+    *out++ = CTL_END;
+    *outp = out;
+    *pp = p;
+    ps->word_expand = 1;
+    return 1;
+}
+
+// Reads one word, removing quotes and backslashes, straight into ast->text.
+// The text is at most twice as long as the rest of the input (a CTL_ESC per
+// byte), so room for it is reserved once and the copy loops need no bounds
+// checks.
+static enum token lex_word(struct parser *ps) {
+    struct ast *ast = ps->ast;
+    const char *p = ps->p;
+    const char *end = ps->end;
+
+    if (text_reserve(ast, 2 * (size_t)(end - p) + 1) != 0) {
+        perror("parse");
+        ps->status = PARSE_ERROR;
+        return TOK_ERROR;
+    }
+    char *out = ast->text + ast->text_len;
+    ps->word = ast->text_len;
+    ps->word_quoted = 0;
+    ps->word_expand = 0;
+    ps->word_glob = 0;
+
+    // "NAME=..." is an assignment when it comes before the command name
+    size_t name_len = name_length(p, end);
+    ps->word_assign = name_len > 0 && p + name_len < end && p[name_len] == '=';
+
+    while (p < end && !(char_class[(unsigned char)*p] & CH_META)) {
+        if (*p == '\\') {
+            if (p + 1 == end) return incomplete(ps);
+            if (p[1] != '\n') out = put_literal(ps, out, p[1]);    // "\<newline>" vanishes
+            p += 2;
+            ps->word_quoted = 1;
+        } else if (*p == '\'') {
+            // everything up to the next ' is literal
+            const char *close = memchr(p + 1, '\'', (size_t)(end - p - 1));
+            if (!close) return incomplete(ps);
+            for (p++; p < close; p++) out = put_literal(ps, out, *p);
+            p = close + 1;
+            ps->word_quoted = 1;
+        } else if (*p == '"') {
+            // a backslash only escapes $ ` " \ and newline here
+            for (p++; p < end && *p != '"'; ) {
+                if (*p == '\\' && p + 1 < end && p[1] && strchr("$`\"\\\n", p[1])) {
+                    if (p[1] != '\n') out = put_literal(ps, out, p[1]);
+                    p += 2;
+                } else if (*p == '$') {
+                    int r = lex_param(ps, &p, &out, 1);
+                    if (r < 0) return TOK_ERROR;
+                    if (r == 0) *out++ = *p++;
+                } else {
+                    out = put_literal(ps, out, *p++);
+                }
+            }
+            if (p == end) return incomplete(ps);
+            p++;
+            ps->word_quoted = 1;
+        } else if (*p == '$') {
+            // an unquoted value is globbed too, like in sh
+            int r = lex_param(ps, &p, &out, 0);
+            if (r < 0) return TOK_ERROR;
+            if (r == 0) {
+                *out++ = *p++;
+            } else {
+                ps->word_glob = 1;
+            }
+        } else if (char_class[(unsigned char)*p] & CH_SPECIAL) {
+            out = put_literal(ps, out, *p++);
+        } else if (char_class[(unsigned char)*p] & CH_GLOB) {
+            *out++ = *p++;
+            ps->word_glob = 1;
+        } else {
+            // a run of ordinary characters is copied in one go
+            const char *run = p;
+            while (p < end && !(char_class[(unsigned char)*p] &
+                                (CH_META | CH_QUOTE | CH_SPECIAL | CH_GLOB))) {
+                p++;
+            }
+            memcpy(out, run, (size_t)(p - run));
+            out += p - run;
+        }
+    }
+
+    *out = '\0';
+    ps->word_len = (uint32_t)(out - (ast->text + ps->word));
+    ast->text_len = ps->word + ps->word_len + 1;
+    ps->p = p;
+    return TOK_WORD;
+}
+
+// Reads a redirection operator at ps->p; fd is the number written before
+// it ("2>"), or -1 for the operator's default descriptor
+static enum token lex_redirect(struct parser *ps, int fd) {
+    const char *p = ps->p;
+
+    if (*p == '<') {
+        ps->redir_fd = fd >= 0 ? fd : 0;
+        if (p + 2 < ps->end && p[1] == '<' && p[2] == '<') {
+            ps->redir_op = REDIR_STRING;
+            p += 3;
+        } else if (p + 1 < ps->end && p[1] == '<') {
+            fprintf(stderr, "<<: here-documents are not supported, use <<<\n");
+            ps->status = PARSE_ERROR;
+            return TOK_ERROR;
+        } else if (p + 1 < ps->end && p[1] == '&') {
+            ps->redir_op = REDIR_DUP;
+            p += 2;
+        } else {
+            ps->redir_op = REDIR_IN;
+            p += 1;
+        }
+    } else {
+        ps->redir_fd = fd >= 0 ? fd : 1;
+        if (p + 1 < ps->end && p[1] == '>') {
+            ps->redir_op = REDIR_APPEND;
+            p += 2;
+        } else if (p + 1 < ps->end && p[1] == '&') {
+            ps->redir_op = REDIR_DUP;
+            p += 2;
+        } else {
+            ps->redir_op = REDIR_OUT;
+            p += 1;
+        }
+    }
+    ps->p = p;
+    return TOK_REDIR;
+}
+
+// Moves to the next token, skipping blanks, comments and "\<newline>"
+static enum token next_token(struct parser *ps) {
+    const char *end = ps->end;
+
+    if (ps->tok == TOK_ERROR) return TOK_ERROR;
+    for (;;) {
+        while (ps->p < end && (char_class[(unsigned char)*ps->p] & CH_BLANK)) ps->p++;
+        if (ps->p < end && *ps->p == '#') {
+            while (ps->p < end && *ps->p != '\n') ps->p++;
+        } else if (ps->p + 1 < end && ps->p[0] == '\\' && ps->p[1] == '\n') {
+            ps->p += 2;
+        } else {
+            break;
+        }
+    }
+
+    const char *p = ps->p;
+    ps->tok_start = p;
+    if (p == end) return ps->tok = TOK_EOF;
+
+    switch (*p) {
+    case '\n':
+        ps->p++;
+        return ps->tok = TOK_NEWLINE;
+    case ';':
+        if (p + 1 < end && p[1] == ';') return ps->tok = TOK_OTHER;
+        ps->p++;
+        return ps->tok = TOK_SEMI;
+    case '&':
+        if (p + 1 < end && p[1] == '&') {
+            ps->p += 2;
+            return ps->tok = TOK_AND_IF;
+        }
+        ps->p++;
+        return ps->tok = TOK_AMP;
+    case '|':
+        if (p + 1 < end && p[1] == '|') {
+            ps->p += 2;
+            return ps->tok = TOK_OR_IF;
+        }
+        ps->p++;
+        return ps->tok = TOK_PIPE;
+    case '(':
+    case ')':
+        return ps->tok = TOK_OTHER;
+    case '<':
+    case '>':
+        return ps->tok = lex_redirect(ps, -1);
+    }
+
+    // digits right before < or > name a descriptor: "2>err", "0<in"
+    if (*p >= '0' && *p <= '9') {
+        const char *q = p;
+        while (q < end && *q >= '0' && *q <= '9') q++;
+        if (q < end && (*q == '<' || *q == '>')) {
+            if (q - p > 1) {
+                fprintf(stderr, "%.*s: bad file descriptor\n", (int)(q - p), p);
+                ps->status = PARSE_ERROR;
+                return ps->tok = TOK_ERROR;
+            }
+            ps->p = q;
+            return ps->tok = lex_redirect(ps, *p - '0');
+        }
+    }
+    return ps->tok = lex_word(ps);
+}
+
+// Reports the current token as unexpected
+static int syntax_error(struct parser *ps) {
+    if (ps->tok == TOK_ERROR) return -1;
+
+    if (ps->tok == TOK_EOF || ps->tok == TOK_NEWLINE) {
+        fprintf(stderr, "syntax error near unexpected token `newline'\n");
+    } else {
+        // show the operator, or the word as it was written
+        const char *e = ps->tok == TOK_WORD || ps->tok == TOK_REDIR ? ps->p : ps->tok_start + 1;
+        if (ps->tok == TOK_OTHER && e < ps->end && *e == ';') e++;
+        fprintf(stderr, "syntax error near unexpected token `%.*s'\n",
+                (int)(e - ps->tok_start), ps->tok_start);
+    }
+    ps->status = PARSE_ERROR;
+    ps->tok = TOK_ERROR;
+    return -1;
+}
+
+static void skip_newlines(struct parser *ps) {
+    while (ps->tok == TOK_NEWLINE) next_token(ps);
+}
+
+// Reserved words; keyword() tells which one the current token is
+enum keyword {
+    KW_NONE,
+    KW_IF, KW_THEN, KW_ELIF, KW_ELSE, KW_FI,
+    KW_WHILE, KW_UNTIL, KW_FOR, KW_IN, KW_DO, KW_DONE,
+    KW_LBRACE, KW_RBRACE
+};
+
+static const char *const keywords[] = {
+    [KW_IF] = "if", [KW_THEN] = "then", [KW_ELIF] = "elif", [KW_ELSE] = "else",
+    [KW_FI] = "fi", [KW_WHILE] = "while", [KW_UNTIL] = "until", [KW_FOR] = "for",
+    [KW_IN] = "in", [KW_DO] = "do", [KW_DONE] = "done", [KW_LBRACE] = "{",
+    [KW_RBRACE] = "}",
+};
+
+// A word is a reserved word only when it is written plainly: "if" is one,
+// "\if" and "$x" holding "if" are not. Whether it counts depends on where
+// it stands; the callers only ask where a command may start.
+static enum keyword keyword(const struct parser *ps) {
+    if (ps->tok != TOK_WORD || ps->word_quoted || ps->word_expand || ps->word_len > 5) {
+        return KW_NONE;
+    }
+    const char *w = ps->ast->text + ps->word;
+    for (int kw = KW_IF; kw <= KW_RBRACE; kw++) {
+        if (strcmp(w, keywords[kw]) == 0) return (enum keyword)kw;
+    }
+    return KW_NONE;
+}
+
+// The reserved words that end a list inside a compound command
+static int at_list_end(const struct parser *ps) {
+    switch (keyword(ps)) {
+    case KW_THEN: case KW_ELIF: case KW_ELSE: case KW_FI:
+    case KW_DO: case KW_DONE: case KW_RBRACE:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// A pattern is expanded too (expand.c hands it to glob.c)
+static uint8_t word_flags(const struct parser *ps) {
+    return (ps->word_quoted ? NODE_QUOTED : 0) |
+           (ps->word_expand || ps->word_glob ? NODE_EXPAND : 0) |
+           (ps->word_glob ? NODE_GLOB : 0);
+}
+
+// redirection: operator word, added as the last child of parent
+static int parse_redirect(struct parser *ps, uint32_t parent, uint32_t *last) {
+    struct ast *ast = ps->ast;
+    uint32_t redir = node_new(ps, NODE_REDIR);
+
+    if (!redir) return -1;
+    ast->nodes[redir].flags = (uint8_t)ps->redir_op;
+    ast->nodes[redir].fd = (uint16_t)ps->redir_fd;
+    add_child(ast, parent, last, redir);
+
+    // the target: a file name, here-string text, or descriptor
+    if (next_token(ps) != TOK_WORD) return syntax_error(ps);
+    if (ast->nodes[redir].flags == REDIR_DUP) {
+        const char *w = ast->text + ps->word;
+        if (strcmp(w, "-") == 0) {
+            ast->nodes[redir].flags = REDIR_CLOSE;
+        } else if (!(w[0] >= '0' && w[0] <= '9' && w[1] == '\0')) {
+            fprintf(stderr, "%s: bad file descriptor\n", w);
+            ps->status = PARSE_ERROR;
+            return -1;
+        }
+    }
+    uint32_t word = node_new(ps, NODE_WORD);
+    if (!word) return -1;
+    ast->nodes[word].flags = word_flags(ps);
+    ast->nodes[word].first = ps->word;
+    ast->nodes[word].len = ps->word_len;
+    ast->nodes[redir].first = word;
+    next_token(ps);
+    return 0;
+}
+
+// Appends the current word as a NODE_WORD child of parent
+static int add_word(struct parser *ps, uint32_t parent, uint32_t *last, uint8_t flags) {
+    uint32_t word = node_new(ps, NODE_WORD);
+
+    if (!word) return -1;
+    ps->ast->nodes[word].flags = flags;
+    ps->ast->nodes[word].first = ps->word;
+    ps->ast->nodes[word].len = ps->word_len;
+    add_child(ps->ast, parent, last, word);
+    next_token(ps);
+    return 0;
+}
+
+// The current token is a plain (unquoted, unexpanded) word that is a
+// variable name: a for loop's variable, or a function's name
+static int at_name(const struct parser *ps) {
+    return ps->tok == TOK_WORD && !ps->word_quoted && !ps->word_expand && !ps->word_glob &&
+           name_length(ps->ast->text + ps->word, ps->ast->text + ps->word + ps->word_len) ==
+           ps->word_len && ps->word_len > 0;
+}
+
+// Moves past a reserved word; like "time", its text is not kept
+static void skip_keyword(struct parser *ps) {
+    ps->ast->text_len = ps->word;
+    next_token(ps);
+}
+
+static int parse_list(struct parser *ps, uint32_t list);
+
+// Parses a list that ends at a reserved word ("then", "do", "fi", ...)
+// into a new NODE_LIST child of parent. Returns that word, or KW_NONE with
+// the parse status set: the input ended first (PARSE_INCOMPLETE), or the
+// list is empty.
+static enum keyword parse_body(struct parser *ps, uint32_t parent, uint32_t *last) {
+    uint32_t list = node_new(ps, NODE_LIST);
+
+    if (!list) return KW_NONE;
+    add_child(ps->ast, parent, last, list);
+    if (parse_list(ps, list) != 0) return KW_NONE;
+    if (ps->tok == TOK_EOF) {
+        ps->status = PARSE_INCOMPLETE;
+        return KW_NONE;
+    }
+    if (ps->ast->nodes[list].len == 0) {
+        syntax_error(ps);
+        return KW_NONE;
+    }
+    return keyword(ps);
+}
+
+// The body ended at kw where want was expected
+static int expect(struct parser *ps, enum keyword kw, enum keyword want) {
+    if (kw == want) return 0;
+    return kw == KW_NONE ? -1 : syntax_error(ps);
+}
+
+// if: "if" list "then" list ("elif" list "then" list)* ["else" list] "fi"
+static int parse_if(struct parser *ps, uint32_t node, uint32_t *last) {
+    enum keyword kw = KW_IF;
+
+    while (kw == KW_IF || kw == KW_ELIF) {
+        skip_keyword(ps);
+        if (expect(ps, parse_body(ps, node, last), KW_THEN) != 0) return -1;
+        skip_keyword(ps);
+        kw = parse_body(ps, node, last);
+    }
+    if (kw == KW_ELSE) {
+        skip_keyword(ps);
+        kw = parse_body(ps, node, last);
+    }
+    return expect(ps, kw, KW_FI);
+}
+
+// while: ("while" | "until") list "do" list "done"
+static int parse_while(struct parser *ps, uint32_t node, uint32_t *last) {
+    skip_keyword(ps);
+    if (expect(ps, parse_body(ps, node, last), KW_DO) != 0) return -1;
+    skip_keyword(ps);
+    return expect(ps, parse_body(ps, node, last), KW_DONE);
+}
+
+// for: "for" name ["in" word* (";" | newline)] "do" list "done"
+static int parse_for(struct parser *ps, uint32_t node, uint32_t *last) {
+    skip_keyword(ps);
+    if (ps->tok == TOK_EOF) {
+        ps->status = PARSE_INCOMPLETE;
+        return -1;
+    }
+    if (!at_name(ps)) return syntax_error(ps);
+    if (add_word(ps, node, last, 0) != 0) return -1;
+
+    skip_newlines(ps);
+    if (keyword(ps) == KW_IN) {
+        skip_keyword(ps);
+        while (ps->tok == TOK_WORD) {
+            if (add_word(ps, node, last, word_flags(ps)) != 0) return -1;
+        }
+        if (ps->tok == TOK_EOF) {
+            ps->status = PARSE_INCOMPLETE;
+            return -1;
+        }
+        if (ps->tok != TOK_SEMI && ps->tok != TOK_NEWLINE) return syntax_error(ps);
+        next_token(ps);
+    } else {
+        ps->ast->nodes[node].flags |= NODE_ARGS;
+        if (ps->tok == TOK_SEMI) next_token(ps);
+    }
+    skip_newlines(ps);
+    if (ps->tok == TOK_EOF) {
+        ps->status = PARSE_INCOMPLETE;
+        return -1;
+    }
+    if (keyword(ps) != KW_DO) return syntax_error(ps);
+    skip_keyword(ps);
+    return expect(ps, parse_body(ps, node, last), KW_DONE);
+}
+
+// compound: (if | while | for | "{" list "}") redirection*
+static int parse_compound(struct parser *ps, enum keyword kw, uint32_t *out) {
+    static const uint8_t types[] = {
+        [KW_IF] = NODE_IF, [KW_WHILE] = NODE_WHILE, [KW_UNTIL] = NODE_WHILE,
+        [KW_FOR] = NODE_FOR, [KW_LBRACE] = NODE_GROUP,
+    };
+    uint32_t last = 0;
+    uint32_t node = node_new(ps, types[kw]);
+    int err;
+
+    if (!node) return -1;
+    *out = node;
+    switch (kw) {
+    case KW_IF:
+        err = parse_if(ps, node, &last);
+        break;
+    case KW_UNTIL:
+        ps->ast->nodes[node].flags |= NODE_UNTIL;
+        // fall through
+    case KW_WHILE:
+        err = parse_while(ps, node, &last);
+        break;
+    case KW_FOR:
+        err = parse_for(ps, node, &last);
+        break;
+    default:
+        skip_keyword(ps);
+        err = expect(ps, parse_body(ps, node, &last), KW_RBRACE);
+        break;
+    }
+    if (err) return -1;
+
+    // past the closing word: redirections of the whole command
+    skip_keyword(ps);
+    while (ps->tok == TOK_REDIR) {
+        if (parse_redirect(ps, node, &last) != 0) return -1;
+    }
+    return 0;
+}
+
+// "name()" starts a function definition: a plain name followed by "(" and
+// ")", with blanks allowed around them
+static int at_funcdef(const struct parser *ps) {
+    const char *p = ps->p;
+
+    if (!at_name(ps)) return 0;
+    while (p < ps->end && (*p == ' ' || *p == '\t')) p++;
+    if (p == ps->end || *p++ != '(') return 0;
+    while (p < ps->end && (*p == ' ' || *p == '\t')) p++;
+    return p < ps->end && *p == ')';
+}
+
+// funcdef: name "(" ")" newline* compound
+static int parse_funcdef(struct parser *ps, uint32_t *out) {
+    uint32_t last = 0;
+    uint32_t node = node_new(ps, NODE_FUNCDEF);
+
+    if (!node) return -1;
+    *out = node;
+    ps->p = (const char *)memchr(ps->p, ')', (size_t)(ps->end - ps->p)) + 1;
+    if (add_word(ps, node, &last, 0) != 0) return -1;
+    skip_newlines(ps);
+    if (ps->tok == TOK_EOF) {
+        ps->status = PARSE_INCOMPLETE;
+        return -1;
+    }
+
+    // the body is a compound command, usually "{ ... }"
+    enum keyword kw = keyword(ps);
+    if (kw != KW_IF && kw != KW_WHILE && kw != KW_UNTIL && kw != KW_FOR && kw != KW_LBRACE) {
+        return syntax_error(ps);
+    }
+    uint32_t body = 0;
+    if (parse_compound(ps, kw, &body) != 0) return -1;
+    add_child(ps->ast, node, &last, body);
+    return 0;
+}
+
+// command: compound | funcdef | (word | redirection)+
+static int parse_command(struct parser *ps, uint32_t *out) {
+    struct ast *ast = ps->ast;
+    uint32_t last = 0;
+
+    if (ps->tok == TOK_EOF) {
+        // "a |", "a &&": the command is on the next line
+        ps->status = PARSE_INCOMPLETE;
+        return -1;
+    }
+    if (ps->tok != TOK_WORD && ps->tok != TOK_REDIR) return syntax_error(ps);
+
+    // reserved words only count where a command starts
+    enum keyword kw = keyword(ps);
+    if (kw == KW_IF || kw == KW_WHILE || kw == KW_UNTIL || kw == KW_FOR || kw == KW_LBRACE) {
+        return parse_compound(ps, kw, out);
+    }
+    if (kw != KW_NONE && kw != KW_IN) return syntax_error(ps);
+    if (at_funcdef(ps)) return parse_funcdef(ps, out);
+
+    uint32_t cmd = node_new(ps, NODE_CMD);
+    if (!cmd) return -1;
+    int assigning = 1;      // no command name yet
+
+    while (ps->tok == TOK_WORD || ps->tok == TOK_REDIR) {
+        uint32_t child;
+
+        if (ps->tok == TOK_WORD) {
+            if (!(child = node_new(ps, NODE_WORD))) return -1;
+            assigning = assigning && ps->word_assign;
+            ast->nodes[child].flags = word_flags(ps) | (assigning ? NODE_ASSIGN : 0);
+            ast->nodes[child].first = ps->word;
+            ast->nodes[child].len = ps->word_len;
+            add_child(ast, cmd, &last, child);
+            next_token(ps);
+            continue;
+        }
+
+        if (parse_redirect(ps, cmd, &last) != 0) return -1;
+    }
+    *out = cmd;
+    return 0;
+}
+
+// pipeline: ["time"] command ("|" command)*
+static int parse_pipeline(struct parser *ps, uint32_t *out) {
+    struct ast *ast = ps->ast;
+    uint32_t last = 0;
+    uint32_t pipeline = node_new(ps, NODE_PIPELINE);
+    if (!pipeline) return -1;
+    *out = pipeline;
+
+    // "time" is a keyword only when it starts a pipeline and is unquoted
+    if (ps->tok == TOK_WORD && !ps->word_quoted && ps->word_len == 4 &&
+        memcmp(ast->text + ps->word, "time", 4) == 0) {
+        ast->nodes[pipeline].flags |= NODE_TIMED;
+        ast->text_len = ps->word;       // its text is not needed
+        next_token(ps);
+        // "time" alone times nothing, like other shells
+        if (ps->tok == TOK_EOF || ps->tok == TOK_NEWLINE || ps->tok == TOK_SEMI ||
+            ps->tok == TOK_AMP) {
+            return 0;
+        }
+    }
+
+    for (;;) {
+        uint32_t cmd = 0;
+        if (parse_command(ps, &cmd) != 0) return -1;
+        add_child(ast, pipeline, &last, cmd);
+        if (ps->tok != TOK_PIPE) return 0;
+        next_token(ps);
+        skip_newlines(ps);
+    }
+}
+
+// and_or: pipeline (("&&" | "||") pipeline)*
+static int parse_and_or(struct parser *ps, uint32_t *out) {
+    struct ast *ast = ps->ast;
+    uint32_t last = 0;
+    uint8_t connector = 0;
+    uint32_t and_or = node_new(ps, NODE_AND_OR);
+    if (!and_or) return -1;
+    *out = and_or;
+
+    for (;;) {
+        uint32_t pipeline = 0;
+        if (parse_pipeline(ps, &pipeline) != 0) return -1;
+        ast->nodes[pipeline].flags |= connector;
+        add_child(ast, and_or, &last, pipeline);
+
+        if (ps->tok == TOK_AND_IF) {
+            connector = NODE_AND;
+        } else if (ps->tok == TOK_OR_IF) {
+            connector = NODE_OR;
+        } else {
+            return 0;
+        }
+        next_token(ps);
+        skip_newlines(ps);
+    }
+}
+
+// list: and_or ((";" | "&" | newline) and_or)* [";" | "&"]
+// It ends at the end of the input, or at a reserved word such as "fi" or
+// "done" that the caller checks
+static int parse_list(struct parser *ps, uint32_t list) {
+    struct ast *ast = ps->ast;
+    uint32_t last = 0;
+
+    for (;;) {
+        skip_newlines(ps);
+        if (ps->tok == TOK_EOF || at_list_end(ps)) return 0;
+
+        uint32_t and_or = 0;
+        if (parse_and_or(ps, &and_or) != 0) return -1;
+        add_child(ast, list, &last, and_or);
+
+        if (ps->tok == TOK_AMP) {
+            ast->nodes[and_or].flags |= NODE_BACKGROUND;
+        } else if (ps->tok != TOK_SEMI && ps->tok != TOK_NEWLINE) {
+            // "if a; then b; fi fi": a compound command may end the list
+            return ps->tok == TOK_EOF || at_list_end(ps) ? 0 : syntax_error(ps);
+        }
+        next_token(ps);
+    }
+}
+
+int ast_parse(struct ast *ast, const char *src, size_t len) {
+    struct parser ps;
+
+    memset(&ps, 0, sizeof(ps));
+    ps.p = src;
+    ps.end = src + len;
+    ps.ast = ast;
+    ps.status = PARSE_OK;
+    ps.tok = TOK_EOF;
+
+    ast->nnodes = 0;
+    ast->text_len = 0;
+    if (len >= UINT32_MAX || node_new(&ps, NODE_LIST) != 0) {
+        fprintf(stderr, "parse: line too long\n");
+        return PARSE_ERROR;
+    }
+
+    next_token(&ps);
+    if (parse_list(&ps, 0) != 0) {
+        if (ps.status == PARSE_OK) ps.status = PARSE_ERROR;
+    } else if (ps.tok != TOK_EOF) {
+        syntax_error(&ps);      // "fi" or "done" without its compound command
+    }
+    return ps.status;
+}
+
+void ast_free(struct ast *ast) {
+    free(ast->nodes);
+    free(ast->text);
+    memset(ast, 0, sizeof(*ast));
 }
 
 /*
@@ -41,156 +931,149 @@ void free_args(char **args) {
 ===============================================================================
 
 PARSER MODULE EXPLANATION:
-This module handles parsing and memory management for command line input.
-It's responsible for converting user input into a format the shell can execute.
+This module turns a line of input into a syntax tree (an "AST", abstract
+syntax tree) that the evaluator (eval.c) walks. It understands:
+    ls -l 'my file' "$HOME dir" a\ b    quoting and backslash escapes
+    a | b | c                           pipelines ("a|b" works too)
+    a ; b        a & b                  lists, background jobs
+    make && ./run || echo failed        && and || chains
+    sort < in > out 2>&1 <<< text       redirections (redirect.c)
+    time a | b                          the "time" keyword
+    echo $USER ${HOME}/x "$A" $$        parameters (expanded by expand.c)
+    echo "today: $(date +%F)"           command substitution (expand.c)
+    ls *.c src/[a-m]?.h                 patterns (glob.c)
+    CC=gcc make                         assignments before the command
+    if a; then b; elif c; then d; else e; fi
+    while a; do b; done   until a; do b; done
+    for f in *.c; do cc -c "$f"; done   loops (for without "in": "$@")
+    { a; b; } > out                     groups; redirections of a whole
+                                        compound command
+    greet() { echo "hi $1"; }           function definitions
+    # comment                           ignored up to the end of the line
+
+THE TREE:
+Every node lives in one array, ast->nodes, and refers to other nodes by
+their index, never by pointer:
+- nodes[0] is the root NODE_LIST; its children are NODE_AND_OR items
+- a NODE_AND_OR holds NODE_PIPELINEs joined by && (NODE_AND) or || (NODE_OR)
+- a NODE_PIPELINE holds NODE_CMDs joined by |
+- a NODE_CMD holds NODE_WORDs and NODE_REDIRs in the order they were written
+- a NODE_REDIR has one child, the NODE_WORD naming its target
+- a compound command (NODE_IF, NODE_WHILE, NODE_FOR, NODE_GROUP) takes the
+  place of a NODE_CMD in its pipeline; its lists are NODE_LIST children,
+  like the root, followed by its NODE_REDIRs. A NODE_FUNCDEF holds the
+  function's name and its body, a compound command.
+"first" is the index of a node's first child and "next" the index of its
+next sibling; 0 means "none", because the root can never be a child.
+A node is 16 bytes, so four fit in one 64-byte cache line. The parser
+appends each node before its children, so walking the tree in order reads
+the array almost strictly from front to back.
+
+Word text (with quotes and backslashes already removed) is stored in one
+buffer, ast->text, each word ending with '\0'. A NODE_WORD keeps the
+offset and length of its text. Because the tree uses offsets and indexes
+instead of pointers, it can be copied or written to a file as two plain
+blocks of memory and still be valid when read back at another address.
+
+The arrays are kept between lines: ast_parse() starts over at the
+beginning of both, and only grows them (doubling) when a line is bigger
+than every line before it. Parsing an ordinary line allocates nothing.
+
+HOW IT WORKS:
+The lexer and the parser work in one pass over the input. The parser asks
+next_token() for one token at a time (a word, an operator, a newline) and
+decides what to build from it; there is no token list in between.
+- A table lookup (char_class) classifies each byte; a run of ordinary
+  characters is copied with one memcpy()
+- Quotes: '...' is copied as is; inside "..." a backslash escapes only
+  $ ` " \ and newline; elsewhere a backslash makes the next character
+  ordinary. NODE_QUOTED records that a word had quoting.
+- $NAME, ${NAME}, $$, $? and the function arguments $1 .. $9, ${10}, $#,
+  $@ and $* outside single quotes become markers in the text
+  (CTL_VAR/CTL_QVAR name CTL_END, see shell.h) and set NODE_EXPAND;
+  expand.c replaces them with the values when the command runs. A '$'
+  followed by anything else stays an ordinary character.
+- $(command) keeps the command text as it was written, between
+  CTL_SUBST/CTL_QSUBST and CTL_END. subst_close() finds the matching ')'
+  past quotes and nested parentheses; the text is parsed only when the
+  substitution runs (expand.c).
+- An unquoted *, ? or [ sets NODE_GLOB: the word is a pattern matched
+  against file names when it runs (glob.c). Quoted ones get a CTL_ESC, so
+  "*" stays a star. An unquoted $NAME or $(...) sets NODE_GLOB as well,
+  since its value is matched too.
+- A word starting with NAME= before the command name gets NODE_ASSIGN
+  ("A=1 B=2 cmd"); after the command name it is an ordinary argument
+- Operators are recognised anywhere, not only as separate words
+- Digits directly in front of < or > name a descriptor ("2>err")
+All state sits in struct parser on the caller's stack, so ast_parse() is
+re-entrant: unlike strtok(), which kept hidden static state, two threads
+can parse into two different ast structures at the same time.
+
+RESERVED WORDS:
+if, then, elif, else, fi, while, until, for, in, do, done, { and } are
+ordinary words to the lexer. keyword() recognises them where a command
+starts, and only when written plainly ("\if" or "$x" is a command name).
+The lists inside a compound command are parsed by parse_list(), which
+stops at a reserved word that ends a list (then, do, fi, done, }, ...);
+parse_body() then checks it is the one expected. Newlines separate
+commands inside a compound command like ";" does. A loop body is parsed
+once, and eval.c runs the same nodes every round.
+
+"name()" followed by a compound command defines a function; at_funcdef()
+looks at the input right after the word for "(" and ")".
+
+INCOMPLETE INPUT:
+An unclosed quote or "$(", a trailing backslash, a line ending in |,
+&& or ||, or a compound command still waiting for its fi, done or } is
+not an error but PARSE_INCOMPLETE: the main loop reads the next line,
+joins the two with '\n', and parses again.
 
 FUNCTION IMPLEMENTATIONS:
 
-1. void trim_newLine(char *line)
+1. int ast_parse(struct ast *ast, const char *src, size_t len)
+   PURPOSE: Parses len bytes of src into ast (src is not modified and
+   does not need a '\0')
+   RETURN VALUE: PARSE_OK; PARSE_INCOMPLETE; or PARSE_ERROR after printing
+   a message such as "syntax error near unexpected token `|'"
+
+2. void ast_free(struct ast *ast)
+   PURPOSE: Releases both arrays (at shell exit)
+
+3. int arg_vec_reserve(struct arg_vec *v, size_t need)
+   PURPOSE: Grows a reusable argv array (struct arg_vec) to at least need
+   pointers, doubling its capacity; the pipeline code builds each command's
+   argv in one. arg_vec_push() appends one pointer.
+   RETURN VALUE: 0, or -1 if out of memory
+
+4. void trim_newLine(char *line)
    PURPOSE: Removes trailing newline character from user input
-   
-   POINTER CONCEPTS:
-   - char *line: Pointer to first character of string
-   - char *p: Pointer to location of newline character
-   
-   HOW IT WORKS:
    - strchr() searches for '\n' character and returns pointer to it
-   - if(p) checks if newline was found (pointer is not NULL)
    - *p = '\0' replaces newline with null terminator (end of string)
-   
-   POINTER EXPLANATION:
-   When you declare "char *p", you're creating a variable that can store
-   the memory address of a character. The * operator is used to:
-   - Declare a pointer: char *p;
-   - Dereference (access value): *p = '\0';
-
-2. char **parse_line(char *line)
-   PURPOSE: Splits command line into array of individual arguments
-   
-   DOUBLE POINTER CONCEPT:
-   - char **args: Pointer to pointer (array of string pointers)
-   - Think of it as: args[0] -> "ls", args[1] -> "-l", args[2] -> NULL
-   
-   MEMORY ALLOCATION:
-   - malloc() allocates memory on the heap (persistent until freed)
-   - sizeof(char *) calculates size of one pointer
-   - MAX_ARGS * sizeof(char *) allocates space for array of pointers
-   
-   TOKENIZATION PROCESS:
-   - strtok(line, " ") splits string at space characters
-   - First call uses original string
-   - Subsequent calls use NULL to continue from last position
-   - strdup() creates copy of each token (allocates new memory)
-   
-   RETURN VALUE:
-   Returns pointer to array of string pointers, or NULL if allocation fails
-
-3. void free_args(char **args)
-   PURPOSE: Deallocates all memory allocated by parse_line()
-   
-   MEMORY CLEANUP PROCESS:
-   - Loop through each string pointer in the array
-   - free(args[i]) deallocates each individual string
-   - free(args) deallocates the array of pointers itself
-   
-   WHY THIS IS NECESSARY:
-   C doesn't have garbage collection. Every malloc() and strdup() must
-   have a corresponding free() to prevent memory leaks.
 
 EXTERNAL FUNCTIONS USED:
+- memchr(s, c, n): finds the closing ' of a single-quoted string
+- memcpy(dst, src, n): copies a run of ordinary characters
+- realloc(ptr, size): grows the node and text arrays; the old block stays
+  valid if it fails
 
-From <string.h>:
-- strchr(const char *str, int c):
-  * Purpose: Searches for first occurrence of character in string
-  * Parameters: 
-    - str: String to search in
-    - c: Character to find
-  * Returns: Pointer to character if found, NULL if not found
-  * Example: strchr("hello", 'l') returns pointer to first 'l'
-
-- strtok(char *str, const char *delim):
-  * Purpose: Splits string into tokens using specified delimiters
-  * Parameters:
-    - str: String to tokenize (NULL for subsequent calls)
-    - delim: String containing delimiter characters
-  * Returns: Pointer to next token, NULL when no more tokens
-  * Warning: Modifies original string by inserting null terminators
-  * Example: strtok("a,b,c", ",") returns "a", then "b", then "c"
-
-- strdup(const char *s):
-  * Purpose: Creates duplicate copy of string in new memory
-  * Parameters: s - String to duplicate
-  * Returns: Pointer to new string copy, NULL if allocation fails
-  * Memory: Allocates new memory that must be freed later
-  * Equivalent to: malloc + strcpy
-
-From <stdlib.h>:
-- malloc(size_t size):
-  * Purpose: Allocates specified number of bytes on heap
-  * Parameters: size - Number of bytes to allocate
-  * Returns: Pointer to allocated memory, NULL if allocation fails
-  * Usage: Must be paired with free() to prevent memory leaks
-  * Example: malloc(10) allocates 10 bytes
-
-- free(void *ptr):
-  * Purpose: Deallocates memory previously allocated by malloc/strdup
-  * Parameters: ptr - Pointer to memory to free
-  * Returns: Nothing (void)
-  * Warning: Don't use pointer after freeing (undefined behavior)
-  * Example: free(ptr); ptr = NULL; // Good practice
-
-POINTER DEEP DIVE:
-Pointers are fundamental to C programming. Here's a comprehensive explanation:
-
-WHAT IS A POINTER?
-A pointer is a variable that stores the memory address of another variable.
-
-POINTER SYNTAX:
-- int *ptr;        // Declares pointer to integer
-- ptr = &variable; // Assigns address of variable to ptr
-- *ptr = 5;        // Assigns value 5 to location ptr points to
-- value = *ptr;    // Reads value from location ptr points to
-
-POINTER ARITHMETIC:
-- ptr++            // Move to next memory location
-- ptr + 1          // Address of next element
-- ptr - ptr2       // Distance between pointers
-
-ARRAY AND POINTER RELATIONSHIP:
-- int arr[5];      // Array of 5 integers
-- int *ptr = arr;  // ptr points to first element
-- arr[i] == *(ptr + i)  // These are equivalent
-
-DOUBLE POINTERS (POINTER TO POINTER):
-char **args is a pointer to a pointer. It's commonly used for:
-- Arrays of strings (each string is char*, array of them is char**)
-- Dynamic 2D arrays
-- Modifying pointer values in functions
+POINTERS AND INDEXES:
+A pointer holds a memory address; an index holds a position in an array.
+ast->nodes[5].next == 9 means "the next sibling is ast->nodes[9]". When
+realloc() moves the array to a bigger block, every pointer into the old
+block becomes invalid, but indexes stay correct. This is why the parser
+refers to nodes by index even while the array is still growing.
 
 MEMORY LAYOUT EXAMPLE:
-char **args after parse_line("ls -l file.txt"):
-
-Memory Address | Content
-----------------|----------
-0x1000         | 0x2000    <- args[0] points to "ls"
-0x1008         | 0x2010    <- args[1] points to "-l"  
-0x1016         | 0x2020    <- args[2] points to "file.txt"
-0x1024         | NULL      <- args[3] is NULL (end marker)
-
-0x2000         | "ls\0"    <- First string
-0x2010         | "-l\0"    <- Second string
-0x2020         | "file.txt\0" <- Third string
-
-COMMON POINTER MISTAKES:
-1. Using uninitialized pointers
-2. Dereferencing NULL pointers
-3. Memory leaks (forgetting to free())
-4. Double free (calling free() twice)
-5. Using freed memory (dangling pointers)
-
-GOOD PRACTICES:
-1. Always check if malloc() returns NULL
-2. Set pointers to NULL after freeing
-3. Free memory in reverse order of allocation
-4. Use tools like valgrind to detect memory issues
-*/
\ No newline at end of file
+ast_parse() of "ls -l | wc" gives:
+
+nodes[0] NODE_LIST      first=1        len=1
+nodes[1] NODE_AND_OR    first=2        len=1
+nodes[2] NODE_PIPELINE  first=3        len=2
+nodes[3] NODE_CMD       first=4 next=6 len=2
+nodes[4] NODE_WORD      first=0 next=5 len=2     text "ls"
+nodes[5] NODE_WORD      first=3        len=2     text "-l"
+nodes[6] NODE_CMD       first=7        len=1
+nodes[7] NODE_WORD      first=6        len=2     text "wc"
+
+ast->text: "ls\0-l\0wc\0"
+*/
@@ -0,0 +1,221 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "shell.h"
+
+struct path_entry {
+    char *name;         // command name, NULL for an empty slot
+    char *path;         // resolved absolute path
+    unsigned hits;      // how many times the entry was used
+};
+
+static struct path_entry *table = NULL;
+static size_t table_cap = 0;     // always a power of two
+static size_t table_used = 0;
+static char *cached_path_var = NULL;    // PATH the entries were resolved with
+
+static size_t hash_name(const char *s) {
+    // FNV-1a
+    size_t h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static struct path_entry *find_slot(struct path_entry *t, size_t cap, const char *name) {
+    size_t i = hash_name(name) & (cap - 1);
+
+    while (t[i].name && strcmp(t[i].name, name) != 0) {
+        i = (i + 1) & (cap - 1);
+    }
+    return &t[i];
+}
+
+static int grow_table(void) {
+    size_t new_cap = table_cap ? table_cap * 2 : 32;
+    struct path_entry *new_table = calloc(new_cap, sizeof(*new_table));
+    if (!new_table) return -1;
+
+    for (size_t i = 0; i < table_cap; i++) {
+        if (table[i].name) {
+            *find_slot(new_table, new_cap, table[i].name) = table[i];
+        }
+    }
+    free(table);
+    table = new_table;
+    table_cap = new_cap;
+    return 0;
+}
+
+void path_cache_clear(void) {
+    for (size_t i = 0; i < table_cap; i++) {
+        free(table[i].name);
+        free(table[i].path);
+        table[i].name = NULL;
+        table[i].path = NULL;
+    }
+    table_used = 0;
+}
+
+// Drops every entry if PATH changed since the entries were resolved
+static void check_path_var(void) {
+    // the shell's PATH variable (vars.c), also when it is not exported
+    const char *path_var = var_get("PATH");
+    if (!path_var) path_var = "";
+
+    if (cached_path_var && strcmp(cached_path_var, path_var) == 0) return;
+
+    path_cache_clear();
+    free(cached_path_var);
+    cached_path_var = strdup(path_var);
+}
+
+static int is_executable(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode) && access(path, X_OK) == 0;
+}
+
+// Walks PATH once and returns a malloc'd absolute path, or NULL
+static char *search_path(const char *name) {
+    const char *dir = cached_path_var;
+    size_t name_len = strlen(name);
+
+    while (dir) {
+        const char *end = strchr(dir, ':');
+        size_t dir_len = end ? (size_t)(end - dir) : strlen(dir);
+        char *full = malloc(dir_len + name_len + 3);
+        if (!full) return NULL;
+
+        // an empty PATH element means the current directory
+        if (dir_len == 0) {
+            memcpy(full, ".", 1);
+            dir_len = 1;
+        } else {
+            memcpy(full, dir, dir_len);
+        }
+        full[dir_len] = '/';
+        memcpy(full + dir_len + 1, name, name_len + 1);
+
+        if (is_executable(full)) return full;
+        free(full);
+        dir = end ? end + 1 : NULL;
+    }
+    return NULL;
+}
+
+const char *find_command(const char *name) {
+    if (!name) return NULL;
+    if (strchr(name, '/')) return name;
+
+    check_path_var();
+    if (table_cap == 0 && grow_table() != 0) return NULL;
+
+    struct path_entry *e = find_slot(table, table_cap, name);
+    if (e->name) {
+        e->hits++;
+        return e->path;
+    }
+
+    char *path = search_path(name);
+    if (!path) return NULL;
+
+    if ((table_used + 1) * 4 > table_cap * 3) {
+        if (grow_table() != 0) {
+            free(path);
+            return NULL;
+        }
+        e = find_slot(table, table_cap, name);
+    }
+    e->name = strdup(name);
+    e->path = path;
+    e->hits = 1;
+    table_used++;
+    return e->path;
+}
+
+void path_cache_forget(const char *name) {
+    if (table_cap == 0) return;
+
+    struct path_entry *e = find_slot(table, table_cap, name);
+    if (!e->name) return;
+
+    free(e->name);
+    free(e->path);
+    e->name = NULL;
+    e->path = NULL;
+    table_used--;
+
+    // re-insert the rest of the probe cluster so lookups still find it
+    size_t i = (size_t)(e - table);
+    for (i = (i + 1) & (table_cap - 1); table[i].name; i = (i + 1) & (table_cap - 1)) {
+        struct path_entry moved = table[i];
+        table[i].name = NULL;
+        *find_slot(table, table_cap, moved.name) = moved;
+    }
+}
+
+void path_cache_print(void) {
+    if (table_used == 0) {
+        printf("hash: hash table empty\n");
+        return;
+    }
+    printf("hits\tcommand\n");
+    for (size_t i = 0; i < table_cap; i++) {
+        if (table[i].name) {
+            printf("%4u\t%s\n", table[i].hits, table[i].path);
+        }
+    }
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+PATH CACHE MODULE EXPLANATION:
+execvp() searches every directory in $PATH and tries execve() in each one
+until it works, every time a command runs. This module remembers where each
+command was found, so repeated commands skip the search and are started with
+one exec of an absolute path (like the "hash" builtin of bash).
+
+DATA STRUCTURE:
+An open-addressing hash table of struct path_entry:
+- The capacity is a power of two, so "hash & (cap - 1)" picks a slot
+- Collisions use linear probing: try the next slot until an empty one
+- The table doubles when it is 3/4 full, keeping probe chains short
+- Deleting an entry re-inserts the entries after it in the same cluster,
+  otherwise a lookup would stop early at the new hole
+
+FUNCTION IMPLEMENTATIONS:
+
+1. const char *find_command(const char *name)
+   PURPOSE: Returns the absolute path of a command
+   - Names containing '/' are returned unchanged (no PATH search)
+   - A cached entry is returned directly and its hit counter increases
+   - Otherwise PATH is searched once and the result is stored
+   RETURN VALUE: Path owned by the cache, or NULL if the command was not found
+
+2. void path_cache_forget(const char *name)
+   PURPOSE: Removes one entry (used when a cached program disappeared)
+
+3. void path_cache_clear(void)
+   PURPOSE: Removes every entry ("hash -r")
+
+4. void path_cache_print(void)
+   PURPOSE: Lists the cached commands with their hit counts ("hash")
+
+INVALIDATION:
+Every lookup compares the shell's PATH variable (var_get("PATH"), vars.c)
+with the copy the entries were resolved against. If PATH changed, the whole
+table is cleared first.
+
+EXTERNAL FUNCTIONS USED:
+- stat(path, &st): reads file metadata; S_ISREG() checks for a regular file
+- access(path, X_OK): checks whether the file may be executed
+- calloc(n, size): allocates zeroed memory, so every slot starts empty
+- strchr(s, ':'): finds the end of the next PATH element
+*/
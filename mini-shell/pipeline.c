@@ -0,0 +1,668 @@
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "shell.h"
+
+#define COPY_CHUNK (64 * 1024)
+
+// Pipelines up to this many stages keep their bookkeeping on the stack
+#define PIPELINE_INLINE 16
+
+// Arguments, assignments and redirections of the current pipeline, reused
+// from one pipeline to the next. Every stage's argv is a NULL-terminated run
+// of line_args and its "NAME=value" prefix one of line_assigns; stage i owns
+// line_redirs.items[first[i]] .. [first[i + 1] - 1]
+static struct arg_vec line_args = {NULL, 0, 0};
+static struct arg_vec line_assigns = {NULL, 0, 0};
+static struct redir_vec line_redirs = {NULL, 0, 0};
+
+// The "timeout" prefix of each stage of the current pipeline (limits.c);
+// seconds is 0 for a stage without one
+static struct timeout *line_timeouts = NULL;
+static int line_timeouts_cap = 0;
+
+static void close_pipes(int (*pipes)[2], int count) {
+    for (int i = 0; i < count; i++) {
+        if (pipes[i][0] >= 0) close(pipes[i][0]);
+        if (pipes[i][1] >= 0) close(pipes[i][1]);
+        pipes[i][0] = pipes[i][1] = -1;
+    }
+}
+
+// Runs a builtin inside the shell with stdin/stdout pointed at the given
+// fds and its redirections applied, then restores the shell's descriptors.
+// Returns the builtin's exit status.
+static int run_builtin_io(char **args, int in_fd, int out_fd,
+                          struct redirect *redirs, size_t nredirs) {
+    struct fd_backup backup;
+    int status = 1;
+
+    if (redirects_open(redirs, nredirs) != 0) return 1;
+
+    builtin_output_flush(NULL, 0);  // what earlier builtins left is not this one's
+    fd_backup_init(&backup);
+    if (in_fd >= 0) fd_backup_dup2(&backup, in_fd, STDIN_FILENO);
+    if (out_fd >= 0) fd_backup_dup2(&backup, out_fd, STDOUT_FILENO);
+
+    int ok = 1;
+    for (size_t i = 0; i < nredirs && ok; i++) {
+        if (fd_backup_dup2(&backup, redirs[i].src, redirs[i].fd) != 0) {
+            fprintf(stderr, "%d: bad file descriptor\n", redirs[i].src);
+            ok = 0;
+        }
+    }
+
+    // a reader that exits early must not kill the shell with SIGPIPE
+    void (*old_handler)(int) = signal(SIGPIPE, SIG_IGN);
+    if (ok) status = run_builtin(args);
+    status = builtin_output_flush(args[0], status);
+    signal(SIGPIPE, old_handler);
+
+    fd_backup_restore(&backup);
+    redirects_close(redirs, nredirs);
+    return status;
+}
+
+// Runs a builtin in a child process (used when its reader is a builtin too),
+// or a function or compound command (cmd), which always get one
+static pid_t fork_builtin(char **args, const struct ast *ast, const struct node *cmd,
+                          int in_fd, int out_fd, const struct launch_opts *opts,
+                          int (*pipes)[2], int npipes) {
+    builtin_output_flush(NULL, 0);
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        perror("fork failed");
+    } else if (pid == 0) {
+        job_child_setup(opts->pgid, opts->foreground);
+        if (in_fd >= 0) dup2(in_fd, STDIN_FILENO);
+        if (out_fd >= 0) dup2(out_fd, STDOUT_FILENO);
+        close_pipes(pipes, npipes);
+        if (redirects_apply(opts->redirs, opts->nredirs) != 0) {
+            perror(args[0]);
+            _exit(1);
+        }
+        builtin_output_setup();
+        const char *name = args[0];
+        if (cmd || is_function(args[0])) {
+            // the commands in it run like a script's: the job they belong
+            // to is this process's
+            job_tty = -1;
+            shell_interactive = 0;
+            shell_max_jobs = 0;
+            name = NULL;    // the builtin that wrote last
+        }
+        jobs_forked();
+        int status = cmd ? eval_compound(ast, cmd) : run_builtin(args);
+        _exit(builtin_output_flush(name, status));
+    }
+    if (pid > 0 && trace_enabled) trace_process_start(pid, args[0]);
+    return pid;
+}
+
+// Runs the stages as one job; returns the exit status of the last stage.
+// Stage i is the compound command ast->nodes[compound[i]] if that is not 0.
+static int run_pipeline(const struct ast *ast, char ***stages, char ***assigns,
+                        const uint32_t *compound, const int *first, int n, int background) {
+    double launched_inline[PIPELINE_INLINE];
+    int pipes_inline[PIPELINE_INLINE][2];
+    pid_t pids_inline[PIPELINE_INLINE];
+    int in_shell_inline[PIPELINE_INLINE];
+    double *launched = launched_inline;
+    int (*pipes)[2] = pipes_inline;
+    pid_t *pids = pids_inline;
+    int *in_shell = in_shell_inline;
+    void *heap = NULL;
+    int npipes = 0;
+    int status = 0;
+
+    if (n > PIPELINE_INLINE) {
+        heap = malloc(n * (sizeof(*launched) + sizeof(*pipes) + sizeof(*pids) +
+                           sizeof(*in_shell)));
+        if (!heap) {
+            perror("pipeline");
+            return 1;
+        }
+        launched = heap;
+        pipes = (int (*)[2])(launched + n);
+        pids = (pid_t *)(pipes + n);
+        in_shell = (int *)(pids + n);
+    }
+
+    double started = stats_enabled ? now_seconds() : 0;
+
+    for (int i = 0; i < n - 1; i++) {
+        if (pipe2(pipes[i], O_CLOEXEC) != 0) {
+            perror("pipe");
+            close_pipes(pipes, npipes);
+            free(heap);
+            return 1;
+        }
+        npipes++;
+    }
+
+    // a background job must not compete with the shell for its input
+    int null_fd = background ? open("/dev/null", O_RDONLY | O_CLOEXEC) : -1;
+
+    // with job control the first process started leads the job's group
+    pid_t pgid = job_tty >= 0 ? 0 : -1;
+
+    // start every stage that needs a process before any builtin runs,
+    // so builtins always have live readers and writers around them
+    for (int i = 0; i < n; i++) {
+        int in_fd = i > 0 ? pipes[i - 1][0] : null_fd;
+        int out_fd = i < n - 1 ? pipes[i][1] : -1;
+
+        pids[i] = -1;
+        in_shell[i] = 0;
+        launched[i] = -1;
+        struct redirect *redirs = line_redirs.items + first[i];
+        size_t nredirs = (size_t)(first[i + 1] - first[i]);
+        struct launch_opts opts = {in_fd, out_fd, pgid, !background, redirs, nredirs, NULL};
+        int timed = line_timeouts[i].seconds > 0;
+
+        // a timed command leads a process group of its own, like under
+        // coreutils' timeout, so that the signal reaches everything it
+        // started; only a job of its own gives it the terminal
+        if (timed) {
+            opts.pgid = 0;
+            opts.foreground = !background && n == 1;
+        }
+
+        // a function runs other pipelines, which reuse this one's vectors;
+        // a timed command needs a process the timeout can kill
+        if (!compound[i] && is_builtin(stages[i]) && !is_function(stages[i][0]) &&
+            !background && !(i < n - 1 && is_builtin(stages[i + 1])) && !timed) {
+            in_shell[i] = 1;    // runs below, once its neighbours are started
+            continue;
+        }
+        // the job's status is the last stage's, also when it cannot start
+        if (i == n - 1) status = 1;
+        if (redirects_open(redirs, nredirs) != 0) continue;   // not started
+
+        if (!stages[i][0]) {
+            // only redirections ("> file"): the files are created, nothing runs
+            if (i == n - 1) status = 0;
+        } else if (!compound[i] && !is_builtin(stages[i])) {
+            double before = stats_enabled ? now_seconds() : 0;
+            // "NAME=value cmd": an environment of its own for this program
+            if (assigns[i][0]) opts.envp = vars_environ_with(assigns[i]);
+            pids[i] = launch_command(stages[i], &opts);
+            free(opts.envp);
+            // every stage shares the pipeline start time, so keep the
+            // spawn latency of this stage relative to it
+            if (stats_enabled) launched[i] = started + (now_seconds() - before);
+            if (i == n - 1 && pids[i] < 0) status = 127;
+        } else {
+            const struct node *cmd = compound[i] ? &ast->nodes[compound[i]] : NULL;
+            pids[i] = fork_builtin(stages[i], ast, cmd, in_fd, out_fd, &opts, pipes, npipes);
+        }
+        redirects_close(redirs, nredirs);
+        if (pgid == 0 && pids[i] > 0 && (!timed || n == 1)) pgid = pids[i];
+        if (pids[i] > 0 && timed) job_timer_add(pids[i], stages[i][0], &line_timeouts[i]);
+    }
+    if (null_fd >= 0) close(null_fd);
+
+    // the shell keeps only the pipe ends its own builtins use
+    for (int i = 0; i < npipes; i++) {
+        if (!in_shell[i + 1]) {
+            close(pipes[i][0]);
+            pipes[i][0] = -1;
+        }
+        if (!in_shell[i]) {
+            close(pipes[i][1]);
+            pipes[i][1] = -1;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (!in_shell[i]) continue;
+
+        int in_fd = i > 0 ? pipes[i - 1][0] : -1;
+        int out_fd = i < n - 1 ? pipes[i][1] : -1;
+        status = run_builtin_io(stages[i], in_fd, out_fd, line_redirs.items + first[i],
+                                (size_t)(first[i + 1] - first[i]));
+
+        // closing our ends lets the neighbours see EOF / EPIPE
+        if (in_fd >= 0) {
+            close(in_fd);
+            pipes[i - 1][0] = -1;
+        }
+        if (out_fd >= 0) {
+            close(out_fd);
+            pipes[i][1] = -1;
+        }
+    }
+
+    if (background) {
+        job_start(pids, n, stages, pgid, 0);
+        status = 0;
+    } else {
+        // the whole pipeline is one job: wait for every stage
+        pid_t last_pid = pids[n - 1];
+        int st = job_wait_foreground(pids, n, stages, pgid, started, launched);
+        if (last_pid > 0) status = exit_status(st);
+    }
+    free(heap);
+    return status;
+}
+
+// "A=1 B=2" without a command sets shell variables
+static int assign_vars(char **assigns) {
+    int status = 0;
+
+    for (int i = 0; assigns[i]; i++) {
+        if (var_assign(assigns[i]) != 0) {
+            perror(assigns[i]);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+// Takes "timeout ..." off the front of every stage into line_timeouts.
+// Returns the number of timed stages, or -1 after a usage error.
+static int take_timeouts(char ***stages, int n) {
+    int timed = 0;
+
+    if (n > line_timeouts_cap) {
+        struct timeout *grown = realloc(line_timeouts, n * sizeof(*grown));
+        if (!grown) {
+            perror("pipeline");
+            return -1;
+        }
+        line_timeouts = grown;
+        line_timeouts_cap = n;
+    }
+    for (int i = 0; i < n; i++) {
+        int skip = timeout_prefix(stages[i], &line_timeouts[i]);
+        if (skip < 0) return -1;
+        stages[i] += skip;
+        if (line_timeouts[i].seconds > 0) timed++;
+    }
+    return timed;
+}
+
+static int run_stages(const struct ast *ast, char ***stages, char ***assigns,
+                      const uint32_t *compound, const int *first, int n, int background) {
+    int timed = take_timeouts(stages, n);
+    if (timed < 0) return 125;      // as coreutils' timeout
+
+    // -j N: everything except a lone builtin or compound command joins
+    // the worker pool. A function definition, or a loop that assigns
+    // variables, must change this shell, not a forked copy; the pipelines
+    // inside a compound command come back here and join the pool one by one.
+    if (shell_max_jobs > 0 && !(n == 1 && (compound[0] || is_builtin(stages[0])))) {
+        background = 1;
+        while (jobs_active() >= shell_max_jobs) {
+            jobs_poll(JOBS_POLL_MS);
+        }
+    }
+
+    // if, loops and { }: the shell runs them itself, nothing is forked
+    if (n == 1 && !background && compound[0]) {
+        return eval_compound(ast, &ast->nodes[compound[0]]);
+    }
+    if (timed) return run_pipeline(ast, stages, assigns, compound, first, n, background);
+    if (n == 1 && !background && first[1] == 0 && !assigns[0][0]) {
+        if (is_builtin(stages[0])) {
+            int status = run_builtin(stages[0]);
+            return builtin_output_done(stages[0][0], status);
+        }
+        return exit_status(execute_command(stages[0]));
+    }
+    // a function call with redirections or assignments, in the shell too
+    if (n == 1 && !background && is_function(stages[0][0])) {
+        int status = assign_vars(assigns[0]);
+        if (status != 0) return status;
+        return eval_function(stages[0], line_redirs.items, (size_t)first[1]);
+    }
+    return run_pipeline(ast, stages, assigns, compound, first, n, background);
+}
+
+// Expands every command's words, assignments and redirections: stage i's
+// argv is stages[i] (pointing into line_args), its assignments assigns[i]
+// (into line_assigns), and its redirections start at first[i]. A compound
+// command is left to eval_compound(): compound[i] is its node, and its argv
+// only names it for the job list.
+static int build_stages(const struct ast *ast, const struct node *pipeline,
+                        char ***stages, char ***assigns, uint32_t *compound, int *first) {
+    int i = 0;
+
+    expand_reset();
+    line_args.len = 0;
+    line_assigns.len = 0;
+    line_redirs.len = 0;
+    for (uint32_t c = pipeline->first; c; c = ast->nodes[c].next, i++) {
+        first[i] = (int)line_redirs.len;
+        compound[i] = ast->nodes[c].type != NODE_CMD ? c : 0;
+        if (compound[i] && arg_vec_push(&line_args, (char *)compound_name(&ast->nodes[c])) != 0) {
+            perror("pipeline");
+            return -1;
+        }
+        for (uint32_t k = compound[i] ? 0 : ast->nodes[c].first; k; k = ast->nodes[k].next) {
+            const struct node *child = &ast->nodes[k];
+            int err;
+
+            // expansion errors are reported where they happen
+            if (child->type == NODE_WORD && (child->flags & NODE_ASSIGN)) {
+                char *entry = expand_string(ast, child);
+                if (!entry) return -1;
+                err = arg_vec_push(&line_assigns, entry) != 0;
+            } else if (child->type == NODE_WORD) {
+                if (expand_word(ast, child, &line_args) != 0) return -1;
+                err = 0;
+            } else {
+                // a here-string is one string, like a quoted word
+                const struct node *word = &ast->nodes[child->first];
+                const char *target = child->flags == REDIR_STRING ?
+                    expand_string(ast, word) : expand_target(ast, word);
+                if (!target) return -1;     // the error is already reported
+                err = redir_vec_add(&line_redirs, child->fd, child->flags, target) != 0;
+            }
+            if (err) {
+                perror("pipeline");
+                return -1;
+            }
+        }
+        if (arg_vec_push(&line_args, NULL) != 0 || arg_vec_push(&line_assigns, NULL) != 0) {
+            perror("pipeline");
+            return -1;
+        }
+    }
+    first[i] = (int)line_redirs.len;
+
+    // the vectors may have moved while they grew, so the stages are only
+    // pointed into them now: stage i starts after the i-th NULL
+    char **arg = line_args.argv;
+    char **assign = line_assigns.argv;
+    for (i = 0; i < (int)pipeline->len; i++) {
+        stages[i] = arg;
+        assigns[i] = assign;
+        while (*arg) arg++;
+        while (*assign) assign++;
+        arg++;
+        assign++;
+    }
+    return 0;
+}
+
+int execute_pipeline(const struct ast *ast, const struct node *pipeline,
+                     int background) {
+    char **stages_inline[PIPELINE_INLINE];
+    char **assigns_inline[PIPELINE_INLINE];
+    uint32_t compound_inline[PIPELINE_INLINE];
+    int first_inline[PIPELINE_INLINE + 1];
+    char ***stages = stages_inline;
+    char ***assigns = assigns_inline;
+    uint32_t *compound = compound_inline;
+    int *first = first_inline;
+    int n = (int)pipeline->len;
+    struct time_mark mark;
+    int status = 1;
+
+    if (n > PIPELINE_INLINE) {
+        stages = malloc(2 * n * sizeof(*stages) + n * sizeof(*compound) +
+                        (n + 1) * sizeof(*first));
+        if (!stages) {
+            perror("pipeline");
+            return 1;
+        }
+        assigns = stages + n;
+        compound = (uint32_t *)(assigns + n);
+        first = (int *)(compound + n);
+    }
+
+    // "time" measures the whole pipeline, however it ends
+    if (pipeline->flags & NODE_TIMED) time_begin(&mark);
+    if (n == 0) {
+        status = 0;     // "time" alone
+    } else if (build_stages(ast, pipeline, stages, assigns, compound, first) == 0) {
+        if (n == 1 && !stages[0][0]) {
+            // no command: "A=1", "> file", or words that expanded to
+            // nothing ("$x" with x empty, "$(true)"). Assignments outside a
+            // pipeline or background job change the shell; elsewhere they
+            // would only change a subshell's copy.
+            status = background ? 0 : assign_vars(assigns[0]);
+            if (status == 0) status = expand_subst_status();    // "X=$(cmd)"
+            if (status == 0 && first[1] > 0) {
+                status = run_stages(ast, stages, assigns, compound, first, n,
+                                    background);    // "> file"
+            }
+        } else {
+            status = run_stages(ast, stages, assigns, compound, first, n, background);
+        }
+    }
+    if (pipeline->flags & NODE_TIMED) time_end(&mark);
+
+    if (stages != stages_inline) free(stages);
+    return status;
+}
+
+static int is_pipe(int fd) {
+    struct stat st;
+    return fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+static int write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t w = write(fd, buf, len);
+        if (w < 0) return -1;
+        buf += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+// Moves len bytes from stdin to fd without copying them through user space
+static int splice_all(int fd, size_t len) {
+    while (len > 0) {
+        ssize_t s = splice(STDIN_FILENO, NULL, fd, NULL, len, SPLICE_F_MOVE);
+        if (s <= 0) return -1;
+        len -= (size_t)s;
+    }
+    return 0;
+}
+
+// Zero-copy tee: tee(2) duplicates the pipe data into stdout, splice(2) then
+// consumes the same bytes into the file. Returns -1 if the kernel refused
+// before any data moved, so the caller can fall back to read()/write().
+static int tee_splice(int file_fd) {
+    for (int moved = 0;; moved = 1) {
+        ssize_t n;
+
+        if (file_fd < 0) {
+            n = splice(STDIN_FILENO, NULL, STDOUT_FILENO, NULL, COPY_CHUNK, SPLICE_F_MOVE);
+        } else {
+            n = tee(STDIN_FILENO, STDOUT_FILENO, COPY_CHUNK, 0);
+        }
+        if (n == 0) return 0;
+        if (n < 0) return moved ? 1 : -1;
+        if (file_fd >= 0 && splice_all(file_fd, (size_t)n) != 0) return 1;
+    }
+}
+
+int builtin_tee(char **args) {
+    builtin_output_flush(NULL, 0);  // it writes to the descriptor directly
+    int argc = 0;
+    while (args[argc]) argc++;
+
+    int *fds = malloc(argc * sizeof(int));
+    int nfds = 0;
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | O_TRUNC;
+    int i = 1;
+    int open_failed = 0;
+
+    if (!fds) {
+        perror("tee");
+        return 1;
+    }
+
+    if (args[1] && strcmp(args[1], "-a") == 0) {
+        flags = O_WRONLY | O_CREAT | O_CLOEXEC | O_APPEND;
+        i++;
+    }
+    for (; args[i]; i++) {
+        int fd = open(args[i], flags, 0666);
+        if (fd < 0) {
+            // the other files still get the input, as with coreutils' tee
+            perror(args[i]);
+            open_failed = 1;
+            continue;
+        }
+        fds[nfds++] = fd;
+    }
+
+    int status = 0;
+    int fast = is_pipe(STDIN_FILENO) && !(flags & O_APPEND) &&
+               (nfds == 0 || (nfds == 1 && is_pipe(STDOUT_FILENO)));
+
+    if (!fast || (status = tee_splice(nfds ? fds[0] : -1)) < 0) {
+        char *buf = malloc(COPY_CHUNK);
+        ssize_t n;
+
+        status = buf ? 0 : 1;
+        while (buf && (n = read(STDIN_FILENO, buf, COPY_CHUNK)) > 0) {
+            if (write_all(STDOUT_FILENO, buf, (size_t)n) != 0) status = 1;
+            for (int f = 0; f < nfds; f++) {
+                if (write_all(fds[f], buf, (size_t)n) != 0) status = 1;
+            }
+        }
+        free(buf);
+    }
+
+    for (int f = 0; f < nfds; f++) {
+        close(fds[f]);
+    }
+    free(fds);
+    return open_failed ? 1 : status;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+PIPELINE MODULE EXPLANATION:
+A pipeline like "ls | grep c | wc -l" connects the standard output of each
+command to the standard input of the next one. All stages run at the same
+time; the kernel pipe between them carries the data and makes a fast writer
+wait when the reader falls behind.
+
+FUNCTION IMPLEMENTATIONS:
+
+1. int execute_pipeline(const struct ast *ast, const struct node *pipeline,
+                          int background)
+   PURPOSE: Runs one NODE_PIPELINE of a parsed line (parser.c) and returns
+   its exit status; eval.c calls it for every pipeline of a list
+   - build_stages() turns the tree into what the launchers take: one
+     NULL-terminated argv per stage in line_args, a vector reused for every
+     line, and the redirections of every stage in line_redirs; first[i] is
+     the index of stage i's first redirection. Words are expanded on the
+     way (expand.c): a word without $ is a pointer straight into the
+     tree's text pool (no copying), others may give several arguments.
+   - "NAME=value" words before a command name go to line_assigns. With a
+     command, they become that program's environment only
+     (vars_environ_with()); builtins ignore them. Without one ("A=1"),
+     assign_vars() sets shell variables, unless the command is part of a
+     longer pipeline or runs in the background, where other shells only
+     change a subshell's copy. A command whose words all expanded to
+     nothing ("$x" with x unset, "$(true)") runs nothing either; its status
+     is that of its last $(...), or 0.
+   - A single command without redirections or assignments goes straight to
+     run_builtin() or execute_command(). Any other command goes through
+     run_pipeline(), which opens the files and passes them to the launch,
+     or applies them around an in-shell builtin with run_builtin_io()
+   - A compound command (if, while, for, { }) alone in the foreground is
+     run by eval_compound() in the shell: a loop of builtins forks nothing.
+     So is a function call; one with redirections goes to eval_function()
+     with them, since the function's own pipelines reuse line_redirs.
+   - "time" (NODE_TIMED) runs the pipeline between time_begin() and
+     time_end() (stats.c), which print real/user/sys times to stderr
+   - "timeout DURATION cmd" is taken off a stage by take_timeouts()
+     (timeout_prefix() in limits.c). A timed stage always runs as a
+     process, even a builtin, so it can be killed; it leads a process
+     group of its own, which gets a timer with job_timer_add() (jobs.c)
+     right after it started. The job's group is led by another stage,
+     unless the timed command is the only one.
+   - background runs it as a job of its own (jobs.c). In "-j N" mode every
+     pipeline except a lone builtin or compound command does, and it first
+     waits in jobs_poll() until fewer than N jobs are running.
+   RETURN VALUE: the status of the last stage, as exit_status() (executor.c)
+   reports it; 127 when that stage could not be started, 1 when it was not
+   started because an earlier one failed, and 0 for a job sent to the
+   background
+
+2. static int run_pipeline(const struct ast *ast, char ***stages, char ***assigns,
+                           const uint32_t *compound, const int *first, int n,
+                           int background)
+   PURPOSE: Runs n stages as one job
+
+   STEPS:
+   1. Create n-1 pipes with pipe2(O_CLOEXEC). Close-on-exec means no program
+      inherits pipe ends it does not use; launch_command() dup2()s only the
+      two ends a stage needs onto fd 0 and 1.
+   2. Start every external stage at once with launch_command().
+   3. Close the pipe ends the shell does not need. A reader only sees EOF
+      when every copy of the write end is closed, so leftovers would hang it.
+   4. Run builtin stages inside the shell with stdin/stdout temporarily
+      pointed at their pipes (run_builtin_io()).
+   5. Wait for every process of the job with job_wait_foreground(), or hand
+      the PIDs to job_start() when it runs in the background. Background
+      jobs read /dev/null and run all their builtins in forked children.
+   With job control (jobs.c) every process of the pipeline joins the
+   process group of the first one started, so Ctrl-C and Ctrl-Z reach the
+   whole job, and a foreground pipeline takes the terminal.
+
+   There is no limit on the number of stages. The per-stage arrays (pipes,
+   PIDs, builtin flags) live on the stack for up to PIPELINE_INLINE stages,
+   so ordinary pipelines allocate nothing; longer ones use one malloc().
+
+   BUILTIN STAGES:
+   - A builtin normally runs in the shell process. Its neighbours were
+     already started, so there is always someone on the other side of its
+     pipes.
+   - If the next stage is also a builtin, nobody would read its output while
+     it runs, so it is run in a forked child instead.
+   - SIGPIPE is ignored while a builtin writes into a pipe, so an early
+     exiting reader (e.g. "hash | head -1") cannot terminate the shell.
+   - Functions and compound commands in a pipeline ("f | sort",
+     "for ...; done | sort") always run in a forked child, via
+     fork_builtin(): they run pipelines of their own, which would reuse
+     the vectors the stages live in. The child runs them like a script,
+     with job control off.
+
+3. int builtin_tee(char **args)
+   PURPOSE: "tee [-a] file..." copies stdin to stdout and to every file
+   RETURN VALUE: 0, or 1 if a file could not be opened (the others are
+   still written) or a write failed
+
+   ZERO-COPY PATH:
+   When data flows through the shell between pipes, it does not need to
+   enter user space at all:
+   - No files: splice(stdin, stdout) moves pipe pages to the output
+   - One file, stdout a pipe: tee(stdin, stdout) duplicates the pipe
+     contents into stdout without consuming them, then splice(stdin, file)
+     consumes the same bytes into the file
+   Other combinations (several files, -a, terminals) use a read()/write()
+   loop with one 64 KiB buffer.
+
+EXTERNAL FUNCTIONS USED:
+- pipe2(fds, O_CLOEXEC): creates a pipe; fds[0] is the read end, fds[1] the
+  write end, both closed automatically on exec
+- fcntl(fd, F_DUPFD_CLOEXEC, 10): duplicates fd to a number >= 10 with
+  close-on-exec set (used to save and later restore stdin/stdout)
+- signal(SIGPIPE, SIG_IGN): ignore the signal sent when writing to a pipe
+  that has no reader; write() then fails with EPIPE instead
+- splice(fd_in, off_in, fd_out, off_out, len, flags): moves data between a
+  pipe and another descriptor inside the kernel
+- tee(fd_in, fd_out, len, flags): duplicates data from one pipe into another
+  without consuming it
+- fstat(fd, &st) with S_ISFIFO(): checks whether a descriptor is a pipe
+*/
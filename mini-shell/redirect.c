@@ -0,0 +1,254 @@
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include "shell.h"
+
+// Makes room for one more redirection, doubling the capacity
+static struct redirect *redir_vec_push(struct redir_vec *v) {
+    if (v->len == v->cap) {
+        size_t new_cap = v->cap ? v->cap * 2 : 8;
+        struct redirect *grown = realloc(v->items, new_cap * sizeof(*grown));
+        if (!grown) return NULL;
+        v->items = grown;
+        v->cap = new_cap;
+    }
+    return &v->items[v->len++];
+}
+
+void redir_vec_free(struct redir_vec *v) {
+    free(v->items);
+    v->items = NULL;
+    v->len = v->cap = 0;
+}
+
+int redir_vec_add(struct redir_vec *v, int fd, enum redir_op op, const char *word) {
+    struct redirect *slot = redir_vec_push(v);
+    if (!slot) return -1;
+
+    slot->fd = fd;
+    slot->op = op;
+    slot->word = word;
+    // the parser only accepts a single digit after N>& and N<&
+    slot->src = op == REDIR_DUP ? word[0] - '0' : -1;
+    slot->opened = 0;
+    return 0;
+}
+
+// Moves fd to a number above every descriptor a redirection can name,
+// so applying an earlier redirection cannot overwrite it
+static int move_high(int fd) {
+    int high = fcntl(fd, F_DUPFD_CLOEXEC, REDIR_MAX_FD + 1);
+    close(fd);
+    return high;
+}
+
+// A "<<<" here-string: the text plus a newline, readable from a descriptor
+static int open_string(const char *text) {
+    size_t len = strlen(text);
+    struct iovec iov[2] = {{(void *)text, len}, {"\n", 1}};
+    int fd;
+
+    if (len + 1 <= PIPE_BUF) {
+        // fits in the pipe buffer, so this write cannot block
+        int p[2];
+        if (pipe2(p, O_CLOEXEC) != 0) return -1;
+        ssize_t w = writev(p[1], iov, 2);
+        close(p[1]);
+        if (w != (ssize_t)(len + 1)) {
+            close(p[0]);
+            return -1;
+        }
+        return p[0];
+    }
+
+    // too big for a pipe: an anonymous in-memory file, read from offset 0
+    fd = memfd_create("here-string", MFD_CLOEXEC);
+    if (fd < 0) return -1;
+    if (writev(fd, iov, 2) != (ssize_t)(len + 1) || lseek(fd, 0, SEEK_SET) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int redirects_open(struct redirect *r, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        int flags = O_CLOEXEC;
+
+        switch (r[i].op) {
+        case REDIR_IN:      flags |= O_RDONLY; break;
+        case REDIR_OUT:     flags |= O_WRONLY | O_CREAT | O_TRUNC; break;
+        case REDIR_APPEND:  flags |= O_WRONLY | O_CREAT | O_APPEND; break;
+        case REDIR_STRING:  break;
+        default:            continue;   // dup and close open nothing
+        }
+
+        int fd = r[i].op == REDIR_STRING ? open_string(r[i].word)
+                                         : open(r[i].word, flags, 0666);
+        for (size_t j = 0; fd >= 0 && j < i; j++) {
+            if (r[j].fd == fd) {
+                fd = move_high(fd);
+                break;
+            }
+        }
+        if (fd < 0) {
+            perror(r[i].word);
+            redirects_close(r, i);
+            return -1;
+        }
+        r[i].src = fd;
+        r[i].opened = 1;
+    }
+    return 0;
+}
+
+void redirects_close(struct redirect *r, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (r[i].opened) {
+            close(r[i].src);
+            r[i].src = -1;
+            r[i].opened = 0;
+        }
+    }
+}
+
+int redirects_apply(const struct redirect *r, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (r[i].src < 0) {
+            close(r[i].fd);
+        } else if (r[i].src == r[i].fd) {
+            // dup2() does nothing here, so clear close-on-exec by hand
+            if (fcntl(r[i].fd, F_SETFD, 0) != 0) return -1;
+        } else if (dup2(r[i].src, r[i].fd) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void fd_backup_init(struct fd_backup *b) {
+    for (int fd = 0; fd <= REDIR_MAX_FD; fd++) {
+        b->saved[fd] = FD_NOT_SAVED;
+    }
+}
+
+int fd_backup_dup2(struct fd_backup *b, int src, int fd) {
+    if (b->saved[fd] == FD_NOT_SAVED) {
+        // -1 records that fd was closed before
+        b->saved[fd] = fcntl(fd, F_DUPFD_CLOEXEC, REDIR_MAX_FD + 1);
+    }
+    // "3>&-" when 3 is not open is not an error: it is closed already
+    if (src < 0) return close(fd) != 0 && errno != EBADF ? -1 : 0;
+    if (src != fd && dup2(src, fd) < 0) return -1;
+    return 0;
+}
+
+void fd_backup_restore(struct fd_backup *b) {
+    for (int fd = 0; fd <= REDIR_MAX_FD; fd++) {
+        if (b->saved[fd] == FD_NOT_SAVED) continue;
+
+        if (b->saved[fd] >= 0) {
+            dup2(b->saved[fd], fd);
+            close(b->saved[fd]);
+        } else {
+            close(fd);
+        }
+        b->saved[fd] = FD_NOT_SAVED;
+    }
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+REDIRECT MODULE EXPLANATION:
+A redirection changes where one of a command's file descriptors points
+before the program starts:
+    sort < in.txt           fd 0 (stdin) reads in.txt
+    ls > out.txt            fd 1 (stdout) writes out.txt, emptied first
+    ls >> out.txt           fd 1 appends to out.txt
+    make 2> errors.txt      fd 2 (stderr) writes errors.txt
+    make > log 2>&1         fd 2 becomes a copy of fd 1 (both go to log)
+    cmd 2>&-                fd 2 is closed
+    wc -w <<< hello         fd 0 reads the text "hello\n" (a here-string)
+The parser (parser.c) recognises the operators, wherever they appear
+("a>b" redirects a's output to b), and gives each one a NODE_REDIR with the
+target word; a quoted operator ("'>'") is an ordinary argument. Descriptors
+0 to 9 can be named. Redirections are applied from left to right, after the
+pipes of a pipeline, so "a 2>&1 | b" sends both outputs of a into the pipe.
+
+Here-documents ("<<EOF" followed by lines) are not supported: the parser
+reports "<<" as an error.
+
+HOW IT AVOIDS EXTRA WORK:
+- No "sh -c" wrapper and no helper process: the shell opens the files
+  itself with O_CLOEXEC, and only the child's descriptor table changes.
+  With posix_spawn() each redirection becomes one dup2 file action; on the
+  fork path the child calls redirects_apply() before execve().
+- Opening in the shell (not in the child) means a missing file is reported
+  as "in.txt: No such file or directory", and the command is not started.
+- The shell's own copies are close-on-exec and are closed right after the
+  launch, so no program inherits a descriptor it did not ask for.
+- A here-string of up to PIPE_BUF (4096) bytes is written into a pipe in
+  one writev() call, which cannot block because it fits in the pipe buffer.
+  Longer text goes into a memfd (an anonymous file that lives in memory).
+  No temporary file is ever created on disk.
+
+DATA STRUCTURES (shell.h):
+- struct redirect: fd (the descriptor being changed), op (REDIR_IN,
+  REDIR_OUT, REDIR_APPEND, REDIR_DUP, REDIR_CLOSE, REDIR_STRING), word (file
+  name or here-string text, pointing into the parsed text), src (the
+  descriptor fd becomes a copy of; -1 closes fd), opened (src was opened by
+  redirects_open() and must be closed)
+- struct redir_vec: growable array of redirections, reused for every
+  pipeline
+- struct fd_backup: saved copies of descriptors 0..9, used while a builtin
+  runs inside the shell with redirected descriptors
+
+FUNCTION IMPLEMENTATIONS:
+
+1. int redir_vec_add(struct redir_vec *v, int fd, enum redir_op op,
+                     const char *word)
+   PURPOSE: Appends one parsed redirection to v; for N>&M, src is M
+   RETURN VALUE: 0, or -1 if out of memory
+
+2. int redirects_open(struct redirect *r, size_t n)
+   PURPOSE: Opens the files and here-strings of one command
+   - If a new descriptor has the number of an earlier redirection's target
+     (e.g. "3>&1 > out" when out is opened as fd 3), it is moved above 9,
+     otherwise applying "3>&1" in the child would overwrite it
+   RETURN VALUE: 0, or -1 (nothing stays open) after printing the error
+
+3. void redirects_close(struct redirect *r, size_t n)
+   PURPOSE: Closes what redirects_open() opened, after the launch
+
+4. int redirects_apply(const struct redirect *r, size_t n)
+   PURPOSE: Performs the redirections in a forked child
+   RETURN VALUE: 0, or -1 with errno set
+
+5. fd_backup_init() / fd_backup_dup2() / fd_backup_restore()
+   PURPOSE: Redirect descriptors of the shell itself while a builtin runs
+   (e.g. "hash > paths.txt"), then put the originals back. The first
+   time a descriptor is changed it is saved with F_DUPFD_CLOEXEC.
+   Closing a descriptor that is not open ("echo x 3>&-") succeeds, as in
+   other shells.
+
+EXTERNAL FUNCTIONS USED:
+- open(path, flags, mode): opens or creates a file
+- dup2(oldfd, newfd): makes newfd refer to the same open file as oldfd
+- fcntl(fd, F_DUPFD_CLOEXEC, min): duplicates fd to the lowest free number
+  >= min, with close-on-exec set
+- fcntl(fd, F_SETFD, 0): clears close-on-exec
+- pipe2(fds, O_CLOEXEC): creates a pipe
+- writev(fd, iov, count): writes several buffers with one system call
+- memfd_create(name, MFD_CLOEXEC): creates an anonymous file in memory
+- lseek(fd, 0, SEEK_SET): moves the file offset back to the start
+*/
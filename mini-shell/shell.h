@@ -1,15 +1,378 @@
 #ifndef SHELL_H
 #define SHELL_H
 
-#define MAX_LINE 1024
-#define MAX_ARGS 64
+// Initial capacity of an argument vector; it doubles when a line needs more
+#define ARGS_INITIAL_CAP 64
+
+#include <stdio.h>
+#include <stdint.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+
+enum launch_mode {
+    LAUNCH_SPAWN,
+    LAUNCH_FORK
+};
+
+extern enum launch_mode launch_mode;
+
+// Growable argument vector, reused from one line to the next (parser.c)
+struct arg_vec {
+    char **argv;
+    size_t len;
+    size_t cap;
+};
+
+// Syntax tree of a parsed line (parser.c). All nodes live in one array and
+// refer to each other by index; 0 means "none" (nodes[0] is the root).
+enum node_type {
+    NODE_LIST,          // children: NODE_AND_OR, run one after another
+    NODE_AND_OR,        // children: NODE_PIPELINE, joined by && and ||
+    NODE_PIPELINE,      // children: NODE_CMD, joined by |
+    NODE_CMD,           // children: NODE_WORD and NODE_REDIR, in line order
+    NODE_WORD,          // text: ast->text + first, len bytes plus a '\0'
+    NODE_REDIR,         // child: the NODE_WORD naming its target
+
+    // Compound commands stand in a NODE_PIPELINE where a NODE_CMD would;
+    // NODE_REDIR children after their lists apply to the whole command
+    NODE_IF,            // children: NODE_LIST condition, NODE_LIST body, ...,
+                        // and an unpaired last NODE_LIST for "else"
+    NODE_WHILE,         // children: NODE_LIST condition, NODE_LIST body
+    NODE_FOR,           // children: NODE_WORD name, NODE_WORD items, NODE_LIST body
+    NODE_GROUP,         // child: NODE_LIST ("{ list; }")
+    NODE_FUNCDEF        // children: NODE_WORD name, the compound command body
+};
+
+#define NODE_BACKGROUND 0x01    // NODE_AND_OR: ended with "&"
+#define NODE_AND        0x01    // NODE_PIPELINE: runs if the previous one succeeded
+#define NODE_OR         0x02    // NODE_PIPELINE: runs if the previous one failed
+#define NODE_TIMED      0x04    // NODE_PIPELINE: "time" prefix
+#define NODE_QUOTED     0x01    // NODE_WORD: part of it was quoted or escaped
+#define NODE_EXPAND     0x02    // NODE_WORD: holds CTL_* markers (expand.c)
+#define NODE_ASSIGN     0x04    // NODE_WORD: NAME=value before the command name
+#define NODE_GLOB       0x08    // NODE_WORD: may be a file name pattern (glob.c)
+#define NODE_UNTIL      0x01    // NODE_WHILE: "until", runs while the condition fails
+#define NODE_ARGS       0x01    // NODE_FOR: no "in" list, the loop goes over "$@"
+
+// Bytes the lexer leaves in a word's text where something is expanded
+// when the command runs (expand.c)
+#define CTL_ESC  '\001'    // the next byte is literal
+#define CTL_VAR  '\002'    // $NAME: CTL_VAR NAME CTL_END
+#define CTL_QVAR '\003'    // "$NAME", inside double quotes
+#define CTL_END  '\004'
+#define CTL_SUBST  '\005' // $(command): CTL_SUBST command text CTL_END
+#define CTL_QSUBST '\006' // "$(command)", inside double quotes
+
+struct node {
+    uint8_t type;       // enum node_type
+    uint8_t flags;      // NODE_* flags above; enum redir_op for NODE_REDIR
+    uint16_t fd;        // NODE_REDIR: descriptor being redirected
+    uint32_t next;      // next sibling
+    uint32_t first;     // first child, or a word's offset in text
+    uint32_t len;       // number of children, or a word's length
+};
+
+struct ast {
+    struct node *nodes;
+    uint32_t nnodes;
+    uint32_t nodes_cap;
+    char *text;         // every word's text, '\0'-terminated
+    uint32_t text_len;
+    uint32_t text_cap;
+};
+
+enum parse_status {
+    PARSE_ERROR = -1,   // a message was printed
+    PARSE_OK = 0,
+    PARSE_INCOMPLETE = 1    // needs the next line (open quote, trailing |)
+};
+
+// Buffered line input (input.c)
+struct line_reader {
+    int fd;
+    char *buf;
+    size_t cap;
+    size_t start;
+    size_t end;
+    int eof;
+    int mapped;
+    int owns_fd;
+    char *tail;
+};
+
+// One entry of the builtin dispatch table (builtins.c, builtins.def)
+struct builtin {
+    const char *name;
+    int (*handler)(char **args);
+};
+
+// Snapshot taken by the "time" prefix (stats.c)
+struct time_mark {
+    double wall;
+    struct rusage self;
+    struct rusage children;
+};
+
+// Kinds of spans in a --trace file (trace.c)
+enum trace_kind {
+    TRACE_PARSE,
+    TRACE_BUILTIN,
+    TRACE_SPAWN,
+    TRACE_EXEC,
+    TRACE_WAIT
+};
+
+// Longest span name kept, with its '\0'
+#define TRACE_NAME_MAX 32
+
+// What a "timeout" prefix asked for (limits.c)
+struct timeout {
+    double seconds;     // 0: no timeout
+    double kill_after;  // SIGKILL this long after sig, 0: never
+    int sig;
+};
+
+// Start of a span of the shell, see trace_begin()
+struct trace_mark {
+    double start;
+    char name[TRACE_NAME_MAX];
+};
+
+extern int stats_enabled;
+extern int trace_enabled;
+extern int shell_interactive;
+extern int shell_max_jobs;
+
+// Job control state (jobs.c)
+extern int job_tty;                 // terminal descriptor, -1 without job control
+extern sigset_t job_sigmask;        // signal mask children start with
+extern sigset_t job_sigdefault;     // signals children reset to SIG_DFL
+extern volatile sig_atomic_t shell_interrupted;     // Ctrl-C at the prompt
+
+// jobs_poll() timeout used by loops that wait for jobs (milliseconds)
+#define JOBS_POLL_MS 1000
+
+// Highest descriptor a redirection can name ("9>file")
+#define REDIR_MAX_FD 9
+#define FD_NOT_SAVED (-2)
+
+enum redir_op {
+    REDIR_IN,           // <
+    REDIR_OUT,          // >
+    REDIR_APPEND,       // >>
+    REDIR_DUP,          // N>&M, N<&M
+    REDIR_CLOSE,        // N>&-
+    REDIR_STRING        // <<< text
+};
+
+// One redirection of a command (redirect.c)
+struct redirect {
+    int fd;             // descriptor being redirected
+    enum redir_op op;
+    const char *word;   // file name or here-string text
+    int src;            // fd becomes a copy of src; -1 closes fd
+    int opened;         // src was opened by redirects_open()
+};
+
+struct redir_vec {
+    struct redirect *items;
+    size_t len;
+    size_t cap;
+};
+
+// Original descriptors 0..REDIR_MAX_FD while a builtin runs redirected
+struct fd_backup {
+    int saved[REDIR_MAX_FD + 1];
+};
+
+// Descriptors given to a launched program; -1 keeps the shell's own.
+// pgid: -1 keeps the shell's process group, 0 starts a new one, > 0 joins it
+struct launch_opts {
+    int in_fd;
+    int out_fd;
+    pid_t pgid;
+    int foreground;     // with job control: the group takes the terminal
+    const struct redirect *redirs;  // applied after in_fd/out_fd
+    size_t nredirs;
+    char **envp;        // environment, NULL for the shell's (vars_environ())
+};
 
     void trim_newLine(char *line);
-    char **parse_line(char *line);
-    void free_args(char **args);
+    int ast_parse(struct ast *ast, const char *src, size_t len);
+    void ast_free(struct ast *ast);
+    int arg_vec_reserve(struct arg_vec *v, size_t need);
+    int arg_vec_push(struct arg_vec *v, char *arg);
+    void arg_vec_free(struct arg_vec *v);
     int is_builtin(char **args);
-    void run_builtin(char **args);
-    void execute_command(char **args);
+    int run_builtin(char **args);
+    void builtin_output_setup(void);
+    int builtin_output_done(const char *name, int status);
+    int builtin_output_flush(const char *name, int status);
+    const struct builtin *lookup_builtin(const char *name);
+    const char *builtin_name(size_t i);
+    int execute_command(char **args);
+    int wait_process(pid_t pid, const char *name, double started, double launched);
+    int exit_status(int wait_status);
+    pid_t launch_command(char **args, const struct launch_opts *opts);
+    int set_launch_mode(const char *name);
+
+    // eval.c
+    int eval_ast(const struct ast *ast);
+    int eval_compound(const struct ast *ast, const struct node *cmd);
+    int eval_status(void);
+    void eval_set_status(int status);
+    const char *compound_name(const struct node *cmd);
+    int is_function(const char *name);
+    int eval_function(char **args, struct redirect *redirs, size_t nredirs);
+    const char *eval_arg(size_t n);
+    size_t eval_argc(void);
+    int builtin_break(char **args);
+    int builtin_continue(char **args);
+    int builtin_return(char **args);
+
+    // vars.c
+    const char *var_get(const char *name);
+    int var_set(const char *name, const char *value);
+    int var_assign(const char *entry);
+    void var_unset(const char *name);
+    size_t var_name_len(const char *s);
+    char **vars_environ(void);
+    char **vars_environ_with(char **assigns);
+    int builtin_export(char **args);
+    int builtin_unset(char **args);
+
+    // expand.c
+    int expand_word(const struct ast *ast, const struct node *word, struct arg_vec *out);
+    char *expand_string(const struct ast *ast, const struct node *word);
+    char *expand_target(const struct ast *ast, const struct node *word);
+    void expand_reset(void);
+    int expand_subst_status(void);
+    char *expand_save(const char *s, size_t len);
+    void word_print(FILE *out, const char *text);
+    const char *word_source(const struct ast *ast, const struct node *word);
+
+    // glob.c
+    int glob_fields(struct arg_vec *v, size_t start);
+    long glob_expand(const char *pattern, struct arg_vec *out);
+    int glob_has_meta(const char *pattern);
+    void glob_unescape(char *s);
+    void glob_cache_clear(void);
+
+    // pipeline.c
+    int execute_pipeline(const struct ast *ast, const struct node *pipeline,
+                         int background);
+    int builtin_tee(char **args);
+
+    // input.c
+    int reader_open_fd(struct line_reader *r, int fd);
+    int reader_open_file(struct line_reader *r, const char *path);
+    int reader_open_string(struct line_reader *r, const char *text);
+    char *reader_next_line(struct line_reader *r);
+    size_t reader_offset(const struct line_reader *r);
+    void reader_seek(struct line_reader *r, size_t offset);
+    void reader_close(struct line_reader *r);
+
+    // jobs.c
+    void jobs_init(int interactive);
+    void job_child_setup(pid_t pgid, int foreground);
+    void jobs_forked(void);
+    int job_start(pid_t *pids, int npids, char ***stages, pid_t pgid, int stopped);
+    int job_wait_foreground(pid_t *pids, int npids, char ***stages, pid_t pgid,
+                            double started, const double *launched);
+    int jobs_poll(int timeout_ms);
+    int jobs_active(void);
+    void jobs_notify(void);
+    int jobs_event_fd(void);
+    void jobs_wait_all(void);
+    int builtin_wait(char **args);
+    int builtin_jobs(char **args);
+    int builtin_fg(char **args);
+    int builtin_bg(char **args);
+    int job_timer_add(pid_t pid, const char *name, const struct timeout *timeout);
+    int job_timers_pending(void);
+    pid_t job_wait_timed(pid_t pid, int *status, int options, struct rusage *ru);
+
+    // history.c
+    int history_open(const char *path);
+    void history_add(const char *line);
+    size_t history_count(void);
+    const char *history_entry(size_t n, size_t *len);
+    size_t history_find_prefix(const char *prefix);
+    size_t history_find_substring(const char *text, size_t before);
+    char *history_expand(char *line);
+    void history_close(void);
+    int builtin_history(char **args);
+
+    // coproc.c
+    int builtin_coproc(char **args);
+    int is_coproc(const char *name);
+    int coproc_request(char **args);
+    void coproc_close_all(void);
+
+    // redirect.c
+    int redir_vec_add(struct redir_vec *v, int fd, enum redir_op op, const char *word);
+    int redirects_open(struct redirect *r, size_t n);
+    void redirects_close(struct redirect *r, size_t n);
+    int redirects_apply(const struct redirect *r, size_t n);
+    void redir_vec_free(struct redir_vec *v);
+    void fd_backup_init(struct fd_backup *b);
+    int fd_backup_dup2(struct fd_backup *b, int src, int fd);
+    void fd_backup_restore(struct fd_backup *b);
+
+    // stats.c
+    double now_seconds(void);
+    void stats_record(const char *name, double wall_sec, double spawn_sec,
+                      const struct rusage *ru);
+    void stats_print_json(FILE *out);
+    void stats_reset(void);
+    int builtin_stats(char **args);
+    void time_begin(struct time_mark *mark);
+    void time_end(const struct time_mark *mark);
+
+    // utilities.c
+    int builtin_echo(char **args);
+    int builtin_printf(char **args);
+    int builtin_test(char **args);
+    int builtin_true(char **args);
+    int builtin_false(char **args);
+    int builtin_pwd(char **args);
+
+    // limits.c
+    int builtin_ulimit(char **args);
+    int timeout_prefix(char **args, struct timeout *t);
+
+    // trace.c
+    int trace_open(const char *path);
+    void trace_begin(struct trace_mark *mark, const char *name);
+    void trace_end(const struct trace_mark *mark, enum trace_kind kind);
+    void trace_process_start(pid_t pid, const char *name);
+    void trace_process_end(pid_t pid);
+    void trace_flush(void);
+    void trace_close(void);
+
+    // pathcache.c
+    const char *find_command(const char *name);
+    void path_cache_forget(const char *name);
+    void path_cache_clear(void);
+    void path_cache_print(void);
+
+    // lineedit.c
+    char *line_edit(const char *prompt);
+
+    // complete.c
+    void complete_index_check(void);
+    int complete_index_pending(void);
+    void complete_index_work(size_t budget);
+    long complete_commands(const char *prefix, struct arg_vec *out);
+    long complete_files(const char *prefix, struct arg_vec *out);
+
+    // astcache.c
+    int ast_cache_open(const char *path, const char *src, size_t len);
+    int ast_cache_next(struct ast *view, size_t *resume);
+    void ast_cache_add(const struct ast *ast, size_t end);
+    void ast_cache_stop(void);
+    void ast_cache_close(void);
 
 #endif
 
@@ -33,41 +396,207 @@ FUNCTION DECLARATIONS:
    - Returns: void (nothing)
    - Used for: Cleaning user input from fgets()
 
-2. char **parse_line(char *line)
-   - Purpose: Splits a command line into individual arguments
+2. int ast_parse(struct ast *ast, const char *src, size_t len)
+   - Purpose: Parses a command line (quotes, escapes, |, &&, ||, ;, &,
+     redirections) into a syntax tree stored in two flat arrays
    - Parameters:
-     * char *line: A pointer to the input string to be parsed
-   - Returns: char ** (double pointer - array of string pointers)
-   - Used for: Converting "ls -l file.txt" into ["ls", "-l", "file.txt", NULL]
+     * struct ast *ast: Tree to fill; its arrays are reused between calls
+     * const char *src, size_t len: The text to parse (left unchanged)
+   - Returns: int (PARSE_OK, PARSE_INCOMPLETE if the command continues on
+     the next line, or PARSE_ERROR after printing a syntax error)
+   - Related: ast_free() releases the arrays
 
-3. void free_args(char **args)
-   - Purpose: Deallocates memory allocated for command arguments
-   - Parameters:
-     * char **args: Double pointer to array of strings
-   - Returns: void (nothing)
-   - Used for: Preventing memory leaks by freeing dynamically allocated memory
+3. int eval_ast(const struct ast *ast)
+   - Purpose: Runs a parsed line: lists, && and || chains, background jobs
+   - Returns: int (exit status of the last pipeline that ran, also $? from
+     then on: eval_status())
+   - Related: exit_status() turns a wait status into an exit status
+     (0-255, 128 + signal number for a killed process)
+   - Related: eval_compound() runs an if, while, until, for or { } command
+     (or defines a function); eval_function() calls a function defined
+     with "name() { ... }", and eval_arg()/eval_argc() give its arguments
+     to $1 and $#; builtin_break(), builtin_continue() and builtin_return()
+     implement "break", "continue" and "return"
 
 4. int is_builtin(char **args)
    - Purpose: Checks if a command is a built-in shell command
    - Parameters:
      * char **args: Array of command arguments
-   - Returns: int (1 if builtin, 0 if not)
+   - Returns: int (1 if builtin or the name of a running coprocess, 0 if not)
    - Used for: Determining whether to handle command internally or externally
 
-5. void run_builtin(char **args)
+5. int run_builtin(char **args)
    - Purpose: Executes built-in shell commands (like cd, exit)
    - Parameters:
      * char **args: Array of command arguments
-   - Returns: void (nothing)
+   - Returns: int (the builtin's exit status)
+   - Related: lookup_builtin() finds the table entry of a name with one
+     perfect-hash lookup; builtins are registered in builtins.def
    - Used for: Handling commands that don't require external programs
 
-6. void execute_command(char **args)
+6. int execute_command(char **args)
    - Purpose: Executes external commands by creating new processes
    - Parameters:
      * char **args: Array of command arguments
-   - Returns: void (nothing)
+   - Returns: int (the child's wait status)
+   - Related: wait_process() waits for one child with wait4() and records
+     its statistics in stats mode
    - Used for: Running system programs like ls, cat, grep, etc.
 
+7. pid_t launch_command(char **args, const struct launch_opts *opts)
+   - Purpose: Starts an external program without waiting for it
+   - Parameters:
+     * const struct launch_opts *opts: stdin/stdout descriptors, process
+       group and terminal handoff for the child, or NULL to inherit the
+       shell's
+   - Returns: pid_t (child process ID, or -1 on failure)
+   - Used for: Sharing the spawn step between execute_command(), pipelines
+     and benchmarks
+
+8. int set_launch_mode(const char *name)
+   - Purpose: Chooses how external programs are started
+   - Parameters:
+     * const char *name: "spawn" (posix_spawn, default) or "fork"
+   - Returns: int (0 on success, -1 for an unknown name)
+
+9. const char *find_command(const char *name)
+   - Purpose: Resolves a command name to an absolute path using a cache
+   - Returns: const char * (path owned by the cache, or NULL if not found)
+   - Related: path_cache_forget(), path_cache_clear() and path_cache_print()
+     remove one entry, remove all entries, and list entries ("hash" builtin)
+
+10. int execute_pipeline(const struct ast *ast, const struct node *pipeline,
+                         int background)
+   - Purpose: Runs one pipeline of a parsed line ("a | b | c")
+   - Returns: int (exit status of the last stage; 0 in the background)
+   - Related: arg_vec_reserve() grows the reusable argv array the stages
+     are built in
+   - Related: int builtin_tee(char **args) implements the "tee" builtin,
+     copying pipe data with splice()/tee() instead of read()/write()
+
+11. char *reader_next_line(struct line_reader *r)
+   - Purpose: Returns the next input line (newline removed) from a reader
+   - Returns: char * pointing into the reader's buffer, or NULL at the end
+   - Related: reader_open_fd(), reader_open_file() and reader_open_string()
+     read from a descriptor, a script file or a "-c" string;
+     reader_close() releases the reader
+
+12. int jobs_poll(int timeout_ms)
+   - Purpose: Reaps finished background processes, waiting up to timeout_ms
+   - Returns: int (number of processes reaped)
+   - Related: job_start() registers a background job, jobs_active() counts
+     running jobs, jobs_notify() reports finished ones, jobs_wait_all() and
+     builtin_wait() implement "wait"; job_wait_foreground() waits for a
+     foreground job and keeps it as a stopped job after Ctrl-Z;
+     builtin_jobs(), builtin_fg() and builtin_bg() implement job control
+
+13. void stats_record(const char *name, double wall_sec, double spawn_sec,
+                     const struct rusage *ru)
+   - Purpose: Adds one finished process to the per-command statistics
+   - Related: stats_print_json(), stats_reset() and builtin_stats() show and
+     clear them ("stats" builtin); time_begin()/time_end() implement the
+     "time" prefix; now_seconds() reads the monotonic clock
+
+14. int redir_vec_add(struct redir_vec *v, int fd, enum redir_op op, const char *word)
+   - Purpose: Adds one parsed redirection ("< in", "> out", "2>&1",
+     "<<< text") to a command's redirection list
+   - Returns: int (0, or -1 if out of memory)
+   - Related: redirects_open() opens the files, redirects_apply() performs
+     them in a forked child, redirects_close() closes the shell's copies;
+     fd_backup_*() redirect and restore the shell's own descriptors around
+     a builtin
+
+15. char *history_expand(char *line)
+   - Purpose: Replaces "!!", "!N", "!-N" and "!prefix" words with entries
+     from the command history
+   - Returns: char * (line itself, the expanded line, or NULL if an entry
+     was not found)
+   - Related: history_open() maps the history file, history_add() appends
+     to it, history_entry()/history_count() read entries,
+     history_find_prefix()/history_find_substring() search them,
+     builtin_history() implements "history"
+
+16. int coproc_request(char **args)
+   - Purpose: Sends a request line to a running coprocess and copies its
+     reply to stdout
+   - Returns: int (0, or 1 if the worker failed and was closed)
+   - Related: builtin_coproc() starts, lists and closes workers;
+     is_coproc() tells is_builtin() that a command word names one
+
+17. const char *var_get(const char *name)
+   - Purpose: Returns the value of a shell variable, or NULL if unset
+   - Related: var_set()/var_assign()/var_unset() change variables,
+     builtin_export()/builtin_unset() implement "export" and "unset", and
+     vars_environ() returns the environment for exec, rebuilt only after
+     an exported variable changed
+
+18. int expand_word(const struct ast *ast, const struct node *word,
+                    struct arg_vec *out)
+   - Purpose: Replaces $NAME, ${NAME} and $(command) in a parsed word and
+     appends the resulting fields to out; words without expansions are
+     passed through
+   - Returns: int (0, or -1 after printing an error)
+   - Related: expand_string() (assignments, no splitting), expand_target()
+     (redirection targets), expand_reset() frees the previous pipeline's
+     strings
+
+19. int glob_fields(struct arg_vec *v, size_t start)
+   - Purpose: Replaces the patterns among the fields v->argv[start..]
+     ("*.c", "[ab]?") with the file names they match, in sorted order
+   - Returns: int (0, or -1 if memory ran out)
+   - Related: glob_expand() matches one pattern; directory listings are
+     cached until the directory's mtime changes, glob_cache_clear() drops
+     them ("hash -r")
+
+20. char *line_edit(const char *prompt)
+   - Purpose: Reads one line from the terminal with editing, history
+     (Up/Down, Ctrl-R) and Tab completion, redrawing with one write()
+   - Returns: char * (the line without '\n', valid until the next call),
+     or NULL at end of input
+   - Related: complete_commands() and complete_files() find the Tab
+     candidates; complete_index_check()/complete_index_work() keep the
+     index of PATH programs up to date while the prompt is idle
+
+21. int ast_cache_open(const char *path, const char *src, size_t len)
+   - Purpose: Looks for saved syntax trees of the script file path whose
+     text is src; starts saving them if there are none
+   - Returns: int (1 if a valid cache was mapped and ast_cache_next() hands
+     out its commands, 0 if the script has to be parsed)
+   - Related: ast_cache_add() saves a parsed command, ast_cache_stop()
+     stops saving at a syntax error, ast_cache_close() writes the file
+
+22. int builtin_test(char **args)
+   - Purpose: Evaluates a "test" or "[ ... ]" expression in the shell
+   - Returns: int (0 true, 1 false, 2 after a syntax error)
+   - Related: builtin_echo(), builtin_printf(), builtin_true(),
+     builtin_false() and builtin_pwd() replace the programs of the same
+     names; their output waits in stdout's buffer until a program starts
+     (builtin_output_done())
+
+23. int trace_open(const char *path)
+   - Purpose: Starts "--trace FILE": from now on parsing, builtins,
+     launches, child processes and waits are recorded as spans in Chrome
+     trace JSON
+   - Returns: int (0, or -1 if the file could not be created)
+   - Related: trace_begin()/trace_end() time a span of the shell,
+     trace_process_start()/trace_process_end() a child's lifetime;
+     trace_flush() writes the buffered events, trace_close() ends the file
+
+24. int timeout_prefix(char **args, struct timeout *t)
+   - Purpose: Recognizes "timeout [-k d] [-s sig] duration" in front of a
+     command and fills in t
+   - Returns: int (number of words to skip, 0 if there is no prefix, -1
+     after a usage error)
+   - Related: job_timer_add() schedules the signal for the started
+     process on the timerfd of jobs.c; job_wait_timed() waits for a
+     foreground process while timers run; builtin_ulimit() implements
+     "ulimit"
+
+LAUNCH MODES:
+- enum launch_mode lists the available backends (LAUNCH_SPAWN, LAUNCH_FORK)
+- extern enum launch_mode launch_mode: the active backend, defined in
+  executor.c. "extern" declares a global variable that lives in another file.
+
 POINTERS EXPLAINED:
 A pointer is a variable that stores the memory address of another variable.
 Think of it like a house address - it tells you where to find something.
@@ -82,16 +611,52 @@ Example:
     int *ptr = &x;  // ptr stores the address of x
     printf("%d", *ptr);  // Prints 42 (the value x points to)
 
+GLOBAL STATE:
+- int shell_interactive (defined in jobs.c, set by main.c): 1 when reading commands from
+  a terminal. Prompts and the "Goodbye!" message are only printed then.
+- int stats_enabled (defined in stats.c): 1 while every process is
+  recorded for the "stats" builtin
+- int trace_enabled (defined in trace.c): 1 while spans go to the
+  --trace file; the hooks in other modules test it before reading the
+  clock
+- int shell_max_jobs (defined in jobs.c, set by main.c): N from "-j N", 0 otherwise. When
+  set, command lines run as background jobs with at most N at a time.
+- int job_tty (defined in jobs.c): the terminal the shell shares with its
+  foreground job, or -1 when job control is off (scripts, pipes)
+- sigset_t job_sigmask / job_sigdefault (jobs.c): the signal mask and the
+  signal dispositions the shell changed for itself, which every child gets
+  back before it runs a program
+
 CONSTANTS DEFINED:
-- MAX_LINE (1024): Maximum length of a command line input
-- MAX_ARGS (64): Maximum number of arguments in a single command
+- ARGS_INITIAL_CAP (64): Starting size of an argument vector. It is not a
+  limit: lines and argument lists grow their buffers as needed.
+
+PARSING: THE LEXER AND THE FLAT AST:
+A line is not split into words with strtok(). ast_parse() (parser.c) runs
+a lexer that reads it byte by byte and hands out tokens: words, the
+operators | && || ; & and the redirections. Quotes, backslashes, $NAME and
+$(...) are handled while a word is read. Quote characters are removed.
+What has to be expanded when the command runs is marked with the CTL_*
+bytes above. The lexer keeps its position in the parser struct, not in
+hidden static state like strtok(), so it is re-entrant.
+The parser builds the tree from those tokens into struct ast:
+- nodes is one array of struct node. A node names its first child and its
+  next sibling by index, not by pointer, so the array can grow with
+  realloc() and be written to the AST cache file as it is (astcache.c)
+- nodes[0] is the NODE_LIST of the line. Children always come after their
+  parent, so every link points forward
+- text holds the words one after the other, each '\0'-terminated. A
+  NODE_WORD's first and len give its offset and length there, so a word
+  with nothing to expand goes into argv without a copy
+The arrays are kept from one line to the next and only grow. eval.c walks
+the tree, and expand.c turns each word into the strings of argv.
 
 EXTERNAL FUNCTIONS USED:
 These functions are provided by the C standard library:
 
 From <stdio.h>:
 - printf(): Outputs formatted text to console
-- fgets(): Reads a line from input stream (safer than gets())
+- fflush(): Writes buffered output immediately
 - fprintf(): Outputs formatted text to a specific stream
 - perror(): Prints system error messages
 
@@ -99,24 +664,29 @@ From <stdlib.h>:
 - malloc(): Allocates dynamic memory on the heap
 - free(): Deallocates memory allocated by malloc()
 - exit(): Terminates the program with a status code
-- strdup(): Creates a copy of a string (allocates new memory)
 
 From <string.h>:
 - strcmp(): Compares two strings (returns 0 if equal)
 - strchr(): Finds first occurrence of a character in string
-- strtok(): Splits string into tokens using delimiters
+- memcpy(): Copies bytes; the lexer copies each word's text into the
+  tree's text buffer
 
 From <unistd.h>:
 - fork(): Creates a new process (child process)
-- execvp(): Replaces current process with new program
+- execve(): Replaces current process with the program at a given path
 - chdir(): Changes current working directory
 
 From <sys/wait.h>:
 - waitpid(): Waits for child process to finish and gets exit status
 
+From <spawn.h>:
+- posix_spawn(): Starts a new program in a child process in one call
+
 MEMORY MANAGEMENT:
 C requires manual memory management. Every malloc() should have a corresponding 
 free() to prevent memory leaks. This shell properly manages memory by:
-1. Allocating memory for argument arrays in parse_line()
-2. Freeing that memory in free_args() after command execution
+1. Keeping the syntax tree of ast_parse() and the argument vectors of
+   execute_pipeline() from one line to the next, so they only grow and
+   ordinary lines allocate nothing
+2. Freeing the tree with ast_free() when the shell exits
 */
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "shell.h"
+
+#define HIST_BUCKETS 32
+
+// Durations in microseconds, bucket i counts values in [2^i, 2^(i+1))
+struct histogram {
+    unsigned long count;
+    double total_us;
+    double max_us;
+    unsigned long buckets[HIST_BUCKETS];
+};
+
+struct cmd_stats {
+    char *name;                 // NULL for an empty slot
+    struct histogram wall;      // start to exit
+    struct histogram spawn;     // start until the program was exec'd
+    double user_us;
+    double sys_us;
+    long max_rss_kb;
+};
+
+int stats_enabled = 0;
+
+static struct cmd_stats *table = NULL;
+static size_t table_cap = 0;    // always a power of two
+static size_t table_used = 0;
+
+double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double timeval_us(struct timeval tv) {
+    return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+static size_t hash_name(const char *s) {
+    // FNV-1a
+    size_t h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static struct cmd_stats *find_slot(struct cmd_stats *t, size_t cap, const char *name) {
+    size_t i = hash_name(name) & (cap - 1);
+
+    while (t[i].name && strcmp(t[i].name, name) != 0) {
+        i = (i + 1) & (cap - 1);
+    }
+    return &t[i];
+}
+
+static int grow_table(void) {
+    size_t new_cap = table_cap ? table_cap * 2 : 32;
+    struct cmd_stats *new_table = calloc(new_cap, sizeof(*new_table));
+    if (!new_table) return -1;
+
+    for (size_t i = 0; i < table_cap; i++) {
+        if (table[i].name) {
+            *find_slot(new_table, new_cap, table[i].name) = table[i];
+        }
+    }
+    free(table);
+    table = new_table;
+    table_cap = new_cap;
+    return 0;
+}
+
+static void hist_add(struct histogram *h, double us) {
+    int bucket = 0;
+
+    while (bucket < HIST_BUCKETS - 1 && us >= (double)(2UL << bucket)) {
+        bucket++;
+    }
+    h->buckets[bucket]++;
+    h->count++;
+    h->total_us += us;
+    if (us > h->max_us) h->max_us = us;
+}
+
+void stats_record(const char *name, double wall_sec, double spawn_sec,
+                  const struct rusage *ru) {
+    if ((table_used + 1) * 4 > table_cap * 3 && grow_table() != 0) return;
+
+    struct cmd_stats *s = find_slot(table, table_cap, name);
+    if (!s->name) {
+        s->name = strdup(name);
+        if (!s->name) return;
+        table_used++;
+    }
+
+    hist_add(&s->wall, wall_sec * 1e6);
+    if (spawn_sec >= 0) hist_add(&s->spawn, spawn_sec * 1e6);
+    if (ru) {
+        s->user_us += timeval_us(ru->ru_utime);
+        s->sys_us += timeval_us(ru->ru_stime);
+        if (ru->ru_maxrss > s->max_rss_kb) s->max_rss_kb = ru->ru_maxrss;
+    }
+}
+
+void stats_reset(void) {
+    for (size_t i = 0; i < table_cap; i++) {
+        free(table[i].name);
+    }
+    memset(table, 0, table_cap * sizeof(*table));
+    table_used = 0;
+}
+
+static void print_json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fprintf(out, "\\%c", *s);
+        } else if ((unsigned char)*s < 0x20) {
+            fprintf(out, "\\u%04x", *s);
+        } else {
+            fputc(*s, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void print_histogram(FILE *out, const struct histogram *h) {
+    fprintf(out, "{\"count\": %lu, \"total_us\": %.0f, \"mean_us\": %.1f, \"max_us\": %.0f, \"buckets\": [",
+            h->count, h->total_us, h->count ? h->total_us / h->count : 0.0, h->max_us);
+
+    // only non-empty buckets, as [lower bound in us, count] pairs
+    int first = 1;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        if (!h->buckets[b]) continue;
+        fprintf(out, "%s[%lu, %lu]", first ? "" : ", ", b ? 1UL << b : 0UL, h->buckets[b]);
+        first = 0;
+    }
+    fprintf(out, "]}");
+}
+
+void stats_print_json(FILE *out) {
+    int first = 1;
+
+    fprintf(out, "{\"commands\": [");
+    for (size_t i = 0; i < table_cap; i++) {
+        const struct cmd_stats *s = &table[i];
+        if (!s->name) continue;
+
+        fprintf(out, "%s\n  {\"name\": ", first ? "" : ",");
+        print_json_string(out, s->name);
+        fprintf(out, ", \"user_us\": %.0f, \"sys_us\": %.0f, \"max_rss_kb\": %ld,\n   \"wall\": ",
+                s->user_us, s->sys_us, s->max_rss_kb);
+        print_histogram(out, &s->wall);
+        fprintf(out, ",\n   \"spawn\": ");
+        print_histogram(out, &s->spawn);
+        fprintf(out, "}");
+        first = 0;
+    }
+    fprintf(out, "%s]}\n", first ? "" : "\n");
+}
+
+int builtin_stats(char **args) {
+    if (!args[1]) {
+        stats_print_json(stdout);
+    } else if (strcmp(args[1], "on") == 0) {
+        stats_enabled = 1;
+    } else if (strcmp(args[1], "off") == 0) {
+        stats_enabled = 0;
+    } else if (strcmp(args[1], "-r") == 0) {
+        stats_reset();
+    } else {
+        fprintf(stderr, "usage: stats [on | off | -r]\n");
+        return 2;
+    }
+    return 0;
+}
+
+void time_begin(struct time_mark *mark) {
+    getrusage(RUSAGE_SELF, &mark->self);
+    getrusage(RUSAGE_CHILDREN, &mark->children);
+    mark->wall = now_seconds();
+}
+
+static void print_duration(const char *label, double sec) {
+    int minutes = (int)(sec / 60);
+    fprintf(stderr, "%s\t%dm%.3fs\n", label, minutes, sec - minutes * 60);
+}
+
+void time_end(const struct time_mark *mark) {
+    struct rusage self, children;
+    double wall = now_seconds() - mark->wall;
+
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+
+    double user = timeval_us(self.ru_utime) - timeval_us(mark->self.ru_utime) +
+                  timeval_us(children.ru_utime) - timeval_us(mark->children.ru_utime);
+    double sys = timeval_us(self.ru_stime) - timeval_us(mark->self.ru_stime) +
+                 timeval_us(children.ru_stime) - timeval_us(mark->children.ru_stime);
+
+    fprintf(stderr, "\n");
+    print_duration("real", wall);
+    print_duration("user", user / 1e6);
+    print_duration("sys", sys / 1e6);
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+STATS MODULE EXPLANATION:
+Measures what each command costs, so slow commands in long scripts can be
+found. Two features share this module:
+
+1. "time COMMAND" prints how long one command line took (like bash):
+       real    0m0.102s     wall-clock time
+       user    0m0.051s     CPU time spent in user mode
+       sys     0m0.020s     CPU time spent in the kernel
+   time_begin() takes a snapshot of the clock and of getrusage() for the
+   shell (RUSAGE_SELF, covers builtins) and for its waited-for children
+   (RUSAGE_CHILDREN); time_end() prints the differences.
+
+2. Stats mode ("stats on", or MINI_SHELL_STATS=1 in the environment) records
+   every external process when it is reaped. "stats" prints the collected
+   data as JSON, "stats -r" clears it, "stats off" stops recording.
+
+WHAT IS RECORDED PER COMMAND NAME:
+- wall: time from just before launch until the process was reaped
+- spawn: time from just before launch until the new program was running
+  (posix_spawn() returns after exec; the fork backend waits for its
+  close-on-exec pipe to close). Unknown for background jobs.
+- user_us / sys_us: total CPU time from the rusage filled in by wait4()
+- max_rss_kb: the largest peak resident memory seen (ru_maxrss)
+
+HISTOGRAMS:
+Durations go into 32 logarithmic buckets: bucket i counts durations of at
+least 2^i microseconds and less than 2^(i+1). The JSON lists only non-empty
+buckets as [lower_bound_us, count] pairs, e.g. [512, 40] means 40 runs took
+between 0.5 and 1 ms. Logarithmic buckets cover microseconds to hours with a
+fixed, small amount of memory per command.
+
+The per-command table is an open-addressing hash table, the same design as
+the path cache (pathcache.c).
+
+EXTERNAL FUNCTIONS USED:
+- clock_gettime(CLOCK_MONOTONIC, &ts): steady clock for measuring durations
+- getrusage(who, &ru): CPU times and peak memory of the shell or its children
+- wait4(pid, &status, options, &ru): waitpid() that also fills a struct
+  rusage for the reaped child (used in executor.c and jobs.c)
+*/
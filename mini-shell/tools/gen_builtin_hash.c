@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <string.h>
+#include "../builtin_hash.h"
+
+// Build: cc -o gen_builtin_hash tools/gen_builtin_hash.c
+// Usage: ./gen_builtin_hash > builtin_table.h
+
+static const char *names[] = {
+#define BUILTIN(name, handler) #name,
+#include "../builtins.def"
+#undef BUILTIN
+};
+
+#define COUNT (sizeof(names) / sizeof(names[0]))
+
+int main(void) {
+    unsigned slots = 1;
+    signed char index[256];
+
+    // at least twice as many slots as names keeps the seed search short
+    while (slots < 2 * COUNT) slots *= 2;
+    if (slots > sizeof(index)) {
+        fprintf(stderr, "too many builtins\n");
+        return 1;
+    }
+
+    for (unsigned seed = 1; seed != 0; seed++) {
+        int perfect = 1;
+
+        memset(index, -1, sizeof(index));
+        for (unsigned i = 0; i < COUNT && perfect; i++) {
+            unsigned slot = builtin_name_hash(names[i], seed) & (slots - 1);
+            if (index[slot] >= 0) perfect = 0;
+            index[slot] = (signed char)i;
+        }
+        if (!perfect) continue;
+
+        printf("/* Generated by tools/gen_builtin_hash.c from builtins.def. Do not edit. */\n");
+        printf("#define BUILTIN_COUNT %u\n", (unsigned)COUNT);
+        printf("#define BUILTIN_SLOTS %u\n", slots);
+        printf("#define BUILTIN_SEED %uu\n\n", seed);
+        printf("// slot -> position in builtins.def, -1 for an empty slot\n");
+        printf("static const signed char builtin_slot_index[BUILTIN_SLOTS] = {");
+        for (unsigned s = 0; s < slots; s++) {
+            printf("%s%d,", s % 16 ? " " : "\n    ", index[s]);
+        }
+        printf("\n};\n");
+        return 0;
+    }
+    fprintf(stderr, "no perfect seed found\n");
+    return 1;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+BUILTIN HASH GENERATOR EXPLANATION:
+Writes builtin_table.h, the perfect hash used by lookup_builtin() in
+builtins.c. "Perfect" means every builtin name lands in its own slot, so a
+lookup is one hash, one array read and one strcmp(), no matter how many
+builtins exist.
+
+HOW IT WORKS:
+- The names come from builtins.def through the same X macro builtins.c uses,
+  so both always see the same list in the same order
+- The table gets the next power of two >= 2 * number of builtins slots
+- Seeds 1, 2, 3, ... are tried until
+  builtin_name_hash(name, seed) & (slots - 1)
+  gives a different slot for every name
+- The seed and the slot -> builtin index table are printed as C code
+
+builtins.c checks BUILTIN_COUNT against its own table with _Static_assert,
+so forgetting to regenerate after editing builtins.def fails the build.
+*/
@@ -0,0 +1,308 @@
+#define _GNU_SOURCE
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "shell.h"
+
+#define TRACE_RING 4096         // events held before they must be written
+#define TRACE_OUT_SIZE 65536    // formatted JSON collected per write()
+#define TRACE_EVENT_MAX 512     // longest formatted event, with its name escaped
+
+struct trace_event {
+    double start;
+    double end;
+    pid_t track;                // 0 for the shell itself, else a child process
+    unsigned char kind;         // enum trace_kind
+    char name[TRACE_NAME_MAX];
+};
+
+// A child started but not reaped yet; its exec span ends when it is
+struct trace_proc {
+    pid_t pid;
+    double start;
+    char name[TRACE_NAME_MAX];
+};
+
+int trace_enabled = 0;
+
+static const char *const kind_names[] = {"parse", "builtin", "spawn", "exec", "wait"};
+
+static int trace_fd = -1;
+static pid_t trace_pid;         // the shell; forked copies never write
+static double trace_t0;         // ts 0 in the file
+
+// Events are added at head and written from tail; both only grow, the
+// slot is the index modulo TRACE_RING
+static struct trace_event ring[TRACE_RING];
+static unsigned long ring_head = 0;
+static unsigned long ring_tail = 0;
+
+static struct trace_proc *procs = NULL;
+static size_t procs_len = 0;
+static size_t procs_cap = 0;
+
+static char out[TRACE_OUT_SIZE];
+static size_t out_len = 0;
+
+// Copies at most TRACE_NAME_MAX - 1 bytes, not cutting a UTF-8 character
+static void copy_name(char *dst, const char *src) {
+    size_t len = strnlen(src, TRACE_NAME_MAX);
+
+    if (len == TRACE_NAME_MAX) {
+        len--;
+        while (len > 0 && ((unsigned char)src[len] & 0xc0) == 0x80) len--;
+    }
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static void out_write(void) {
+    size_t done = 0;
+
+    while (done < out_len) {
+        ssize_t n = write(trace_fd, out + done, out_len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;      // a full disk loses the rest of the batch
+        done += (size_t)n;
+    }
+    out_len = 0;
+}
+
+static void out_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static void out_printf(const char *format, ...) {
+    va_list ap;
+
+    va_start(ap, format);
+    int n = vsnprintf(out + out_len, TRACE_OUT_SIZE - out_len, format, ap);
+    va_end(ap);
+    if (n > 0) out_len += (size_t)n < TRACE_OUT_SIZE - out_len ? (size_t)n : 0;
+}
+
+static void out_str(const char *s) {
+    size_t len = strlen(s);
+    memcpy(out + out_len, s, len);
+    out_len += len;
+}
+
+static void out_uint(unsigned long long v) {
+    char digits[24];
+    int n = 0;
+
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n > 0) out[out_len++] = digits[--n];
+}
+
+// Seconds as microseconds with three decimals ("1520.118"). printf("%.3f")
+// would do, but costs more than the rest of the event together.
+static void out_us(double sec) {
+    unsigned long long ns = sec > 0 ? (unsigned long long)(sec * 1e9 + 0.5) : 0;
+    unsigned frac = (unsigned)(ns % 1000);
+
+    out_uint(ns / 1000);
+    out[out_len++] = '.';
+    out[out_len++] = (char)('0' + frac / 100);
+    out[out_len++] = (char)('0' + frac / 10 % 10);
+    out[out_len++] = (char)('0' + frac % 10);
+}
+
+// Appends name as the inside of a JSON string
+static void out_name(const char *name) {
+    static const char hex[] = "0123456789abcdef";
+
+    for (const unsigned char *s = (const unsigned char *)name; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            out[out_len++] = '\\';
+            out[out_len++] = (char)*s;
+        } else if (*s < 0x20) {
+            out_str("\\u00");
+            out[out_len++] = hex[*s >> 4];
+            out[out_len++] = hex[*s & 15];
+        } else {
+            out[out_len++] = (char)*s;
+        }
+    }
+}
+
+// ,"pid":P,"tid":T
+static void out_ids(pid_t tid) {
+    out_str(",\"pid\":");
+    out_uint((unsigned long long)trace_pid);
+    out_str(",\"tid\":");
+    out_uint((unsigned long long)tid);
+}
+
+static void out_event(const struct trace_event *e) {
+    pid_t tid = e->track ? e->track : trace_pid;
+
+    // every event follows the metadata written by trace_open()
+    if (out_len + TRACE_EVENT_MAX > TRACE_OUT_SIZE) out_write();
+
+    // a child gets a track of its own, named after the command
+    if (e->kind == TRACE_EXEC) {
+        out_str(",\n{\"name\":\"thread_name\",\"ph\":\"M\"");
+        out_ids(tid);
+        out_str(",\"args\":{\"name\":\"");
+        out_name(e->name);
+        out[out_len++] = ' ';
+        out_uint((unsigned long long)tid);
+        out_str("\"}}");
+    }
+    out_str(",\n{\"name\":\"");
+    out_name(e->name);
+    out_str("\",\"cat\":\"");
+    out_str(kind_names[e->kind]);
+    out_str("\",\"ph\":\"X\",\"ts\":");
+    out_us(e->start - trace_t0);
+    out_str(",\"dur\":");
+    out_us(e->end - e->start);
+    out_ids(tid);
+    out[out_len++] = '}';
+}
+
+void trace_flush(void) {
+    if (trace_fd < 0 || getpid() != trace_pid) return;
+    while (ring_tail != ring_head) {
+        out_event(&ring[ring_tail % TRACE_RING]);
+        ring_tail++;
+    }
+    out_write();
+}
+
+static void add_event(enum trace_kind kind, const char *name, pid_t track,
+                      double start, double end) {
+    // a full ring is written out right away; normally that happens while
+    // the shell waits for a program anyway (wait_process())
+    if (ring_head - ring_tail == TRACE_RING) trace_flush();
+
+    struct trace_event *e = &ring[ring_head % TRACE_RING];
+    e->start = start;
+    e->end = end;
+    e->track = track;
+    e->kind = (unsigned char)kind;
+    memcpy(e->name, name, TRACE_NAME_MAX);
+    ring_head++;
+}
+
+void trace_begin(struct trace_mark *mark, const char *name) {
+    copy_name(mark->name, name);
+    mark->start = now_seconds();
+}
+
+void trace_end(const struct trace_mark *mark, enum trace_kind kind) {
+    add_event(kind, mark->name, 0, mark->start, now_seconds());
+}
+
+void trace_process_start(pid_t pid, const char *name) {
+    if (procs_len == procs_cap) {
+        size_t cap = procs_cap ? procs_cap * 2 : 16;
+        struct trace_proc *grown = realloc(procs, cap * sizeof(*grown));
+        if (!grown) return;     // the process just gets no track
+        procs = grown;
+        procs_cap = cap;
+    }
+    struct trace_proc *p = &procs[procs_len++];
+    p->pid = pid;
+    p->start = now_seconds();
+    copy_name(p->name, name);
+}
+
+void trace_process_end(pid_t pid) {
+    for (size_t i = 0; i < procs_len; i++) {
+        if (procs[i].pid != pid) continue;
+        add_event(TRACE_EXEC, procs[i].name, pid, procs[i].start, now_seconds());
+        procs[i] = procs[--procs_len];
+        return;
+    }
+}
+
+void trace_close(void) {
+    if (trace_fd < 0 || getpid() != trace_pid) return;
+    trace_flush();
+    out_printf("\n]\n");
+    out_write();
+    close(trace_fd);
+    trace_fd = -1;
+    trace_enabled = 0;
+}
+
+int trace_open(const char *path) {
+    trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (trace_fd < 0) {
+        perror(path);
+        return -1;
+    }
+    trace_pid = getpid();
+    trace_t0 = now_seconds();
+    out_printf("[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+               "\"args\":{\"name\":\"mini-shell\"}},\n"
+               "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+               "\"args\":{\"name\":\"shell\"}}",
+               (int)trace_pid, (int)trace_pid, (int)trace_pid, (int)trace_pid);
+    trace_enabled = 1;
+    atexit(trace_close);
+    return 0;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+TRACE MODULE EXPLANATION:
+"mini-shell --trace FILE script" writes a timeline of the run to FILE in
+the Chrome trace event format. Open it in https://ui.perfetto.dev or
+chrome://tracing to see where a long script spends its time. Each span
+is one "complete" event:
+    {"name":"ls","cat":"spawn","ph":"X","ts":1520.118,"dur":84.310,
+     "pid":4711,"tid":4711}
+ts (start) and dur are microseconds since the trace was opened.
+
+SPANS ("cat"):
+- parse:   ast_parse() of a command line (main.c); commands replayed
+           from the AST cache (astcache.c) are not parsed and have none
+- builtin: a builtin or shell function run by the shell (run_builtin());
+           the commands of a function nest inside its span
+- spawn:   launch_command() starting a program, up to its exec
+- exec:    a child process, from its start until it was reaped
+- wait:    the shell blocked until a foreground process exited, or until
+           a $(...) command's output ended
+The shell's spans are on one track (tid = the shell's pid). Every child
+gets a track of its own (tid = its pid), named with a "thread_name"
+metadata event, so the stages of a pipeline and parallel "-j N" jobs show
+up side by side. Commands run by forked copies of the shell (functions in
+pipelines, $(a; b), "a && b &") are shown as one exec span of that copy:
+only the shell itself writes the file.
+
+KEEPING THE COST LOW:
+A span costs two clock_gettime() calls (through the vDSO, no system call)
+and a copy of its name, truncated to TRACE_NAME_MAX - 1 bytes, into a ring
+of TRACE_RING events. Nothing is formatted or written at that point. The
+shell is single-threaded, so the ring needs no locks: events are added at
+ring_head and taken out at ring_tail.
+The ring is written out:
+- by trace_flush() just before the shell blocks waiting for a foreground
+  program, so formatting and write() overlap with the program's run
+- when it is full (loops of builtins that never wait)
+- when the shell exits (trace_close(), registered with atexit())
+Formatting collects up to TRACE_OUT_SIZE bytes before each write(). When
+tracing is off, each hook is one test of trace_enabled.
+
+FILE FORMAT:
+The file is one JSON array. trace_close() writes the closing "]"; a trace
+cut short by a crash still loads, since the viewers accept an unfinished
+array.
+
+EXTERNAL FUNCTIONS USED:
+- vsnprintf(buf, size, format, ap): printf() into a buffer
+- open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644): creates the
+  trace file; O_CLOEXEC keeps it out of launched programs
+- atexit(fn): runs trace_close() when the shell exits; getpid() tells a
+  forked copy, which also runs it, to leave the file alone
+*/
@@ -0,0 +1,602 @@
+#define _GNU_SOURCE
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include "shell.h"
+
+// Handles the escape after a backslash at p (echo -e, printf, %b) and
+// returns the text after it. Octal escapes are "\0nnn" in echo and %b, but
+// "\nnn" in a printf format. *stop is set by "\c" (not in a format): no
+// more output at all.
+static const char *put_escape(FILE *out, const char *p, int zero_octal, int *stop) {
+    int value = 0;
+    int digits = 0;
+
+    switch (*p) {
+    case 'a': putc('\a', out); return p + 1;
+    case 'b': putc('\b', out); return p + 1;
+    case 'e': putc('\033', out); return p + 1;
+    case 'f': putc('\f', out); return p + 1;
+    case 'n': putc('\n', out); return p + 1;
+    case 'r': putc('\r', out); return p + 1;
+    case 't': putc('\t', out); return p + 1;
+    case 'v': putc('\v', out); return p + 1;
+    case '\\': putc('\\', out); return p + 1;
+    case 'c':
+        if (!zero_octal) break;     // only echo and %b know "\c"
+        *stop = 1;
+        return p + 1;
+    case 'x':
+        while (digits < 2) {
+            char c = p[1 + digits];
+            int d = c >= '0' && c <= '9' ? c - '0' :
+                    c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+                    c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+            if (d < 0) break;
+            value = value * 16 + d;
+            digits++;
+        }
+        if (digits == 0) {
+            fputs("\\x", out);
+        } else {
+            putc(value, out);
+        }
+        return p + 1 + digits;
+    case '\0':
+        putc('\\', out);    // a backslash at the end stays
+        return p;
+    default:
+        if (zero_octal ? *p == '0' : (*p >= '0' && *p <= '7')) {
+            const char *d = zero_octal ? p + 1 : p;
+            while (digits < 3 && d[digits] >= '0' && d[digits] <= '7') {
+                value = value * 8 + (d[digits] - '0');
+                digits++;
+            }
+            putc(value & 0xff, out);
+            return d + digits;
+        }
+        break;
+    }
+    putc('\\', out);
+    putc(*p, out);
+    return p + 1;
+}
+
+// Writes s with its escapes replaced; returns 1 if "\c" stopped it
+static int put_escaped(FILE *out, const char *s, int zero_octal) {
+    int stop = 0;
+
+    while (*s && !stop) {
+        const char *bs = strchr(s, '\\');
+        size_t len = bs ? (size_t)(bs - s) : strlen(s);
+        fwrite(s, 1, len, out);
+        if (!bs) break;
+        s = put_escape(out, bs + 1, zero_octal, &stop);
+    }
+    return stop;
+}
+
+int builtin_true(char **args) {
+    (void)args;
+    return 0;
+}
+
+int builtin_false(char **args) {
+    (void)args;
+    return 1;
+}
+
+int builtin_pwd(char **args) {
+    static char cwd[PATH_MAX];
+
+    for (int i = 1; args[i]; i++) {
+        if (strcmp(args[i], "-L") != 0 && strcmp(args[i], "-P") != 0) {
+            fprintf(stderr, "pwd: %s: invalid option\n", args[i]);
+            return 2;
+        }
+    }
+    if (!getcwd(cwd, sizeof(cwd))) {
+        perror("pwd");
+        return 1;
+    }
+    puts(cwd);
+    return 0;
+}
+
+// "echo [-neE] args...": options are only recognised before the first
+// argument that is not made of n, e and E letters after a '-'
+int builtin_echo(char **args) {
+    int newline = 1;
+    int escapes = 0;
+    int i = 1;
+
+    for (; args[i] && args[i][0] == '-' && args[i][1]; i++) {
+        const char *o = args[i] + 1;
+        if (strspn(o, "neE") != strlen(o)) break;
+        for (; *o; o++) {
+            if (*o == 'n') newline = 0;
+            else escapes = *o == 'e';
+        }
+    }
+    for (int first = i; args[i]; i++) {
+        if (i > first) putchar(' ');
+        if (!escapes) {
+            fputs(args[i], stdout);
+        } else if (put_escaped(stdout, args[i], 1)) {
+            return 0;
+        }
+    }
+    if (newline) putchar('\n');
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// printf
+
+struct printf_args {
+    char **next;        // the next argument to convert
+    int used;           // 1 once a conversion took an argument
+    int status;         // 1 after an invalid number
+};
+
+static const char *next_arg(struct printf_args *pa) {
+    if (!*pa->next) return NULL;
+    pa->used = 1;
+    return *pa->next++;
+}
+
+// A number argument: C syntax (0x1f, 017, -3) or 'c for the code of c.
+// Invalid text is reported and converts as far as it is a number, as in
+// bash.
+static long long arg_integer(struct printf_args *pa) {
+    const char *s = next_arg(pa);
+    char *end;
+
+    if (!s || !*s) return 0;
+    if (*s == '\'' || *s == '"') return (unsigned char)s[1];
+    errno = 0;
+    long long value = strtoll(s, &end, 0);
+    if (end == s || *end || errno) {
+        fprintf(stderr, "printf: %s: invalid number\n", s);
+        pa->status = 1;
+    }
+    return value;
+}
+
+static double arg_double(struct printf_args *pa) {
+    const char *s = next_arg(pa);
+    char *end;
+
+    if (!s || !*s) return 0;
+    if (*s == '\'' || *s == '"') return (unsigned char)s[1];
+    double value = strtod(s, &end);
+    if (end == s || *end) {
+        fprintf(stderr, "printf: %s: invalid number\n", s);
+        pa->status = 1;
+    }
+    return value;
+}
+
+// Converts one "%..." directive at p (just after the '%') and returns the
+// text after it, or NULL for an invalid directive. *stop is set by a "\c"
+// inside a %b argument.
+static const char *put_directive(const char *p, struct printf_args *pa, int *stop) {
+    char spec[64];
+    size_t n = 0;
+    int star[2];
+    int nstar = 0;
+
+    spec[n++] = '%';
+    while (*p && strchr("-+ #0", *p) && n < 16) spec[n++] = *p++;
+    for (int part = 0; part < 2; part++) {
+        if (part == 1) {
+            if (*p != '.') break;
+            spec[n++] = *p++;
+        }
+        if (*p == '*') {
+            star[nstar++] = (int)arg_integer(pa);
+            spec[n++] = *p++;
+        } else {
+            while (*p >= '0' && *p <= '9' && n < 48) spec[n++] = *p++;
+        }
+    }
+
+    char conv = *p;
+    switch (conv) {
+    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+        spec[n++] = 'l';
+        spec[n++] = 'l';
+        spec[n++] = conv;
+        spec[n] = '\0';
+        long long value = arg_integer(pa);
+        if (nstar == 2) printf(spec, star[0], star[1], value);
+        else if (nstar == 1) printf(spec, star[0], value);
+        else printf(spec, value);
+        break;
+    case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+        spec[n++] = conv;
+        spec[n] = '\0';
+        double d = arg_double(pa);
+        if (nstar == 2) printf(spec, star[0], star[1], d);
+        else if (nstar == 1) printf(spec, star[0], d);
+        else printf(spec, d);
+        break;
+    case 's': case 'c': case 'b': {
+        const char *s = next_arg(pa);
+        char *expanded = NULL;
+        size_t size = 0;
+        if (!s) s = "";
+        if (conv == 'b') {
+            // the escapes are replaced first, so width and precision count
+            // the resulting bytes
+            if (n == 1) {
+                *stop = put_escaped(stdout, s, 1);
+                return p + 1;
+            }
+            FILE *mem = open_memstream(&expanded, &size);
+            if (!mem) {
+                perror("printf");
+                return NULL;
+            }
+            *stop = put_escaped(mem, s, 1);
+            fclose(mem);
+            s = expanded;
+        }
+        // %c prints the first character of its argument
+        if (conv == 'c' && *s) {
+            spec[n++] = '.';
+            spec[n++] = '1';
+        }
+        spec[n++] = 's';
+        spec[n] = '\0';
+        if (nstar == 2) printf(spec, star[0], star[1], s);
+        else if (nstar == 1) printf(spec, star[0], s);
+        else printf(spec, s);
+        free(expanded);
+        break;
+    }
+    default:
+        if (conv) fprintf(stderr, "printf: %c: invalid format character\n", conv);
+        else fprintf(stderr, "printf: missing format character\n");
+        return NULL;
+    }
+    return p + 1;
+}
+
+// "printf format [args...]": the format is reused while arguments remain
+int builtin_printf(char **args) {
+    int i = 1;
+
+    if (args[i] && strcmp(args[i], "--") == 0) i++;
+    if (!args[i]) {
+        fprintf(stderr, "printf: usage: printf format [arguments]\n");
+        return 2;
+    }
+
+    const char *format = args[i];
+    struct printf_args pa = {args + i + 1, 0, 0};
+    int stop = 0;
+    do {
+        pa.used = 0;
+        for (const char *p = format; *p && !stop;) {
+            if (*p == '%' && p[1] == '%') {
+                putchar('%');
+                p += 2;
+            } else if (*p == '%') {
+                p = put_directive(p + 1, &pa, &stop);
+                if (!p) return 1;
+            } else if (*p == '\\') {
+                p = put_escape(stdout, p + 1, 0, &stop);
+            } else {
+                const char *end = p + strcspn(p, "%\\");
+                fwrite(p, 1, (size_t)(end - p), stdout);
+                p = end;
+            }
+        }
+    } while (!stop && pa.used && *pa.next);
+    return pa.status;
+}
+
+// ---------------------------------------------------------------------------
+// test and [
+
+struct test_state {
+    const char *name;   // "test" or "[", for messages
+    char **argv;
+    int argc;
+    int pos;
+    int error;          // set after the first message
+};
+
+static int test_fail(struct test_state *t, const char *what, const char *arg) {
+    if (!t->error) {
+        if (arg) fprintf(stderr, "%s: %s: %s\n", t->name, arg, what);
+        else fprintf(stderr, "%s: %s\n", t->name, what);
+    }
+    t->error = 1;
+    return 0;
+}
+
+static int is_unary_op(const char *s) {
+    return s[0] == '-' && s[1] && !s[2] && strchr("bcdefghknprsStuwxzGLO", s[1]);
+}
+
+static const char *const binary_ops[] = {
+    "=", "==", "!=", "<", ">", "-eq", "-ne", "-lt", "-le", "-gt", "-ge",
+    "-nt", "-ot", "-ef", NULL
+};
+
+static int is_binary_op(const char *s) {
+    for (int i = 0; binary_ops[i]; i++) {
+        if (strcmp(s, binary_ops[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static long long test_integer(struct test_state *t, const char *s) {
+    char *end;
+
+    errno = 0;
+    long long value = strtoll(s, &end, 10);
+    while (*end == ' ' || *end == '\t') end++;
+    if (end == s || *end || errno) test_fail(t, "integer expression expected", s);
+    return value;
+}
+
+static int test_unary(struct test_state *t, char op, const char *arg) {
+    struct stat st;
+
+    switch (op) {
+    case 'n': return *arg != '\0';
+    case 'z': return *arg == '\0';
+    case 't': return isatty((int)test_integer(t, arg));
+    case 'r': return faccessat(AT_FDCWD, arg, R_OK, AT_EACCESS) == 0;
+    case 'w': return faccessat(AT_FDCWD, arg, W_OK, AT_EACCESS) == 0;
+    case 'x': return faccessat(AT_FDCWD, arg, X_OK, AT_EACCESS) == 0;
+    case 'h': case 'L': return lstat(arg, &st) == 0 && S_ISLNK(st.st_mode);
+    }
+    if (stat(arg, &st) != 0) return 0;
+    switch (op) {
+    case 'b': return S_ISBLK(st.st_mode);
+    case 'c': return S_ISCHR(st.st_mode);
+    case 'd': return S_ISDIR(st.st_mode);
+    case 'f': return S_ISREG(st.st_mode);
+    case 'p': return S_ISFIFO(st.st_mode);
+    case 'S': return S_ISSOCK(st.st_mode);
+    case 's': return st.st_size > 0;
+    case 'g': return (st.st_mode & S_ISGID) != 0;
+    case 'u': return (st.st_mode & S_ISUID) != 0;
+    case 'k': return (st.st_mode & S_ISVTX) != 0;
+    case 'O': return st.st_uid == geteuid();
+    case 'G': return st.st_gid == getegid();
+    default: return 1;      // -e
+    }
+}
+
+static int newer(const struct stat *a, const struct stat *b) {
+    return a->st_mtim.tv_sec > b->st_mtim.tv_sec ||
+           (a->st_mtim.tv_sec == b->st_mtim.tv_sec && a->st_mtim.tv_nsec > b->st_mtim.tv_nsec);
+}
+
+static int test_binary(struct test_state *t, const char *a, const char *op, const char *b) {
+    if (op[0] != '-') {
+        int cmp = strcmp(a, b);
+        if (op[0] == '<') return cmp < 0;
+        if (op[0] == '>') return cmp > 0;
+        return op[0] == '!' ? cmp != 0 : cmp == 0;
+    }
+    if (op[1] == 'n' || op[1] == 'o' || (op[1] == 'e' && op[2] == 'f')) {
+        struct stat sa, sb;
+        int ha = stat(a, &sa) == 0;
+        int hb = stat(b, &sb) == 0;
+        // a file that exists is newer than one that does not
+        if (op[1] == 'n') return ha && (!hb || newer(&sa, &sb));
+        if (op[1] == 'o') return hb && (!ha || newer(&sb, &sa));
+        return ha && hb && sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+    }
+    long long x = test_integer(t, a);
+    long long y = test_integer(t, b);
+    switch (op[1] * 256 + op[2]) {
+    case 'e' * 256 + 'q': return x == y;
+    case 'n' * 256 + 'e': return x != y;
+    case 'l' * 256 + 't': return x < y;
+    case 'l' * 256 + 'e': return x <= y;
+    case 'g' * 256 + 't': return x > y;
+    default: return x >= y;     // -ge
+    }
+}
+
+static int test_or(struct test_state *t);
+
+// primary: ( expr ) | -op arg | arg op arg | arg
+static int test_primary(struct test_state *t) {
+    char **a = t->argv + t->pos;
+    int left = t->argc - t->pos;
+
+    if (left <= 0) return test_fail(t, "argument expected", NULL);
+    if (left >= 3 && is_binary_op(a[1])) {
+        t->pos += 3;
+        return test_binary(t, a[0], a[1], a[2]);
+    }
+    if (strcmp(a[0], "(") == 0) {
+        t->pos++;
+        int value = test_or(t);
+        if (t->pos >= t->argc || strcmp(t->argv[t->pos], ")") != 0) {
+            return test_fail(t, "`)' expected", NULL);
+        }
+        t->pos++;
+        return value;
+    }
+    if (left >= 2 && is_unary_op(a[0])) {
+        t->pos += 2;
+        return test_unary(t, a[0][1], a[1]);
+    }
+    t->pos++;
+    return *a[0] != '\0';
+}
+
+static int test_not(struct test_state *t) {
+    if (t->pos < t->argc && strcmp(t->argv[t->pos], "!") == 0) {
+        t->pos++;
+        return !test_not(t);
+    }
+    return test_primary(t);
+}
+
+static int test_and(struct test_state *t) {
+    int value = test_not(t);
+    while (t->pos < t->argc && strcmp(t->argv[t->pos], "-a") == 0) {
+        t->pos++;
+        value = test_not(t) && value;
+    }
+    return value;
+}
+
+static int test_or(struct test_state *t) {
+    int value = test_and(t);
+    while (t->pos < t->argc && strcmp(t->argv[t->pos], "-o") == 0) {
+        t->pos++;
+        value = test_and(t) || value;
+    }
+    return value;
+}
+
+// POSIX decides up to four arguments by their number, so "test -n" and
+// "test ! = x" mean what they say; longer expressions are parsed with
+// -a binding tighter than -o
+static int test_expr(struct test_state *t, int start) {
+    char **a = t->argv + start;
+    int n = t->argc - start;
+
+    t->pos = start;
+    switch (n) {
+    case 0:
+        return 0;
+    case 1:
+        t->pos++;
+        return *a[0] != '\0';
+    case 2:
+        if (strcmp(a[0], "!") == 0) {
+            t->pos += 2;
+            return *a[1] == '\0';
+        }
+        if (!is_unary_op(a[0])) {
+            t->pos = t->argc;
+            return test_fail(t, "unary operator expected", a[0]);
+        }
+        break;
+    case 3:
+        if (is_binary_op(a[1])) {
+            t->pos += 3;
+            return test_binary(t, a[0], a[1], a[2]);
+        }
+        if (strcmp(a[1], "-a") == 0 || strcmp(a[1], "-o") == 0) {
+            t->pos += 3;
+            return a[1][1] == 'a' ? *a[0] && *a[2] : *a[0] || *a[2];
+        }
+        if (strcmp(a[0], "!") == 0) return !test_expr(t, start + 1);
+        if (strcmp(a[0], "(") == 0 && strcmp(a[2], ")") == 0) {
+            t->pos += 3;
+            return *a[1] != '\0';
+        }
+        break;
+    case 4:
+        if (strcmp(a[0], "!") == 0) return !test_expr(t, start + 1);
+        if (strcmp(a[0], "(") == 0 && strcmp(a[3], ")") == 0) {
+            // the inner expression ends before the ")"
+            t->argc--;
+            int value = test_expr(t, start + 1);
+            t->argc++;
+            if (t->pos == t->argc - 1) t->pos++;
+            return value;
+        }
+        break;
+    }
+    return test_or(t);
+}
+
+int builtin_test(char **args) {
+    struct test_state t = {args[0], args + 1, 0, 0, 0};
+
+    while (t.argv[t.argc]) t.argc++;
+    if (strcmp(args[0], "[") == 0) {
+        if (t.argc == 0 || strcmp(t.argv[t.argc - 1], "]") != 0) {
+            fprintf(stderr, "[: missing `]'\n");
+            return 2;
+        }
+        t.argc--;
+    }
+
+    int value = test_expr(&t, 0);
+    if (!t.error && t.pos < t.argc) test_fail(&t, "too many arguments", NULL);
+    return t.error ? 2 : !value;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+UTILITIES MODULE EXPLANATION:
+echo, printf, test, [, true, false and pwd exist as programs in /bin, but
+scripts run them so often that starting a process for each is most of
+their run time: fork and exec of /bin/echo take about a millisecond, the
+builtin a fraction of a microsecond. These builtins behave like bash's.
+":" is another name for true (builtins.def).
+
+BUFFERED OUTPUT:
+The builtins write with stdio into stdout's buffer, which belongs to the
+shell, instead of calling write() per string. The buffer is written out
+(see builtin_output_setup() in builtins.c):
+- before a program is started (launch_command() and every fork()), so
+  output stays in order with the programs'
+- after each builtin when stderr is the same file as stdout, so error
+  messages cannot overtake earlier output
+- after a builtin that ran redirected or in a pipeline (run_builtin_io()
+  in pipeline.c), before the shell's descriptors are restored
+- when the shell exits
+A loop of echo into a file or a pipe therefore costs one write() per few
+kilobytes of output.
+
+ECHO:
+"echo [-neE] words": -n drops the final newline, -e replaces backslash
+escapes (\n, \t, \\, \0nnn, \xHH, ...), -E turns that off again. An
+argument like "-x" or "--" is printed, as bash does. "\c" ends all output.
+
+PRINTF:
+The format's %d %i %o %u %x %X (64-bit integers), %e %f %g %a (doubles),
+%s %c %b and %% directives take flags, a width and a precision, "*" taking
+them from the arguments. A directive is handed to the C library's printf()
+with "ll" added for integers. %b prints its argument with echo -e's
+escapes. The format is used again while arguments are left; a missing
+argument counts as "" or 0. A number may be written as 'c, the code of c.
+
+TEST AND [:
+Return 0 when the expression is true, 1 when it is false and 2 after a
+syntax error. With up to four arguments POSIX decides the meaning by their
+count ("test -n" is true: "-n" is a non-empty string). Longer expressions
+are parsed by recursive descent:
+    or      := and { "-o" and }
+    and     := not { "-a" not }
+    not     := "!" not | primary
+    primary := "(" or ")" | unary-op word | word binary-op word | word
+Unary operators test strings (-n -z) and files (-e -f -d -r -w -x -s -L
+...); binary operators compare strings (= == != < >), integers (-eq -ne
+-lt -le -gt -ge) and files (-nt -ot -ef).
+
+EXTERNAL FUNCTIONS USED:
+- getcwd(buf, size): the current directory's absolute path
+- stat(path, &st) / lstat(path, &st): file type, size, mode and times;
+  lstat() does not follow a symbolic link
+- faccessat(AT_FDCWD, path, mode, AT_EACCESS): whether the shell may read,
+  write or execute a file, checked with its effective user like test(1)
+- strtoll(s, &end, base) / strtod(s, &end): parse numbers; end shows where
+  the number stopped
+- open_memstream(&buf, &size): a FILE writing into memory, used to expand
+  a %b argument before it is padded
+*/
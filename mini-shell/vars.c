@@ -0,0 +1,451 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "shell.h"
+
+extern char **environ;
+
+#define VAR_EXPORTED 0x01   // part of the environment of launched programs
+#define VAR_BORROWED 0x02   // entry points into the environment we started with
+
+// Entries are allocated in steps of this many bytes, so a value that grows
+// a little ("9" to "10") still fits where it is
+#define ENTRY_ROUND 32
+
+struct var {
+    char *entry;        // "NAME=value", NULL for an empty slot
+    size_t name_len;
+    size_t size;        // bytes allocated for entry; 0 when borrowed
+    unsigned flags;
+};
+
+static struct var *table = NULL;
+static size_t table_cap = 0;     // always a power of two
+static size_t table_used = 0;
+
+// Packed environment for exec: the exported entries, NULL-terminated.
+// Rebuilt by vars_environ() only after an exported variable changed.
+static char **envp = NULL;
+static size_t envp_cap = 0;
+static size_t exported = 0;
+static int envp_dirty = 1;
+
+static size_t hash_name(const char *s, size_t len) {
+    // FNV-1a
+    size_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static struct var *find_slot(struct var *t, size_t cap, const char *name, size_t len) {
+    size_t i = hash_name(name, len) & (cap - 1);
+
+    while (t[i].entry && !(t[i].name_len == len && memcmp(t[i].entry, name, len) == 0)) {
+        i = (i + 1) & (cap - 1);
+    }
+    return &t[i];
+}
+
+static int grow_table(void) {
+    size_t new_cap = table_cap ? table_cap * 2 : 64;
+    struct var *new_table = calloc(new_cap, sizeof(*new_table));
+    if (!new_table) return -1;
+
+    for (size_t i = 0; i < table_cap; i++) {
+        if (table[i].entry) {
+            *find_slot(new_table, new_cap, table[i].entry, table[i].name_len) = table[i];
+        }
+    }
+    free(table);
+    table = new_table;
+    table_cap = new_cap;
+    return 0;
+}
+
+size_t var_name_len(const char *s) {
+    size_t n = 0;
+
+    if (!((s[0] >= 'a' && s[0] <= 'z') || (s[0] >= 'A' && s[0] <= 'Z') || s[0] == '_')) {
+        return 0;
+    }
+    while ((s[n] >= 'a' && s[n] <= 'z') || (s[n] >= 'A' && s[n] <= 'Z') ||
+           (s[n] >= '0' && s[n] <= '9') || s[n] == '_') {
+        n++;
+    }
+    return n;
+}
+
+// The variables start as the environment the shell was given. The entries
+// are borrowed, not copied: a string is only duplicated when it changes.
+static int import_environ(void) {
+    if (table_cap == 0 && grow_table() != 0) return -1;
+
+    for (char **e = environ; e && *e; e++) {
+        size_t len = var_name_len(*e);
+        if (len == 0 || (*e)[len] != '=') continue;     // not a shell name
+
+        if ((table_used + 1) * 4 > table_cap * 3 && grow_table() != 0) return -1;
+        struct var *v = find_slot(table, table_cap, *e, len);
+        if (v->entry) continue;         // the first definition wins
+        v->entry = *e;
+        v->name_len = len;
+        v->size = 0;
+        v->flags = VAR_EXPORTED | VAR_BORROWED;
+        table_used++;
+        exported++;
+    }
+    return 0;
+}
+
+// Returns the variable's slot, or NULL when it is not set
+static struct var *lookup(const char *name, size_t len) {
+    if (table_cap == 0 && import_environ() != 0) return NULL;
+
+    struct var *v = find_slot(table, table_cap, name, len);
+    return v->entry ? v : NULL;
+}
+
+const char *var_get(const char *name) {
+    size_t len = strlen(name);
+    struct var *v = lookup(name, len);
+    return v ? v->entry + len + 1 : NULL;
+}
+
+// Frees an entry that was replaced or unset. Once vars_environ() ran,
+// environ is envp and may still point at the string, so a dirty array is
+// rebuilt first: getenv() in the shell never reads a freed entry.
+static void free_entry(char *entry) {
+    if (envp_dirty && envp && environ == envp) vars_environ();
+    free(entry);
+}
+
+// Stores entry ("NAME=value", malloc'd, size bytes) for the name of its
+// first len bytes, keeping the exported flag of a variable that already
+// exists
+static int store(char *entry, size_t len, size_t size) {
+    if (table_cap == 0 && import_environ() != 0) return -1;
+    if ((table_used + 1) * 4 > table_cap * 3 && grow_table() != 0) return -1;
+
+    struct var *v = find_slot(table, table_cap, entry, len);
+    char *old = NULL;
+    if (v->entry) {
+        if (!(v->flags & VAR_BORROWED)) old = v->entry;
+        v->flags &= ~VAR_BORROWED;
+        if (v->flags & VAR_EXPORTED) envp_dirty = 1;
+    } else {
+        v->name_len = len;
+        v->flags = 0;
+        table_used++;
+    }
+    v->entry = entry;
+    v->size = size;
+    if (old) free_entry(old);
+    return 0;
+}
+
+// Sets the variable called name (len bytes) to value. A string of its own
+// that is big enough is overwritten in place, so a loop that sets the same
+// variables round after round allocates nothing. The environment array
+// points at the same string and needs no rebuild.
+static int set_value(const char *name, size_t len, const char *value) {
+    size_t value_len = strlen(value);
+    size_t need = len + value_len + 2;
+    struct var *v = lookup(name, len);
+
+    if (v && v->size >= need) {
+        memmove(v->entry + len + 1, value, value_len + 1);
+        return 0;
+    }
+
+    size_t size = (need + ENTRY_ROUND - 1) & ~(size_t)(ENTRY_ROUND - 1);
+    char *entry = malloc(size);
+    if (!entry) return -1;
+    memcpy(entry, name, len);
+    entry[len] = '=';
+    memcpy(entry + len + 1, value, value_len + 1);
+    if (store(entry, len, size) != 0) {
+        free(entry);
+        return -1;
+    }
+    return 0;
+}
+
+int var_assign(const char *entry) {
+    size_t len = var_name_len(entry);
+    if (len == 0 || entry[len] != '=') return -1;
+    return set_value(entry, len, entry + len + 1);
+}
+
+int var_set(const char *name, const char *value) {
+    return set_value(name, strlen(name), value);
+}
+
+// Marks a set variable exported (on = 1) or not (on = 0)
+static void set_exported(struct var *v, int on) {
+    if (!!(v->flags & VAR_EXPORTED) == on) return;
+
+    if (on) {
+        v->flags |= VAR_EXPORTED;
+        exported++;
+    } else {
+        v->flags &= ~VAR_EXPORTED;
+        exported--;
+    }
+    envp_dirty = 1;
+}
+
+void var_unset(const char *name) {
+    size_t len = strlen(name);
+    struct var *v = lookup(name, len);
+    if (!v) return;
+
+    set_exported(v, 0);
+    char *old = v->flags & VAR_BORROWED ? NULL : v->entry;
+    v->entry = NULL;
+    table_used--;
+
+    // re-insert the rest of the probe cluster so lookups still find it
+    size_t i = (size_t)(v - table);
+    for (i = (i + 1) & (table_cap - 1); table[i].entry; i = (i + 1) & (table_cap - 1)) {
+        struct var moved = table[i];
+        table[i].entry = NULL;
+        *find_slot(table, table_cap, moved.entry, moved.name_len) = moved;
+    }
+    if (old) free_entry(old);
+}
+
+char **vars_environ(void) {
+    if (table_cap == 0 && import_environ() != 0) return environ;
+    if (!envp_dirty) return envp;
+
+    if (exported + 1 > envp_cap) {
+        size_t new_cap = envp_cap ? envp_cap : 64;
+        while (new_cap < exported + 1) new_cap *= 2;
+        char **grown = realloc(envp, new_cap * sizeof(*grown));
+        if (!grown) return environ;
+        envp = grown;
+        envp_cap = new_cap;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < table_cap; i++) {
+        if (table[i].entry && (table[i].flags & VAR_EXPORTED)) envp[n++] = table[i].entry;
+    }
+    envp[n] = NULL;
+    envp_dirty = 0;
+    // getenv() in the shell itself sees the same variables as its children
+    environ = envp;
+    return envp;
+}
+
+char **vars_environ_with(char **assigns) {
+    char **base = vars_environ();
+    size_t nbase = 0, nassigns = 0;
+
+    while (base[nbase]) nbase++;
+    while (assigns[nassigns]) nassigns++;
+
+    char **env = malloc((nbase + nassigns + 1) * sizeof(*env));
+    if (!env) return NULL;
+
+    // "NAME=value cmd": the assignment replaces an exported NAME
+    size_t n = 0;
+    for (size_t i = 0; i < nbase; i++) {
+        size_t len = strchr(base[i], '=') - base[i];
+        int replaced = 0;
+        for (size_t a = 0; a < nassigns && !replaced; a++) {
+            replaced = strncmp(assigns[a], base[i], len + 1) == 0;
+        }
+        if (!replaced) env[n++] = base[i];
+    }
+    // of "A=1 A=2 cmd" the last one counts
+    for (size_t a = 0; a < nassigns; a++) {
+        size_t len = strchr(assigns[a], '=') - assigns[a];
+        int later = 0;
+        for (size_t b = a + 1; b < nassigns && !later; b++) {
+            later = strncmp(assigns[a], assigns[b], len + 1) == 0;
+        }
+        if (!later) env[n++] = assigns[a];
+    }
+    env[n] = NULL;
+    return env;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// "export" alone: every exported variable, sorted, in a form the shell
+// can read back
+static int print_exported(void) {
+    char **env = vars_environ();
+    size_t n = 0;
+
+    while (env[n]) n++;
+    char **sorted = malloc((n + 1) * sizeof(*sorted));
+    if (!sorted) {
+        perror("export");
+        return 1;
+    }
+    memcpy(sorted, env, n * sizeof(*sorted));
+    qsort(sorted, n, sizeof(*sorted), compare_entries);
+
+    for (size_t i = 0; i < n; i++) {
+        const char *eq = strchr(sorted[i], '=');
+        printf("export %.*s='", (int)(eq - sorted[i]), sorted[i]);
+        for (const char *c = eq + 1; *c; c++) {
+            if (*c == '\'') {
+                fputs("'\\''", stdout);
+            } else {
+                putchar(*c);
+            }
+        }
+        printf("'\n");
+    }
+    free(sorted);
+    return 0;
+}
+
+int builtin_export(char **args) {
+    int on = 1;
+    int status = 0;
+    int i = 1;
+
+    if (args[i] && strcmp(args[i], "-n") == 0) {
+        on = 0;
+        i++;
+    }
+    if (!args[i]) return on ? print_exported() : 0;
+
+    for (; args[i]; i++) {
+        size_t len = var_name_len(args[i]);
+        if (len == 0 || (args[i][len] != '=' && args[i][len] != '\0')) {
+            fprintf(stderr, "export: `%s': not a valid identifier\n", args[i]);
+            status = 1;
+            continue;
+        }
+        if (args[i][len] == '=' && var_assign(args[i]) != 0) {
+            perror("export");
+            status = 1;
+            continue;
+        }
+
+        struct var *v = lookup(args[i], len);
+        if (!v && on) {
+            // "export NAME" before NAME is set exports it as empty
+            char *entry = malloc(len + 2);
+            if (!entry) {
+                perror("export");
+                return 1;
+            }
+            memcpy(entry, args[i], len);
+            memcpy(entry + len, "=", 2);
+            if (store(entry, len, len + 2) != 0) {
+                free(entry);
+                perror("export");
+                return 1;
+            }
+            v = lookup(args[i], len);
+        }
+        if (v) set_exported(v, on);
+    }
+    return status;
+}
+
+int builtin_unset(char **args) {
+    int status = 0;
+
+    for (int i = 1; args[i]; i++) {
+        size_t len = var_name_len(args[i]);
+        if (len == 0 || args[i][len] != '\0') {
+            fprintf(stderr, "unset: `%s': not a valid identifier\n", args[i]);
+            status = 1;
+            continue;
+        }
+        var_unset(args[i]);
+    }
+    return status;
+}
+
+/*
+===============================================================================
+                        DEVELOPER DOCUMENTATION
+===============================================================================
+
+VARIABLES MODULE EXPLANATION:
+Keeps the shell's variables and builds the environment its programs get.
+    NAME=value          set a shell variable (parser.c marks the word)
+    export NAME=value   set it and pass it to every program started later
+    export -n NAME      stop passing it on; "export" alone lists them
+    unset NAME          forget it
+    NAME=value cmd      pass it to this one command only (pipeline.c)
+$NAME and ${NAME} are replaced by the values in expand.c.
+
+DATA STRUCTURE:
+An open-addressing hash table of struct var, built like the path cache
+(pathcache.c): a power-of-two capacity, linear probing, doubling at 3/4
+full, and re-inserting the rest of a probe cluster after a deletion.
+Each variable is stored as one string "NAME=value", the exact form execve()
+wants in the environment, so passing a variable on never copies it.
+
+STARTUP: COPY ON WRITE
+The first lookup imports the environment the shell was started with. The
+table entries point at the original strings (VAR_BORROWED); only a variable
+that is changed gets a string of its own. The import happens on first use,
+so the benchmarks and any other program linking this module need no setup.
+
+SETTING A VARIABLE AGAIN:
+A string the table allocated itself is rounded up to ENTRY_ROUND bytes
+and its size kept. Setting the variable again writes the new value into
+the same string when it fits, which is the usual case in a loop
+("for i in ...", "X=$i"): no malloc() and free() per round. Since the
+string does not move, an exported variable changed this way does not
+even dirty the environment array below.
+
+THE ENVIRONMENT OF LAUNCHED PROGRAMS:
+posix_spawn() and execve() take the environment as a NULL-terminated array
+of "NAME=value" pointers. Building that array means walking the whole
+table, so vars_environ() keeps the last one and only rebuilds it when an
+exported variable was set, exported or removed since (envp_dirty).
+A script that sets a few variables and then runs thousands of commands
+builds the array once; each launch just passes the same pointer.
+Changing a variable that is not exported never dirties the array.
+
+FUNCTION IMPLEMENTATIONS:
+
+1. const char *var_get(const char *name)
+   RETURN VALUE: the value, or NULL when the variable is not set. The
+   string belongs to the table and is valid until the variable changes.
+
+2. int var_set(const char *name, const char *value)
+   int var_assign(const char *entry)
+   PURPOSE: Set a variable from a name and a value, or from "NAME=value".
+   An exported variable stays exported.
+   RETURN VALUE: 0, or -1 for an invalid name or when memory runs out
+
+3. void var_unset(const char *name)
+   PURPOSE: Removes a variable (and its slot in the environment)
+
+4. char **vars_environ(void)
+   PURPOSE: The environment for exec, rebuilt only when it changed. It also
+   becomes the C library's environ, so getenv() in the shell agrees with
+   what its programs see. Because environ shares the table's strings, an
+   entry is only freed after a dirty array was rebuilt without it
+   (free_entry()).
+
+5. char **vars_environ_with(char **assigns)
+   PURPOSE: For "A=1 B=2 cmd": a malloc'd copy of the environment with the
+   given "NAME=value" strings added or replacing exported ones. The caller
+   frees the array (not the strings).
+
+6. size_t var_name_len(const char *s)
+   PURPOSE: Length of the variable name at the start of s (letters, digits
+   and '_', not starting with a digit), 0 if s does not start with one
+
+7. int builtin_export(char **args), int builtin_unset(char **args)
+   PURPOSE: The "export" and "unset" builtins; an invalid name is reported
+   and makes the status 1, the other arguments are still handled
+*/